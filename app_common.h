@@ -41,4 +41,27 @@
  */
 #define DEVICE_NAME_MAX_LENGTH              (20)
 
+/* User NVM layout, in words from &nvm_start_address, for the &nvm_size of
+ * the keyr files
+ */
+#define NVM_SIZE_WORDS                      (128)
+
+/* Ephemeral ID key and the counter to start from, written when the beacon
+ * is provisioned and read together. The beacon keeps the counter it has
+ * reached in the store.
+ */
+#define NVM_OFFSET_EID_KEY                  (0)
+#define NVM_EID_KEY_WORDS                   (8)
+#define NVM_OFFSET_EID_COUNTER              (NVM_OFFSET_EID_KEY + \
+                                             NVM_EID_KEY_WORDS)
+#define NVM_EID_COUNTER_WORDS               (3)
+
+/* Store of the records the beacon writes itself, to the end of the user
+ * NVM (beacon_store.h)
+ */
+#define NVM_OFFSET_STORE                    (NVM_OFFSET_EID_COUNTER + \
+                                             NVM_EID_COUNTER_WORDS)
+#define NVM_STORE_WORDS                     (NVM_SIZE_WORDS - \
+                                             NVM_OFFSET_STORE)
+
 #endif /* __APP_COMMON_H__ */
@@ -5,7 +5,11 @@
  *      app_debug.c
  *
  *  DESCRIPTION
- *      This file contains implementation of the debug functions
+ *      This file contains implementation of the debug log. Records are
+ *      copied into a RAM ring and handed to the UART a buffer at a time;
+ *      the UART sends them while the CPU sleeps and asks for the next
+ *      buffer once it is done. Nothing waits for the UART, so logging does
+ *      not move the radio or the sleep pattern.
  *
  *****************************************************************************/
 
@@ -13,9 +17,9 @@
  *  SDK Header Files
  *============================================================================*/
 
-#include <debug.h>
 #include <types.h>
-#include <gatt_uuid.h>
+#include <timer.h>
+#include <uart.h>
 
 /*============================================================================*
  *  Local Header File
@@ -23,13 +27,54 @@
 
 #include "app_debug.h"
 
-#if DEBUG_OUTPUT_ENABLED
+#if APP_DEBUG_LOG_LEVEL > APP_DEBUG_LEVEL_NONE
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define LOG_INDEX_MASK                  (APP_DEBUG_LOG_WORDS - 1)
+
+/* UART buffer sizes; nothing is received */
+#define UART_RX_BUFFER_SIZE             (BUFFER_SIZE_32)
+#define UART_TX_BUFFER_SIZE             (BUFFER_SIZE_64)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Records not yet handed to the UART */
+    uint16 log[APP_DEBUG_LOG_WORDS];
+
+    /* Free running write and send positions */
+    uint16 head;
+    uint16 tail;
+
+    /* Whether the UART is still sending the last buffer */
+    bool uart_busy;
+
+    /* Records lost since the log was last full */
+    uint16 dropped;
+} APP_DEBUG_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static APP_DEBUG_DATA_T g_debug;
+
+static uint16 uart_rx_buffer[UART_BUFFER_WORDS(UART_RX_BUFFER_SIZE)];
+static uint16 uart_tx_buffer[UART_BUFFER_WORDS(UART_TX_BUFFER_SIZE)];
 
 /*============================================================================*
  *  Private Function Prototypes
  *============================================================================*/
 
-static uint8 itoa(int16 value, char *str);
+static void pushRecord(debug_msg id, uint16 count, const uint16 *args);
+static void sendNext(void);
+static void uartSent(void);
 
 /*============================================================================*
  *  Private Function Implementations
@@ -37,136 +82,164 @@ static uint8 itoa(int16 value, char *str);
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      itoa
+ *      pushRecord
  *
  *  DESCRIPTION
- *      This function converts the signed integer(decimal) value
- *      into a string.
+ *      This function copies a record into the log. The caller has checked
+ *      that it fits.
  *
- *  RETURNS/MODIFIES
- *      uint8 : returns the lenth of the string.
+ *  RETURNS
+ *      Nothing.
  *
  *---------------------------------------------------------------------------*/
+static void pushRecord(debug_msg id, uint16 count, const uint16 *args)
+{
+    uint32 now = TimeGet32();
+    uint16 i;
 
-uint8 itoa(int16 value, char *str)
-{   
-    const char *digits = "0123456789abcdefghijklmnopqrstuvwxyz";
-    uint8 len = 0;
-    uint16 ulvalue = value;
-    char *p = str, *q = str;
-    char temp;
-
-    if ( value < 0)
-    {
-        *p++ = '-';
-        q = p;
-        ulvalue =-value;
-    }
-      
-    do {
-        *p++ = digits[ulvalue % 10];
-        ulvalue /= 10;
-        len++;
-    } while (ulvalue > 0);
-
-    *p-- = '\0';
+    g_debug.log[g_debug.head++ & LOG_INDEX_MASK] =
+        (count << APP_DEBUG_RECORD_ARGS_SHIFT) | (uint16)id;
+    g_debug.log[g_debug.head++ & LOG_INDEX_MASK] = (uint16)(now & 0xFFFF);
+    g_debug.log[g_debug.head++ & LOG_INDEX_MASK] = (uint16)(now >> 16);
 
-    while (q < p) 
+    for(i = 0; i < count; i++)
     {
-        temp = *q;
-        *q++ = *p;
-        *p-- = temp;
+        g_debug.log[g_debug.head++ & LOG_INDEX_MASK] = args[i];
     }
-    
-    return len;
 }
 
-/*============================================================================*
- *  Public Function Implementations
- *============================================================================*/
-
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppDebugInit
+ *      sendNext
  *
  *  DESCRIPTION
- *      This function is used to intialise debug output.
+ *      This function hands the UART as much of the log as fits in its
+ *      transmit buffer, stopping at the end of the ring. Records may be
+ *      split between buffers; the stream is contiguous on the wire.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-void AppDebugInit(void)
+static void sendNext(void)
 {
-    /* Initialise debug output */
-    DebugInit(0, NULL, NULL);
+    uint16 start = g_debug.tail & LOG_INDEX_MASK;
+    uint16 length = g_debug.head - g_debug.tail;
+
+    if(length == 0)
+    {
+        return;
+    }
+
+    if(length > APP_DEBUG_LOG_WORDS - start)
+    {
+        length = APP_DEBUG_LOG_WORDS - start;
+    }
+    if(length > UART_BUFFER_WORDS(UART_TX_BUFFER_SIZE))
+    {
+        length = UART_BUFFER_WORDS(UART_TX_BUFFER_SIZE);
+    }
+
+    if(UartWrite(&g_debug.log[start], length))
+    {
+        g_debug.tail += length;
+        g_debug.uart_busy = TRUE;
+    }
 }
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppDebugWriteBdAddress
+ *      uartSent
  *
  *  DESCRIPTION
- *      This function prints out the Bluetooth address.
+ *      This function is called by the firmware once the UART has sent the
+ *      last buffer, and passes it the next one.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-void AppDebugWriteBdAddress(TYPED_BD_ADDR_T* address)
+static void uartSent(void)
 {
-    DebugWriteUint8(WORD_MSB(address->addr.nap));
-    DebugWriteString(":");
-    DebugWriteUint8(WORD_LSB(address->addr.nap));
-    DebugWriteString(":");
-    DebugWriteUint8(address->addr.uap);
-    DebugWriteString(":");
-    DebugWriteUint8(WORD_LSB(address->addr.lap >> 16));
-    DebugWriteString(":");
-    DebugWriteUint8(WORD_MSB(address->addr.lap));
-    DebugWriteString(":");
-    DebugWriteUint8(WORD_LSB(address->addr.lap));
+    g_debug.uart_busy = FALSE;
+    sendNext();
 }
 
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppDebugWriteInt
+ *      AppDebugInit
  *
  *  DESCRIPTION
- *      This function prints out the integer value
+ *      This function is used to intialise debug output.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-void AppDebugWriteInt(int value)
+void AppDebugInit(void)
 {
-    char valueString[6];
-
-    itoa(value, valueString);
-    
-    DebugWriteString(valueString);
+    g_debug.head = 0;
+    g_debug.tail = 0;
+    g_debug.uart_busy = FALSE;
+    g_debug.dropped = 0;
+
+    /* Words are sent LSB first */
+    UartInit(NULL, uartSent,
+             uart_rx_buffer, UART_RX_BUFFER_SIZE,
+             uart_tx_buffer, UART_TX_BUFFER_SIZE,
+             uart_data_packed);
+    UartEnable(TRUE);
 }
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppDebugWriteuuid128
+ *      AppDebugRecord
  *
  *  DESCRIPTION
- *      This function prints out the 128-bit UUID
+ *      This function queues a log record and starts the UART if it is
+ *      idle. When the log is full the record is dropped and counted; the
+ *      count is logged ahead of the next record that fits.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-void AppDebugWriteUuid128(uint8* uuid)
+void AppDebugRecord(debug_msg id, uint16 count, const uint16 *args)
 {
-    int i;
-    
-    for(i = 0; i < 16; i++)
+    uint16 space = APP_DEBUG_LOG_WORDS - (g_debug.head - g_debug.tail);
+    uint16 needed = APP_DEBUG_RECORD_HEADER_WORDS + count;
+
+    if(count > APP_DEBUG_RECORD_MAX_ARGS)
+    {
+        return;
+    }
+
+    if(g_debug.dropped != 0)
+    {
+        needed += APP_DEBUG_RECORD_HEADER_WORDS + 1;
+    }
+
+    if(needed > space)
+    {
+        g_debug.dropped++;
+        return;
+    }
+
+    if(g_debug.dropped != 0)
+    {
+        pushRecord(DEBUG_MSG_DROPPED, 1, &g_debug.dropped);
+        g_debug.dropped = 0;
+    }
+    pushRecord(id, count, args);
+
+    if(!g_debug.uart_busy)
     {
-        DebugWriteUint8(uuid[i]);
+        sendNext();
     }
 }
 
-#endif /* DEBUG_OUTPUT_ENABLED */
\ No newline at end of file
+#endif /* APP_DEBUG_LOG_LEVEL > APP_DEBUG_LEVEL_NONE */
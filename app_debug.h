@@ -5,7 +5,10 @@
  *      app_debug.h
  *
  *  DESCRIPTION
- *      This file defines a debug output routines for the application
+ *      This file defines the debug log of the application. Records are
+ *      binary, a message ID from app_debug_msgs.h with its arguments, and
+ *      are queued in RAM and sent by the UART in the background, so
+ *      logging never blocks the application.
  *
  *****************************************************************************/
 
@@ -16,61 +19,136 @@
  *  SDK Header Files
  *============================================================================*/
 
-#include <bluetooth.h>
-#include <debug.h>
+#include <types.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_debug_msgs.h"
 
 /*============================================================================*
  *  Public Definitions
  *============================================================================*/
 
-/* Debug settings */
-#define DEBUG_OUTPUT_ENABLED            (TRUE)
+/* Debug settings. Release builds can set APP_DEBUG_LOG_LEVEL to
+ * APP_DEBUG_LEVEL_NONE in the project defines to remove the log entirely.
+ */
+#ifndef APP_DEBUG_LOG_LEVEL
+#define APP_DEBUG_LOG_LEVEL             (APP_DEBUG_LEVEL_INFO)
+#endif
+
+/* Size of the RAM log in words, a power of two */
+#define APP_DEBUG_LOG_WORDS             (128)
+
+/* Record layout: a header word holding the argument count and the message
+ * ID, the 32-bit TimeGet32() timestamp (LSW first) and the arguments
+ */
+#define APP_DEBUG_RECORD_ARGS_SHIFT     (11)
+#define APP_DEBUG_RECORD_ID_MASK        (0x07FF)
+#define APP_DEBUG_RECORD_HEADER_WORDS   (3)
+#define APP_DEBUG_RECORD_MAX_ARGS       (16)
 
 /*============================================================================*
- *  Public Function Prototypes
+ *  Public Data Types
  *============================================================================*/
 
-#if DEBUG_OUTPUT_ENABLED
+#define APP_DEBUG_MSG_ID(id, level, format)     id,
+#define APP_DEBUG_MSG_LEVEL(id, level, format)  id##_LEVEL = (level),
 
-/* map the macros to the debug functions */
-#define AppDebugWriteString(a)          DebugWriteString(a)
-#define AppDebugWriteUint8(a)           DebugWriteUint8(a)
-#define AppDebugWriteUint16(a)          DebugWriteUint16(a)
-#define AppDebugWriteUint32(a)          DebugWriteUint32(a)
+/* Message IDs */
+typedef enum
+{
+    APP_DEBUG_MESSAGES(APP_DEBUG_MSG_ID)
 
+    debug_msg_count
+} debug_msg;
 
-/* This function intialises the debug output */
-extern void AppDebugInit(void);
+/* Level of each message, as id##_LEVEL */
+enum
+{
+    APP_DEBUG_MESSAGES(APP_DEBUG_MSG_LEVEL)
+};
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
 
-/* Write the Bluetooth address */
-extern void AppDebugWriteBdAddress(TYPED_BD_ADDR_T* address);
+#if APP_DEBUG_LOG_LEVEL > APP_DEBUG_LEVEL_NONE
 
-/* Write integer */
-extern void AppDebugWriteInt(int value);
+/* This function intialises the debug output */
+extern void AppDebugInit(void);
 
-/* Write an error message with a status code */
-#define AppDebugWriteErrorMessage(msg, error)   \
-    DebugWriteString(msg);                      \
-    DebugWriteString(" (0x");                   \
-    DebugWriteUint16((uint16)error);            \
-    DebugWriteString(")\r\n")
+/* Queue a record of count argument words */
+extern void AppDebugRecord(debug_msg id, uint16 count, const uint16 *args);
+
+/* Log a message with up to three 16-bit arguments; the level test is
+ * resolved at compile time
+ */
+#define AppDebugLog0(id)                                                    \
+    do {                                                                    \
+        if(id##_LEVEL <= APP_DEBUG_LOG_LEVEL)                               \
+        {                                                                   \
+            AppDebugRecord((id), 0, NULL);                                  \
+        }                                                                   \
+    } while(0)
+
+#define AppDebugLog1(id, a)                                                 \
+    do {                                                                    \
+        if(id##_LEVEL <= APP_DEBUG_LOG_LEVEL)                               \
+        {                                                                   \
+            uint16 args_[1];                                                \
+            args_[0] = (uint16)(a);                                         \
+            AppDebugRecord((id), 1, args_);                                 \
+        }                                                                   \
+    } while(0)
+
+#define AppDebugLog2(id, a, b)                                              \
+    do {                                                                    \
+        if(id##_LEVEL <= APP_DEBUG_LOG_LEVEL)                               \
+        {                                                                   \
+            uint16 args_[2];                                                \
+            args_[0] = (uint16)(a);                                         \
+            args_[1] = (uint16)(b);                                         \
+            AppDebugRecord((id), 2, args_);                                 \
+        }                                                                   \
+    } while(0)
+
+#define AppDebugLog3(id, a, b, c)                                           \
+    do {                                                                    \
+        if(id##_LEVEL <= APP_DEBUG_LOG_LEVEL)                               \
+        {                                                                   \
+            uint16 args_[3];                                                \
+            args_[0] = (uint16)(a);                                         \
+            args_[1] = (uint16)(b);                                         \
+            args_[2] = (uint16)(c);                                         \
+            AppDebugRecord((id), 3, args_);                                 \
+        }                                                                   \
+    } while(0)
+
+/* Log a message with one 32-bit argument */
+#define AppDebugLogLong(id, a)                                              \
+    AppDebugLog2(id, (uint32)(a) & 0xFFFF, (uint32)(a) >> 16)
+
+/* Log a message with count words of arguments, 32-bit values LSW first */
+#define AppDebugLogWords(id, words, count)                                  \
+    do {                                                                    \
+        if(id##_LEVEL <= APP_DEBUG_LOG_LEVEL)                               \
+        {                                                                   \
+            AppDebugRecord((id), (count), (words));                         \
+        }                                                                   \
+    } while(0)
 
-/* Write 128-bit UUID */
-extern void AppDebugWriteUuid128(uint8* uuid);
-    
 #else
 
-#define AppDebugWriteString(a)
-#define AppDebugWriteUint8(a)
-#define AppDebugWriteUint16(a)
-#define AppDebugWriteUint32(a)
 #define AppDebugInit()
-#define AppDebugWriteBdAddress(a)
-#define AppDebugWriteInt(a)
-#define AppDebugWriteErrorMessage(msg, error)
-#define AppDebugWriteUuid128(a)
+#define AppDebugLog0(id)
+#define AppDebugLog1(id, a)
+#define AppDebugLog2(id, a, b)
+#define AppDebugLog3(id, a, b, c)
+#define AppDebugLogLong(id, a)
+#define AppDebugLogWords(id, words, count)
 
-#endif /* DEBUG_OUTPUT_ENABLED */
+#endif /* APP_DEBUG_LOG_LEVEL > APP_DEBUG_LEVEL_NONE */
 
 #endif /* __APP_DEBUG_H__ */
-
@@ -0,0 +1,86 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      app_debug_msgs.h
+ *
+ *  DESCRIPTION
+ *      Debug log message table. The firmware only sends the message ID and
+ *      its arguments; the format strings are used by the host decoder
+ *      (host/log_decode) and never reach the chip.
+ *
+ *      Formats take %u, %d and %x for a 16-bit argument and %lu, %ld and
+ *      %lx for a 32-bit one. IDs are positions in the table, so add new
+ *      messages at the end and do not remove old ones.
+ *
+ *****************************************************************************/
+
+#ifndef __APP_DEBUG_MSGS_H__
+#define __APP_DEBUG_MSGS_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Log levels; records above APP_DEBUG_LOG_LEVEL are compiled out */
+#define APP_DEBUG_LEVEL_NONE            (0)
+#define APP_DEBUG_LEVEL_ERROR           (1)
+#define APP_DEBUG_LEVEL_WARNING         (2)
+#define APP_DEBUG_LEVEL_INFO            (3)
+#define APP_DEBUG_LEVEL_VERBOSE         (4)
+
+/* MSG(id, level, format) */
+#define APP_DEBUG_MESSAGES(MSG)                                              \
+    MSG(DEBUG_MSG_DROPPED,          APP_DEBUG_LEVEL_WARNING,                 \
+        "%u log records dropped")                                            \
+    MSG(DEBUG_MSG_BOOT,             APP_DEBUG_LEVEL_INFO,                    \
+        "Beacon example, last sleep state %u")                               \
+    MSG(DEBUG_MSG_GATT_DB_FAILED,   APP_DEBUG_LEVEL_ERROR,                   \
+        "GATT database not added (0x%x)")                                    \
+    MSG(DEBUG_MSG_LADDER_TIER,      APP_DEBUG_LEVEL_INFO,                    \
+        "battery %u mV, ladder tier %u")                                     \
+    MSG(DEBUG_MSG_LADDER_LOW,       APP_DEBUG_LEVEL_WARNING,                 \
+        "battery low, ladder tier %u")                                       \
+    MSG(DEBUG_MSG_SCHEDULE_OPEN,    APP_DEBUG_LEVEL_INFO,                    \
+        "advertising window open, closes in %lu s")                          \
+    MSG(DEBUG_MSG_COUNTERS,         APP_DEBUG_LEVEL_INFO,                    \
+        "counters: boots %lu sleep %lu adv %lu/%lu wake %lu/%lu/%lu "        \
+        "awake %lu ms")                                                      \
+    MSG(DEBUG_MSG_ROTATION_FRAME,   APP_DEBUG_LEVEL_VERBOSE,                 \
+        "rotation frame %u")                                                 \
+    MSG(DEBUG_MSG_CONFIG_STATE,     APP_DEBUG_LEVEL_INFO,                    \
+        "configuration state %u")                                            \
+    MSG(DEBUG_MSG_CONFIG_PASSCODE_WRONG, APP_DEBUG_LEVEL_WARNING,            \
+        "wrong configuration passcode, %u tries left")                       \
+    MSG(DEBUG_MSG_CONFIG_COMMITTED, APP_DEBUG_LEVEL_INFO,                    \
+        "configuration committed, major %u minor %u")                        \
+    MSG(DEBUG_MSG_EID_NO_KEY,       APP_DEBUG_LEVEL_WARNING,                 \
+        "ephemeral IDs enabled but no key provisioned")                      \
+    MSG(DEBUG_MSG_EID_ROTATED,      APP_DEBUG_LEVEL_VERBOSE,                 \
+        "ephemeral ID counter %lu")                                          \
+    MSG(DEBUG_MSG_CONN_PARAMS,      APP_DEBUG_LEVEL_INFO,                    \
+        "connection interval %u latency %u timeout %u")                      \
+    MSG(DEBUG_MSG_CONN_PARAM_REQ,   APP_DEBUG_LEVEL_INFO,                    \
+        "connection parameter request %u")                                   \
+    MSG(DEBUG_MSG_CONN_PARAM_REJECTED, APP_DEBUG_LEVEL_WARNING,              \
+        "connection parameter request failed (0x%x)")                       \
+    MSG(DEBUG_MSG_TELEMETRY,        APP_DEBUG_LEVEL_VERBOSE,                 \
+        "telemetry: battery %u mV, temperature %d C")                       \
+    MSG(DEBUG_MSG_ADV_CHANNELS,     APP_DEBUG_LEVEL_INFO,                    \
+        "advertising channels 0x%x, %u us radio-on per iBeacon event")      \
+    MSG(DEBUG_MSG_PAYLOAD_REJECTED, APP_DEBUG_LEVEL_ERROR,                   \
+        "advertising payload of %u octets refused")                         \
+    MSG(DEBUG_MSG_CENSUS,           APP_DEBUG_LEVEL_INFO,                    \
+        "census: %u advertisers from %u reports")                           \
+    MSG(DEBUG_MSG_SCAN_FAILED,      APP_DEBUG_LEVEL_WARNING,                 \
+        "scan refused (%u)")                                                 \
+    MSG(DEBUG_MSG_SLOTS_SYNC,       APP_DEBUG_LEVEL_INFO,                    \
+        "slots: synced, error %d us, clock drift %d")                        \
+    MSG(DEBUG_MSG_SLOTS_MISSED,     APP_DEBUG_LEVEL_WARNING,                 \
+        "slots: sync beacon not heard in %u windows")                        \
+    MSG(DEBUG_MSG_BOOT_ADVERTISING, APP_DEBUG_LEVEL_INFO,                    \
+        "advertising %lu us after boot")                                     \
+    MSG(DEBUG_MSG_MOTION,           APP_DEBUG_LEVEL_INFO,                    \
+        "motion: moving %u")
+
+#endif /* __APP_DEBUG_MSGS_H__ */
@@ -15,6 +15,8 @@
 
 #include <main.h>
 #include <mem.h>
+#include <timer.h>
+#include <sleep.h>
 
 #include <gatt.h>
 #include <gatt_prim.h>
@@ -31,46 +33,139 @@
 #include "app_debug.h"
 #include "user_config.h"
 #include "gap_conn_params.h"
+#include "beacon_frame.h"
+#include "beacon_rotation.h"
+#include "beacon_payload.h"
+#include "beacon_ladder.h"
+#include "beacon_schedule.h"
+#include "beacon_counters.h"
+#include "beacon_service.h"
+#include "beacon_config.h"
+#include "beacon_eid.h"
+#include "beacon_link.h"
+#include "beacon_telemetry.h"
+#include "beacon_channels.h"
+#include "beacon_dispatch.h"
+#include "beacon_census.h"
+#include "beacon_slots.h"
+#include "beacon_store.h"
+#include "beacon_motion.h"
+#include "app_gatt_db.h"
 
 /*=============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Beacon advert size */
-#define BEACON_ADVERT_SIZE              (26)
-
 /* user key indices */
 #define BEACON_UUID_MSW_USER_KEY_IDX    (0)     /* MSW of the beacon UUID */
 #define BEACON_MAJOR_USER_KEY_IDX       (1)     /* Beacon major */
 #define BEACON_MINOR_USER_KEY_IDX       (2)     /* Beacon minor */
 #define BEACON_TX_POWER_USER_KEY_IDX    (3)     /* Beacon TX power */
+#define BEACON_ROTATION_USER_KEY_IDX    (4)     /* Frame rotation weights */
+#define BEACON_CLOCK_USER_KEY_IDX       (5)     /* Time of day at power-up */
+#define BEACON_WINDOW_USER_KEY_IDX      (6)     /* Advertising window */
+#define BEACON_OPTIONS_USER_KEY_IDX     (7)     /* Option bits */
+#define BEACON_PASSCODE_LSW_USER_KEY_IDX (8)    /* Config passcode, LSW */
+#define BEACON_PASSCODE_MSW_USER_KEY_IDX (9)    /* Config passcode, MSW */
+
+/* Option bits of user key 7 */
+#define BEACON_OPTION_EPHEMERAL_ID      (0x0001)
+#define BEACON_OPTION_SCAN_RESPONSE     (0x0002)
+#define BEACON_OPTION_CHANNELS          (0x001C)    /* channels 37 to 39, */
+#define BEACON_OPTION_CHANNELS_SHIFT    (2)         /* zero for all three */
+#define BEACON_OPTION_CENSUS            (0x0020)
+#define BEACON_OPTION_SLOTS             (0x00C0)    /* slots_mode, 3 is */
+#define BEACON_OPTION_SLOTS_SHIFT       (6)         /* taken as off */
+#define BEACON_OPTION_MOTION_PIO        (0x0F00)    /* accelerometer PIO plus */
+#define BEACON_OPTION_MOTION_PIO_SHIFT  (8)         /* one, zero for none */
+#define BEACON_OPTION_MOTION_SLEEP      (0x1000)
 
 #define BEACON_USER_KEY_DEFAULT_VALUE   (0)     /* default value */
 
+/* Maximum number of timers */
+#define MAX_APP_TIMERS                  (4)     /* task wheel, schedule,
+                                                 * connection parameter
+                                                 * requests and ephemeral
+                                                 * ID top-up */
+
+/* How late the configuration task may run, so that it can share a
+ * wake-up
+ */
+#define CONFIG_TASK_TOLERANCE           (1 * SECOND)
+
+DISPATCH_CHECK_SPAN(period, BEACON_CONFIG_PERIOD + CONFIG_TASK_TOLERANCE);
+DISPATCH_CHECK_SPAN(window, BEACON_CONFIG_WINDOW + CONFIG_TASK_TOLERANCE);
+DISPATCH_CHECK_SPAN(connection,
+                    BEACON_CONFIG_CONNECTION_TIME + CONFIG_TASK_TOLERANCE);
+
+/* Number of entries in an event table */
+#define EVENT_COUNT(table)              ((uint8)(sizeof(table) /          \
+                                                 sizeof((table)[0])))
+
 /*============================================================================*
  *  Private Data Types
  *============================================================================*/
 
-typedef struct {
-    /* Beacon UUID */
-    uint8 uuid[16];
+/* What the radio is doing */
+typedef enum
+{
+    app_state_beaconing,            /* non-connectable advertising */
+    app_state_config_fast,          /* configuration window is open,
+                                     * advertising fast */
+    app_state_config_cancelling,    /* configuration window is closing */
+    app_state_connected,            /* a client is configuring the beacon */
+    app_state_disconnecting,        /* the connection is being dropped */
+    app_state_config_slowing,       /* moving to slow advertising */
+    app_state_config_slow           /* configuration window is open,
+                                     * advertising slowly */
+} app_state;
 
-    /* Beacon major */
-    uint16 major;
+typedef struct {
+    /* Beacon advertising frame, holding the UUID, major, minor and TX
+     * power
+     */
+    uint8 advData[BEACON_FRAME_SIZE];
 
-    /* Beacon minor */
-    uint16 minor;
-    
-    /* Beacon TX power */
+    /* Beacon TX power measured at BEACON_TX_POWER_REFERENCE_LEVEL, before
+     * the battery ladder adjusts it
+     */
     int8 txPower;
+
+    /* Whether the major and minor are ephemeral IDs */
+    bool eid;
+
+    /* Whether the GATT database has been added since AppInit(); only the
+     * configuration window needs it
+     */
+    bool gatt_ready;
+
+    /* Whether a still asset hibernates until it moves, rather than
+     * advertising slowly
+     */
+    bool motion_sleep;
+
+    app_state state;
+
+    /* Connection of the configuring client */
+    uint16 cid;
+
+    /* Task timing the configuration window, the connection or the time to
+     * the next window, depending on the state
+     */
+    dispatch_task config_task;
 } APP_DATA_T;
 
 /*============================================================================*
  *  Private Data
  *============================================================================*/
 
-/* application data holder */
-static APP_DATA_T g_app_data;
+/* application data holder, the frame starts out as the compile-time
+ * template from user_config.h
+ */
+static APP_DATA_T g_app_data = { BEACON_FRAME_INIT };
+
+/* Declare space for application timers */
+static uint16 app_timers[SIZEOF_APP_TIMER * MAX_APP_TIMERS];
 
 /*============================================================================*
  *  Private Function Prototypes
@@ -78,6 +173,55 @@ static APP_DATA_T g_app_data;
 
 static void startBeaconing(void);
 static void initBeacon(void);
+static void patchFrame(void);
+static void patchEid(const uint8 *eid);
+static void patchTxPower(void);
+static void storeScanResponse(void);
+static void initGatt(void);
+static void armConfigTimer(uint32 time);
+static void startConfigWindow(bool fast);
+static void configTask(void);
+static void resumeBeaconing(void);
+static void sleepUntilMoved(void);
+static void beaconTierChanged(void);
+static void beaconMotionChanged(bool moving);
+static void beaconScheduleClosed(void);
+static void beaconConfigCommitted(void);
+static void beaconEidRotated(const uint8 *eid);
+static void handleSignalBatteryLow(void *data);
+static void handleSignalPioChanged(void *data);
+static void handleSignalGattAccessInd(LM_EVENT_T *p_event_data);
+static void handleSignalGattAddDbCfm(LM_EVENT_T *p_event_data);
+static void handleSignalGattConnectCfm(LM_EVENT_T *p_event_data);
+static void handleSignalGattCancelConnectCfm(LM_EVENT_T *p_event_data);
+static void handleSignalLsConnParamUpdateCfm(LM_EVENT_T *p_event_data);
+static void handleSignalLmEvConnectionUpdate(LM_EVENT_T *p_event_data);
+static void handleSignalLmEvDisconnectComplete(LM_EVENT_T *p_event_data);
+static void handleSignalLmEvAdvertisingReport(LM_EVENT_T *p_event_data);
+
+/*============================================================================*
+ *  Event Tables
+ *============================================================================*/
+
+/* System events the application handles; the rest are ignored */
+static const DISPATCH_SYSTEM_EVENT_T g_system_events[] =
+{
+    { sys_event_battery_low,            handleSignalBatteryLow              },
+    { sys_event_pio_changed,            handleSignalPioChanged              }
+};
+
+/* LM events the application handles; the rest are ignored */
+static const DISPATCH_LM_EVENT_T g_lm_events[] =
+{
+    { GATT_ACCESS_IND,                  handleSignalGattAccessInd           },
+    { GATT_ADD_DB_CFM,                  handleSignalGattAddDbCfm            },
+    { GATT_CONNECT_CFM,                 handleSignalGattConnectCfm          },
+    { GATT_CANCEL_CONNECT_CFM,          handleSignalGattCancelConnectCfm    },
+    { LS_CONNECTION_PARAM_UPDATE_CFM,   handleSignalLsConnParamUpdateCfm    },
+    { LM_EV_CONNECTION_UPDATE,          handleSignalLmEvConnectionUpdate    },
+    { LM_EV_DISCONNECT_COMPLETE,        handleSignalLmEvDisconnectComplete  },
+    { LM_EV_ADVERTISING_REPORT,         handleSignalLmEvAdvertisingReport   }
+};
 
 /*============================================================================*
  *  Private Function Implementations
@@ -88,7 +232,9 @@ static void initBeacon(void);
  *      initBeacon
  *
  *  DESCRIPTION
- *      This function initialises beacon data
+ *      This function initialises beacon data. The user keys override the
+ *      compile-time defaults, and a configuration committed over GATT
+ *      overrides both.
  *
  *  RETURNS
  *      Nothing.
@@ -96,68 +242,229 @@ static void initBeacon(void);
  *---------------------------------------------------------------------------*/
 void initBeacon(void)
 {
-    /* read the config values from CsKeys */
-    uint16 beaconUuidMsw = CSReadUserKey(BEACON_UUID_MSW_USER_KEY_IDX);
-    uint16 beaconMajor = CSReadUserKey(BEACON_MAJOR_USER_KEY_IDX);
-    uint16 beaconMinor = CSReadUserKey(BEACON_MINOR_USER_KEY_IDX);
+    BEACON_CONFIG_T defaults;
     uint16 txPower = CSReadUserKey(BEACON_TX_POWER_USER_KEY_IDX);
-    
-    /* set up beacon UUID */
-    if(beaconUuidMsw == BEACON_USER_KEY_DEFAULT_VALUE)
+    uint16 options = CSReadUserKey(BEACON_OPTIONS_USER_KEY_IDX);
+    uint32 passcode;
+    slots_mode slots;
+    uint8 motion_pio;
+
+    /* read the config values from CsKeys */
+    defaults.uuid_msw = CSReadUserKey(BEACON_UUID_MSW_USER_KEY_IDX);
+    defaults.major = CSReadUserKey(BEACON_MAJOR_USER_KEY_IDX);
+    defaults.minor = CSReadUserKey(BEACON_MINOR_USER_KEY_IDX);
+
+    if(defaults.uuid_msw == BEACON_USER_KEY_DEFAULT_VALUE)
     {
-        g_app_data.uuid[0] = BEACON_UUID_00;
-        g_app_data.uuid[1] = BEACON_UUID_01;
+        defaults.uuid_msw = ((uint16)BEACON_UUID_00 << 8) | BEACON_UUID_01;
     }
-    else
+    if(defaults.major == BEACON_USER_KEY_DEFAULT_VALUE)
     {
-        g_app_data.uuid[0] = WORD_MSB(beaconUuidMsw);
-        g_app_data.uuid[1] = WORD_LSB(beaconUuidMsw);
+        defaults.major = BEACON_DEFAULT_MAJOR;
     }
-    
-    g_app_data.uuid[2] = BEACON_UUID_02;
-    g_app_data.uuid[3] = BEACON_UUID_03;
-    g_app_data.uuid[4] = BEACON_UUID_04;
-    g_app_data.uuid[5] = BEACON_UUID_05;
-    g_app_data.uuid[6] = BEACON_UUID_06;
-    g_app_data.uuid[7] = BEACON_UUID_07;
-    g_app_data.uuid[8] = BEACON_UUID_08;
-    g_app_data.uuid[9] = BEACON_UUID_09;
-    g_app_data.uuid[10] = BEACON_UUID_10;
-    g_app_data.uuid[11] = BEACON_UUID_11;
-    g_app_data.uuid[12] = BEACON_UUID_12;
-    g_app_data.uuid[13] = BEACON_UUID_13;
-    g_app_data.uuid[14] = BEACON_UUID_14;
-    g_app_data.uuid[15] = BEACON_UUID_15;
-
-    /* set up beacon major */
-    if(beaconMajor == BEACON_USER_KEY_DEFAULT_VALUE)
-    {
-        g_app_data.major = BEACON_DEFAULT_MAJOR;
+    if(defaults.minor == BEACON_USER_KEY_DEFAULT_VALUE)
+    {
+        defaults.minor = BEACON_DEFAULT_MINOR;
     }
-    else
+    if(txPower == BEACON_USER_KEY_DEFAULT_VALUE)
     {
-        g_app_data.major = beaconMajor;
+        txPower = (uint8)BEACON_DEFAULT_TX_POWER;
     }
-    
-    /* set up beacon minor */
-    if(beaconMinor == BEACON_USER_KEY_DEFAULT_VALUE)
+    defaults.tx_power = (int8)WORD_LSB(txPower);
+
+    /* the passcode is the device's own; there is no default */
+    passcode = ((uint32)CSReadUserKey(BEACON_PASSCODE_MSW_USER_KEY_IDX) << 16) |
+               CSReadUserKey(BEACON_PASSCODE_LSW_USER_KEY_IDX);
+    ConfigInit(&defaults, passcode, beaconConfigCommitted);
+
+    slots = (slots_mode)((options & BEACON_OPTION_SLOTS) >>
+                         BEACON_OPTION_SLOTS_SHIFT);
+    if(slots > slots_mode_sync)
+    {
+        slots = slots_mode_off;
+    }
+    SlotsInit(slots);
+
+    /* a sync beacon keeps the frame for the others, moving or not, and a
+     * scheduled beacon would lose the time of day by hibernating
+     */
+    motion_pio = (uint8)((options & BEACON_OPTION_MOTION_PIO) >>
+                         BEACON_OPTION_MOTION_PIO_SHIFT);
+    if(motion_pio == 0 || slots == slots_mode_sync)
     {
-        g_app_data.minor = BEACON_DEFAULT_MINOR;
+        motion_pio = MOTION_PIO_NONE;
     }
     else
     {
-        g_app_data.minor = beaconMinor;
+        motion_pio--;
     }
+    MotionInit(motion_pio, beaconMotionChanged);
+    g_app_data.motion_sleep = (options & BEACON_OPTION_MOTION_SLEEP) &&
+                              CSReadUserKey(BEACON_CLOCK_USER_KEY_IDX) == 0;
 
-    /* set up the TX power */
-    if(txPower == BEACON_USER_KEY_DEFAULT_VALUE)
+    /* a sync beacon advertises nothing but the sync frame, so it has no
+     * identity to hide
+     */
+    g_app_data.eid = FALSE;
+    if((options & BEACON_OPTION_EPHEMERAL_ID) && slots != slots_mode_sync)
+    {
+        g_app_data.eid = EidInit(beaconEidRotated);
+    }
+
+    /* the controller keeps the scan response through every restart of
+     * advertising
+     */
+    if(options & BEACON_OPTION_SCAN_RESPONSE)
+    {
+        storeScanResponse();
+    }
+
+    ChannelsInit((uint8)((options & BEACON_OPTION_CHANNELS) >>
+                         BEACON_OPTION_CHANNELS_SHIFT));
+
+    patchFrame();
+
+    /* the census count lengthens the TLM frame, so it is set up before the
+     * rotation takes the frame
+     */
+    if(options & BEACON_OPTION_CENSUS)
+    {
+        CensusInit();
+    }
+
+    /* serialise the frames to rotate through, the iBeacon frame included */
+    RotationInit(g_app_data.advData,
+                 CSReadUserKey(BEACON_ROTATION_USER_KEY_IDX));
+    if(g_app_data.eid)
+    {
+        RotationSetEid(EidCurrent());
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      patchFrame
+ *
+ *  DESCRIPTION
+ *      This function patches the configuration in use into the frame, with
+ *      the ephemeral ID in place of the major and minor if there is one.
+ *      Every field is rewritten so that the frame is also correct after an
+ *      HCI reset, when the initialised data is not reloaded.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void patchFrame(void)
+{
+    const BEACON_CONFIG_T *config = ConfigGet();
+
+    BEACON_FRAME_SET_WORD(g_app_data.advData, BEACON_FRAME_UUID_OFFSET,
+                          config->uuid_msw);
+    if(g_app_data.eid)
     {
-        g_app_data.txPower = BEACON_DEFAULT_TX_POWER;
+        patchEid(EidCurrent());
     }
     else
     {
-        g_app_data.txPower = txPower;
+        BEACON_FRAME_SET_WORD(g_app_data.advData, BEACON_FRAME_MAJOR_OFFSET,
+                              config->major);
+        BEACON_FRAME_SET_WORD(g_app_data.advData, BEACON_FRAME_MINOR_OFFSET,
+                              config->minor);
+    }
+
+    g_app_data.txPower = (int8)config->tx_power;
+    patchTxPower();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      patchEid
+ *
+ *  DESCRIPTION
+ *      This function patches the first four octets of an ephemeral ID into
+ *      the major and minor.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void patchEid(const uint8 *eid)
+{
+    uint8 i;
+
+    for(i = 0; i < 4; i++)
+    {
+        g_app_data.advData[BEACON_FRAME_MAJOR_OFFSET + i] = eid[i];
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      patchTxPower
+ *
+ *  DESCRIPTION
+ *      This function patches the TX power of the battery ladder tier into
+ *      the frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void patchTxPower(void)
+{
+    g_app_data.advData[BEACON_FRAME_TX_POWER_OFFSET] =
+        (uint8)LadderTxPower(g_app_data.txPower);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      storeScanResponse
+ *
+ *  DESCRIPTION
+ *      This function builds the scan response and stores it with the
+ *      controller. The name is sent shortened if it does not fit.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void storeScanResponse(void)
+{
+    static const char name[] = BEACON_DEVICE_NAME;
+    uint8 ad[SCAN_RSP_NAME_MAX + 1];
+    uint8 len = sizeof(name) - 1;
+    uint8 i;
+
+    LsStoreAdvScanData(0, NULL, ad_src_scan_rsp);
+
+    ad[0] = AD_TYPE_APPEARANCE;
+    ad[1] = WORD_LSB(BEACON_APPEARANCE);
+    ad[2] = WORD_MSB(BEACON_APPEARANCE);
+    LsStoreAdvScanData(SCAN_RSP_APPEARANCE_SIZE, ad, ad_src_scan_rsp);
+
+    ad[0] = AD_TYPE_MANUF;
+    ad[1] = WORD_LSB(SCAN_RSP_CSR_COMPANY_ID);
+    ad[2] = WORD_MSB(SCAN_RSP_CSR_COMPANY_ID);
+    ad[3] = WORD_LSB(BEACON_FIRMWARE_VERSION);
+    ad[4] = WORD_MSB(BEACON_FIRMWARE_VERSION);
+    LsStoreAdvScanData(SCAN_RSP_VERSION_SIZE, ad, ad_src_scan_rsp);
+
+    ad[0] = AD_TYPE_LOCAL_NAME_COMPLETE;
+    if(len > SCAN_RSP_NAME_MAX)
+    {
+        ad[0] = AD_TYPE_LOCAL_NAME_SHORT;
+        len = SCAN_RSP_NAME_MAX;
+    }
+    for(i = 0; i < len; i++)
+    {
+        ad[i + 1] = (uint8)name[i];
     }
+    LsStoreAdvScanData(len + 1, ad, ad_src_scan_rsp);
 }
 
 
@@ -174,9 +481,15 @@ void initBeacon(void)
  *---------------------------------------------------------------------------*/
 void startBeaconing(void)
 {
-    uint8 advData[BEACON_ADVERT_SIZE];
-    uint16 offset = 0;
-    
+    const LADDER_TIER_T *tier = LadderTier();
+    uint32 adv_interval = MotionInterval(tier->adv_interval);
+    uint32 interval = SlotsInterval(adv_interval);
+
+    g_app_data.state = app_state_beaconing;
+
+    /* advertising is off until the end, so the first frame stores at once */
+    PayloadSetAdvertising(payload_adv_off);
+
     /* set the GAP Broadcaster role */
     GapSetMode(gap_role_broadcaster,
                gap_mode_discover_no,
@@ -184,136 +497,856 @@ void startBeaconing(void)
                gap_mode_bond_no,
                gap_mode_security_none);
     
-    /* clear the existing advertisement data */
-    LsStoreAdvScanData(0, NULL, ad_src_advertise);
-
-    /* set the advertisement interval */
-    GapSetAdvInterval(BEACON_ADVERTISING_INTERVAL_MIN, BEACON_ADVERTISING_INTERVAL_MAX);
-    
-    /* store the manufacturing data */
-    advData[offset++] = AD_TYPE_MANUF;
-
-    /* Apple company code, little endian */
-    advData[offset++] = 0x4C;
-    advData[offset++] = 0x00;
+    /* set the advertisement interval and transmit power of the battery
+     * ladder tier, the interval slowed while the asset is still, on the
+     * chosen channels
+     */
+    GapSetAdvInterval(adv_interval, adv_interval);
+    LsSetTransmitPowerLevel(tier->tx_power_level);
+    ChannelsApply();
     
-    advData[offset++] = 2;         /* Magic number */
-    advData[offset++] = 0x15;      /* Length of the beacon payload */
+    /* replace the advertisement data with the first frame of the rotation,
+     * already serialised by initBeacon(), or with the sync frame for a sync
+     * beacon
+     */
+    if(SlotsMode() == slots_mode_sync)
+    {
+        RotationStop();
+        SlotsStoreSyncFrame();
+    }
+    else
+    {
+        RotationStart(interval);
+    }
     
-    /* Beacon UUID */
-    MemCopy(advData + offset, g_app_data.uuid, sizeof(g_app_data.uuid));
-    offset += sizeof(g_app_data.uuid);
+    /* Start broadcasting, in the beacon's slot once it has one */
+    if(!SlotsStart(interval, ConfigGet()->minor))
+    {
+        LsStartStopAdvertise(TRUE, whitelist_disabled, ls_addr_type_random);
+        PayloadSetAdvertising(payload_adv_restart);
+    }
+    CountersAdvStart(interval);
+}
 
-    /* Beacon major */
-    advData[offset++] = WORD_MSB(g_app_data.major);
-    advData[offset++] = WORD_LSB(g_app_data.major);
-    
-    /* Beacon minor */
-    advData[offset++] = WORD_MSB(g_app_data.minor);
-    advData[offset++] = WORD_LSB(g_app_data.minor);
 
-    /* Beacon TX Power */
-    advData[offset++] = g_app_data.txPower;
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      initGatt
+ *
+ *  DESCRIPTION
+ *      This function initialises GATT and installs the database before the
+ *      first configuration window after AppInit(). A broadcaster with no
+ *      window open never needs it, so it is kept off the way to the first
+ *      advert.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void initGatt(void)
+{
+    uint16 dbLength = 0;
+    uint16 *p_gattDb;
+
+    if(g_app_data.gatt_ready)
+    {
+        return;
+    }
 
-    /* store the advertisement data */
-    LsStoreAdvScanData(BEACON_ADVERT_SIZE, advData, ad_src_advertise);
-    
-    /* Start broadcasting */
-    LsStartStopAdvertise(TRUE, whitelist_disabled, ls_addr_type_random);
-}
+    /* Initialise GATT entity */
+    GattInit();
 
+    /* Install the GATT database; the confirmation needs no action */
+    p_gattDb = GattGetDatabase(&dbLength);
+    GattAddDatabaseReq(dbLength, p_gattDb);
+
+    g_app_data.gatt_ready = TRUE;
+}
 
-/*============================================================================*
- *  Public Function Implementations
- *============================================================================*/
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppPowerOnReset
+ *      armConfigTimer
  *
  *  DESCRIPTION
- *      This function is called just after a power-on reset (including after
- *      a firmware panic).
+ *      This function (re)starts the configuration task to run once after
+ *      the given time. A zero time leaves it stopped, which is how a zero
+ *      BEACON_CONFIG_PERIOD keeps the beacon from opening further windows.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-
-void AppPowerOnReset(void)
+static void armConfigTimer(uint32 time)
 {
-    /* empty */
+    if(time != 0)
+    {
+        DispatchStartTask(g_app_data.config_task, time, 0);
+    }
+    else
+    {
+        DispatchStopTask(g_app_data.config_task);
+    }
 }
 
+
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppInit
+ *      startConfigWindow
  *
  *  DESCRIPTION
- *      This function is called after a power-on reset (including after a
- *      firmware panic) or after an HCI Reset has been requested.
- *
- *      NOTE: In the case of a power-on reset, this function is called
- *      after AppPowerOnReset().
+ *      This function makes the beacon connectable, advertising at the fast
+ *      connection interval for the first BEACON_CONFIG_FAST_TIME of the
+ *      window and at the reduced power interval for the rest of
+ *      BEACON_CONFIG_WINDOW. Neither is faster than the battery ladder
+ *      tier allows. The frames are advertised and rotated as usual, so the
+ *      window does not interrupt the beacon.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
-
-void AppInit(sleep_state last_sleep_state)
+static void startConfigWindow(bool fast)
 {
-    /* initialise application debug */
-    AppDebugInit();
+    const LADDER_TIER_T *tier = LadderTier();
+    uint32 interval_min;
+    uint32 interval_max;
 
-    AppDebugWriteString("\r\n\r\n*****************\r\n");
-    AppDebugWriteString("Beacon example\r\n");
-    
-    /* Initialise GATT entity */
-    GattInit();
-    
-    /* Initialise beacon data */
-    initBeacon();
-    
-    /* Start beaconing */
-    startBeaconing();   
+    /* the window advertises connectably, out of the slots */
+    SlotsStop();
+    PayloadSetAdvertising(payload_adv_off);
+    initGatt();
+
+    if(fast)
+    {
+        /* a new window, with new tries at the passcode */
+        ConfigWindowOpened();
+        g_app_data.state = app_state_config_fast;
+        interval_min = FC_ADVERTISING_INTERVAL_MIN;
+        interval_max = FC_ADVERTISING_INTERVAL_MAX;
+    }
+    else
+    {
+        g_app_data.state = app_state_config_slow;
+        interval_min = RP_ADVERTISING_INTERVAL_MIN;
+        interval_max = RP_ADVERTISING_INTERVAL_MAX;
+    }
+
+    if(interval_min < tier->adv_interval)
+    {
+        interval_min = tier->adv_interval;
+    }
+    if(interval_max < tier->adv_interval)
+    {
+        interval_max = tier->adv_interval;
+    }
+    AppDebugLog1(DEBUG_MSG_CONFIG_STATE, g_app_data.state);
+
+    GapSetMode(gap_role_peripheral,
+               gap_mode_discover_no,
+               gap_mode_connect_undirected,
+               gap_mode_bond_no,
+               gap_mode_security_none);
+
+    GapSetAdvInterval(interval_min, interval_max);
+    LsSetTransmitPowerLevel(tier->tx_power_level);
+    ChannelsApplyAll();
+
+    RotationStart(interval_max);
+
+    /* Advertise connectably until a client connects or the window is
+     * cancelled. GATT runs that advertising, so the frame on air stays as
+     * it is until the window ends.
+     */
+    GattConnectReq(NULL, L2CAP_CONNECTION_SLAVE_UNDIRECTED);
+    PayloadSetAdvertising(payload_adv_held);
+    CountersAdvStart(interval_max);
+
+    if(!fast)
+    {
+        armConfigTimer(BEACON_CONFIG_WINDOW - BEACON_CONFIG_FAST_TIME);
+    }
+    else if(BEACON_CONFIG_WINDOW > BEACON_CONFIG_FAST_TIME)
+    {
+        armConfigTimer(BEACON_CONFIG_FAST_TIME);
+    }
+    else
+    {
+        armConfigTimer(BEACON_CONFIG_WINDOW);
+    }
 }
 
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppProcessSystemEvent
+ *      configTask
  *
  *  DESCRIPTION
- *      This user application function is called whenever a system event, such
- *      as a battery low notification, is received by the system.
+ *      This function is called when the configuration task falls due. It
+ *      opens the next configuration window, slows down or closes the one
+ *      that is open or drops a client that has been connected for too
+ *      long.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
+static void configTask(void)
+{
+    switch(g_app_data.state)
+    {
+        case app_state_beaconing:
+            LsStartStopAdvertise(FALSE, whitelist_disabled,
+                                 ls_addr_type_random);
+            CountersAdvStop();
+            startConfigWindow(TRUE);
+        break;
 
-void AppProcessSystemEvent(sys_event_id id, void *data)
+        case app_state_config_fast:
+            /* connectable advertising has to be restarted to change its
+             * interval
+             */
+            if(BEACON_CONFIG_WINDOW > BEACON_CONFIG_FAST_TIME)
+            {
+                g_app_data.state = app_state_config_slowing;
+            }
+            else
+            {
+                g_app_data.state = app_state_config_cancelling;
+            }
+            GattCancelConnectReq();
+        break;
+
+        case app_state_config_slow:
+            g_app_data.state = app_state_config_cancelling;
+            GattCancelConnectReq();
+        break;
+
+        case app_state_connected:
+            g_app_data.state = app_state_disconnecting;
+            GattDisconnectReq(g_app_data.cid);
+        break;
+
+        default:
+            /* already on the way back to beaconing */
+        break;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      resumeBeaconing
+ *
+ *  DESCRIPTION
+ *      This function goes back to beaconing at the end of a configuration
+ *      window, or hibernates if the asset went still while it was open and
+ *      a still asset is not to advertise.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void resumeBeaconing(void)
 {
-    /* empty */
+    if(g_app_data.motion_sleep && !MotionMoving())
+    {
+        /* the window is over; there is nothing left to cancel */
+        g_app_data.state = app_state_beaconing;
+        sleepUntilMoved();
+        return;
+    }
+
+    startBeaconing();
+    armConfigTimer(BEACON_CONFIG_PERIOD);
 }
 
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      AppProcessLmEvent
+ *      sleepUntilMoved
  *
  *  DESCRIPTION
- *      This user application function is called whenever a LM-specific event is
- *      received by the system.
+ *      This function stops everything as at the close of an advertising
+ *      window and hibernates until the accelerometer PIO wakes the chip.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
+static void sleepUntilMoved(void)
+{
+    beaconScheduleClosed();
+    SleepRequest(sleep_state_hibernate, TRUE, NULL);
+}
 
-extern bool AppProcessLmEvent(lm_event_code event_code, 
-                              LM_EVENT_T *p_event_data)
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      beaconTierChanged
+ *
+ *  DESCRIPTION
+ *      This function is called when the battery ladder moves to another
+ *      tier. The advertised TX power is brought into line with the new
+ *      transmit power and advertising is restarted with the new interval,
+ *      unless the configuration service is in use.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void beaconTierChanged(void)
 {
+    patchTxPower();
+    RotationSetTxPower((int8)g_app_data.advData[BEACON_FRAME_TX_POWER_OFFSET]);
+
+    if(g_app_data.state != app_state_beaconing)
+    {
+        /* Leave the configuration window running; the new interval is
+         * taken up when beaconing resumes
+         */
+        LsSetTransmitPowerLevel(LadderTier()->tx_power_level);
+        RotationRefresh();
+        return;
+    }
+
+    LsStartStopAdvertise(FALSE, whitelist_disabled, ls_addr_type_random);
+    CountersAdvStop();
+
+    startBeaconing();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      beaconMotionChanged
+ *
+ *  DESCRIPTION
+ *      This function is called when the asset starts moving or goes still.
+ *      Advertising is restarted with the interval for the new state, or a
+ *      still asset hibernates if it is not to advertise, unless the
+ *      configuration service is in use.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void beaconMotionChanged(bool moving)
+{
+    if(g_app_data.state != app_state_beaconing)
+    {
+        /* the change is taken up when beaconing resumes */
+        return;
+    }
+
+    if(!moving && g_app_data.motion_sleep)
+    {
+        sleepUntilMoved();
+        return;
+    }
+
+    LsStartStopAdvertise(FALSE, whitelist_disabled, ls_addr_type_random);
+    CountersAdvStop();
+
+    startBeaconing();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      beaconScheduleClosed
+ *
+ *  DESCRIPTION
+ *      This function is called at the close of an advertising window, just
+ *      before the chip hibernates. It stops advertising and saves the
+ *      counters and the ephemeral ID counter, which hibernation would
+ *      otherwise lose.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void beaconScheduleClosed(void)
+{
+    RotationStop();
+    CensusStop();
+    SlotsStop();
+    SlotsClose();
+
+    switch(g_app_data.state)
+    {
+        case app_state_config_fast:
+        case app_state_config_slowing:
+        case app_state_config_slow:
+            GattCancelConnectReq();
+        break;
+
+        case app_state_connected:
+            GattDisconnectReq(g_app_data.cid);
+            LinkDisconnected();
+        break;
+
+        default:
+            LsStartStopAdvertise(FALSE, whitelist_disabled,
+                                 ls_addr_type_random);
+        break;
+    }
+
+    DispatchStopTask(g_app_data.config_task);
+    g_app_data.state = app_state_beaconing;
+
+    if(g_app_data.eid)
+    {
+        EidSave();
+    }
+
+    CountersAdvStop();
+    CountersSnapshot();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      beaconConfigCommitted
+ *
+ *  DESCRIPTION
+ *      This function is called when a client commits a new configuration.
+ *      The frames are patched in place and take effect when advertising
+ *      resumes after the connection; nothing is restarted.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void beaconConfigCommitted(void)
+{
+    patchFrame();
+    RotationSetIdentity(g_app_data.advData);
+    RotationRefresh();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      beaconEidRotated
+ *
+ *  DESCRIPTION
+ *      This function is called when the ephemeral ID changes. The new ID is
+ *      patched into the frames and the frame on air is replaced, as soon as
+ *      the way advertising is run lets it be stored whole.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void beaconEidRotated(const uint8 *eid)
+{
+    patchEid(eid);
+    RotationSetEid(eid);
+    RotationRefresh();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalBatteryLow
+ *
+ *  DESCRIPTION
+ *      This function handles the battery low system event. The beacon
+ *      moves to the most frugal tier of the battery ladder, and the low
+ *      voltage goes out in the next TLM frame rather than at the next
+ *      sample.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalBatteryLow(void *data)
+{
+    LadderBatteryLow();
+    TelemetrySample();
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalPioChanged
+ *
+ *  DESCRIPTION
+ *      This function passes a PIO edge on to the motion trigger.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalPioChanged(void *data)
+{
+    MotionPioChanged((const pio_changed_data *)data);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattAccessInd
+ *
+ *  DESCRIPTION
+ *      This function passes a GATT access to the service that owns the
+ *      handle.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalGattAccessInd(LM_EVENT_T *p_event_data)
+{
+    GATT_ACCESS_IND_T *ind = &p_event_data->gatt_access_ind;
+
+    if(BeaconCheckHandleRange(ind->handle))
+    {
+        BeaconHandleAccess(ind);
+    }
+    else if(ConfigCheckHandleRange(ind->handle))
+    {
+        ConfigHandleAccess(ind);
+    }
+    else
+    {
+        GattAccessRsp(ind->cid, ind->handle, gatt_status_invalid_handle,
+                      0, NULL);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattAddDbCfm
+ *
+ *  DESCRIPTION
+ *      This function logs a failure to install the GATT database; success
+ *      needs no action.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalGattAddDbCfm(LM_EVENT_T *p_event_data)
+{
+    if(p_event_data->gatt_add_db_cfm.result != sys_status_success)
+    {
+        AppDebugLog1(DEBUG_MSG_GATT_DB_FAILED,
+                     p_event_data->gatt_add_db_cfm.result);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattConnectCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the end of connectable advertising, either
+ *      because a client connected or because the window was cancelled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalGattConnectCfm(LM_EVENT_T *p_event_data)
+{
+    if(p_event_data->gatt_connect_cfm.result != sys_status_success)
+    {
+        if(g_app_data.state == app_state_config_slowing)
+        {
+            /* the slow advertising starts on the cancel confirmation */
+            return;
+        }
+
+        /* the window is over */
+        CountersAdvStop();
+        resumeBeaconing();
+    }
+    else
+    {
+        /* the controller stops advertising on connection */
+        g_app_data.state = app_state_connected;
+        PayloadSetAdvertising(payload_adv_off);
+        g_app_data.cid = p_event_data->gatt_connect_cfm.cid;
+        RotationStop();
+        CountersAdvStop();
+        ConfigConnected();
+        LinkConnected(&p_event_data->gatt_connect_cfm.bd_addr);
+        armConfigTimer(BEACON_CONFIG_CONNECTION_TIME);
+    }
+    AppDebugLog1(DEBUG_MSG_CONFIG_STATE, g_app_data.state);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalGattCancelConnectCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the cancel of connectable advertising, which
+ *      either closes the configuration window or restarts it slowly.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalGattCancelConnectCfm(LM_EVENT_T *p_event_data)
+{
+    /* a client may have connected before the cancel took effect */
+    if(g_app_data.state == app_state_config_cancelling)
+    {
+        CountersAdvStop();
+        resumeBeaconing();
+        AppDebugLog1(DEBUG_MSG_CONFIG_STATE, g_app_data.state);
+    }
+    else if(g_app_data.state == app_state_config_slowing)
+    {
+        CountersAdvStop();
+        startConfigWindow(FALSE);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalLsConnParamUpdateCfm
+ *
+ *  DESCRIPTION
+ *      This function passes the answer to a connection parameter request
+ *      on to the link.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalLsConnParamUpdateCfm(LM_EVENT_T *p_event_data)
+{
+    LinkParamUpdateCfm(&p_event_data->ls_connection_param_update_cfm);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalLmEvConnectionUpdate
+ *
+ *  DESCRIPTION
+ *      This function passes new connection parameters on to the link.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalLmEvConnectionUpdate(LM_EVENT_T *p_event_data)
+{
+    LinkConnectionUpdate(&p_event_data->lm_ev_connection_update);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalLmEvDisconnectComplete
+ *
+ *  DESCRIPTION
+ *      This function goes back to beaconing when the client disconnects.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalLmEvDisconnectComplete(LM_EVENT_T *p_event_data)
+{
+    LinkDisconnected();
+    ConfigDisconnected();
+    resumeBeaconing();
+    AppDebugLog1(DEBUG_MSG_CONFIG_STATE, g_app_data.state);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleSignalLmEvAdvertisingReport
+ *
+ *  DESCRIPTION
+ *      This function passes an advertiser heard while scanning on to the
+ *      census and to the slot synchronisation, each of which ignores it
+ *      unless it has a window open.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleSignalLmEvAdvertisingReport(LM_EVENT_T *p_event_data)
+{
+    CensusReport(&p_event_data->lm_ev_advertising_report);
+    SlotsReport(&p_event_data->lm_ev_advertising_report);
+}
+
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppPowerOnReset
+ *
+ *  DESCRIPTION
+ *      This function is called just after a power-on reset (including after
+ *      a firmware panic).
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+void AppPowerOnReset(void)
+{
+    /* empty */
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppInit
+ *
+ *  DESCRIPTION
+ *      This function is called after a power-on reset (including after a
+ *      firmware panic) or after an HCI Reset has been requested, and on
+ *      waking from hibernate or dormant.
+ *
+ *      NOTE: In the case of a power-on reset, this function is called
+ *      after AppPowerOnReset().
+ *
+ *      A wake from hibernate or dormant is the warm path: nobody is there
+ *      to configure a beacon that has just woken on its schedule or to a
+ *      PIO, so it starts beaconing at once and the first configuration
+ *      window opens BEACON_CONFIG_PERIOD later. GATT is only set up when
+ *      a window opens.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+void AppInit(sleep_state last_sleep_state)
+{
+    uint32 wake = TimeGet32();
+    bool warm = (last_sleep_state == sleep_state_hibernate ||
+                 last_sleep_state == sleep_state_dormant);
+
+    /* initialise application debug */
+    AppDebugInit();
+
+    AppDebugLog1(DEBUG_MSG_BOOT, last_sleep_state);
+    
+    /* Initialise the application timers */
+    TimerInit(MAX_APP_TIMERS, (void*)app_timers);
+
+    /* Periodic tasks share the task wheel, events go through the tables */
+    DispatchInit(g_lm_events, EVENT_COUNT(g_lm_events),
+                 g_system_events, EVENT_COUNT(g_system_events));
+
+    /* Nothing is known of the store after a reset, and the counters are
+     * the first to read it
+     */
+    StoreInit();
+
+    /* Count the boot */
+    CountersInit(last_sleep_state);
+
+    /* Outside the advertising schedule the chip goes straight back to
+     * hibernate
+     */
+    if(!ScheduleInit(last_sleep_state,
+                     CSReadUserKey(BEACON_CLOCK_USER_KEY_IDX),
+                     CSReadUserKey(BEACON_WINDOW_USER_KEY_IDX),
+                     beaconScheduleClosed))
+    {
+        CountersSnapshot();
+        return;
+    }
+
+    /* an HCI reset does not reload the initialised data, and takes the
+     * GATT database with it
+     */
+    g_app_data.gatt_ready = FALSE;
+
+    /* Pick the battery ladder tier */
+    LadderInit(beaconTierChanged);
+    
+    /* Initialise beacon data */
+    initBeacon();
+    
+    /* Open the configuration window, after a cold boot; the beacon
+     * advertises throughout
+     */
+    g_app_data.config_task = DispatchAddTask(configTask,
+                                             CONFIG_TASK_TOLERANCE);
+    if(BEACON_CONFIG_WINDOW != 0 && !warm)
+    {
+        startConfigWindow(TRUE);
+    }
+    else
+    {
+        startBeaconing();
+        if(BEACON_CONFIG_WINDOW != 0)
+        {
+            armConfigTimer(BEACON_CONFIG_PERIOD);
+        }
+    }
+
+    AppDebugLogLong(DEBUG_MSG_BOOT_ADVERTISING, TimeGet32() - wake);
+
+    CountersWakeEnd(wake);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppProcessSystemEvent
+ *
+ *  DESCRIPTION
+ *      This user application function is called whenever a system event, such
+ *      as a battery low notification, is received by the system.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+void AppProcessSystemEvent(sys_event_id id, void *data)
+{
+    uint32 wake = CountersWakeStart(counter_wake_system_event);
+
+    DispatchSystemEvent(id, data);
+
+    CountersWakeEnd(wake);
+}
+
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AppProcessLmEvent
+ *
+ *  DESCRIPTION
+ *      This user application function is called whenever a LM-specific event is
+ *      received by the system.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool AppProcessLmEvent(lm_event_code event_code, 
+                              LM_EVENT_T *p_event_data)
+{
+    uint32 wake = CountersWakeStart(counter_wake_lm_event);
+
+    DispatchLmEvent(event_code, p_event_data);
+
+    CountersWakeEnd(wake);
+
     return TRUE;
 }
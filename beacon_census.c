@@ -0,0 +1,409 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_census.c
+ *
+ *  DESCRIPTION
+ *      This file estimates how many distinct advertisers are in range.
+ *      Every BEACON_CENSUS_PERIOD the beacon scans for BEACON_CENSUS_WINDOW
+ *      while it carries on advertising, and the count of the window is
+ *      sent with the Eddystone-TLM frame.
+ *
+ *      Advertisers are counted with a HyperLogLog sketch: each address is
+ *      hashed, the top bits of the hash pick a register and the register
+ *      keeps the longest run of leading zeros seen in the rest. The sketch
+ *      is CENSUS_REGISTERS registers of four bits, packed four to a word,
+ *      whatever the number of advertisers; hearing an advertiser again
+ *      changes nothing. The standard error of the count is 1.04 over the
+ *      square root of the number of registers, about 5%.
+ *
+ *      The count is worked out in integer arithmetic. Below 2.5 registers
+ *      per advertiser the raw estimate is biased and the count comes from
+ *      the number of registers still empty instead (linear counting).
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <mem.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_frame.h"
+#include "beacon_census.h"
+#include "beacon_telemetry.h"
+#include "beacon_dispatch.h"
+#include "beacon_scan.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Hash bits picking the register, and the number of registers */
+#define CENSUS_INDEX_BITS               (9)
+#define CENSUS_REGISTERS                (1 << CENSUS_INDEX_BITS)
+
+/* Registers hold ranks of up to CENSUS_RANK_MAX in four bits, four to a
+ * word; the cap only matters beyond millions of advertisers
+ */
+#define CENSUS_RANK_MAX                 (14)
+#define CENSUS_RANK_BITS                (4)
+#define CENSUS_RANK_MASK                ((1 << CENSUS_RANK_BITS) - 1)
+#define CENSUS_WORDS                    (CENSUS_REGISTERS / 4)
+
+/* HyperLogLog bias correction times the square of the number of registers,
+ * in units of 2^-CENSUS_RANK_MAX to match the register sum:
+ * 0.7213 / (1 + 1.079 / 512) * 512^2 * 2^14
+ */
+#define CENSUS_ALPHA_MM                 (3091444932UL)
+
+/* Linear counting applies below this raw estimate */
+#define CENSUS_LINEAR_LIMIT             (5UL * CENSUS_REGISTERS / 2)
+
+/* Fractional bits of the base 2 logarithm, the logarithm of the number of
+ * registers in that fixed point, and the number of registers times ln(2)
+ * in units of 2^-16 per unit of that fixed point: 512 * ln(2) * 2^4. A
+ * unit of the logarithm is 0.09 of an advertiser, so log2Fixed(), good to
+ * about a unit, moves a linear count by less than a quarter.
+ */
+#define CENSUS_LOG2_FRACTION_BITS       (12)
+#define CENSUS_LOG2_REGISTERS           (CENSUS_INDEX_BITS <<               \
+                                         CENSUS_LOG2_FRACTION_BITS)
+#define CENSUS_REGISTERS_LN2            (5678UL)
+
+/* Largest count sent; TLM_CENSUS_UNKNOWN means no window has closed */
+#define CENSUS_COUNT_MAX                (TLM_CENSUS_UNKNOWN - 1)
+
+/* How late a window may open, so that it can share a wake-up with the TLM
+ * sample, and how late it may close
+ */
+#define CENSUS_OPEN_TOLERANCE           (BEACON_CENSUS_PERIOD / 10)
+#define CENSUS_CLOSE_TOLERANCE          (BEACON_CENSUS_WINDOW / 10)
+
+DISPATCH_CHECK_SPAN(open, BEACON_CENSUS_PERIOD + CENSUS_OPEN_TOLERANCE);
+DISPATCH_CHECK_SPAN(close, BEACON_CENSUS_WINDOW + CENSUS_CLOSE_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Tasks opening a window every period and closing it */
+    dispatch_task open_task;
+    dispatch_task close_task;
+
+    /* A window is open */
+    bool scanning;
+
+    /* Reports heard in the window, counted or not */
+    uint16 reports;
+
+    /* The sketch */
+    uint16 registers[CENSUS_WORDS];
+} CENSUS_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static CENSUS_DATA_T g_census;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint32 mixHash(uint32 hash);
+static uint16 log2Fixed(uint16 x);
+static uint16 countAdvertisers(void);
+static void openWindow(void);
+static void closeWindow(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mixHash
+ *
+ *  DESCRIPTION
+ *      This function is the MurmurHash3 finaliser, which spreads every bit
+ *      of its input across the whole hash.
+ *
+ *  RETURNS
+ *      The mixed hash.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 mixHash(uint32 hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BUL;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35UL;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      log2Fixed
+ *
+ *  DESCRIPTION
+ *      This function works out the base 2 logarithm of a non-zero integer
+ *      with CENSUS_LOG2_FRACTION_BITS fractional bits. The integer part is
+ *      the position of the top bit; each fractional bit comes from
+ *      squaring the remaining mantissa.
+ *
+ *  RETURNS
+ *      The logarithm in fixed point.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 log2Fixed(uint16 x)
+{
+    uint16 result = 0;
+    uint32 mantissa;
+    uint16 bit;
+
+    while((x >> result) > 1)
+    {
+        result++;
+    }
+
+    /* 1 <= mantissa < 2 in 1.15 fixed point */
+    mantissa = (uint32)x << (15 - result);
+    result <<= CENSUS_LOG2_FRACTION_BITS;
+
+    for(bit = 1 << (CENSUS_LOG2_FRACTION_BITS - 1); bit != 0; bit >>= 1)
+    {
+        mantissa = (mantissa * mantissa) >> 15;
+        if(mantissa >= (2UL << 15))
+        {
+            mantissa >>= 1;
+            result |= bit;
+        }
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      countAdvertisers
+ *
+ *  DESCRIPTION
+ *      This function estimates the number of distinct advertisers from the
+ *      sketch: the bias-corrected harmonic mean of the registers, or
+ *      linear counting while it is small and some registers are empty.
+ *
+ *  RETURNS
+ *      The estimate, at most CENSUS_COUNT_MAX.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 countAdvertisers(void)
+{
+    uint32 sum = 0;
+    uint32 estimate;
+    uint16 empty = 0;
+    uint16 i;
+
+    for(i = 0; i < CENSUS_REGISTERS; i++)
+    {
+        uint16 rank = (g_census.registers[i >> 2] >>
+                       ((i & 3) * CENSUS_RANK_BITS)) & CENSUS_RANK_MASK;
+
+        sum += 1UL << (CENSUS_RANK_MAX - rank);
+        if(rank == 0)
+        {
+            empty++;
+        }
+    }
+
+    estimate = CENSUS_ALPHA_MM / sum;
+
+    if(estimate <= CENSUS_LINEAR_LIMIT && empty != 0)
+    {
+        /* registers * ln(registers / empty) */
+        estimate = ((uint32)(CENSUS_LOG2_REGISTERS - log2Fixed(empty)) *
+                    CENSUS_REGISTERS_LN2 + 0x8000UL) >> 16;
+    }
+
+    if(estimate > CENSUS_COUNT_MAX)
+    {
+        estimate = CENSUS_COUNT_MAX;
+    }
+
+    return (uint16)estimate;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      openWindow
+ *
+ *  DESCRIPTION
+ *      This function is called every BEACON_CENSUS_PERIOD. It empties the
+ *      sketch and starts scanning for BEACON_CENSUS_WINDOW. Advertising
+ *      is left running; the controller scans between its events.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void openWindow(void)
+{
+    if(g_census.scanning)
+    {
+        return;
+    }
+
+    MemSet(g_census.registers, 0, sizeof(g_census.registers));
+    g_census.reports = 0;
+
+    if(!ScanStart(scan_user_census))
+    {
+        return;
+    }
+
+    g_census.scanning = TRUE;
+    DispatchStartTask(g_census.close_task, BEACON_CENSUS_WINDOW, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      closeWindow
+ *
+ *  DESCRIPTION
+ *      This function is called at the end of a census window. It stops
+ *      scanning and puts the count into the Eddystone-TLM frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void closeWindow(void)
+{
+    uint16 count;
+
+    ScanStop(scan_user_census);
+    g_census.scanning = FALSE;
+
+    count = countAdvertisers();
+    TelemetrySetCensus(count);
+
+    AppDebugLog2(DEBUG_MSG_CENSUS, count, g_census.reports);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CensusInit
+ *
+ *  DESCRIPTION
+ *      This function adds the census tasks and opens the first window one
+ *      period after boot, in step with the TLM sampling. Until that window
+ *      closes the frame sends TLM_CENSUS_UNKNOWN.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CensusInit(void)
+{
+    g_census.scanning = FALSE;
+
+    TelemetrySetCensus(TLM_CENSUS_UNKNOWN);
+
+    g_census.open_task = DispatchAddTask(openWindow, CENSUS_OPEN_TOLERANCE);
+    g_census.close_task = DispatchAddTask(closeWindow,
+                                          CENSUS_CLOSE_TOLERANCE);
+    DispatchStartTask(g_census.open_task, BEACON_CENSUS_PERIOD,
+                      BEACON_CENSUS_PERIOD);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CensusReport
+ *
+ *  DESCRIPTION
+ *      This function adds the advertiser of a report to the sketch. The
+ *      address type is hashed in with the address, as a public and a
+ *      random address with the same value are different devices.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CensusReport(const LM_EV_ADVERTISING_REPORT_T *report)
+{
+    const TYPED_BD_ADDR_T *address = &report->data.address;
+    uint32 hash;
+    uint32 rest;
+    uint16 index;
+    uint16 shift;
+    uint16 rank = 1;
+
+    if(!g_census.scanning)
+    {
+        return;
+    }
+
+    g_census.reports++;
+
+    hash = mixHash(((uint32)address->addr.lap & 0xFFFFFFUL) |
+                   ((uint32)address->addr.uap << 24));
+    hash = mixHash(hash ^ address->addr.nap ^
+                   ((uint32)address->type << 16));
+
+    index = (uint16)(hash >> (32 - CENSUS_INDEX_BITS));
+    rest = hash << CENSUS_INDEX_BITS;
+    while(rank < CENSUS_RANK_MAX && (rest & 0x80000000UL) == 0)
+    {
+        rank++;
+        rest <<= 1;
+    }
+
+    shift = (index & 3) * CENSUS_RANK_BITS;
+    if(rank > ((g_census.registers[index >> 2] >> shift) & CENSUS_RANK_MASK))
+    {
+        g_census.registers[index >> 2] =
+            (g_census.registers[index >> 2] &
+             ~(uint16)(CENSUS_RANK_MASK << shift)) | (rank << shift);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CensusStop
+ *
+ *  DESCRIPTION
+ *      This function stops scanning if a window is open. The window is
+ *      dropped without a count; the frame keeps the last one.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CensusStop(void)
+{
+    if(!g_census.scanning)
+    {
+        return;
+    }
+
+    ScanStop(scan_user_census);
+    g_census.scanning = FALSE;
+    DispatchStopTask(g_census.close_task);
+}
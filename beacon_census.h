@@ -0,0 +1,39 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_census.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the neighbourhood census, which scans in a
+ *      short window between advertising events and estimates how many
+ *      distinct advertisers are in range
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_CENSUS_H__
+#define __BEACON_CENSUS_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Add the census tasks, open a window every BEACON_CENSUS_PERIOD and send
+ * the count with the Eddystone-TLM frame; call before RotationInit()
+ */
+extern void CensusInit(void);
+
+/* Count the advertiser of a report, if a window is open */
+extern void CensusReport(const LM_EV_ADVERTISING_REPORT_T *report);
+
+/* Stop scanning, dropping the window in progress, before hibernating */
+extern void CensusStop(void);
+
+#endif /* __BEACON_CENSUS_H__ */
@@ -0,0 +1,145 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_channels.c
+ *
+ *  DESCRIPTION
+ *      This file restricts beaconing to a subset of the three advertising
+ *      channels. Every channel left out saves its PDU and the turnaround
+ *      to the next channel, close to a third of the transmit energy each,
+ *      at the cost of receivers that scan only the channels left out never
+ *      hearing the beacon.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <gap_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "beacon_frame.h"
+#include "beacon_channels.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of advertising channels */
+#define ADV_CHANNEL_COUNT               (3)
+
+/* Radio timing of an advertising event: the radio wakes before the first
+ * PDU and turns around between channels. Each PDU carries preamble, access
+ * address, header, AdvA and CRC besides the AD data, at 8 us an octet.
+ */
+#define RADIO_WAKE_US                   (400)
+#define RADIO_CHANNEL_GAP_US            (150)
+#define ADV_PDU_OVERHEAD_OCTETS         (16)
+#define RADIO_US_PER_OCTET              (8)
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Channels to beacon on, GAP_ADV_CHANNEL_* bits */
+static uint8 g_channel_mask = GAP_ADV_CHANNELS_ALL;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ChannelsInit
+ *
+ *  DESCRIPTION
+ *      This function takes the channels to beacon on. Zero, or bits for
+ *      channels that do not exist, select all three.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ChannelsInit(uint8 channel_mask)
+{
+    if(channel_mask == 0 || (channel_mask & ~GAP_ADV_CHANNELS_ALL) != 0)
+    {
+        channel_mask = GAP_ADV_CHANNELS_ALL;
+    }
+
+    g_channel_mask = channel_mask;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ChannelsApply
+ *
+ *  DESCRIPTION
+ *      This function sets the chosen channels for beaconing. The controller
+ *      keeps them through changes of interval and advertising data, so
+ *      this is only needed when advertising starts. The radio-on time of
+ *      an iBeacon event is logged so that the saving can be checked.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ChannelsApply(void)
+{
+    GapSetAdvChanMask(g_channel_mask);
+
+    AppDebugLog2(DEBUG_MSG_ADV_CHANNELS, g_channel_mask,
+                 ChannelsEventAirtime(BEACON_FRAME_SIZE));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ChannelsApplyAll
+ *
+ *  DESCRIPTION
+ *      This function sets all three channels. The configuration window
+ *      uses them so that any phone can find the beacon quickly.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ChannelsApplyAll(void)
+{
+    GapSetAdvChanMask(GAP_ADV_CHANNELS_ALL);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ChannelsEventAirtime
+ *
+ *  DESCRIPTION
+ *      This function estimates how long the radio is on for one
+ *      non-connectable advertising event on the chosen channels.
+ *
+ *  RETURNS
+ *      Radio-on time in microseconds.
+ *
+ *---------------------------------------------------------------------------*/
+uint16 ChannelsEventAirtime(uint8 adv_len)
+{
+    uint16 channels = 0;
+    uint8 channel;
+
+    for(channel = 0; channel < ADV_CHANNEL_COUNT; channel++)
+    {
+        channels += (g_channel_mask >> channel) & 1;
+    }
+
+    return (uint16)(RADIO_WAKE_US +
+                    (channels - 1) * RADIO_CHANNEL_GAP_US +
+                    channels * (ADV_PDU_OVERHEAD_OCTETS + adv_len) *
+                    RADIO_US_PER_OCTET);
+}
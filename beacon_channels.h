@@ -0,0 +1,44 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_channels.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the advertising channel mask, which lets a
+ *      beacon with receivers on known channels advertise on fewer than
+ *      three
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_CHANNELS_H__
+#define __BEACON_CHANNELS_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Take the channels to beacon on, GAP_ADV_CHANNEL_* bits; zero selects all
+ * three
+ */
+extern void ChannelsInit(uint8 channel_mask);
+
+/* Beacon on the chosen channels, and log the radio-on time of an event */
+extern void ChannelsApply(void);
+
+/* Advertise on all three channels, for the configuration window */
+extern void ChannelsApplyAll(void);
+
+/* Estimated radio-on time in microseconds of an advertising event on the
+ * chosen channels, for advertising data of the given length including the
+ * AD length octets
+ */
+extern uint16 ChannelsEventAirtime(uint8 adv_len);
+
+#endif /* __BEACON_CHANNELS_H__ */
@@ -0,0 +1,491 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_config.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for using the configuration service.
+ *      Writes are staged and only take effect, all together, when the
+ *      client commits them; the committed configuration is kept in NVM and
+ *      takes precedence over the user keys from then on.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <gatt.h>
+#include <gatt_prim.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_common.h"
+#include "app_debug.h"
+#include "app_gatt_db.h"
+#include "user_config.h"
+#include "beacon_config.h"
+#include "beacon_store.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Passcode words of a device that has not been given one */
+#define CONFIG_PASSCODE_BLANK           (0x00000000UL)
+#define CONFIG_PASSCODE_ERASED          (0xFFFFFFFFUL)
+
+/* Values written to the commit characteristic */
+#define CONFIG_COMMIT_DISCARD           (0x00)
+#define CONFIG_COMMIT_APPLY             (0x01)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Configuration in use, and the one being written over GATT */
+    BEACON_CONFIG_T live;
+    BEACON_CONFIG_T staged;
+
+    /* The device's passcode, whether the client has sent it, and the tries
+     * left until the next window opens
+     */
+    uint32 passcode;
+    bool authenticated;
+    uint8 attempts;
+
+    config_commit_handler handler;
+} CONFIG_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static CONFIG_DATA_T g_config;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static bool configEqual(const BEACON_CONFIG_T *a, const BEACON_CONFIG_T *b);
+static bool readConfig(BEACON_CONFIG_T *config);
+static void writeConfig(const BEACON_CONFIG_T *config);
+static sys_status handleWrite(uint16 handle, const uint8 *value,
+                              uint16 size);
+static void handleAccessRead(GATT_ACCESS_IND_T *p_ind);
+static void handleAccessWrite(GATT_ACCESS_IND_T *p_ind);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      configEqual
+ *
+ *  DESCRIPTION
+ *      This function compares two configurations.
+ *
+ *  RETURNS
+ *      TRUE if they are the same.
+ *
+ *---------------------------------------------------------------------------*/
+static bool configEqual(const BEACON_CONFIG_T *a, const BEACON_CONFIG_T *b)
+{
+    return (a->uuid_msw == b->uuid_msw && a->major == b->major &&
+            a->minor == b->minor && a->tx_power == b->tx_power) ?
+           TRUE : FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readConfig
+ *
+ *  DESCRIPTION
+ *      This function reads the configuration committed over GATT.
+ *
+ *  RETURNS
+ *      TRUE if there is one.
+ *
+ *---------------------------------------------------------------------------*/
+static bool readConfig(BEACON_CONFIG_T *config)
+{
+    uint16 words[STORE_CONFIG_WORDS];
+
+    if(!StoreRead(store_record_config, words))
+    {
+        return FALSE;
+    }
+
+    config->uuid_msw = words[0];
+    config->major = words[1];
+    config->minor = words[2];
+    config->tx_power = (int16)words[3];
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeConfig
+ *
+ *  DESCRIPTION
+ *      This function writes the configuration to the store.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeConfig(const BEACON_CONFIG_T *config)
+{
+    uint16 words[STORE_CONFIG_WORDS];
+
+    words[0] = config->uuid_msw;
+    words[1] = config->major;
+    words[2] = config->minor;
+    words[3] = (uint16)config->tx_power;
+    StoreWrite(store_record_config, words);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleWrite
+ *
+ *  DESCRIPTION
+ *      This function checks and applies a write. Everything but the
+ *      passcode needs the passcode first. Multi-octet values are little
+ *      endian.
+ *
+ *  RETURNS
+ *      The status to answer with.
+ *
+ *---------------------------------------------------------------------------*/
+static sys_status handleWrite(uint16 handle, const uint8 *value, uint16 size)
+{
+    uint16 word = 0;
+
+    if(size >= 2)
+    {
+        word = (uint16)(value[0] | (value[1] << 8));
+    }
+
+    if(handle == HANDLE_CONFIG_PASSCODE)
+    {
+        if(size != 4)
+        {
+            return gatt_status_invalid_length;
+        }
+        if(g_config.attempts == 0)
+        {
+            return gatt_status_insufficient_authentication;
+        }
+
+        if(((uint32)word | ((uint32)value[2] << 16) |
+            ((uint32)value[3] << 24)) != g_config.passcode)
+        {
+            g_config.attempts--;
+            AppDebugLog1(DEBUG_MSG_CONFIG_PASSCODE_WRONG, g_config.attempts);
+            return gatt_status_insufficient_authentication;
+        }
+
+        g_config.authenticated = TRUE;
+        return sys_status_success;
+    }
+
+    if(!g_config.authenticated)
+    {
+        return gatt_status_insufficient_authentication;
+    }
+
+    switch(handle)
+    {
+        case HANDLE_CONFIG_UUID_MSW:
+        case HANDLE_CONFIG_MAJOR:
+        case HANDLE_CONFIG_MINOR:
+            if(size != 2)
+            {
+                return gatt_status_invalid_length;
+            }
+
+            if(handle == HANDLE_CONFIG_UUID_MSW)
+            {
+                g_config.staged.uuid_msw = word;
+            }
+            else if(handle == HANDLE_CONFIG_MAJOR)
+            {
+                g_config.staged.major = word;
+            }
+            else
+            {
+                g_config.staged.minor = word;
+            }
+        break;
+
+        case HANDLE_CONFIG_TX_POWER:
+            if(size != 1)
+            {
+                return gatt_status_invalid_length;
+            }
+            g_config.staged.tx_power = (int8)value[0];
+        break;
+
+        case HANDLE_CONFIG_COMMIT:
+            if(size != 1)
+            {
+                return gatt_status_invalid_length;
+            }
+            if(value[0] > CONFIG_COMMIT_APPLY)
+            {
+                return gatt_status_write_not_permitted;
+            }
+
+            if(value[0] == CONFIG_COMMIT_DISCARD)
+            {
+                g_config.staged = g_config.live;
+            }
+            else if(!configEqual(&g_config.staged, &g_config.live))
+            {
+                /* Nothing is written when nothing has changed */
+                g_config.live = g_config.staged;
+                writeConfig(&g_config.live);
+                AppDebugLog2(DEBUG_MSG_CONFIG_COMMITTED,
+                             g_config.live.major, g_config.live.minor);
+                g_config.handler();
+            }
+        break;
+
+        default:
+            return gatt_status_write_not_permitted;
+    }
+
+    return sys_status_success;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleAccessRead
+ *
+ *  DESCRIPTION
+ *      This function handles read operations. The client reads back what
+ *      it has staged.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleAccessRead(GATT_ACCESS_IND_T *p_ind)
+{
+    uint8 value[2];
+    uint16 word;
+    uint16 length = 2;
+
+    switch(p_ind->handle)
+    {
+        case HANDLE_CONFIG_UUID_MSW:
+            word = g_config.staged.uuid_msw;
+        break;
+
+        case HANDLE_CONFIG_MAJOR:
+            word = g_config.staged.major;
+        break;
+
+        case HANDLE_CONFIG_MINOR:
+            word = g_config.staged.minor;
+        break;
+
+        case HANDLE_CONFIG_TX_POWER:
+            word = (uint16)g_config.staged.tx_power;
+            length = 1;
+        break;
+
+        default:
+            GattAccessRsp(p_ind->cid, p_ind->handle,
+                          gatt_status_read_not_permitted, 0, NULL);
+            return;
+    }
+
+    value[0] = (uint8)(word & 0xFF);
+    value[1] = (uint8)(word >> 8);
+
+    GattAccessRsp(p_ind->cid, p_ind->handle, sys_status_success,
+                  length, value);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleAccessWrite
+ *
+ *  DESCRIPTION
+ *      This function handles write operations.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleAccessWrite(GATT_ACCESS_IND_T *p_ind)
+{
+    GattAccessRsp(p_ind->cid, p_ind->handle,
+                  handleWrite(p_ind->handle, p_ind->value, p_ind->size_value),
+                  0, NULL);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigInit
+ *
+ *  DESCRIPTION
+ *      This function picks the configuration to start with. No tries at
+ *      the passcode are allowed until a window opens.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ConfigInit(const BEACON_CONFIG_T *defaults, uint32 passcode,
+                config_commit_handler handler)
+{
+    g_config.handler = handler;
+    g_config.passcode = passcode;
+    g_config.attempts = 0;
+
+    if(!readConfig(&g_config.live))
+    {
+        g_config.live = *defaults;
+    }
+
+    ConfigDisconnected();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigGet
+ *
+ *  DESCRIPTION
+ *      This function returns the configuration in use.
+ *
+ *  RETURNS
+ *      The configuration in use.
+ *
+ *---------------------------------------------------------------------------*/
+const BEACON_CONFIG_T *ConfigGet(void)
+{
+    return &g_config.live;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigWindowOpened
+ *
+ *  DESCRIPTION
+ *      This function gives the passcode its tries for a new configuration
+ *      window. They are shared by every connection in the window, so a
+ *      client cannot get more by reconnecting. A device without a
+ *      passcode gets none and cannot be configured.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ConfigWindowOpened(void)
+{
+    if(g_config.passcode == CONFIG_PASSCODE_BLANK ||
+       g_config.passcode == CONFIG_PASSCODE_ERASED)
+    {
+        g_config.attempts = 0;
+    }
+    else
+    {
+        g_config.attempts = BEACON_CONFIG_PASSCODE_ATTEMPTS;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigConnected
+ *
+ *  DESCRIPTION
+ *      This function starts a configuration session, with whatever tries
+ *      at the passcode the window has left.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ConfigConnected(void)
+{
+    g_config.staged = g_config.live;
+    g_config.authenticated = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigDisconnected
+ *
+ *  DESCRIPTION
+ *      This function ends a configuration session, dropping anything that
+ *      was not committed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ConfigDisconnected(void)
+{
+    g_config.staged = g_config.live;
+    g_config.authenticated = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigHandleAccess
+ *
+ *  DESCRIPTION
+ *      This function handles GATT accesses to the configuration service.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ConfigHandleAccess(GATT_ACCESS_IND_T *p_ind)
+{
+    if(p_ind->flags == (ATT_ACCESS_PERMISSION | ATT_ACCESS_READ))
+    {
+        handleAccessRead(p_ind);
+    }
+    else if(p_ind->flags & ATT_ACCESS_WRITE)
+    {
+        handleAccessWrite(p_ind);
+    }
+    else
+    {
+        GattAccessRsp(p_ind->cid, p_ind->handle,
+                      gatt_status_write_not_permitted, 0, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ConfigCheckHandleRange
+ *
+ *  DESCRIPTION
+ *      This function checks whether a handle belongs to the configuration
+ *      service.
+ *
+ *  RETURNS
+ *      TRUE if it does.
+ *
+ *---------------------------------------------------------------------------*/
+bool ConfigCheckHandleRange(uint16 handle)
+{
+    return (handle >= HANDLE_CONFIG_SERVICE &&
+            handle <= HANDLE_CONFIG_SERVICE_END) ? TRUE : FALSE;
+}
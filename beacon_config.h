@@ -0,0 +1,69 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_config.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the configuration service
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_CONFIG_H__
+#define __BEACON_CONFIG_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <gatt_prim.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Beacon identity and TX power. Every field is a word so that the block
+ * has the same layout in NVM whatever the compiler.
+ */
+typedef struct
+{
+    uint16 uuid_msw;
+    uint16 major;
+    uint16 minor;
+    int16 tx_power;
+} BEACON_CONFIG_T;
+
+/* Called once a new configuration has been committed */
+typedef void (*config_commit_handler)(void);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Take the configuration from NVM if one was committed, from the defaults
+ * otherwise, and the device's passcode; a passcode of all zeros or all
+ * ones locks the service
+ */
+extern void ConfigInit(const BEACON_CONFIG_T *defaults, uint32 passcode,
+                       config_commit_handler handler);
+
+/* Configuration in use */
+extern const BEACON_CONFIG_T *ConfigGet(void);
+
+/* A configuration window has opened; the passcode tries are renewed */
+extern void ConfigWindowOpened(void);
+
+/* A client has connected, or the connection has gone; anything not
+ * committed is discarded
+ */
+extern void ConfigConnected(void);
+extern void ConfigDisconnected(void);
+
+/* Handle a GATT access to the configuration service */
+extern void ConfigHandleAccess(GATT_ACCESS_IND_T *p_ind);
+
+/* Check whether a handle belongs to the configuration service */
+extern bool ConfigCheckHandleRange(uint16 handle);
+
+#endif /* __BEACON_CONFIG_H__ */
@@ -0,0 +1,400 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_counters.c
+ *
+ *  DESCRIPTION
+ *      This file keeps the runtime counters used to tie battery drain in the
+ *      field to firmware behaviour. Counting a wake-up costs an increment
+ *      and two TimeGet32() calls; the divisions and the NVM accesses are
+ *      left to the snapshot, which rides on a wake-up that happens anyway.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <mem.h>
+#include <timer.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_common.h"
+#include "app_debug.h"
+#include "user_config.h"
+#include "beacon_counters.h"
+#include "beacon_store.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Serialised layout version; change it, and the store's version of the
+ * counters record, if COUNTERS_T changes
+ */
+#define COUNTERS_VERSION                (1)
+
+/* The controller adds a pseudo-random advDelay of 0 to 10 ms to every
+ * advertising interval
+ */
+#define COUNTERS_ADV_DELAY_MEAN         (5 * MILLISECOND)
+
+/* Size of the counters in NVM words, STORE_COUNTERS_WORDS in
+ * beacon_store.h
+ */
+#define COUNTERS_NVM_WORDS              (sizeof(COUNTERS_T) / sizeof(uint16))
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Counters kept across resets. Every field is 32 bits so that the block
+ * has the same layout in NVM whatever the compiler.
+ */
+typedef struct
+{
+    uint32 boot_count;
+    uint32 last_sleep_state;
+    uint32 adv_enables;
+    uint32 adv_events;
+    uint32 wakeups[counter_wake_count];
+    uint32 awake_ms;
+} COUNTERS_T;
+
+typedef struct
+{
+    COUNTERS_T counters;
+
+    /* Time of the last bookkeeping */
+    uint32 last_time;
+
+    /* Time not yet added to the awake time, the advertising event
+     * estimate or the snapshot period
+     */
+    uint32 awake_us;
+    uint32 adv_us;
+    uint32 snapshot_us;
+
+    /* Interval of the advertising under way, zero when stopped */
+    uint32 adv_interval;
+
+    /* Whether the totals of earlier boots have been added from NVM */
+    bool restored;
+} COUNTERS_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static COUNTERS_DATA_T g_counters;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void catchUp(void);
+static void settleAdvEvents(void);
+static void restore(void);
+static uint8 *packLong(uint8 *value, uint32 data);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      catchUp
+ *
+ *  DESCRIPTION
+ *      This function carries the time since the last bookkeeping into the
+ *      advertising and snapshot accumulators. It must run at least once in
+ *      every 71 minute wrap of TimeGet32(), which any timer does.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void catchUp(void)
+{
+    uint32 now = TimeGet32();
+    uint32 elapsed = now - g_counters.last_time;
+
+    g_counters.last_time = now;
+    g_counters.snapshot_us += elapsed;
+    if(g_counters.adv_interval != 0)
+    {
+        g_counters.adv_us += elapsed;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      settleAdvEvents
+ *
+ *  DESCRIPTION
+ *      This function turns the advertising time into an estimate of the
+ *      advertising events, as the controller does not report them to the
+ *      application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void settleAdvEvents(void)
+{
+    catchUp();
+
+    if(g_counters.adv_interval != 0)
+    {
+        g_counters.counters.adv_events +=
+            g_counters.adv_us / g_counters.adv_interval;
+        g_counters.adv_us %= g_counters.adv_interval;
+    }
+
+    g_counters.counters.awake_ms += g_counters.awake_us / MILLISECOND;
+    g_counters.awake_us %= MILLISECOND;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      restore
+ *
+ *  DESCRIPTION
+ *      This function adds the totals of earlier boots from the last NVM
+ *      snapshot to the counts since this boot. It is put off from
+ *      CountersInit() so that the NVM read does not hold up the first
+ *      advert.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void restore(void)
+{
+    uint16 words[STORE_COUNTERS_WORDS];
+    COUNTERS_T stored;
+    uint8 i;
+
+    g_counters.restored = TRUE;
+
+    if(!StoreRead(store_record_counters, words))
+    {
+        return;
+    }
+
+    MemCopy(&stored, words, sizeof(COUNTERS_T));
+
+    g_counters.counters.boot_count += stored.boot_count;
+    g_counters.counters.adv_enables += stored.adv_enables;
+    g_counters.counters.adv_events += stored.adv_events;
+    for(i = 0; i < counter_wake_count; i++)
+    {
+        g_counters.counters.wakeups[i] += stored.wakeups[i];
+    }
+    g_counters.counters.awake_ms += stored.awake_ms;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      packLong
+ *
+ *  DESCRIPTION
+ *      This function writes a 32-bit value little endian.
+ *
+ *  RETURNS
+ *      The octet after the value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint8 *packLong(uint8 *value, uint32 data)
+{
+    *value++ = (uint8)(data & 0xFF);
+    *value++ = (uint8)((data >> 8) & 0xFF);
+    *value++ = (uint8)((data >> 16) & 0xFF);
+    *value++ = (uint8)((data >> 24) & 0xFF);
+
+    return value;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersInit
+ *
+ *  DESCRIPTION
+ *      This function starts the counts of this boot and counts the boot
+ *      itself. The totals of earlier boots are added from NVM at the first
+ *      snapshot or read.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersInit(sleep_state last_sleep_state)
+{
+    MemSet(&g_counters.counters, 0, sizeof(COUNTERS_T));
+    g_counters.restored = FALSE;
+
+    g_counters.counters.boot_count = 1;
+    g_counters.counters.last_sleep_state = last_sleep_state;
+
+    g_counters.last_time = TimeGet32();
+    g_counters.adv_interval = 0;
+    g_counters.adv_us = 0;
+    g_counters.awake_us = 0;
+    g_counters.snapshot_us = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersWakeStart
+ *
+ *  DESCRIPTION
+ *      This function counts a wake-up by its cause.
+ *
+ *  RETURNS
+ *      The time of the wake-up.
+ *
+ *---------------------------------------------------------------------------*/
+uint32 CountersWakeStart(counter_wake cause)
+{
+    g_counters.counters.wakeups[cause]++;
+
+    return TimeGet32();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersWakeEnd
+ *
+ *  DESCRIPTION
+ *      This function adds the time spent awake and takes the NVM snapshot
+ *      once BEACON_COUNTERS_SNAPSHOT_PERIOD has passed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersWakeEnd(uint32 wake_time)
+{
+    g_counters.awake_us += TimeGet32() - wake_time;
+
+    catchUp();
+    if(g_counters.snapshot_us >= BEACON_COUNTERS_SNAPSHOT_PERIOD)
+    {
+        CountersSnapshot();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersAdvStart
+ *
+ *  DESCRIPTION
+ *      This function is called whenever advertising is enabled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersAdvStart(uint32 adv_interval)
+{
+    settleAdvEvents();
+
+    g_counters.counters.adv_enables++;
+    g_counters.adv_interval = adv_interval + COUNTERS_ADV_DELAY_MEAN;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersAdvStop
+ *
+ *  DESCRIPTION
+ *      This function is called whenever advertising is disabled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersAdvStop(void)
+{
+    settleAdvEvents();
+
+    g_counters.adv_interval = 0;
+    g_counters.adv_us = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersSnapshot
+ *
+ *  DESCRIPTION
+ *      This function writes the counters to the store, and to the debug
+ *      log.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersSnapshot(void)
+{
+    uint16 words[STORE_COUNTERS_WORDS];
+
+    if(!g_counters.restored)
+    {
+        restore();
+    }
+
+    settleAdvEvents();
+    g_counters.snapshot_us = 0;
+
+    MemCopy(words, &g_counters.counters, sizeof(COUNTERS_T));
+    StoreWrite(store_record_counters, words);
+
+    AppDebugLogWords(DEBUG_MSG_COUNTERS, words, COUNTERS_NVM_WORDS);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      CountersSerialise
+ *
+ *  DESCRIPTION
+ *      This function packs the counters for the GATT characteristic:
+ *      layout version, boot count, last sleep state, advertising enables,
+ *      estimated advertising events, timer, system event and LM event
+ *      wake-ups and awake time in ms.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void CountersSerialise(uint8 *value)
+{
+    const COUNTERS_T *counters = &g_counters.counters;
+    uint8 i;
+
+    if(!g_counters.restored)
+    {
+        restore();
+    }
+
+    settleAdvEvents();
+
+    *value++ = COUNTERS_VERSION;
+    value = packLong(value, counters->boot_count);
+    *value++ = (uint8)counters->last_sleep_state;
+    value = packLong(value, counters->adv_enables);
+    value = packLong(value, counters->adv_events);
+    for(i = 0; i < counter_wake_count; i++)
+    {
+        value = packLong(value, counters->wakeups[i]);
+    }
+    packLong(value, counters->awake_ms);
+}
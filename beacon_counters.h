@@ -0,0 +1,68 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_counters.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the runtime counters
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_COUNTERS_H__
+#define __BEACON_COUNTERS_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Size of the counters as read over GATT */
+#define COUNTERS_SERIALISED_SIZE        (30)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* What woke the CPU */
+typedef enum
+{
+    counter_wake_timer,
+    counter_wake_system_event,
+    counter_wake_lm_event,
+
+    counter_wake_count
+} counter_wake;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Start the counters of this boot */
+extern void CountersInit(sleep_state last_sleep_state);
+
+/* Count a wake-up; returns the time to pass to CountersWakeEnd() */
+extern uint32 CountersWakeStart(counter_wake cause);
+
+/* Add the time since CountersWakeStart() to the awake time, and take the
+ * snapshot if it is due
+ */
+extern void CountersWakeEnd(uint32 wake_time);
+
+/* Advertising started with the given interval, or stopped */
+extern void CountersAdvStart(uint32 adv_interval);
+extern void CountersAdvStop(void);
+
+/* Write the counters to NVM now */
+extern void CountersSnapshot(void);
+
+/* Pack the counters little endian into COUNTERS_SERIALISED_SIZE octets */
+extern void CountersSerialise(uint8 *value);
+
+#endif /* __BEACON_COUNTERS_H__ */
@@ -0,0 +1,382 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_dispatch.c
+ *
+ *  DESCRIPTION
+ *      This file runs the periodic tasks of the application from a single
+ *      timer and hands system and LM events to the handlers in the
+ *      application's tables.
+ *
+ *      Each task has a tolerance, how late it may run. The timer is set
+ *      for the earliest time some task would run out of tolerance, and
+ *      every task due by then runs in that wake-up, so tasks whose
+ *      deadlines fall close together share one wake-up instead of waking
+ *      the chip once each. A periodic task keeps its phase: the next
+ *      deadline follows from the last one, not from when it ran.
+ *
+ *      With this few tasks the wheel is a table scanned on each wake-up
+ *      and on each change, which is cheaper than keeping them in slots.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "beacon_dispatch.h"
+#include "beacon_counters.h"
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    dispatch_task_handler handler;
+
+    /* TimeGet32() time the task falls due */
+    uint32 due;
+
+    /* Time between runs, zero for a task run once */
+    uint32 period;
+
+    /* How late the task may run */
+    uint32 tolerance;
+
+    bool active;
+} DISPATCH_TASK_T;
+
+typedef struct
+{
+    DISPATCH_TASK_T task[DISPATCH_MAX_TASKS];
+    uint8 task_count;
+
+    /* The wheel timer and the TimeGet32() time it fires */
+    timer_id timer;
+    uint32 timer_due;
+
+    /* Tasks are being run; the timer is set when they are done */
+    bool running;
+
+    const DISPATCH_LM_EVENT_T *lm_events;
+    uint8 lm_count;
+    const DISPATCH_SYSTEM_EVENT_T *system_events;
+    uint8 system_count;
+} DISPATCH_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static DISPATCH_DATA_T g_dispatch;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void armTimer(void);
+static void dispatchTimerHandler(timer_id const id);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      armTimer
+ *
+ *  DESCRIPTION
+ *      This function sets the wheel timer for the earliest time any task
+ *      runs out of tolerance. A timer already set for that time is left
+ *      alone, so starting a task that falls due later costs no timer
+ *      calls.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void armTimer(void)
+{
+    uint32 now;
+    int32 wake = 0;
+    bool found = FALSE;
+    uint8 i;
+
+    if(g_dispatch.running)
+    {
+        return;
+    }
+
+    now = TimeGet32();
+    for(i = 0; i < g_dispatch.task_count; i++)
+    {
+        const DISPATCH_TASK_T *task = &g_dispatch.task[i];
+        int32 until;
+
+        if(!task->active)
+        {
+            continue;
+        }
+
+        until = (int32)(task->due + task->tolerance - now);
+        if(!found || until < wake)
+        {
+            wake = until;
+            found = TRUE;
+        }
+    }
+
+    if(wake < 0)
+    {
+        wake = 0;
+    }
+
+    if(g_dispatch.timer != TIMER_INVALID)
+    {
+        if(found && g_dispatch.timer_due == now + (uint32)wake)
+        {
+            return;
+        }
+
+        TimerDelete(g_dispatch.timer);
+        g_dispatch.timer = TIMER_INVALID;
+    }
+
+    if(found)
+    {
+        g_dispatch.timer_due = now + (uint32)wake;
+        g_dispatch.timer = TimerCreate((uint32)wake, TRUE,
+                                       dispatchTimerHandler);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      dispatchTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function is called when the wheel timer expires and runs every
+ *      task that has fallen due, whether or not it was the one the timer
+ *      was set for.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void dispatchTimerHandler(timer_id const id)
+{
+    uint32 wake = CountersWakeStart(counter_wake_timer);
+    uint32 now = TimeGet32();
+    uint8 i;
+
+    g_dispatch.timer = TIMER_INVALID;
+    g_dispatch.running = TRUE;
+
+    for(i = 0; i < g_dispatch.task_count; i++)
+    {
+        DISPATCH_TASK_T *task = &g_dispatch.task[i];
+
+        if(!task->active || (int32)(now - task->due) < 0)
+        {
+            continue;
+        }
+
+        /* Work out the next deadline first, so that the handler can
+         * restart or stop its own task
+         */
+        if(task->period == 0)
+        {
+            task->active = FALSE;
+        }
+        else
+        {
+            do
+            {
+                task->due += task->period;
+            } while((int32)(now - task->due) >= 0);
+        }
+
+        task->handler();
+    }
+
+    g_dispatch.running = FALSE;
+    armTimer();
+
+    CountersWakeEnd(wake);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchInit
+ *
+ *  DESCRIPTION
+ *      This function drops every task and takes the event tables. It is
+ *      called at every boot, after TimerInit() has dropped the timers.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void DispatchInit(const DISPATCH_LM_EVENT_T *lm_events, uint8 lm_count,
+                  const DISPATCH_SYSTEM_EVENT_T *system_events,
+                  uint8 system_count)
+{
+    g_dispatch.task_count = 0;
+    g_dispatch.timer = TIMER_INVALID;
+    g_dispatch.running = FALSE;
+
+    g_dispatch.lm_events = lm_events;
+    g_dispatch.lm_count = lm_count;
+    g_dispatch.system_events = system_events;
+    g_dispatch.system_count = system_count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchAddTask
+ *
+ *  DESCRIPTION
+ *      This function adds a stopped task to the wheel.
+ *
+ *  RETURNS
+ *      The task, or DISPATCH_TASK_INVALID if the wheel is full.
+ *
+ *---------------------------------------------------------------------------*/
+dispatch_task DispatchAddTask(dispatch_task_handler handler,
+                              uint32 tolerance)
+{
+    DISPATCH_TASK_T *task;
+
+    if(g_dispatch.task_count == DISPATCH_MAX_TASKS)
+    {
+        return DISPATCH_TASK_INVALID;
+    }
+
+    task = &g_dispatch.task[g_dispatch.task_count];
+    task->handler = handler;
+    task->tolerance = tolerance;
+    task->active = FALSE;
+
+    return g_dispatch.task_count++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchStartTask
+ *
+ *  DESCRIPTION
+ *      This function starts a task, or moves it if it is already running.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void DispatchStartTask(dispatch_task task, uint32 delay, uint32 period)
+{
+    DISPATCH_TASK_T *entry;
+
+    if(task >= g_dispatch.task_count)
+    {
+        return;
+    }
+
+    entry = &g_dispatch.task[task];
+    entry->due = TimeGet32() + delay;
+    entry->period = period;
+    entry->active = TRUE;
+
+    armTimer();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchStopTask
+ *
+ *  DESCRIPTION
+ *      This function stops a task. The wheel timer is moved on if no other
+ *      task needs it as early.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void DispatchStopTask(dispatch_task task)
+{
+    if(task >= g_dispatch.task_count || !g_dispatch.task[task].active)
+    {
+        return;
+    }
+
+    g_dispatch.task[task].active = FALSE;
+
+    armTimer();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchLmEvent
+ *
+ *  DESCRIPTION
+ *      This function looks the event up in the LM event table and calls
+ *      its handler.
+ *
+ *  RETURNS
+ *      TRUE if the event has a handler.
+ *
+ *---------------------------------------------------------------------------*/
+bool DispatchLmEvent(lm_event_code event_code, LM_EVENT_T *p_event_data)
+{
+    uint8 i;
+
+    for(i = 0; i < g_dispatch.lm_count; i++)
+    {
+        if(g_dispatch.lm_events[i].code == event_code)
+        {
+            g_dispatch.lm_events[i].handler(p_event_data);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      DispatchSystemEvent
+ *
+ *  DESCRIPTION
+ *      This function looks the event up in the system event table and
+ *      calls its handler.
+ *
+ *  RETURNS
+ *      TRUE if the event has a handler.
+ *
+ *---------------------------------------------------------------------------*/
+bool DispatchSystemEvent(sys_event_id id, void *data)
+{
+    uint8 i;
+
+    for(i = 0; i < g_dispatch.system_count; i++)
+    {
+        if(g_dispatch.system_events[i].id == id)
+        {
+            g_dispatch.system_events[i].handler(data);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
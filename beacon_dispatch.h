@@ -0,0 +1,119 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_dispatch.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the task wheel, which runs every periodic
+ *      task of the application from one timer, and for the table-driven
+ *      dispatch of system and LM events
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_DISPATCH_H__
+#define __BEACON_DISPATCH_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Most tasks that can be added: frame rotation, telemetry sampling,
+ * battery ladder, ephemeral ID rotation, configuration, the opening and
+ * closing of census windows, the slot restarts and sync windows of
+ * slotted advertising, and the motion hold-off
+ */
+#define DISPATCH_MAX_TASKS              (11)
+
+/* Returned when no more tasks can be added; starting or stopping it does
+ * nothing
+ */
+#define DISPATCH_TASK_INVALID           ((dispatch_task)0xFF)
+
+/* Longest delay or period, plus the task's tolerance, the wheel can time:
+ * it counts microseconds to the next deadline in a signed 32-bit number,
+ * which wraps after 35.7 minutes. Longer spans have to be counted out in
+ * shorter ones, as the advertising schedule does.
+ */
+#define DISPATCH_MAX_SPAN               (0x7FFFFFFFUL)
+
+/* Stops the build if a span fixed at compile time is too long for the
+ * wheel; name makes the check's type unique in its file
+ */
+#define DISPATCH_CHECK_SPAN(name, span)                                      \
+    typedef char dispatch_span_##name[((span) <= DISPATCH_MAX_SPAN) ? 1 : -1]
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Task handle */
+typedef uint8 dispatch_task;
+
+/* Called when a task falls due */
+typedef void (*dispatch_task_handler)(void);
+
+/* Handlers of LM and system events */
+typedef void (*dispatch_lm_handler)(LM_EVENT_T *p_event_data);
+typedef void (*dispatch_system_handler)(void *data);
+
+/* Entries of the event tables */
+typedef struct
+{
+    lm_event_code code;
+    dispatch_lm_handler handler;
+} DISPATCH_LM_EVENT_T;
+
+typedef struct
+{
+    sys_event_id id;
+    dispatch_system_handler handler;
+} DISPATCH_SYSTEM_EVENT_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Drop every task and take the event tables; call after TimerInit() and
+ * before any task is added
+ */
+extern void DispatchInit(const DISPATCH_LM_EVENT_T *lm_events,
+                         uint8 lm_count,
+                         const DISPATCH_SYSTEM_EVENT_T *system_events,
+                         uint8 system_count);
+
+/* Add a task that may run up to tolerance microseconds after it falls due,
+ * so that it can share a wake-up with other tasks. The task is stopped.
+ */
+extern dispatch_task DispatchAddTask(dispatch_task_handler handler,
+                                     uint32 tolerance);
+
+/* Start a task, or restart it, to fall due after delay and then every
+ * period; a zero period runs it once. Delay and period, each plus the
+ * tolerance, must be at most DISPATCH_MAX_SPAN.
+ */
+extern void DispatchStartTask(dispatch_task task, uint32 delay,
+                              uint32 period);
+
+/* Stop a task */
+extern void DispatchStopTask(dispatch_task task);
+
+/* Pass an LM event to its handler in the table. Returns FALSE if it has
+ * none.
+ */
+extern bool DispatchLmEvent(lm_event_code event_code,
+                            LM_EVENT_T *p_event_data);
+
+/* Pass a system event to its handler in the table. Returns FALSE if it has
+ * none.
+ */
+extern bool DispatchSystemEvent(sys_event_id id, void *data);
+
+#endif /* __BEACON_DISPATCH_H__ */
@@ -0,0 +1,380 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_eid.c
+ *
+ *  DESCRIPTION
+ *      This file derives the ephemeral identifiers from the device key and
+ *      a counter with the AES hardware. IDs are worked out a batch ahead on
+ *      a wake-up of their own, so a rotation only takes the next ID from
+ *      the table. The counter is reserved in the store a batch at a time, so
+ *      that an ID is never repeated after a reset.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>
+#include <nvm.h>
+#include <aes.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_common.h"
+#include "app_debug.h"
+#include "user_config.h"
+#include "beacon_counters.h"
+#include "beacon_dispatch.h"
+#include "beacon_store.h"
+#include "beacon_eid.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Words of an ID as kept in the batch */
+#define EID_WORDS                       (EID_LENGTH / 2)
+
+#define EID_BATCH_MASK                  (BEACON_EID_BATCH_SIZE - 1)
+
+/* The batch is topped up once half of it has been used, shortly after the
+ * rotation so that the rotation itself stays short
+ */
+#define EID_REFILL_THRESHOLD            (BEACON_EID_BATCH_SIZE / 2)
+#define EID_REFILL_DELAY                (100 * MILLISECOND)
+
+/* How late an ID may change, so that the change can share a wake-up; far
+ * less than resolvers allow for clock drift
+ */
+#define EID_ROTATE_TOLERANCE            (1 * SECOND)
+
+DISPATCH_CHECK_SPAN(rotate, BEACON_EID_PERIOD + EID_ROTATE_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    uint16 key[AES_BLOCK_WORDS];
+
+    /* IDs worked out ahead, the one on air at head */
+    uint16 batch[BEACON_EID_BATCH_SIZE][EID_WORDS];
+    uint16 head;
+    uint16 count;
+
+    /* Counter of the ID on air, and the first counter not reserved in
+     * the store
+     */
+    uint32 counter;
+    uint32 reserved;
+
+    /* ID on air as octets */
+    uint8 eid[EID_LENGTH];
+
+    timer_id refill_timer;
+    dispatch_task rotate_task;
+    eid_rotate_handler handler;
+} EID_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static EID_DATA_T g_eid;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void deriveId(uint32 counter, uint16 *id);
+static void writeCounter(uint32 counter);
+static void unpackCurrent(void);
+static void refill(void);
+static void refillTimerHandler(timer_id const id);
+static void rotateTask(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      deriveId
+ *
+ *  DESCRIPTION
+ *      This function works out the ID for a counter value.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void deriveId(uint32 counter, uint16 *id)
+{
+    uint16 block[AES_BLOCK_WORDS] = { 0 };
+    uint16 i;
+
+    block[AES_BLOCK_WORDS - 2] = (uint16)(counter >> 16);
+    block[AES_BLOCK_WORDS - 1] = (uint16)counter;
+
+    AesEncrypt(g_eid.key, block, block);
+
+    for(i = 0; i < EID_WORDS; i++)
+    {
+        id[i] = block[i];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeCounter
+ *
+ *  DESCRIPTION
+ *      This function writes the first counter not handed out to the
+ *      store.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeCounter(uint32 counter)
+{
+    uint16 words[STORE_EID_COUNTER_WORDS];
+
+    words[0] = (uint16)(counter >> 16);
+    words[1] = (uint16)counter;
+    StoreWrite(store_record_eid_counter, words);
+
+    g_eid.reserved = counter;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      unpackCurrent
+ *
+ *  DESCRIPTION
+ *      This function unpacks the ID on air into octets.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void unpackCurrent(void)
+{
+    const uint16 *id = g_eid.batch[g_eid.head];
+    uint16 i;
+
+    for(i = 0; i < EID_WORDS; i++)
+    {
+        g_eid.eid[2 * i] = WORD_MSB(id[i]);
+        g_eid.eid[2 * i + 1] = WORD_LSB(id[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      refill
+ *
+ *  DESCRIPTION
+ *      This function fills the batch and reserves its counters in the
+ *      store.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void refill(void)
+{
+    while(g_eid.count < BEACON_EID_BATCH_SIZE)
+    {
+        deriveId(g_eid.counter + g_eid.count,
+                 g_eid.batch[(g_eid.head + g_eid.count) & EID_BATCH_MASK]);
+        g_eid.count++;
+    }
+
+    if(g_eid.counter + g_eid.count > g_eid.reserved)
+    {
+        writeCounter(g_eid.counter + g_eid.count);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      refillTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function is called to top up the batch.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void refillTimerHandler(timer_id const id)
+{
+    uint32 wake = CountersWakeStart(counter_wake_timer);
+
+    g_eid.refill_timer = TIMER_INVALID;
+    refill();
+
+    CountersWakeEnd(wake);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      rotateTask
+ *
+ *  DESCRIPTION
+ *      This function is called every ID period and moves on to the next ID
+ *      in the batch. The batch is only worked out here if the
+ *      top-up has not run.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void rotateTask(void)
+{
+    if(g_eid.count < 2)
+    {
+        refill();
+    }
+
+    g_eid.head = (g_eid.head + 1) & EID_BATCH_MASK;
+    g_eid.count--;
+    g_eid.counter++;
+
+    unpackCurrent();
+    AppDebugLogLong(DEBUG_MSG_EID_ROTATED, g_eid.counter);
+    g_eid.handler(g_eid.eid);
+
+    if(g_eid.count <= EID_REFILL_THRESHOLD &&
+       g_eid.refill_timer == TIMER_INVALID)
+    {
+        g_eid.refill_timer = TimerCreate(EID_REFILL_DELAY, TRUE,
+                                         refillTimerHandler);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EidInit
+ *
+ *  DESCRIPTION
+ *      This function reads the device key and provisioned counter, which
+ *      follow each other in NVM, and the counter reserved in the store. A
+ *      key of all zeros or all ones is taken as not provisioned. Only the
+ *      first ID is worked out before advertising starts; the rest of the
+ *      batch and the reservation follow shortly after.
+ *
+ *  RETURNS
+ *      TRUE if ephemeral IDs are in use.
+ *
+ *---------------------------------------------------------------------------*/
+bool EidInit(eid_rotate_handler handler)
+{
+    uint16 words[NVM_EID_KEY_WORDS + NVM_EID_COUNTER_WORDS];
+    const uint16 *counter = &words[NVM_EID_KEY_WORDS];
+    uint16 reserved[STORE_EID_COUNTER_WORDS];
+    uint16 all_zeros = 0;
+    uint16 all_ones = 0xFFFF;
+    uint16 i;
+
+    NvmConfigureI2cEeprom();
+    if(NvmRead(words, NVM_EID_KEY_WORDS + NVM_EID_COUNTER_WORDS,
+               NVM_OFFSET_EID_KEY) != sys_status_success)
+    {
+        NvmDisable();
+        return FALSE;
+    }
+    NvmDisable();
+
+    for(i = 0; i < NVM_EID_KEY_WORDS; i++)
+    {
+        g_eid.key[i] = words[i];
+        all_zeros |= words[i];
+        all_ones &= words[i];
+    }
+
+    if(all_zeros == 0 || all_ones == 0xFFFF)
+    {
+        AppDebugLog0(DEBUG_MSG_EID_NO_KEY);
+        return FALSE;
+    }
+
+    /* A provisioned counter that fails its check starts from zero. The
+     * one reserved in the store is further on, unless the beacon has been
+     * provisioned again with a later counter; either way the later one is
+     * taken, so no ID is repeated.
+     */
+    g_eid.counter = 0;
+    if(counter[2] == (uint16)~(counter[0] ^ counter[1]))
+    {
+        g_eid.counter = ((uint32)counter[0] << 16) | counter[1];
+    }
+    if(StoreRead(store_record_eid_counter, reserved) &&
+       (((uint32)reserved[0] << 16) | reserved[1]) > g_eid.counter)
+    {
+        g_eid.counter = ((uint32)reserved[0] << 16) | reserved[1];
+    }
+    g_eid.reserved = g_eid.counter;
+
+    g_eid.handler = handler;
+    g_eid.head = 0;
+    g_eid.count = 1;
+    deriveId(g_eid.counter, g_eid.batch[0]);
+    unpackCurrent();
+
+    g_eid.refill_timer = TimerCreate(EID_REFILL_DELAY, TRUE,
+                                     refillTimerHandler);
+    g_eid.rotate_task = DispatchAddTask(rotateTask, EID_ROTATE_TOLERANCE);
+    DispatchStartTask(g_eid.rotate_task, BEACON_EID_PERIOD,
+                      BEACON_EID_PERIOD);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EidCurrent
+ *
+ *  DESCRIPTION
+ *      This function returns the ID on air.
+ *
+ *  RETURNS
+ *      EID_LENGTH octets.
+ *
+ *---------------------------------------------------------------------------*/
+const uint8 *EidCurrent(void)
+{
+    return g_eid.eid;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EidSave
+ *
+ *  DESCRIPTION
+ *      This function saves the counter following the ID on air, so that a
+ *      wake from hibernation carries on from there rather than skipping
+ *      the rest of the reserved batch.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void EidSave(void)
+{
+    if(g_eid.reserved != g_eid.counter + 1)
+    {
+        writeCounter(g_eid.counter + 1);
+    }
+}
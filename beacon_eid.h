@@ -0,0 +1,55 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_eid.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the ephemeral identifiers
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_EID_H__
+#define __BEACON_EID_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Length of an ephemeral ID in octets. The iBeacon major and minor carry
+ * its first four octets.
+ *
+ * The ID for counter value c is the first half of AES-128 under the device
+ * key of a block of twelve zero octets followed by c, big endian.
+ */
+#define EID_LENGTH                      (8)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Called with the new ID each time the ID changes */
+typedef void (*eid_rotate_handler)(const uint8 *eid);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Read the device key and counter, work out the first ID and start
+ * rotating; returns FALSE if no key has been provisioned
+ */
+extern bool EidInit(eid_rotate_handler handler);
+
+/* ID on air, EID_LENGTH octets */
+extern const uint8 *EidCurrent(void);
+
+/* Save the counter exactly, before hibernating */
+extern void EidSave(void);
+
+#endif /* __BEACON_EID_H__ */
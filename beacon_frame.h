@@ -0,0 +1,235 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_frame.h
+ *
+ *  DESCRIPTION
+ *      Compile-time templates of the iBeacon and Eddystone advertising
+ *      frames. The frames are assembled by the preprocessor from
+ *      user_config.h, so the start-up code copies them from flash with the
+ *      rest of the initialised data and only the user key overrides need
+ *      patching in at boot.
+ *
+ *      Frames are held as they go on air: a sequence of AD structures, each
+ *      preceded by its length octet.
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_FRAME_H__
+#define __BEACON_FRAME_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <ls_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Beacon advert size, excluding the AD length octet added by the stack */
+#define BEACON_ADVERT_SIZE              (26)
+
+/* Size of the iBeacon frame including the AD length octet */
+#define BEACON_FRAME_SIZE               (BEACON_ADVERT_SIZE + 1)
+
+/* Field offsets within the frame */
+#define BEACON_FRAME_UUID_OFFSET        (6)
+#define BEACON_FRAME_MAJOR_OFFSET       (22)
+#define BEACON_FRAME_MINOR_OFFSET       (24)
+#define BEACON_FRAME_TX_POWER_OFFSET    (26)
+
+/* Frame initialiser: manufacturer specific data carrying the Apple company
+ * code (little endian), the iBeacon type and payload length, then the UUID,
+ * major and minor (big endian) and the measured TX power
+ */
+#define BEACON_FRAME_INIT                                                   \
+{                                                                           \
+    BEACON_ADVERT_SIZE,                                                     \
+    AD_TYPE_MANUF, 0x4C, 0x00, 0x02, 0x15,                                  \
+    BEACON_UUID_00, BEACON_UUID_01, BEACON_UUID_02, BEACON_UUID_03,         \
+    BEACON_UUID_04, BEACON_UUID_05, BEACON_UUID_06, BEACON_UUID_07,         \
+    BEACON_UUID_08, BEACON_UUID_09, BEACON_UUID_10, BEACON_UUID_11,         \
+    BEACON_UUID_12, BEACON_UUID_13, BEACON_UUID_14, BEACON_UUID_15,         \
+    WORD_MSB(BEACON_DEFAULT_MAJOR), WORD_LSB(BEACON_DEFAULT_MAJOR),         \
+    WORD_MSB(BEACON_DEFAULT_MINOR), WORD_LSB(BEACON_DEFAULT_MINOR),         \
+    (uint8)(BEACON_DEFAULT_TX_POWER)                                        \
+}
+
+/* Eddystone frames carry the complete 16-bit service UUID list followed by
+ * the service data, both for the Eddystone service UUID (little endian)
+ */
+#define EDDYSTONE_SERVICE_LIST_INIT                                         \
+    0x03, AD_TYPE_SERVICE_UUID_16BIT_LIST, 0xAA, 0xFE
+
+#define EDDYSTONE_SERVICE_DATA_INIT(length, frame_type)                     \
+    (length), AD_TYPE_SERVICE_DATA_UUID_16BIT, 0xAA, 0xFE, (frame_type)
+
+/* Eddystone frame types */
+#define EDDYSTONE_FRAME_TYPE_UID        (0x00)
+#define EDDYSTONE_FRAME_TYPE_URL        (0x10)
+#define EDDYSTONE_FRAME_TYPE_TLM        (0x20)
+#define EDDYSTONE_FRAME_TYPE_EID        (0x30)
+
+/* Offset of the field following the frame type, common to all Eddystone
+ * frames
+ */
+#define EDDYSTONE_FRAME_BODY_OFFSET     (9)
+
+/* Eddystone TX power is calibrated at 0 m, the iBeacon measured power at
+ * 1 m; the difference is the free space path loss over the first metre
+ */
+#define EDDYSTONE_TX_POWER_1M_TO_0M     (41)
+
+/* Eddystone-UID: calibrated TX power, 10-octet namespace, 6-octet instance
+ * and two reserved octets. The namespace is the iBeacon UUID with its
+ * middle six octets elided, as the Eddystone specification recommends, and
+ * the instance carries the iBeacon major and minor.
+ */
+#define EDDYSTONE_UID_FRAME_SIZE        (28)
+#define EDDYSTONE_UID_TX_POWER_OFFSET   (9)
+#define EDDYSTONE_UID_NAMESPACE_OFFSET  (10)
+#define EDDYSTONE_UID_MAJOR_OFFSET      (22)
+#define EDDYSTONE_UID_MINOR_OFFSET      (24)
+
+#define EDDYSTONE_UID_FRAME_INIT                                            \
+{                                                                           \
+    EDDYSTONE_SERVICE_LIST_INIT,                                            \
+    EDDYSTONE_SERVICE_DATA_INIT(0x17, EDDYSTONE_FRAME_TYPE_UID),            \
+    (uint8)(BEACON_DEFAULT_TX_POWER + EDDYSTONE_TX_POWER_1M_TO_0M),         \
+    BEACON_UUID_00, BEACON_UUID_01, BEACON_UUID_02, BEACON_UUID_03,         \
+    BEACON_UUID_10, BEACON_UUID_11, BEACON_UUID_12, BEACON_UUID_13,         \
+    BEACON_UUID_14, BEACON_UUID_15,                                         \
+    0x00, 0x00,                                                             \
+    WORD_MSB(BEACON_DEFAULT_MAJOR), WORD_LSB(BEACON_DEFAULT_MAJOR),         \
+    WORD_MSB(BEACON_DEFAULT_MINOR), WORD_LSB(BEACON_DEFAULT_MINOR),         \
+    0x00, 0x00                                                              \
+}
+
+/* Eddystone-URL: calibrated TX power, URL scheme prefix and encoded URL */
+#define EDDYSTONE_URL_FRAME_SIZE        (11 + EDDYSTONE_URL_LENGTH)
+#define EDDYSTONE_URL_TX_POWER_OFFSET   (9)
+
+#define EDDYSTONE_URL_FRAME_INIT                                            \
+{                                                                           \
+    EDDYSTONE_SERVICE_LIST_INIT,                                            \
+    EDDYSTONE_SERVICE_DATA_INIT(6 + EDDYSTONE_URL_LENGTH,                   \
+                                EDDYSTONE_FRAME_TYPE_URL),                  \
+    (uint8)(BEACON_DEFAULT_TX_POWER + EDDYSTONE_TX_POWER_1M_TO_0M),         \
+    EDDYSTONE_URL_SCHEME, EDDYSTONE_URL_INIT                                \
+}
+
+/* Eddystone-TLM (unencrypted): version, battery voltage in mV, temperature
+ * in signed 8.8 fixed point, advertising PDU count and time since power-up
+ * in 0.1 s, all big endian
+ */
+#define EDDYSTONE_TLM_FRAME_SIZE        (22)
+#define EDDYSTONE_TLM_VBATT_OFFSET      (10)
+#define EDDYSTONE_TLM_TEMP_OFFSET       (12)
+#define EDDYSTONE_TLM_ADV_CNT_OFFSET    (14)
+#define EDDYSTONE_TLM_SEC_CNT_OFFSET    (18)
+
+/* Temperature value meaning not supported */
+#define EDDYSTONE_TLM_TEMP_UNKNOWN      (0x8000)
+
+#define EDDYSTONE_TLM_FRAME_INIT                                            \
+{                                                                           \
+    EDDYSTONE_SERVICE_LIST_INIT,                                            \
+    EDDYSTONE_SERVICE_DATA_INIT(0x11, EDDYSTONE_FRAME_TYPE_TLM),            \
+    0x00,                                                                   \
+    0x00, 0x00,                                                             \
+    WORD_MSB(EDDYSTONE_TLM_TEMP_UNKNOWN),                                   \
+    WORD_LSB(EDDYSTONE_TLM_TEMP_UNKNOWN),                                   \
+    0x00, 0x00, 0x00, 0x00,                                                 \
+    0x00, 0x00, 0x00, 0x00                                                  \
+}
+
+/* Neighbourhood census, appended to the Eddystone-TLM frame when the
+ * census is on: manufacturer specific data under the CSR company
+ * identifier, a tag octet that tells it from the firmware version of the
+ * scan response, and the number of advertisers heard in the last census
+ * window, little endian. Sizes exclude the AD length octet.
+ */
+#define TLM_CENSUS_SIZE                 (6)
+#define TLM_CENSUS_TAG                  (0x01)
+#define TLM_CENSUS_FRAME_SIZE           (EDDYSTONE_TLM_FRAME_SIZE +         \
+                                         TLM_CENSUS_SIZE + 1)
+#define TLM_CENSUS_COUNT_OFFSET         (EDDYSTONE_TLM_FRAME_SIZE + 5)
+
+/* Census count before the first window has closed */
+#define TLM_CENSUS_UNKNOWN              (0xFFFF)
+
+/* Slot sync frame, advertised alone by a sync beacon: manufacturer
+ * specific data under the CSR company identifier, a tag octet and the
+ * frame length in milliseconds, little endian, which followers check
+ * against their own. The size includes the AD length octet.
+ */
+#define SLOT_SYNC_TAG                   (0x02)
+#define SLOT_SYNC_FRAME_SIZE            (7)
+
+#define SLOT_SYNC_FRAME_INIT                                                \
+{                                                                           \
+    SLOT_SYNC_FRAME_SIZE - 1, AD_TYPE_MANUF,                                \
+    WORD_LSB(SCAN_RSP_CSR_COMPANY_ID), WORD_MSB(SCAN_RSP_CSR_COMPANY_ID),   \
+    SLOT_SYNC_TAG,                                                          \
+    WORD_LSB(BEACON_SLOT_FRAME / MILLISECOND),                              \
+    WORD_MSB(BEACON_SLOT_FRAME / MILLISECOND)                               \
+}
+
+/* Eddystone-EID: calibrated TX power and the 8-octet ephemeral identifier.
+ * Sent in place of Eddystone-UID when ephemeral IDs are in use.
+ */
+#define EDDYSTONE_EID_FRAME_SIZE        (18)
+#define EDDYSTONE_EID_TX_POWER_OFFSET   (9)
+#define EDDYSTONE_EID_ID_OFFSET         (10)
+
+#define EDDYSTONE_EID_FRAME_INIT                                            \
+{                                                                           \
+    EDDYSTONE_SERVICE_LIST_INIT,                                            \
+    EDDYSTONE_SERVICE_DATA_INIT(0x0D, EDDYSTONE_FRAME_TYPE_EID),            \
+    (uint8)(BEACON_DEFAULT_TX_POWER + EDDYSTONE_TX_POWER_1M_TO_0M),         \
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00                          \
+}
+
+/* Scan response, sent to active scanners only: the appearance, the
+ * firmware version as manufacturer specific data under the CSR company
+ * identifier, both little endian, then as much of the device name as the
+ * rest of the scan response holds. Sizes exclude the AD length octet.
+ */
+#define SCAN_RSP_APPEARANCE_SIZE        (3)
+#define SCAN_RSP_VERSION_SIZE           (5)
+#define SCAN_RSP_CSR_COMPANY_ID         (0x000A)
+#define SCAN_RSP_NAME_MAX               (MAX_ADV_DATA_LEN -                 \
+                                         (SCAN_RSP_APPEARANCE_SIZE + 1) -   \
+                                         (SCAN_RSP_VERSION_SIZE + 1) - 2)
+
+/* Write a big endian 16-bit field into a frame */
+#define BEACON_FRAME_SET_WORD(frame, offset, value)                         \
+    do                                                                      \
+    {                                                                       \
+        (frame)[(offset)] = WORD_MSB(value);                                \
+        (frame)[(offset) + 1] = WORD_LSB(value);                            \
+    } while(0)
+
+/* Read a big endian 16-bit field from a frame */
+#define BEACON_FRAME_GET_WORD(frame, offset)                                \
+    ((uint16)(((uint16)(frame)[(offset)] << 8) | (frame)[(offset) + 1]))
+
+/* Write a big endian 32-bit field into a frame */
+#define BEACON_FRAME_SET_LONG(frame, offset, value)                         \
+    do                                                                      \
+    {                                                                       \
+        BEACON_FRAME_SET_WORD(frame, offset, (uint16)((value) >> 16));      \
+        BEACON_FRAME_SET_WORD(frame, (offset) + 2, (uint16)(value));        \
+    } while(0)
+
+#endif /* __BEACON_FRAME_H__ */
@@ -0,0 +1,234 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_ladder.c
+ *
+ *  DESCRIPTION
+ *      This file steps the beacon down a ladder of advertising interval and
+ *      transmit power tiers as the battery discharges. The ladder only
+ *      moves down: a cell does not recover charge, and a replaced cell
+ *      means a power-on reset, which starts again from the top.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <battery.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "gap_conn_params.h"
+#include "beacon_ladder.h"
+#include "beacon_dispatch.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of &TX_POWER_LEVEL steps */
+#define TX_POWER_LEVEL_COUNT            (8)
+
+/* How late a battery sample may be, so that it can share a wake-up */
+#define LADDER_SAMPLE_TOLERANCE         (BEACON_LADDER_SAMPLE_PERIOD / 10)
+
+DISPATCH_CHECK_SPAN(sample,
+                    BEACON_LADDER_SAMPLE_PERIOD + LADDER_SAMPLE_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Index of the tier in use */
+    uint8 tier;
+
+    /* Battery sampling task */
+    dispatch_task task;
+
+    ladder_tier_handler handler;
+} LADDER_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static LADDER_DATA_T g_ladder;
+
+static const LADDER_TIER_T g_tiers[] = BEACON_LADDER_TIERS;
+
+#define LADDER_TIER_COUNT   (sizeof(g_tiers) / sizeof(g_tiers[0]))
+
+/* Radio output in dBm at each &TX_POWER_LEVEL step */
+static const int8 g_tx_power_dbm[TX_POWER_LEVEL_COUNT] =
+    { -18, -14, -10, -6, -2, 2, 6, 8 };
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static bool stepDown(uint16 battery_mv);
+static void ladderTask(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      stepDown
+ *
+ *  DESCRIPTION
+ *      This function moves down the ladder to the first tier the battery
+ *      voltage is good enough for.
+ *
+ *  RETURNS
+ *      TRUE if the tier changed.
+ *
+ *---------------------------------------------------------------------------*/
+static bool stepDown(uint16 battery_mv)
+{
+    uint8 tier = g_ladder.tier;
+
+    while(tier < LADDER_TIER_COUNT - 1 &&
+          battery_mv < g_tiers[tier].min_battery_mv)
+    {
+        tier++;
+    }
+
+    if(tier == g_ladder.tier)
+    {
+        return FALSE;
+    }
+
+    g_ladder.tier = tier;
+    AppDebugLog2(DEBUG_MSG_LADDER_TIER, battery_mv, tier);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ladderTask
+ *
+ *  DESCRIPTION
+ *      This function is called every battery sampling period. Sampling
+ *      stops on the last tier, as there is nowhere left to go.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void ladderTask(void)
+{
+    if(stepDown(BatteryReadVoltage()))
+    {
+        g_ladder.handler();
+    }
+
+    if(g_ladder.tier == LADDER_TIER_COUNT - 1)
+    {
+        DispatchStopTask(g_ladder.task);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LadderInit
+ *
+ *  DESCRIPTION
+ *      This function picks the starting tier from the battery voltage and
+ *      starts the sampling task. The handler is not called for the
+ *      starting tier.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LadderInit(ladder_tier_handler handler)
+{
+    g_ladder.handler = handler;
+    g_ladder.tier = 0;
+    g_ladder.task = DispatchAddTask(ladderTask, LADDER_SAMPLE_TOLERANCE);
+
+    stepDown(BatteryReadVoltage());
+
+    if(g_ladder.tier < LADDER_TIER_COUNT - 1)
+    {
+        DispatchStartTask(g_ladder.task, BEACON_LADDER_SAMPLE_PERIOD,
+                          BEACON_LADDER_SAMPLE_PERIOD);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LadderTier
+ *
+ *  DESCRIPTION
+ *      This function returns the tier in use.
+ *
+ *  RETURNS
+ *      The tier in use.
+ *
+ *---------------------------------------------------------------------------*/
+const LADDER_TIER_T *LadderTier(void)
+{
+    return &g_tiers[g_ladder.tier];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LadderTxPower
+ *
+ *  DESCRIPTION
+ *      This function works out the TX power to advertise for the tier in
+ *      use. The measured power at 1 m moves by the same number of dB as the
+ *      radio output, so receivers keep estimating the same distance.
+ *
+ *  RETURNS
+ *      Advertised TX power in dBm.
+ *
+ *---------------------------------------------------------------------------*/
+int8 LadderTxPower(int8 reference_tx_power)
+{
+    return (int8)(reference_tx_power +
+                  g_tx_power_dbm[g_tiers[g_ladder.tier].tx_power_level] -
+                  g_tx_power_dbm[BEACON_TX_POWER_REFERENCE_LEVEL]);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LadderBatteryLow
+ *
+ *  DESCRIPTION
+ *      This function moves to the last tier when the firmware reports the
+ *      battery low event, and stops sampling.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LadderBatteryLow(void)
+{
+    DispatchStopTask(g_ladder.task);
+
+    if(g_ladder.tier != LADDER_TIER_COUNT - 1)
+    {
+        g_ladder.tier = LADDER_TIER_COUNT - 1;
+        AppDebugLog1(DEBUG_MSG_LADDER_LOW, g_ladder.tier);
+        g_ladder.handler();
+    }
+}
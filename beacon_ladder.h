@@ -0,0 +1,60 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_ladder.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the battery ladder, which trades advertising
+ *      interval and transmit power against the remaining battery
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_LADDER_H__
+#define __BEACON_LADDER_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* One tier of the ladder */
+typedef struct
+{
+    /* Advertising interval in microseconds */
+    uint32 adv_interval;
+
+    /* Transmit power in &TX_POWER_LEVEL steps */
+    uint8 tx_power_level;
+
+    /* Lowest battery voltage in mV at which the tier is used */
+    uint16 min_battery_mv;
+} LADDER_TIER_T;
+
+/* Called when the ladder moves to another tier */
+typedef void (*ladder_tier_handler)(void);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Pick the tier for the present battery voltage and start monitoring it */
+extern void LadderInit(ladder_tier_handler handler);
+
+/* The tier in use */
+extern const LADDER_TIER_T *LadderTier(void);
+
+/* Advertised TX power for the tier in use, from the TX power measured at
+ * BEACON_TX_POWER_REFERENCE_LEVEL
+ */
+extern int8 LadderTxPower(int8 reference_tx_power);
+
+/* Move straight to the last tier on a battery low event */
+extern void LadderBatteryLow(void);
+
+#endif /* __BEACON_LADDER_H__ */
@@ -0,0 +1,263 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_link.c
+ *
+ *  DESCRIPTION
+ *      This file asks a connected client for the preferred connection
+ *      parameters. Centrals usually connect with a short interval and no
+ *      slave latency, which keeps the radio awake far more than a
+ *      configuration session needs; once the client has had time to
+ *      discover the services the beacon asks for a long interval with
+ *      latency instead, and asks again if the client does not move to it.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <ls_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "gap_conn_params.h"
+#include "beacon_link.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Address of the connected client */
+    TYPED_BD_ADDR_T address;
+
+    /* Whether the parameters in force are the preferred ones. The
+     * parameters the central connected with are not reported, so they
+     * count as not preferred until a connection update says otherwise.
+     */
+    bool preferred;
+
+    /* Number of requests sent on this connection */
+    uint8 requests;
+
+    /* Delay before the next request */
+    timer_id timer;
+} LINK_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static LINK_DATA_T g_link;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static bool isPreferred(const HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T
+                        *params);
+static void armRequest(void);
+static void linkTimerHandler(timer_id const id);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      isPreferred
+ *
+ *  DESCRIPTION
+ *      This function checks connection parameters against the preferred
+ *      ones. A central may pick any interval in the preferred range, and a
+ *      longer supervision timeout or more latency than asked for is fine.
+ *
+ *  RETURNS
+ *      TRUE if the parameters are good enough.
+ *
+ *---------------------------------------------------------------------------*/
+static bool isPreferred(const HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T
+                        *params)
+{
+    return params->conn_interval >= PREFERRED_MIN_CON_INTERVAL &&
+           params->conn_interval <= PREFERRED_MAX_CON_INTERVAL &&
+           params->conn_latency >= PREFERRED_SLAVE_LATENCY;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      armRequest
+ *
+ *  DESCRIPTION
+ *      This function starts the delay before the next request, unless the
+ *      parameters are already right or the requests are used up.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void armRequest(void)
+{
+    if(!g_link.preferred &&
+       g_link.requests < MAX_NUM_CONN_PARAM_UPDATE_REQS &&
+       g_link.timer == TIMER_INVALID)
+    {
+        g_link.timer = TimerCreate(BEACON_CONN_PARAM_UPDATE_DELAY, TRUE,
+                                   linkTimerHandler);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      linkTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function asks the central for the preferred parameters. If
+ *      the stack cannot send the request, it is retried after the delay
+ *      while requests are left.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void linkTimerHandler(timer_id const id)
+{
+    ble_con_params params;
+    ls_err result;
+
+    g_link.timer = TIMER_INVALID;
+
+    if(g_link.preferred)
+    {
+        return;
+    }
+
+    params.con_min_interval = PREFERRED_MIN_CON_INTERVAL;
+    params.con_max_interval = PREFERRED_MAX_CON_INTERVAL;
+    params.con_slave_latency = PREFERRED_SLAVE_LATENCY;
+    params.con_super_timeout = PREFERRED_SUPERVISION_TIMEOUT;
+
+    /* A request the stack refuses counts against the limit too, and is
+     * retried after the delay like one the central refuses
+     */
+    g_link.requests++;
+    result = LsConnectionParamUpdateReq(&g_link.address, &params);
+
+    if(result == ls_err_none)
+    {
+        AppDebugLog1(DEBUG_MSG_CONN_PARAM_REQ, g_link.requests);
+    }
+    else
+    {
+        AppDebugLog1(DEBUG_MSG_CONN_PARAM_REJECTED, result);
+        armRequest();
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LinkConnected
+ *
+ *  DESCRIPTION
+ *      This function starts negotiating with a client that has just
+ *      connected. The first request waits for
+ *      &BEACON_CONN_PARAM_UPDATE_DELAY so that service discovery runs at
+ *      the central's interval.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LinkConnected(const TYPED_BD_ADDR_T *address)
+{
+    g_link.address = *address;
+    g_link.preferred = FALSE;
+    g_link.requests = 0;
+    g_link.timer = TIMER_INVALID;
+
+    armRequest();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LinkDisconnected
+ *
+ *  DESCRIPTION
+ *      This function stops negotiating when the connection goes. It must
+ *      be called for every connection passed to LinkConnected().
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LinkDisconnected(void)
+{
+    if(g_link.timer != TIMER_INVALID)
+    {
+        TimerDelete(g_link.timer);
+        g_link.timer = TIMER_INVALID;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LinkParamUpdateCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the central's answer to a request. A refusal
+ *      is retried after the delay while requests are left.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LinkParamUpdateCfm(const LS_CONNECTION_PARAM_UPDATE_CFM_T *cfm)
+{
+    if(cfm->status != sys_status_success)
+    {
+        AppDebugLog1(DEBUG_MSG_CONN_PARAM_REJECTED, cfm->status);
+        armRequest();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      LinkConnectionUpdate
+ *
+ *  DESCRIPTION
+ *      This function notes the parameters the central moved to. The
+ *      central may update the connection on its own, so parameters that
+ *      are not the preferred ones start another request.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void LinkConnectionUpdate(const LM_EV_CONNECTION_UPDATE_T *update)
+{
+    const HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T *data = &update->data;
+
+    if(data->status != sys_status_success)
+    {
+        return;
+    }
+
+    AppDebugLog3(DEBUG_MSG_CONN_PARAMS, data->conn_interval,
+                 data->conn_latency, data->supervision_timeout);
+
+    g_link.preferred = isPreferred(data);
+    armRequest();
+}
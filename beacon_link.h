@@ -0,0 +1,41 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_link.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for connection parameter negotiation, which asks
+ *      a connected client for the preferred connection parameters of
+ *      gap_conn_params.h
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_LINK_H__
+#define __BEACON_LINK_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <bluetooth.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Start negotiating with a client that has just connected */
+extern void LinkConnected(const TYPED_BD_ADDR_T *address);
+
+/* Stop negotiating when the connection goes */
+extern void LinkDisconnected(void);
+
+/* Handle LS_CONNECTION_PARAM_UPDATE_CFM */
+extern void LinkParamUpdateCfm(const LS_CONNECTION_PARAM_UPDATE_CFM_T *cfm);
+
+/* Handle LM_EV_CONNECTION_UPDATE */
+extern void LinkConnectionUpdate(const LM_EV_CONNECTION_UPDATE_T *update);
+
+#endif /* __BEACON_LINK_H__ */
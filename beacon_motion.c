@@ -0,0 +1,217 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_motion.c
+ *
+ *  DESCRIPTION
+ *      This file tells a moving asset from a still one by an accelerometer
+ *      interrupt wired to a PIO. Every rising edge of the PIO is motion;
+ *      BEACON_MOTION_HOLD_OFF without one and the asset is still.
+ *
+ *      While the asset moves the accelerometer may interrupt many times a
+ *      second. An edge only notes the time, so the hold-off timer is not
+ *      restarted for each; when it falls due it is armed again for what is
+ *      left of the hold-off after the last edge, and the asset is still
+ *      only once none is left.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>
+#include <pio.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_motion.h"
+#include "beacon_dispatch.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* How late the asset may be found still, so that the hold-off can share a
+ * wake-up
+ */
+#define MOTION_HOLD_OFF_TOLERANCE       (BEACON_MOTION_HOLD_OFF / 10)
+
+DISPATCH_CHECK_SPAN(hold_off,
+                    BEACON_MOTION_HOLD_OFF + MOTION_HOLD_OFF_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* The accelerometer PIO as a mask, zero without one */
+    uint32 mask;
+
+    /* Task finding the asset still at the end of the hold-off */
+    dispatch_task task;
+
+    bool moving;
+
+    /* TimeGet32() time of the last edge */
+    uint32 last_edge;
+
+    motion_handler handler;
+} MOTION_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static MOTION_DATA_T g_motion;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void holdOffTask(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      holdOffTask
+ *
+ *  DESCRIPTION
+ *      This function is called at the end of the hold-off. An edge since
+ *      it was armed moves the end on; otherwise the asset is still.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void holdOffTask(void)
+{
+    uint32 since = TimeGet32() - g_motion.last_edge;
+
+    if(since < BEACON_MOTION_HOLD_OFF)
+    {
+        DispatchStartTask(g_motion.task, BEACON_MOTION_HOLD_OFF - since, 0);
+        return;
+    }
+
+    g_motion.moving = FALSE;
+    AppDebugLog1(DEBUG_MSG_MOTION, FALSE);
+    g_motion.handler(FALSE);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MotionInit
+ *
+ *  DESCRIPTION
+ *      This function sets the accelerometer PIO up as an input raising an
+ *      event on its rising edge, held low by a weak pull-down while the
+ *      accelerometer is not driving it, and starts the hold-off.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void MotionInit(uint8 pio, motion_handler handler)
+{
+    g_motion.mask = 0;
+    g_motion.moving = TRUE;
+    g_motion.handler = handler;
+
+    if(pio >= PIO_COUNT)
+    {
+        return;
+    }
+
+    g_motion.mask = 1UL << pio;
+    PioSetModes(g_motion.mask, pio_mode_user);
+    PioSetDir(pio, PIO_DIRECTION_INPUT);
+    PioSetPullModes(g_motion.mask, pio_mode_weak_pull_down);
+    PioSetEventMask(g_motion.mask, pio_event_mode_rising);
+
+    g_motion.last_edge = TimeGet32();
+    g_motion.task = DispatchAddTask(holdOffTask, MOTION_HOLD_OFF_TOLERANCE);
+    DispatchStartTask(g_motion.task, BEACON_MOTION_HOLD_OFF, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MotionMoving
+ *
+ *  DESCRIPTION
+ *      This function returns whether the asset is moving.
+ *
+ *  RETURNS
+ *      TRUE if it is, or there is no accelerometer.
+ *
+ *---------------------------------------------------------------------------*/
+bool MotionMoving(void)
+{
+    return g_motion.moving;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MotionInterval
+ *
+ *  DESCRIPTION
+ *      This function slows a battery ladder interval down to
+ *      BEACON_MOTION_STILL_INTERVAL while the asset is still.
+ *
+ *  RETURNS
+ *      The advertising interval.
+ *
+ *---------------------------------------------------------------------------*/
+uint32 MotionInterval(uint32 adv_interval)
+{
+    if(!g_motion.moving && adv_interval < BEACON_MOTION_STILL_INTERVAL)
+    {
+        return BEACON_MOTION_STILL_INTERVAL;
+    }
+
+    return adv_interval;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      MotionPioChanged
+ *
+ *  DESCRIPTION
+ *      This function takes an edge of the accelerometer PIO. A still asset
+ *      is moving again at once; a moving one only notes the time.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void MotionPioChanged(const pio_changed_data *data)
+{
+    if((data->pio_cause & g_motion.mask) == 0)
+    {
+        return;
+    }
+
+    g_motion.last_edge = TimeGet32();
+    if(g_motion.moving)
+    {
+        return;
+    }
+
+    g_motion.moving = TRUE;
+    DispatchStartTask(g_motion.task, BEACON_MOTION_HOLD_OFF, 0);
+    AppDebugLog1(DEBUG_MSG_MOTION, TRUE);
+    g_motion.handler(TRUE);
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_motion.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for motion-triggered advertising, which follows
+ *      an accelerometer interrupt on a PIO to tell a moving asset from a
+ *      still one
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_MOTION_H__
+#define __BEACON_MOTION_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <pio.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* PIO given to MotionInit() when there is no accelerometer */
+#define MOTION_PIO_NONE                 (0xFF)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Called when the asset starts moving, and when it has been still for
+ * BEACON_MOTION_HOLD_OFF
+ */
+typedef void (*motion_handler)(bool moving);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Take the accelerometer PIO, or MOTION_PIO_NONE, and listen to it. The
+ * asset is taken to be moving at boot, which is what a wake by the PIO
+ * means.
+ */
+extern void MotionInit(uint8 pio, motion_handler handler);
+
+/* Whether the asset is moving; always TRUE without an accelerometer */
+extern bool MotionMoving(void);
+
+/* Advertising interval for a battery ladder interval: the ladder's while
+ * the asset moves, no shorter than BEACON_MOTION_STILL_INTERVAL while it
+ * is still
+ */
+extern uint32 MotionInterval(uint32 adv_interval);
+
+/* Take a PIO event, ignoring PIOs other than the accelerometer's */
+extern void MotionPioChanged(const pio_changed_data *data);
+
+#endif /* __BEACON_MOTION_H__ */
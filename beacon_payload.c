@@ -0,0 +1,413 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_payload.c
+ *
+ *  DESCRIPTION
+ *      This file keeps two copies of the advertising data: the payload on
+ *      air and a pending payload that callers load and patch. Fields are
+ *      patched off air and a commit hands the whole pending payload to the
+ *      controller at once, then swaps the two. A commit that would not
+ *      change the payload on air stores nothing.
+ *
+ *      The controller only takes advertising data through
+ *      LsStoreAdvScanData(): a clear, then one store per AD structure. An
+ *      event falling between the clear and the last store would go out
+ *      empty or with only the first AD structures, so the stores are only
+ *      ever made with advertising off. How that is done depends on who runs
+ *      advertising, as the application tells this module: with it off a
+ *      commit stores at once; while beaconing the commit stops advertising
+ *      around the stores and restarts it; and where advertising cannot be
+ *      stopped at will, in the configuration window or while the slot task
+ *      restarts advertising at each slot, the payload is held until the
+ *      next restart flushes it.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <mem.h>
+#include <ls_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "beacon_payload.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of payload buffers */
+#define PAYLOAD_BUFFERS                 (2)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Payloads in on-air form, one on air and one pending */
+    uint8 data[PAYLOAD_BUFFERS][MAX_ADV_DATA_LEN];
+    uint8 len[PAYLOAD_BUFFERS];
+
+    /* Index of the payload on air */
+    uint8 live;
+
+    /* The pending payload has not been loaded since the last commit, so
+     * it stands for a copy of the payload on air, made when first patched
+     */
+    bool stale;
+
+    /* The controller may not hold the payload on air, so the next commit
+     * stores whatever is pending
+     */
+    bool invalid;
+
+    /* How advertising is run, and so when a commit may store */
+    payload_adv adv;
+} PAYLOAD_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static PAYLOAD_DATA_T g_payload;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void syncPending(void);
+static bool pendingChanged(void);
+static bool storePayload(uint8 index);
+static bool storePending(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      syncPending
+ *
+ *  DESCRIPTION
+ *      This function makes the pending payload the copy of the payload on
+ *      air that it stands for after a commit.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void syncPending(void)
+{
+    uint8 pending = g_payload.live ^ 1;
+
+    if(g_payload.stale)
+    {
+        MemCopy(g_payload.data[pending], g_payload.data[g_payload.live],
+                g_payload.len[g_payload.live]);
+        g_payload.len[pending] = g_payload.len[g_payload.live];
+        g_payload.stale = FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      pendingChanged
+ *
+ *  DESCRIPTION
+ *      This function compares the pending payload with the one on air.
+ *
+ *  RETURNS
+ *      TRUE if the pending payload needs storing.
+ *
+ *---------------------------------------------------------------------------*/
+static bool pendingChanged(void)
+{
+    const uint8 *live = g_payload.data[g_payload.live];
+    const uint8 *pending = g_payload.data[g_payload.live ^ 1];
+    uint8 len = g_payload.len[g_payload.live ^ 1];
+    uint8 i;
+
+    if(g_payload.invalid)
+    {
+        return TRUE;
+    }
+
+    if(g_payload.stale)
+    {
+        return FALSE;
+    }
+
+    if(len != g_payload.len[g_payload.live])
+    {
+        return TRUE;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        if(pending[i] != live[i])
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      storePayload
+ *
+ *  DESCRIPTION
+ *      This function clears the advertising data and stores the AD
+ *      structures of a payload one by one. Advertising must be off.
+ *
+ *  RETURNS
+ *      TRUE if the controller took every AD structure.
+ *
+ *---------------------------------------------------------------------------*/
+static bool storePayload(uint8 index)
+{
+    uint8 *data = g_payload.data[index];
+    uint8 len = g_payload.len[index];
+    uint8 offset;
+
+    LsStoreAdvScanData(0, NULL, ad_src_advertise);
+    for(offset = 0; offset < len; offset += data[offset] + 1)
+    {
+        if(LsStoreAdvScanData(data[offset], &data[offset + 1],
+                              ad_src_advertise) != ls_err_none)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      storePending
+ *
+ *  DESCRIPTION
+ *      This function stores the pending payload, if it differs from the
+ *      one on air, and makes it the payload on air. Advertising must be
+ *      off. A payload that is not whole AD structures is refused before
+ *      anything is cleared. If the controller refuses a store part way,
+ *      the payload on air is stored again, so that a torn one is never
+ *      sent; only if that fails too is what the controller holds unknown,
+ *      and the next commit stores again.
+ *
+ *  RETURNS
+ *      TRUE if the pending payload was stored.
+ *
+ *---------------------------------------------------------------------------*/
+static bool storePending(void)
+{
+    uint8 pending = g_payload.live ^ 1;
+    uint8 *data = g_payload.data[pending];
+    uint8 len = g_payload.len[pending];
+    uint8 offset;
+
+    if(!pendingChanged())
+    {
+        return FALSE;
+    }
+
+    for(offset = 0; offset < len; offset += data[offset] + 1)
+    {
+        if(data[offset] == 0 || (uint16)offset + data[offset] + 1 > len)
+        {
+            AppDebugLog1(DEBUG_MSG_PAYLOAD_REJECTED, len);
+            return FALSE;
+        }
+    }
+
+    if(!storePayload(pending))
+    {
+        AppDebugLog1(DEBUG_MSG_PAYLOAD_REJECTED, len);
+        g_payload.invalid = g_payload.invalid ||
+                            !storePayload(g_payload.live);
+        return FALSE;
+    }
+
+    g_payload.live = pending;
+    g_payload.stale = TRUE;
+    g_payload.invalid = FALSE;
+
+    return TRUE;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadInvalidate
+ *
+ *  DESCRIPTION
+ *      This function forgets what the controller holds. It is called
+ *      whenever advertising is set up again, as the controller may not
+ *      keep the data through that, so the first commit afterwards always
+ *      stores.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void PayloadInvalidate(void)
+{
+    syncPending();
+    g_payload.invalid = TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadSetAdvertising
+ *
+ *  DESCRIPTION
+ *      This function takes how advertising is now run, which decides what
+ *      a commit does: store at once with advertising off, stop and restart
+ *      advertising around the stores, or hold the payload for
+ *      PayloadFlush(). It must be called whenever that changes; advertising
+ *      counts as off until it is first called.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void PayloadSetAdvertising(payload_adv adv)
+{
+    g_payload.adv = adv;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadLoad
+ *
+ *  DESCRIPTION
+ *      This function replaces the pending payload with a serialised frame,
+ *      AD structures with their length octets. Nothing goes on air until
+ *      the next commit.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void PayloadLoad(const uint8 *frame, uint8 len)
+{
+    uint8 pending = g_payload.live ^ 1;
+
+    if(len > MAX_ADV_DATA_LEN)
+    {
+        return;
+    }
+
+    MemCopy(g_payload.data[pending], frame, len);
+    g_payload.len[pending] = len;
+    g_payload.stale = FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadPatch
+ *
+ *  DESCRIPTION
+ *      This function overwrites a field of the pending payload, such as a
+ *      minor or a counter, leaving the rest as it was. After a commit the
+ *      pending payload starts out as a copy of the one on air, taken here
+ *      rather than on every commit since rotation only loads whole frames,
+ *      so fields can be patched one at a time and committed together.
+ *      Patches beyond the end of the payload are ignored.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void PayloadPatch(uint8 offset, const uint8 *value, uint8 len)
+{
+    uint8 pending = g_payload.live ^ 1;
+    uint8 i;
+
+    syncPending();
+
+    if((uint16)offset + len > g_payload.len[pending])
+    {
+        return;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        g_payload.data[pending][offset + i] = value[i];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadCommit
+ *
+ *  DESCRIPTION
+ *      This function puts the pending payload on air, if it differs from
+ *      the payload there, and makes it the payload on air; the new pending
+ *      payload stands for a copy of it. While beaconing, advertising is
+ *      stopped around the stores and restarted, which also restarts the
+ *      advertising interval. Where advertising cannot be stopped here the
+ *      payload is held, pending, for the next PayloadFlush().
+ *
+ *  RETURNS
+ *      TRUE if the payload was stored, FALSE if there was nothing to
+ *      change, it was refused or it is held.
+ *
+ *---------------------------------------------------------------------------*/
+bool PayloadCommit(void)
+{
+    bool stored;
+
+    switch(g_payload.adv)
+    {
+        case payload_adv_held:
+            return FALSE;
+
+        case payload_adv_restart:
+            if(!pendingChanged())
+            {
+                return FALSE;
+            }
+
+            LsStartStopAdvertise(FALSE, whitelist_disabled,
+                                 ls_addr_type_random);
+            stored = storePending();
+            LsStartStopAdvertise(TRUE, whitelist_disabled,
+                                 ls_addr_type_random);
+            return stored;
+
+        default:
+            return storePending();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      PayloadFlush
+ *
+ *  DESCRIPTION
+ *      This function stores a payload held by PayloadCommit(), for the
+ *      owner of advertising to call while it has advertising stopped.
+ *
+ *  RETURNS
+ *      TRUE if the payload was stored.
+ *
+ *---------------------------------------------------------------------------*/
+bool PayloadFlush(void)
+{
+    return storePending();
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_payload.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the advertising payload, a double-buffered
+ *      copy of the advertising data that is patched off air and committed
+ *      to the controller whole
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_PAYLOAD_H__
+#define __BEACON_PAYLOAD_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* How advertising is run, which decides when a commit may store */
+typedef enum
+{
+    /* Advertising is off; a commit stores at once */
+    payload_adv_off,
+
+    /* Beaconing; a commit stops advertising around the stores */
+    payload_adv_restart,
+
+    /* Advertising cannot be stopped at will; a commit is held for the
+     * next PayloadFlush()
+     */
+    payload_adv_held
+} payload_adv;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Forget the payload on air, so that the next commit stores it whatever it
+ * holds; for use when advertising is set up again
+ */
+extern void PayloadInvalidate(void);
+
+/* Say how advertising is now run; off until first called */
+extern void PayloadSetAdvertising(payload_adv adv);
+
+/* Replace the pending payload with a serialised frame of len octets */
+extern void PayloadLoad(const uint8 *frame, uint8 len);
+
+/* Patch len octets of the pending payload at the given offset */
+extern void PayloadPatch(uint8 offset, const uint8 *value, uint8 len);
+
+/* Put the pending payload on air, if it differs from the payload there,
+ * stopping advertising around the stores or holding it as
+ * PayloadSetAdvertising() says. Returns TRUE if it was stored.
+ */
+extern bool PayloadCommit(void);
+
+/* Store a held payload; advertising must be stopped. Returns TRUE if it
+ * was stored.
+ */
+extern bool PayloadFlush(void);
+
+#endif /* __BEACON_PAYLOAD_H__ */
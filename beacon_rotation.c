@@ -0,0 +1,397 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_rotation.c
+ *
+ *  DESCRIPTION
+ *      This file interleaves the iBeacon and Eddystone frames on air. Every
+ *      frame is serialised once at initialisation; a single task then swaps
+ *      the frame the controller advertises, so a rotation costs only the
+ *      store of a ready-made frame.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_frame.h"
+#include "beacon_rotation.h"
+#include "beacon_payload.h"
+#include "beacon_dispatch.h"
+#include "beacon_eid.h"
+#include "beacon_telemetry.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* How late a rotation may be, so that it can share a wake-up */
+#define ROTATION_TOLERANCE              (BEACON_ROTATION_PERIOD / 10)
+
+DISPATCH_CHECK_SPAN(rotation, BEACON_ROTATION_PERIOD + ROTATION_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* One serialised frame in the ring */
+typedef struct
+{
+    uint8 *frame;
+    uint8 len;
+} ROTATION_SLOT_T;
+
+typedef struct
+{
+    /* Frames in on-air form, indexed by rotation_frame */
+    ROTATION_SLOT_T ring[rotation_frame_count];
+
+    /* Weight of each frame type and its running credit for the smooth
+     * weighted round robin
+     */
+    uint8 weight[rotation_frame_count];
+    int16 credit[rotation_frame_count];
+    uint8 total_weight;
+
+    /* Frame currently on air */
+    rotation_frame current;
+
+    /* Rotation task */
+    dispatch_task task;
+} ROTATION_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static ROTATION_DATA_T g_rotation;
+
+/* Eddystone frames, starting out as the compile-time templates */
+static uint8 g_uid_frame[EDDYSTONE_UID_FRAME_SIZE] = EDDYSTONE_UID_FRAME_INIT;
+static uint8 g_url_frame[EDDYSTONE_URL_FRAME_SIZE] = EDDYSTONE_URL_FRAME_INIT;
+static uint8 g_eid_frame[EDDYSTONE_EID_FRAME_SIZE] = EDDYSTONE_EID_FRAME_INIT;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static rotation_frame nextFrame(void);
+static void storeFrame(rotation_frame frame);
+static void rotationTask(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextFrame
+ *
+ *  DESCRIPTION
+ *      This function picks the next frame with a smooth weighted round
+ *      robin, which spreads each frame type evenly over the rotation cycle
+ *      instead of sending its periods back to back.
+ *
+ *  RETURNS
+ *      The frame to put on air next.
+ *
+ *---------------------------------------------------------------------------*/
+static rotation_frame nextFrame(void)
+{
+    rotation_frame next = rotation_frame_count;
+    rotation_frame frame;
+
+    for(frame = 0; frame < rotation_frame_count; frame++)
+    {
+        if(g_rotation.weight[frame] == 0)
+        {
+            continue;
+        }
+
+        g_rotation.credit[frame] += g_rotation.weight[frame];
+        if(next == rotation_frame_count ||
+           g_rotation.credit[frame] > g_rotation.credit[next])
+        {
+            next = frame;
+        }
+    }
+
+    g_rotation.credit[next] -= g_rotation.total_weight;
+
+    return next;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      storeFrame
+ *
+ *  DESCRIPTION
+ *      This function commits a serialised frame as the advertising data,
+ *      or leaves it alone if the frame on air is the same. The payload
+ *      module keeps advertising off while the data is stored, restarting it
+ *      or holding the frame for the slot task's next restart.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void storeFrame(rotation_frame frame)
+{
+    const ROTATION_SLOT_T *slot = &g_rotation.ring[frame];
+
+    AppDebugLog1(DEBUG_MSG_ROTATION_FRAME, frame);
+
+    if(frame == rotation_frame_eddystone_tlm)
+    {
+        TelemetryUpdate();
+    }
+
+    PayloadLoad(slot->frame, slot->len);
+    PayloadCommit();
+
+    g_rotation.current = frame;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      rotationTask
+ *
+ *  DESCRIPTION
+ *      This function is called every rotation period and swaps in the next
+ *      frame if it differs from the one on air.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void rotationTask(void)
+{
+    rotation_frame next;
+
+    /* The TLM frame is stored at least once a rotation cycle, which keeps
+     * its counters current
+     */
+    next = nextFrame();
+    if(next != g_rotation.current ||
+       next == rotation_frame_eddystone_tlm)
+    {
+        storeFrame(next);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationInit
+ *
+ *  DESCRIPTION
+ *      This function serialises the Eddystone frames from the iBeacon
+ *      frame so that every frame identifies the same beacon, and sets up
+ *      the frame weights.
+ *      A zero weights value selects the user_config.h defaults.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationInit(uint8 *ibeacon_frame, uint16 weights)
+{
+    rotation_frame frame;
+
+    if(weights == 0)
+    {
+        weights = ROTATION_DEFAULT_WEIGHTS;
+    }
+
+    RotationSetIdentity(ibeacon_frame);
+
+    g_rotation.ring[rotation_frame_ibeacon].frame = ibeacon_frame;
+    g_rotation.ring[rotation_frame_ibeacon].len = BEACON_FRAME_SIZE;
+    g_rotation.ring[rotation_frame_eddystone_uid].frame = g_uid_frame;
+    g_rotation.ring[rotation_frame_eddystone_uid].len =
+        EDDYSTONE_UID_FRAME_SIZE;
+    g_rotation.ring[rotation_frame_eddystone_url].frame = g_url_frame;
+    g_rotation.ring[rotation_frame_eddystone_url].len =
+        EDDYSTONE_URL_FRAME_SIZE;
+    g_rotation.ring[rotation_frame_eddystone_tlm].frame = TelemetryFrame();
+    g_rotation.ring[rotation_frame_eddystone_tlm].len = TelemetryFrameSize();
+
+    g_rotation.total_weight = 0;
+    for(frame = 0; frame < rotation_frame_count; frame++)
+    {
+        g_rotation.weight[frame] =
+            (weights >> (4 * (rotation_frame_count - 1 - frame))) & 0xF;
+        g_rotation.total_weight += g_rotation.weight[frame];
+    }
+
+    /* The sensors are only sampled for a beacon that sends TLM */
+    if(g_rotation.weight[rotation_frame_eddystone_tlm] != 0)
+    {
+        TelemetryInit();
+    }
+
+    g_rotation.task = DispatchAddTask(rotationTask, ROTATION_TOLERANCE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationStart
+ *
+ *  DESCRIPTION
+ *      This function stores the first frame of the rotation, whatever the
+ *      controller held before advertising was set up again. The rotation
+ *      task only runs if there is more than one frame type to interleave
+ *      or a TLM frame to keep current, so a plain iBeacon never wakes for
+ *      it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationStart(uint32 adv_interval)
+{
+    rotation_frame frame;
+
+    RotationStop();
+
+    TelemetryAdvStart(adv_interval);
+    for(frame = 0; frame < rotation_frame_count; frame++)
+    {
+        g_rotation.credit[frame] = 0;
+    }
+
+    PayloadInvalidate();
+    storeFrame(nextFrame());
+
+    if(g_rotation.weight[g_rotation.current] != g_rotation.total_weight ||
+       g_rotation.weight[rotation_frame_eddystone_tlm] != 0)
+    {
+        DispatchStartTask(g_rotation.task, BEACON_ROTATION_PERIOD,
+                          BEACON_ROTATION_PERIOD);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationSetIdentity
+ *
+ *  DESCRIPTION
+ *      This function patches the UUID MSW, major, minor and TX power of the
+ *      iBeacon frame into the Eddystone frames. It takes effect from the
+ *      next store of each frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationSetIdentity(const uint8 *ibeacon_frame)
+{
+    /* Eddystone-UID namespace and instance */
+    g_uid_frame[EDDYSTONE_UID_NAMESPACE_OFFSET] =
+        ibeacon_frame[BEACON_FRAME_UUID_OFFSET];
+    g_uid_frame[EDDYSTONE_UID_NAMESPACE_OFFSET + 1] =
+        ibeacon_frame[BEACON_FRAME_UUID_OFFSET + 1];
+    BEACON_FRAME_SET_WORD(g_uid_frame, EDDYSTONE_UID_MAJOR_OFFSET,
+        BEACON_FRAME_GET_WORD(ibeacon_frame, BEACON_FRAME_MAJOR_OFFSET));
+    BEACON_FRAME_SET_WORD(g_uid_frame, EDDYSTONE_UID_MINOR_OFFSET,
+        BEACON_FRAME_GET_WORD(ibeacon_frame, BEACON_FRAME_MINOR_OFFSET));
+
+    /* Calibrated TX power */
+    RotationSetTxPower((int8)ibeacon_frame[BEACON_FRAME_TX_POWER_OFFSET]);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationRefresh
+ *
+ *  DESCRIPTION
+ *      This function stores the frame on air again after it has been
+ *      patched, if the patch changed it. Advertising carries on throughout.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationRefresh(void)
+{
+    storeFrame(g_rotation.current);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationSetTxPower
+ *
+ *  DESCRIPTION
+ *      This function patches the calibrated TX power of the Eddystone
+ *      frames from the iBeacon TX power. It takes effect from the next
+ *      store of each frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationSetTxPower(int8 tx_power)
+{
+    uint8 txPower = (uint8)(tx_power + EDDYSTONE_TX_POWER_1M_TO_0M);
+
+    g_uid_frame[EDDYSTONE_UID_TX_POWER_OFFSET] = txPower;
+    g_url_frame[EDDYSTONE_URL_TX_POWER_OFFSET] = txPower;
+    g_eid_frame[EDDYSTONE_EID_TX_POWER_OFFSET] = txPower;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationSetEid
+ *
+ *  DESCRIPTION
+ *      This function patches an ephemeral ID into the Eddystone-EID frame,
+ *      which from then on takes the place of the Eddystone-UID frame so
+ *      that no fixed identity is sent. It takes effect from the next store
+ *      of the frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationSetEid(const uint8 *eid)
+{
+    uint8 i;
+
+    for(i = 0; i < EID_LENGTH; i++)
+    {
+        g_eid_frame[EDDYSTONE_EID_ID_OFFSET + i] = eid[i];
+    }
+
+    g_rotation.ring[rotation_frame_eddystone_uid].frame = g_eid_frame;
+    g_rotation.ring[rotation_frame_eddystone_uid].len =
+        EDDYSTONE_EID_FRAME_SIZE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RotationStop
+ *
+ *  DESCRIPTION
+ *      This function stops the rotation task.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RotationStop(void)
+{
+    DispatchStopTask(g_rotation.task);
+}
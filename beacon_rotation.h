@@ -0,0 +1,81 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_rotation.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the advertising frame rotation
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_ROTATION_H__
+#define __BEACON_ROTATION_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Frame rotation weights are packed one nibble per frame type, iBeacon in
+ * the most significant nibble
+ */
+#define ROTATION_WEIGHTS(ibeacon, uid, url, tlm)                            \
+    ((uint16)(((ibeacon) << 12) | ((uid) << 8) | ((url) << 4) | (tlm)))
+
+#define ROTATION_DEFAULT_WEIGHTS                                            \
+    ROTATION_WEIGHTS(BEACON_ROTATION_IBEACON_WEIGHT,                        \
+                     BEACON_ROTATION_EDDYSTONE_UID_WEIGHT,                  \
+                     BEACON_ROTATION_EDDYSTONE_URL_WEIGHT,                  \
+                     BEACON_ROTATION_EDDYSTONE_TLM_WEIGHT)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Frame types in the rotation */
+typedef enum
+{
+    rotation_frame_ibeacon,
+    rotation_frame_eddystone_uid,
+    rotation_frame_eddystone_url,
+    rotation_frame_eddystone_tlm,
+
+    rotation_frame_count
+} rotation_frame;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Serialise every frame of the rotation from the patched iBeacon frame */
+extern void RotationInit(uint8 *ibeacon_frame, uint16 weights);
+
+/* Store the first frame and start rotating; the advertising interval is
+ * passed on to keep the TLM advertising count
+ */
+extern void RotationStart(uint32 adv_interval);
+
+/* Patch the identity and TX power of the iBeacon frame into the Eddystone
+ * frames
+ */
+extern void RotationSetIdentity(const uint8 *ibeacon_frame);
+
+/* Send the Eddystone-EID frame with the given ID instead of Eddystone-UID */
+extern void RotationSetEid(const uint8 *eid);
+
+/* Store the frame on air again, after patching */
+extern void RotationRefresh(void);
+
+/* Patch a new iBeacon TX power into the Eddystone frames */
+extern void RotationSetTxPower(int8 tx_power);
+
+/* Stop rotating, leaving the current frame on air */
+extern void RotationStop(void);
+
+#endif /* __BEACON_ROTATION_H__ */
@@ -0,0 +1,101 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_scan.c
+ *
+ *  DESCRIPTION
+ *      This file shares the controller's scanner between the census and
+ *      the slot synchronisation, whose windows may overlap. The controller
+ *      refuses a second start and a stop ends scanning for everyone, so
+ *      scanning is started for the first user and stopped after the last.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <gap_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_scan.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Users scanning, scan_user bits */
+static uint8 g_scan_users;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ScanStart
+ *
+ *  DESCRIPTION
+ *      This function starts passive scanning for a user, listening for
+ *      BEACON_SCAN_WINDOW of every BEACON_SCAN_INTERVAL, unless another
+ *      user has already started it. Advertising carries on; the controller
+ *      scans between its events.
+ *
+ *  RETURNS
+ *      TRUE if the controller is scanning.
+ *
+ *---------------------------------------------------------------------------*/
+bool ScanStart(scan_user user)
+{
+    ls_err status;
+
+    if(g_scan_users == 0)
+    {
+        GapSetScanInterval(BEACON_SCAN_INTERVAL, BEACON_SCAN_WINDOW);
+        status = LsStartStopScan(TRUE, whitelist_disabled,
+                                 ls_addr_type_random);
+        if(status != ls_err_none)
+        {
+            AppDebugLog1(DEBUG_MSG_SCAN_FAILED, status);
+            return FALSE;
+        }
+    }
+
+    g_scan_users |= user;
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ScanStop
+ *
+ *  DESCRIPTION
+ *      This function releases the scanner for a user and stops the
+ *      controller scanning if that was the last one. A user that is not
+ *      scanning is ignored.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void ScanStop(scan_user user)
+{
+    if((g_scan_users & user) == 0)
+    {
+        return;
+    }
+
+    g_scan_users &= ~user;
+    if(g_scan_users == 0)
+    {
+        LsStartStopScan(FALSE, whitelist_disabled, ls_addr_type_random);
+    }
+}
@@ -0,0 +1,45 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_scan.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the shared scanner, which keeps the
+ *      controller scanning while any of its users needs it
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_SCAN_H__
+#define __BEACON_SCAN_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Users of the scanner, one bit each */
+typedef enum
+{
+    scan_user_census = 0x01,
+    scan_user_slots = 0x02
+} scan_user;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Scan for a user, starting the controller if no other user has. Returns
+ * FALSE if the controller refuses to scan.
+ */
+extern bool ScanStart(scan_user user);
+
+/* Release the scanner; the controller stops once no user needs it */
+extern void ScanStop(scan_user user);
+
+#endif /* __BEACON_SCAN_H__ */
@@ -0,0 +1,360 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_schedule.c
+ *
+ *  DESCRIPTION
+ *      This file limits advertising to windows of the day. Between windows
+ *      the chip hibernates, the deepest sleep it can still wake from on a
+ *      timer, and restarts through AppInit() at the next opening. RAM does
+ *      not survive hibernation, so the time of day at the wake-up is kept
+ *      in NVM.
+ *
+ *      The chip has no real time clock: the time of day is set at power-up
+ *      from a user key and kept by counting timer periods from there.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <sleep.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_common.h"
+#include "user_config.h"
+#include "beacon_schedule.h"
+#include "beacon_counters.h"
+#include "beacon_store.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define SECONDS_PER_MINUTE              (60UL)
+#define SECONDS_PER_DAY                 (24UL * 60UL * SECONDS_PER_MINUTE)
+
+/* A window given by user key 6 is in tens of minutes */
+#define SCHEDULE_KEY_WINDOW_UNIT        (10)
+
+/* Longest timer the schedule arms, well inside the 32-bit microsecond
+ * timer range; longer waits are made up of several
+ */
+#define SCHEDULE_MAX_TIMER_SECONDS      (60UL * SECONDS_PER_MINUTE)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Windows in use and their number */
+    const SCHEDULE_WINDOW_T *windows;
+    uint8 num_windows;
+
+    /* Window given by user key */
+    SCHEDULE_WINDOW_T key_window;
+
+    /* Time of day in seconds, as of the last timer expiry */
+    uint32 day_seconds;
+
+    /* Seconds left until the window closes, and the length of the timer
+     * running now
+     */
+    uint32 remaining;
+    uint32 timer_seconds;
+
+    schedule_close_handler handler;
+} SCHEDULE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static SCHEDULE_DATA_T g_schedule;
+
+static const SCHEDULE_WINDOW_T g_windows[] = BEACON_SCHEDULE_WINDOWS;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint32 secondsUntil(uint16 minute);
+static uint32 nextTransition(bool *open);
+static void armTimer(void);
+static void scheduleTimerHandler(timer_id const id);
+static void hibernate(uint32 seconds);
+static bool readClock(uint32 *day_seconds);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      secondsUntil
+ *
+ *  DESCRIPTION
+ *      This function works out how long it is until a time of day.
+ *
+ *  RETURNS
+ *      Seconds from now until the minute comes round, 0 if it is now.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 secondsUntil(uint16 minute)
+{
+    return (minute * SECONDS_PER_MINUTE + SECONDS_PER_DAY -
+            g_schedule.day_seconds) % SECONDS_PER_DAY;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextTransition
+ *
+ *  DESCRIPTION
+ *      This function finds whether a window is open now and how long it is
+ *      until the schedule next changes: the close of the open window, or
+ *      the nearest opening.
+ *
+ *  RETURNS
+ *      Seconds until the next transition.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 nextTransition(bool *open)
+{
+    uint32 next = SECONDS_PER_DAY;
+    uint8 i;
+
+    *open = FALSE;
+
+    for(i = 0; i < g_schedule.num_windows; i++)
+    {
+        const SCHEDULE_WINDOW_T *window = &g_schedule.windows[i];
+        uint32 to_open;
+        uint32 to_close;
+
+        if(window->open == window->close)
+        {
+            continue;
+        }
+
+        /* a window closing now is a whole day from closing again */
+        to_open = secondsUntil(window->open);
+        to_close = secondsUntil(window->close);
+        if(to_close == 0)
+        {
+            to_close = SECONDS_PER_DAY;
+        }
+
+        /* The window is open if it closes before it next opens */
+        if(to_close < to_open || to_open == 0)
+        {
+            *open = TRUE;
+            return to_close;
+        }
+
+        if(to_open < next)
+        {
+            next = to_open;
+        }
+    }
+
+    return next;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      armTimer
+ *
+ *  DESCRIPTION
+ *      This function arms the timer for the rest of the open window, or
+ *      as much of it as one timer can cover.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void armTimer(void)
+{
+    g_schedule.timer_seconds = g_schedule.remaining;
+    if(g_schedule.timer_seconds > SCHEDULE_MAX_TIMER_SECONDS)
+    {
+        g_schedule.timer_seconds = SCHEDULE_MAX_TIMER_SECONDS;
+    }
+
+    TimerCreate(g_schedule.timer_seconds * SECOND, TRUE,
+                scheduleTimerHandler);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      scheduleTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function is called when the schedule timer expires. At the
+ *      close of the window the application stops advertising and the chip
+ *      hibernates until the next opening, unless another window is open
+ *      by then.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void scheduleTimerHandler(timer_id const id)
+{
+    uint32 wake = CountersWakeStart(counter_wake_timer);
+    bool open;
+    uint32 closed;
+
+    g_schedule.day_seconds = (g_schedule.day_seconds +
+                              g_schedule.timer_seconds) % SECONDS_PER_DAY;
+    g_schedule.remaining -= g_schedule.timer_seconds;
+
+    if(g_schedule.remaining != 0)
+    {
+        armTimer();
+    }
+    else
+    {
+        /* With windows back to back or overlapping the next one is
+         * already open, and the beacon carries on as it is
+         */
+        closed = nextTransition(&open);
+        if(!open)
+        {
+            g_schedule.handler();
+            hibernate(closed);
+        }
+        else
+        {
+            g_schedule.remaining = closed;
+            armTimer();
+        }
+    }
+
+    CountersWakeEnd(wake);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hibernate
+ *
+ *  DESCRIPTION
+ *      This function stores the time of day at the wake-up and requests
+ *      hibernation for the given time.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void hibernate(uint32 seconds)
+{
+    uint32 wake = (g_schedule.day_seconds + seconds) % SECONDS_PER_DAY;
+    uint16 clock[STORE_CLOCK_WORDS];
+
+    clock[0] = (uint16)(wake >> 16);
+    clock[1] = (uint16)wake;
+    StoreWrite(store_record_clock, clock);
+
+    SleepRequest(sleep_state_hibernate, FALSE, &seconds);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readClock
+ *
+ *  DESCRIPTION
+ *      This function reads the time of day stored before hibernation.
+ *
+ *  RETURNS
+ *      TRUE if a valid time was stored.
+ *
+ *---------------------------------------------------------------------------*/
+static bool readClock(uint32 *day_seconds)
+{
+    uint16 clock[STORE_CLOCK_WORDS];
+
+    if(!StoreRead(store_record_clock, clock))
+    {
+        return FALSE;
+    }
+
+    *day_seconds = ((uint32)clock[0] << 16) | clock[1];
+
+    return *day_seconds < SECONDS_PER_DAY;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ScheduleInit
+ *
+ *  DESCRIPTION
+ *      This function works out the time of day, from NVM after hibernation
+ *      and from the user key otherwise. Inside a window it arms the timer
+ *      for the close; outside it requests hibernation until the opening.
+ *
+ *  RETURNS
+ *      TRUE if the beacon should advertise.
+ *
+ *---------------------------------------------------------------------------*/
+bool ScheduleInit(sleep_state last_sleep_state, uint16 clock,
+                  uint16 window, schedule_close_handler handler)
+{
+    bool open;
+    uint32 next;
+
+    /* without a time of day there is no schedule */
+    if(clock == 0)
+    {
+        return TRUE;
+    }
+
+    g_schedule.handler = handler;
+
+    if(window != 0)
+    {
+        g_schedule.key_window.open =
+            WORD_MSB(window) * SCHEDULE_KEY_WINDOW_UNIT;
+        g_schedule.key_window.close =
+            WORD_LSB(window) * SCHEDULE_KEY_WINDOW_UNIT;
+        g_schedule.windows = &g_schedule.key_window;
+        g_schedule.num_windows = 1;
+    }
+    else
+    {
+        g_schedule.windows = g_windows;
+        g_schedule.num_windows = sizeof(g_windows) / sizeof(g_windows[0]);
+    }
+
+    if(last_sleep_state != sleep_state_hibernate ||
+       !readClock(&g_schedule.day_seconds))
+    {
+        g_schedule.day_seconds =
+            ((clock - 1) * SECONDS_PER_MINUTE) % SECONDS_PER_DAY;
+    }
+
+    next = nextTransition(&open);
+    if(!open)
+    {
+        hibernate(next);
+        return FALSE;
+    }
+
+    g_schedule.remaining = next;
+    armTimer();
+    AppDebugLogLong(DEBUG_MSG_SCHEDULE_OPEN, next);
+
+    return TRUE;
+}
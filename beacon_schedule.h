@@ -0,0 +1,50 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_schedule.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the advertising schedule
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_SCHEDULE_H__
+#define __BEACON_SCHEDULE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* One advertising window, in minutes since midnight */
+typedef struct
+{
+    uint16 open;
+    uint16 close;
+} SCHEDULE_WINDOW_T;
+
+/* Called at the close of a window, before the chip hibernates */
+typedef void (*schedule_close_handler)(void);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Work out the time of day and start the schedule. clock is the time of
+ * day at power-up in minutes plus one, zero turning the schedule off;
+ * window is a single window replacing BEACON_SCHEDULE_WINDOWS, open and
+ * close in tens of minutes in its MSB and LSB, or zero. Returns FALSE
+ * outside the advertising windows, in which case hibernation has been
+ * requested and the application must not start advertising.
+ */
+extern bool ScheduleInit(sleep_state last_sleep_state, uint16 clock,
+                         uint16 window, schedule_close_handler handler);
+
+#endif /* __BEACON_SCHEDULE_H__ */
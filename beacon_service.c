@@ -0,0 +1,119 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_service.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for using the beacon service
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <gatt.h>
+#include <gatt_prim.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_gatt_db.h"
+#include "beacon_service.h"
+#include "beacon_counters.h"
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void handleAccessRead(GATT_ACCESS_IND_T *p_ind);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      handleAccessRead
+ *
+ *  DESCRIPTION
+ *      This function handles read operations on the beacon service
+ *      attributes. Values longer than the ATT MTU are read in parts, so the
+ *      offset of the read is honoured.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void handleAccessRead(GATT_ACCESS_IND_T *p_ind)
+{
+    uint8 value[COUNTERS_SERIALISED_SIZE];
+
+    if(p_ind->handle != HANDLE_BEACON_COUNTERS)
+    {
+        GattAccessRsp(p_ind->cid, p_ind->handle,
+                      gatt_status_read_not_permitted, 0, NULL);
+        return;
+    }
+
+    if(p_ind->offset > COUNTERS_SERIALISED_SIZE)
+    {
+        GattAccessRsp(p_ind->cid, p_ind->handle,
+                      gatt_status_invalid_offset, 0, NULL);
+        return;
+    }
+
+    CountersSerialise(value);
+    GattAccessRsp(p_ind->cid, p_ind->handle, sys_status_success,
+                  COUNTERS_SERIALISED_SIZE - p_ind->offset,
+                  value + p_ind->offset);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BeaconHandleAccess
+ *
+ *  DESCRIPTION
+ *      This function handles GATT accesses to the beacon service. Every
+ *      attribute is read only.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void BeaconHandleAccess(GATT_ACCESS_IND_T *p_ind)
+{
+    if(p_ind->flags == (ATT_ACCESS_PERMISSION | ATT_ACCESS_READ))
+    {
+        handleAccessRead(p_ind);
+    }
+    else
+    {
+        GattAccessRsp(p_ind->cid, p_ind->handle,
+                      gatt_status_write_not_permitted, 0, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      BeaconCheckHandleRange
+ *
+ *  DESCRIPTION
+ *      This function checks whether a handle belongs to the beacon
+ *      service.
+ *
+ *  RETURNS
+ *      TRUE if it does.
+ *
+ *---------------------------------------------------------------------------*/
+bool BeaconCheckHandleRange(uint16 handle)
+{
+    return (handle >= HANDLE_BEACON_SERVICE &&
+            handle <= HANDLE_BEACON_SERVICE_END) ? TRUE : FALSE;
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_service.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the beacon service
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_SERVICE_H__
+#define __BEACON_SERVICE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <gatt_prim.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Handle a GATT access to the beacon service */
+extern void BeaconHandleAccess(GATT_ACCESS_IND_T *p_ind);
+
+/* Check whether a handle belongs to the beacon service */
+extern bool BeaconCheckHandleRange(uint16 handle);
+
+#endif /* __BEACON_SERVICE_H__ */
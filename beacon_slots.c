@@ -0,0 +1,820 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_slots.c
+ *
+ *  DESCRIPTION
+ *      This file keeps co-located beacons out of each other's advertising
+ *      events. Time is cut into frames of BEACON_SLOT_FRAME that start
+ *      whenever a sync beacon advertises, and each frame into
+ *      BEACON_SLOT_COUNT slots. The sync beacon has slot 0 and every other
+ *      beacon advertises at the start of the slot its minor picks, so
+ *      beacons with different slots never overlap however many of them
+ *      there are.
+ *
+ *      The controller adds a random advDelay of up to 10 ms to every
+ *      advertising interval, which would carry a beacon out of its slot
+ *      within a few events. Only the first event after advertising is
+ *      enabled comes without it, so a slotted beacon sets the controller's
+ *      interval out of reach and restarts advertising at each of its slots
+ *      instead.
+ *
+ *      A follower finds the frame from the sync frames it hears, taking the
+ *      earliest in a window as the least delayed. Between windows it runs on
+ *      its own sleep clock, corrected for the rate that clock was measured
+ *      to gain or lose against the sync beacon's, and each window corrects
+ *      what error is left. Until the sync beacon is first heard the
+ *      follower advertises as an unslotted beacon would.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <gap_app_if.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_frame.h"
+#include "beacon_slots.h"
+#include "beacon_payload.h"
+#include "beacon_dispatch.h"
+#include "beacon_scan.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Length of a slot */
+#define SLOTS_WIDTH                     (BEACON_SLOT_FRAME / BEACON_SLOT_COUNT)
+
+/* Controller advertising interval while slotted, the longest there is, so
+ * that it never sends an event of its own between restarts
+ */
+#define SLOTS_HOLD_INTERVAL             (10240 * MILLISECOND)
+
+/* Time from the sync beacon enabling advertising to a follower taking the
+ * report of its first PDU: the controller's start-up delay before the
+ * first event, the radio waking, the PDU itself and the application
+ * waking for the report. Only the part that differs between followers
+ * matters; the rest moves every slot alike.
+ */
+#define SLOTS_SYNC_LATENCY              (1900)
+
+/* Time from the sync beacon's PDU on one channel to its PDU on the next: the
+ * PDU, at 8 us an octet with 16 octets of overhead, and the radio turning
+ * round. A report does not say which channel it was heard on.
+ */
+#define SLOTS_CHANNEL_STEP              ((16 + SLOT_SYNC_FRAME_SIZE) * 8 + 150)
+
+/* A window that knows when to expect the sync beacon opens this long
+ * before and closes this long after
+ */
+#define SLOTS_TRACK_GUARD               (2 * MILLISECOND)
+
+/* Clock rate in units of 2^-SLOTS_DRIFT_BITS, close to parts per million,
+ * and the most it is trusted to be out: 500 ppm
+ */
+#define SLOTS_DRIFT_BITS                (20)
+#define SLOTS_DRIFT_ONE                 (1L << SLOTS_DRIFT_BITS)
+#define SLOTS_DRIFT_MASK                ((uint32)SLOTS_DRIFT_ONE - 1)
+#define SLOTS_DRIFT_MAX                 (524)
+
+/* Longest time between syncs the rate is measured over; beyond it the
+ * error may have wrapped by a frame
+ */
+#define SLOTS_RATE_SPAN_MAX             (4 * BEACON_SLOT_SYNC_PERIOD)
+
+/* A window opens up to a frame past the sync period */
+DISPATCH_CHECK_SPAN(window, BEACON_SLOT_SYNC_PERIOD + BEACON_SLOT_FRAME);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    slots_mode mode;
+
+    /* Tasks restarting advertising at the beacon's slot, and opening and
+     * closing the windows that listen for the sync beacon
+     */
+    dispatch_task slot_task;
+    dispatch_task open_task;
+    dispatch_task close_task;
+
+    /* Beaconing, and advertising in slots while doing so; the time between
+     * the beacon's own events, the offset of its slot into the frame and
+     * the TimeGet32() time of the next one
+     */
+    bool beaconing;
+    bool slotted;
+    uint32 interval;
+    uint32 offset;
+    uint32 next;
+
+    /* The frame is known: the TimeGet32() time of the start of a frame and
+     * of the last one heard from the sync beacon. Tracking once the clock
+     * rate has been measured, the windows then only listening around the
+     * sync events.
+     */
+    bool synced;
+    bool tracking;
+    uint32 epoch;
+    uint32 synced_at;
+
+    /* Rate at which the sleep clock runs fast against the sync beacon's,
+     * and the fraction of a microsecond carried from one slot to the next,
+     * both in units of 2^-SLOTS_DRIFT_BITS
+     */
+    int32 drift;
+    int32 residue;
+
+    /* Windows in a row that heard nothing */
+    uint16 misses;
+
+    /* A window is open, and the sync frames heard in it with the earliest
+     * frame start they gave
+     */
+    bool listening;
+    uint8 heard;
+    uint32 heard_epoch;
+} SLOTS_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static SLOTS_DATA_T g_slots;
+
+/* The sync frame, as a sync beacon advertises it and a follower looks for
+ * it
+ */
+static uint8 g_sync_frame[SLOT_SYNC_FRAME_SIZE] = SLOT_SYNC_FRAME_INIT;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint32 localSpan(uint32 span);
+static uint32 localSpanLong(uint32 span);
+static void advanceEpoch(uint32 now);
+static void armSlot(void);
+static void enterSlots(void);
+static void syncTo(uint32 epoch);
+static void armWindow(void);
+static bool isSyncFrame(const uint8 *data, uint16 len);
+static void slotTask(void);
+static void openWindow(void);
+static void closeWindow(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      localSpan
+ *
+ *  DESCRIPTION
+ *      This function converts a span of the sync beacon's time, of up to
+ *      half the TimeGet32() range, into the sleep clock's, carrying the
+ *      fraction of a microsecond over to the next call so that slot after
+ *      slot adds up without bias. The span is split at 2^10 us so that
+ *      neither product overflows 32 bits, as a slot interval of several
+ *      seconds times the largest drift would.
+ *
+ *  RETURNS
+ *      The span in TimeGet32() microseconds.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 localSpan(uint32 span)
+{
+    /* drift of the whole kilo-microseconds, in units of 2^-10 us */
+    int32 high = (int32)(span >> 10) * g_slots.drift;
+    int32 high_fraction = (int32)((uint32)high & 0x3FF);
+    int32 scaled = (high_fraction << 10) +
+                   (int32)(span & 0x3FF) * g_slots.drift + g_slots.residue;
+
+    g_slots.residue = (int32)((uint32)scaled & SLOTS_DRIFT_MASK);
+
+    return span + (uint32)((high - high_fraction) / 1024) +
+           (uint32)((scaled - g_slots.residue) / SLOTS_DRIFT_ONE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      localSpanLong
+ *
+ *  DESCRIPTION
+ *      This function converts a span of the sync beacon's time of up to
+ *      half the TimeGet32() range into the sleep clock's, to within a
+ *      microsecond per millisecond of drift.
+ *
+ *  RETURNS
+ *      The span in TimeGet32() microseconds.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 localSpanLong(uint32 span)
+{
+    return span + (uint32)(((int32)(span >> 10) * g_slots.drift) /
+                           (SLOTS_DRIFT_ONE >> 10));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      advanceEpoch
+ *
+ *  DESCRIPTION
+ *      This function moves the epoch on by whole frames to the last frame
+ *      start the clock puts at or before the given time.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void advanceEpoch(uint32 now)
+{
+    uint32 frames;
+
+    if((int32)(now - g_slots.epoch) <= 0)
+    {
+        return;
+    }
+
+    frames = (now - g_slots.epoch) / BEACON_SLOT_FRAME;
+    if(frames != 0)
+    {
+        g_slots.epoch += localSpanLong(frames * BEACON_SLOT_FRAME);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      armSlot
+ *
+ *  DESCRIPTION
+ *      This function starts the slot task for the beacon's next slot after
+ *      the current time, found from the epoch.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void armSlot(void)
+{
+    uint32 now = TimeGet32();
+
+    advanceEpoch(now);
+
+    g_slots.next = g_slots.epoch + g_slots.offset;
+    while((int32)(g_slots.next - now) <= 0)
+    {
+        g_slots.next += BEACON_SLOT_FRAME;
+    }
+
+    DispatchStartTask(g_slots.slot_task, g_slots.next - now, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      enterSlots
+ *
+ *  DESCRIPTION
+ *      This function hands advertising over to the slot task. Advertising
+ *      must already be stopped; the slot task enables it at the slot.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void enterSlots(void)
+{
+    GapSetAdvInterval(SLOTS_HOLD_INTERVAL, SLOTS_HOLD_INTERVAL);
+    g_slots.slotted = TRUE;
+    PayloadSetAdvertising(payload_adv_held);
+
+    armSlot();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      syncTo
+ *
+ *  DESCRIPTION
+ *      This function takes the start of a frame as heard from the sync
+ *      beacon. The error against the frame the clock predicted, over the
+ *      time since the last sync, is the rate the clock gains or loses and
+ *      is added to the correction, unless that time is too short to tell
+ *      or too long to trust; the phase is then taken as heard. The
+ *      first sync puts a beaconing follower into its slot.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void syncTo(uint32 epoch)
+{
+    int32 error = 0;
+
+    if(g_slots.synced)
+    {
+        int32 elapsed = (int32)(epoch - g_slots.synced_at);
+
+        advanceEpoch(epoch);
+        error = (int32)(epoch - g_slots.epoch);
+        if(error > (int32)(BEACON_SLOT_FRAME / 2))
+        {
+            error -= BEACON_SLOT_FRAME;
+        }
+        else if(error < -(int32)(BEACON_SLOT_FRAME / 2))
+        {
+            error += BEACON_SLOT_FRAME;
+        }
+
+        /* Once the rate is known the drift between syncs is small, and
+         * whole channel steps are down to the channels heard: late, the
+         * sync frame was heard on channel 38 or 39 and is taken back to
+         * channel 37; early, the last one was and the phase moves back
+         */
+        if(g_slots.tracking)
+        {
+            int32 steps = (error + (error < 0 ? -1 : 1) *
+                           (int32)(SLOTS_CHANNEL_STEP / 2)) /
+                          (int32)SLOTS_CHANNEL_STEP;
+
+            if(steps > 2)
+            {
+                steps = 2;
+            }
+            else if(steps < -2)
+            {
+                steps = -2;
+            }
+
+            error -= steps * SLOTS_CHANNEL_STEP;
+            if(steps > 0)
+            {
+                epoch -= (uint32)steps * SLOTS_CHANNEL_STEP;
+            }
+        }
+
+        if(elapsed >= (int32)BEACON_SLOT_FRAME &&
+           elapsed <= (int32)SLOTS_RATE_SPAN_MAX)
+        {
+            g_slots.drift += (error << 10) / (elapsed >> 10);
+            if(g_slots.drift > SLOTS_DRIFT_MAX)
+            {
+                g_slots.drift = SLOTS_DRIFT_MAX;
+            }
+            else if(g_slots.drift < -SLOTS_DRIFT_MAX)
+            {
+                g_slots.drift = -SLOTS_DRIFT_MAX;
+            }
+            g_slots.tracking = TRUE;
+        }
+    }
+
+    g_slots.epoch = epoch;
+    g_slots.synced_at = epoch;
+    g_slots.synced = TRUE;
+    g_slots.misses = 0;
+
+    AppDebugLog2(DEBUG_MSG_SLOTS_SYNC, (uint16)error, (uint16)g_slots.drift);
+
+    if(!g_slots.beaconing)
+    {
+        return;
+    }
+
+    if(g_slots.slotted)
+    {
+        armSlot();
+    }
+    else
+    {
+        LsStartStopAdvertise(FALSE, whitelist_disabled, ls_addr_type_random);
+        enterSlots();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      armWindow
+ *
+ *  DESCRIPTION
+ *      This function starts the open task for the next window. While
+ *      tracking, the window opens SLOTS_TRACK_GUARD before a sync frame is
+ *      due to be heard about BEACON_SLOT_SYNC_PERIOD from now; otherwise it
+ *      opens BEACON_SLOT_SYNC_PERIOD from now.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void armWindow(void)
+{
+    uint32 now = TimeGet32();
+    uint32 delay = BEACON_SLOT_SYNC_PERIOD;
+
+    if(g_slots.tracking)
+    {
+        uint32 frames = BEACON_SLOT_SYNC_PERIOD / BEACON_SLOT_FRAME;
+
+        advanceEpoch(now);
+        delay = g_slots.epoch + localSpanLong(frames * BEACON_SLOT_FRAME) +
+                SLOTS_SYNC_LATENCY - SLOTS_TRACK_GUARD - now;
+    }
+
+    DispatchStartTask(g_slots.open_task, delay, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      isSyncFrame
+ *
+ *  DESCRIPTION
+ *      This function compares advertising data with the sync frame, which
+ *      the sync beacon advertises alone. The frame length is part of it, so
+ *      a sync beacon keeping another frame is not followed.
+ *
+ *  RETURNS
+ *      TRUE if the data is the sync frame.
+ *
+ *---------------------------------------------------------------------------*/
+static bool isSyncFrame(const uint8 *data, uint16 len)
+{
+    uint16 i;
+
+    if(len != SLOT_SYNC_FRAME_SIZE)
+    {
+        return FALSE;
+    }
+
+    for(i = 0; i < SLOT_SYNC_FRAME_SIZE; i++)
+    {
+        if(data[i] != g_sync_frame[i])
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      slotTask
+ *
+ *  DESCRIPTION
+ *      This function is called at the start of the beacon's slot. It
+ *      restarts advertising, so that the event goes out at once without
+ *      advDelay, storing any payload committed since the last slot while
+ *      advertising is off, and sets itself for the slot one interval on.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void slotTask(void)
+{
+    int32 delay;
+
+    LsStartStopAdvertise(FALSE, whitelist_disabled, ls_addr_type_random);
+    PayloadFlush();
+    LsStartStopAdvertise(TRUE, whitelist_disabled, ls_addr_type_random);
+
+    g_slots.next += localSpan(g_slots.interval);
+    delay = (int32)(g_slots.next - TimeGet32());
+    DispatchStartTask(g_slots.slot_task, delay > 0 ? (uint32)delay : 0, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      openWindow
+ *
+ *  DESCRIPTION
+ *      This function starts scanning for the sync beacon, for
+ *      BEACON_SLOT_ACQUIRE_WINDOW or, while tracking, for twice
+ *      SLOTS_TRACK_GUARD.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void openWindow(void)
+{
+    if(!ScanStart(scan_user_slots))
+    {
+        armWindow();
+        return;
+    }
+
+    g_slots.listening = TRUE;
+    g_slots.heard = 0;
+
+    DispatchStartTask(g_slots.close_task,
+                      g_slots.tracking ? 2 * SLOTS_TRACK_GUARD :
+                                         BEACON_SLOT_ACQUIRE_WINDOW, 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      closeWindow
+ *
+ *  DESCRIPTION
+ *      This function stops scanning at the end of a window and syncs to
+ *      what it heard. A window that heard nothing drops tracking, so that
+ *      the next one listens for long enough to find the sync beacon again;
+ *      the slots carry on meanwhile.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void closeWindow(void)
+{
+    ScanStop(scan_user_slots);
+    g_slots.listening = FALSE;
+
+    if(g_slots.heard != 0)
+    {
+        syncTo(g_slots.heard_epoch);
+    }
+    else
+    {
+        g_slots.tracking = FALSE;
+        g_slots.misses++;
+        AppDebugLog1(DEBUG_MSG_SLOTS_MISSED, g_slots.misses);
+    }
+
+    armWindow();
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsInit
+ *
+ *  DESCRIPTION
+ *      This function takes the mode and adds the tasks it needs. A
+ *      follower opens its first window at once, so that it may be slotted
+ *      by the time beaconing starts.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void SlotsInit(slots_mode mode)
+{
+    g_slots.mode = mode;
+    g_slots.beaconing = FALSE;
+    g_slots.slotted = FALSE;
+    g_slots.synced = FALSE;
+    g_slots.tracking = FALSE;
+    g_slots.listening = FALSE;
+    g_slots.drift = 0;
+    g_slots.residue = 0;
+    g_slots.misses = 0;
+
+    if(mode == slots_mode_off)
+    {
+        return;
+    }
+
+    g_slots.slot_task = DispatchAddTask(slotTask, 0);
+
+    if(mode == slots_mode_follower)
+    {
+        g_slots.open_task = DispatchAddTask(openWindow, 0);
+        g_slots.close_task = DispatchAddTask(closeWindow, SLOTS_TRACK_GUARD);
+        DispatchStartTask(g_slots.open_task, 0, 0);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsMode
+ *
+ *  DESCRIPTION
+ *      This function returns the mode given to SlotsInit().
+ *
+ *  RETURNS
+ *      The mode.
+ *
+ *---------------------------------------------------------------------------*/
+slots_mode SlotsMode(void)
+{
+    return g_slots.mode;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsInterval
+ *
+ *  DESCRIPTION
+ *      This function rounds a battery ladder interval up to whole frames
+ *      for a follower. A sync beacon advertises in every frame whatever the
+ *      ladder gives, so that a follower's window hears it.
+ *
+ *  RETURNS
+ *      The time between the beacon's own events.
+ *
+ *---------------------------------------------------------------------------*/
+uint32 SlotsInterval(uint32 adv_interval)
+{
+    switch(g_slots.mode)
+    {
+        case slots_mode_follower:
+            return (adv_interval + BEACON_SLOT_FRAME - 1) /
+                   BEACON_SLOT_FRAME * BEACON_SLOT_FRAME;
+
+        case slots_mode_sync:
+            return BEACON_SLOT_FRAME;
+
+        default:
+            return adv_interval;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsStoreSyncFrame
+ *
+ *  DESCRIPTION
+ *      This function stores the sync frame as the advertising data,
+ *      whatever the controller held before.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void SlotsStoreSyncFrame(void)
+{
+    PayloadInvalidate();
+    PayloadLoad(g_sync_frame, SLOT_SYNC_FRAME_SIZE);
+    PayloadCommit();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsStart
+ *
+ *  DESCRIPTION
+ *      This function is called as beaconing starts, with advertising set up
+ *      but not enabled. A sync beacon takes the current time as the start
+ *      of its first frame; a follower that has not heard the sync beacon
+ *      yet is left to advertise as usual until it does.
+ *
+ *  RETURNS
+ *      TRUE if the slot task enables advertising.
+ *
+ *---------------------------------------------------------------------------*/
+bool SlotsStart(uint32 interval, uint16 minor)
+{
+    if(g_slots.mode == slots_mode_off)
+    {
+        return FALSE;
+    }
+
+    g_slots.beaconing = TRUE;
+    g_slots.slotted = FALSE;
+    g_slots.interval = interval;
+
+    if(g_slots.mode == slots_mode_sync)
+    {
+        g_slots.offset = 0;
+        if(!g_slots.synced)
+        {
+            g_slots.epoch = TimeGet32();
+            g_slots.synced = TRUE;
+        }
+    }
+    else
+    {
+        g_slots.offset = (uint32)(1 + minor % (BEACON_SLOT_COUNT - 1)) *
+                         SLOTS_WIDTH;
+    }
+
+    if(!g_slots.synced)
+    {
+        return FALSE;
+    }
+
+    enterSlots();
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsStop
+ *
+ *  DESCRIPTION
+ *      This function stops the slot task as beaconing ends. The sync
+ *      windows carry on, so that the frame is still known when it resumes.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void SlotsStop(void)
+{
+    g_slots.beaconing = FALSE;
+    g_slots.slotted = FALSE;
+
+    if(g_slots.mode != slots_mode_off)
+    {
+        DispatchStopTask(g_slots.slot_task);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsReport
+ *
+ *  DESCRIPTION
+ *      This function takes the frame start a sync frame gives. Later events
+ *      of the window are whole frames on; anything beyond that is delay,
+ *      from hearing a later channel or waking late, so the earliest frame
+ *      start of the window is kept.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void SlotsReport(const LM_EV_ADVERTISING_REPORT_T *report)
+{
+    uint32 epoch;
+    int32 offset;
+
+    if(!g_slots.listening ||
+       !isSyncFrame(report->data.data, report->data.length_data))
+    {
+        return;
+    }
+
+    epoch = TimeGet32() - SLOTS_SYNC_LATENCY;
+
+    if(g_slots.heard == 0)
+    {
+        g_slots.heard_epoch = epoch;
+    }
+    else
+    {
+        offset = (int32)(epoch - g_slots.heard_epoch) %
+                 (int32)BEACON_SLOT_FRAME;
+        if(offset > (int32)(BEACON_SLOT_FRAME / 2))
+        {
+            offset -= BEACON_SLOT_FRAME;
+        }
+        else if(offset < -(int32)(BEACON_SLOT_FRAME / 2))
+        {
+            offset += BEACON_SLOT_FRAME;
+        }
+        if(offset < 0)
+        {
+            g_slots.heard_epoch += (uint32)offset;
+        }
+    }
+
+    if(g_slots.heard < 0xFF)
+    {
+        g_slots.heard++;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SlotsClose
+ *
+ *  DESCRIPTION
+ *      This function stops scanning if a window is open. The window is
+ *      dropped without a sync.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void SlotsClose(void)
+{
+    if(!g_slots.listening)
+    {
+        return;
+    }
+
+    ScanStop(scan_user_slots);
+    g_slots.listening = FALSE;
+    DispatchStopTask(g_slots.close_task);
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_slots.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for slotted advertising, in which the beacons in
+ *      range of a sync beacon keep to a shared frame and advertise in
+ *      slots of their own
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_SLOTS_H__
+#define __BEACON_SLOTS_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Part the beacon plays, from bits 6 and 7 of user key 7 */
+typedef enum
+{
+    slots_mode_off,
+
+    /* Advertise in the slot the minor picks, once the sync beacon is heard */
+    slots_mode_follower,
+
+    /* Advertise the sync frame alone, in slot 0 of every frame */
+    slots_mode_sync
+} slots_mode;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Take the mode and add its tasks; a follower starts listening for the
+ * sync beacon at once
+ */
+extern void SlotsInit(slots_mode mode);
+
+/* The mode given to SlotsInit() */
+extern slots_mode SlotsMode(void);
+
+/* Time between the beacon's own events for a battery ladder interval: a
+ * whole number of frames when slotted
+ */
+extern uint32 SlotsInterval(uint32 adv_interval);
+
+/* Store the sync frame as the advertising data, for a sync beacon */
+extern void SlotsStoreSyncFrame(void);
+
+/* Take over advertising for beaconing at the given SlotsInterval(), in the
+ * slot of the minor. Returns FALSE if the beacon is not slotted yet and
+ * the caller is to start advertising as usual.
+ */
+extern bool SlotsStart(uint32 interval, uint16 minor);
+
+/* Stop advertising in slots, leaving advertising to the caller */
+extern void SlotsStop(void);
+
+/* Take the time of a sync frame heard in a window that is open */
+extern void SlotsReport(const LM_EV_ADVERTISING_REPORT_T *report);
+
+/* Stop scanning, dropping the window in progress, before hibernating */
+extern void SlotsClose(void);
+
+#endif /* __BEACON_SLOTS_H__ */
@@ -0,0 +1,417 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_store.c
+ *
+ *  DESCRIPTION
+ *      This file keeps the records the beacon writes to NVM itself. Each
+ *      record has a ring of slots, and every write goes to the slot after
+ *      the latest copy, so the latest copy is never touched while a newer
+ *      one is being written and the writes are spread over the ring.
+ *
+ *      A ring holds a sequence word for each of its slots, then the slots,
+ *      each a copy of the record and its CRC. A write puts the copy in the
+ *      slot first and its sequence word last. The CRC covers the record
+ *      kind, its layout version and the sequence number, so a copy cut
+ *      short by a brown-out, a copy whose sequence word was not written and
+ *      a copy of an older layout all fail it. Reading takes the sequence
+ *      words in one NVM read and only the copy with the highest sequence
+ *      number that passes, so the cost does not grow with the ring.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <nvm.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "app_common.h"
+#include "beacon_store.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Layout versions of the records; a change to a record's layout must bump
+ * its version, so that copies of the old layout are ignored. The host store
+ * check builds the store again with a version bumped.
+ */
+#ifndef STORE_CLOCK_VERSION
+#define STORE_CLOCK_VERSION             (1)
+#endif
+#ifndef STORE_COUNTERS_VERSION
+#define STORE_COUNTERS_VERSION          (1)
+#endif
+#ifndef STORE_CONFIG_VERSION
+#define STORE_CONFIG_VERSION            (1)
+#endif
+#ifndef STORE_EID_COUNTER_VERSION
+#define STORE_EID_COUNTER_VERSION       (1)
+#endif
+
+/* Words of a ring taken by each slot besides the record: its sequence word
+ * and its CRC
+ */
+#define STORE_SLOT_OVERHEAD             (2)
+#define STORE_RING_WORDS(words, slots)  ((slots) * \
+                                         ((words) + STORE_SLOT_OVERHEAD))
+
+/* Most slots in a ring, and the largest record */
+#define STORE_MAX_SLOTS                 (8)
+#define STORE_MAX_WORDS                 (STORE_COUNTERS_WORDS)
+
+/* Slots of the rings written now and then: two, so that the latest copy
+ * survives a brown-out during the next write
+ */
+#define STORE_CLOCK_SLOTS               (2)
+#define STORE_CONFIG_SLOTS              (2)
+#define STORE_EID_COUNTER_SLOTS         (2)
+
+/* The counters, written every snapshot, get the rest of the store */
+#define STORE_SMALL_RINGS_WORDS                                              \
+    (STORE_RING_WORDS(STORE_CLOCK_WORDS, STORE_CLOCK_SLOTS) +                \
+     STORE_RING_WORDS(STORE_CONFIG_WORDS, STORE_CONFIG_SLOTS) +              \
+     STORE_RING_WORDS(STORE_EID_COUNTER_WORDS, STORE_EID_COUNTER_SLOTS))
+#define STORE_COUNTERS_FIT                                                   \
+    ((NVM_STORE_WORDS - STORE_SMALL_RINGS_WORDS) /                           \
+     (STORE_COUNTERS_WORDS + STORE_SLOT_OVERHEAD))
+#define STORE_COUNTERS_SLOTS            (STORE_COUNTERS_FIT < STORE_MAX_SLOTS \
+                                         ? STORE_COUNTERS_FIT : STORE_MAX_SLOTS)
+
+/* Where the rings start in NVM */
+#define STORE_OFFSET_CLOCK              (NVM_OFFSET_STORE)
+#define STORE_OFFSET_CONFIG             (STORE_OFFSET_CLOCK +                \
+                                         STORE_RING_WORDS(STORE_CLOCK_WORDS, \
+                                                          STORE_CLOCK_SLOTS))
+#define STORE_OFFSET_EID_COUNTER        (STORE_OFFSET_CONFIG +               \
+                                         STORE_RING_WORDS(STORE_CONFIG_WORDS, \
+                                                          STORE_CONFIG_SLOTS))
+#define STORE_OFFSET_COUNTERS           (STORE_OFFSET_EID_COUNTER +          \
+                                         STORE_RING_WORDS(                   \
+                                             STORE_EID_COUNTER_WORDS,        \
+                                             STORE_EID_COUNTER_SLOTS))
+
+/* Sequence words of unwritten EEPROM; no copy is given either, so empty
+ * slots are passed over without reading them
+ */
+#define STORE_SEQ_ERASED                (0xFFFF)
+#define STORE_SEQ_ZERO                  (0x0000)
+
+/* Slot of a ring without a valid copy */
+#define STORE_SLOT_NONE                 (0xFF)
+
+/* CRC-16/CCITT, taken a word at a time, most significant bit first */
+#define STORE_CRC_POLY                  (0x1021)
+#define STORE_CRC_INIT                  (0xFFFF)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Where a record's ring is and what it holds */
+typedef struct
+{
+    uint16 offset;
+    uint8 words;
+    uint8 slots;
+    uint8 version;
+} STORE_RING_T;
+
+/* The latest valid copy of a record, once it has been looked for since
+ * StoreInit()
+ */
+typedef struct
+{
+    bool located;
+    uint8 slot;
+    uint16 seq;
+} STORE_HEAD_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Rings in the order of store_record */
+static const STORE_RING_T g_rings[store_record_count] =
+{
+    { STORE_OFFSET_CLOCK,       STORE_CLOCK_WORDS,
+      STORE_CLOCK_SLOTS,        STORE_CLOCK_VERSION         },
+    { STORE_OFFSET_COUNTERS,    STORE_COUNTERS_WORDS,
+      STORE_COUNTERS_SLOTS,     STORE_COUNTERS_VERSION      },
+    { STORE_OFFSET_CONFIG,      STORE_CONFIG_WORDS,
+      STORE_CONFIG_SLOTS,       STORE_CONFIG_VERSION        },
+    { STORE_OFFSET_EID_COUNTER, STORE_EID_COUNTER_WORDS,
+      STORE_EID_COUNTER_SLOTS,  STORE_EID_COUNTER_VERSION   }
+};
+
+static STORE_HEAD_T g_heads[store_record_count];
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static uint16 crcWord(uint16 crc, uint16 word);
+static uint16 slotCrc(store_record record, uint16 seq, const uint16 *words);
+static uint16 slotOffset(const STORE_RING_T *ring, uint8 slot);
+static bool locate(store_record record, uint16 *words);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      crcWord
+ *
+ *  DESCRIPTION
+ *      This function adds a word to a CRC.
+ *
+ *  RETURNS
+ *      The new CRC.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 crcWord(uint16 crc, uint16 word)
+{
+    uint8 bit;
+
+    crc ^= word;
+    for(bit = 0; bit < 16; bit++)
+    {
+        crc = (crc & 0x8000) ? (uint16)((crc << 1) ^ STORE_CRC_POLY) :
+                               (uint16)(crc << 1);
+    }
+
+    return crc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      slotCrc
+ *
+ *  DESCRIPTION
+ *      This function works out the CRC of a copy of a record with the
+ *      given sequence number.
+ *
+ *  RETURNS
+ *      The CRC.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 slotCrc(store_record record, uint16 seq, const uint16 *words)
+{
+    const STORE_RING_T *ring = &g_rings[record];
+    uint16 crc = STORE_CRC_INIT;
+    uint8 i;
+
+    crc = crcWord(crc, ((uint16)record << 8) | ring->version);
+    crc = crcWord(crc, seq);
+    for(i = 0; i < ring->words; i++)
+    {
+        crc = crcWord(crc, words[i]);
+    }
+
+    return crc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      slotOffset
+ *
+ *  DESCRIPTION
+ *      This function works out where a slot of a ring is, after the
+ *      sequence words.
+ *
+ *  RETURNS
+ *      The NVM offset of the slot.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 slotOffset(const STORE_RING_T *ring, uint8 slot)
+{
+    return ring->offset + ring->slots + slot * (ring->words + 1);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      locate
+ *
+ *  DESCRIPTION
+ *      This function finds the latest valid copy of a record, trying the
+ *      slots from the highest sequence number down until one passes its
+ *      CRC, and optionally reads it. NVM must be configured.
+ *
+ *  RETURNS
+ *      TRUE if there is a valid copy.
+ *
+ *---------------------------------------------------------------------------*/
+static bool locate(store_record record, uint16 *words)
+{
+    const STORE_RING_T *ring = &g_rings[record];
+    STORE_HEAD_T *head = &g_heads[record];
+    uint16 seq[STORE_MAX_SLOTS];
+    uint16 copy[STORE_MAX_WORDS + 1];
+    uint8 tried = 0;
+    uint8 best;
+    uint8 i;
+
+    head->located = TRUE;
+    head->slot = STORE_SLOT_NONE;
+
+    if(NvmRead(seq, ring->slots, ring->offset) != sys_status_success)
+    {
+        return FALSE;
+    }
+
+    for(;;)
+    {
+        best = STORE_SLOT_NONE;
+        for(i = 0; i < ring->slots; i++)
+        {
+            if((tried & (1 << i)) != 0 ||
+               seq[i] == STORE_SEQ_ERASED || seq[i] == STORE_SEQ_ZERO)
+            {
+                continue;
+            }
+
+            /* sequence numbers wrap, so the highest is the one ahead */
+            if(best == STORE_SLOT_NONE || (int16)(seq[i] - seq[best]) > 0)
+            {
+                best = i;
+            }
+        }
+
+        if(best == STORE_SLOT_NONE)
+        {
+            return FALSE;
+        }
+        tried |= 1 << best;
+
+        if(NvmRead(copy, ring->words + 1,
+                   slotOffset(ring, best)) == sys_status_success &&
+           copy[ring->words] == slotCrc(record, seq[best], copy))
+        {
+            break;
+        }
+    }
+
+    head->slot = best;
+    head->seq = seq[best];
+
+    if(words != NULL)
+    {
+        for(i = 0; i < ring->words; i++)
+        {
+            words[i] = copy[i];
+        }
+    }
+
+    return TRUE;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      StoreInit
+ *
+ *  DESCRIPTION
+ *      This function forgets where the latest copies are, which an HCI
+ *      reset would otherwise leave behind. Each ring is looked at again
+ *      the first time its record is read or written.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void StoreInit(void)
+{
+    uint8 i;
+
+    for(i = 0; i < store_record_count; i++)
+    {
+        g_heads[i].located = FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      StoreRead
+ *
+ *  DESCRIPTION
+ *      This function reads the latest valid copy of a record.
+ *
+ *  RETURNS
+ *      TRUE if there is one.
+ *
+ *---------------------------------------------------------------------------*/
+bool StoreRead(store_record record, uint16 *words)
+{
+    bool found;
+
+    NvmConfigureI2cEeprom();
+    found = locate(record, words);
+    NvmDisable();
+
+    return found;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      StoreWrite
+ *
+ *  DESCRIPTION
+ *      This function writes a new copy of a record in the slot after the
+ *      latest one, the copy and its CRC first and the sequence word that
+ *      makes it the latest last. The slot written over holds the oldest
+ *      copy, so the ring needs no compaction.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void StoreWrite(store_record record, const uint16 *words)
+{
+    const STORE_RING_T *ring = &g_rings[record];
+    STORE_HEAD_T *head = &g_heads[record];
+    uint16 copy[STORE_MAX_WORDS + 1];
+    uint16 seq = 1;
+    uint8 slot = 0;
+    uint8 i;
+
+    NvmConfigureI2cEeprom();
+
+    if(!head->located)
+    {
+        locate(record, NULL);
+    }
+
+    if(head->slot != STORE_SLOT_NONE)
+    {
+        slot = (uint8)((head->slot + 1) % ring->slots);
+        seq = head->seq + 1;
+        if(seq == STORE_SEQ_ERASED || seq == STORE_SEQ_ZERO)
+        {
+            seq = 1;
+        }
+    }
+
+    for(i = 0; i < ring->words; i++)
+    {
+        copy[i] = words[i];
+    }
+    copy[ring->words] = slotCrc(record, seq, words);
+
+    NvmWrite(copy, ring->words + 1, slotOffset(ring, slot));
+    NvmWrite(&seq, 1, ring->offset + slot);
+
+    NvmDisable();
+
+    head->slot = slot;
+    head->seq = seq;
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_store.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the record store, which keeps the records
+ *      the beacon writes to NVM itself in rings of CRC-protected slots
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_STORE_H__
+#define __BEACON_STORE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Size of each record in words */
+#define STORE_CLOCK_WORDS               (2)     /* time of day at wake-up */
+#define STORE_COUNTERS_WORDS            (16)    /* runtime counter totals */
+#define STORE_CONFIG_WORDS              (4)     /* configuration committed
+                                                 * over GATT */
+#define STORE_EID_COUNTER_WORDS         (2)     /* first ephemeral ID
+                                                 * counter not handed out */
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Records in the store, each with a ring of its own */
+typedef enum
+{
+    store_record_clock,
+    store_record_counters,
+    store_record_config,
+    store_record_eid_counter,
+
+    store_record_count
+} store_record;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Forget where the latest records are, as after a reset */
+extern void StoreInit(void);
+
+/* Read the latest valid copy of a record. Returns FALSE if there is none,
+ * leaving words untouched.
+ */
+extern bool StoreRead(store_record record, uint16 *words);
+
+/* Write a new copy of a record in the next slot of its ring, leaving the
+ * latest copy as it was until the new one is complete
+ */
+extern void StoreWrite(store_record record, const uint16 *words);
+
+#endif /* __BEACON_STORE_H__ */
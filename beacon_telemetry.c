@@ -0,0 +1,307 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_telemetry.c
+ *
+ *  DESCRIPTION
+ *      This file keeps the Eddystone-TLM frame ready to store. The battery
+ *      and die temperature are read with the ADC, which costs more than an
+ *      advert, so they are sampled every BEACON_TLM_SAMPLE_PERIOD and
+ *      encoded into the frame there and then. Storing the frame only has
+ *      the two counters to patch.
+ *
+ *      With the neighbourhood census on, the frame carries the count of
+ *      the last census window after the Eddystone service data.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <timer.h>
+#include <battery.h>
+#include <thermometer.h>
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "user_config.h"
+#include "beacon_frame.h"
+#include "beacon_telemetry.h"
+#include "beacon_dispatch.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Resolution of the TLM time since power-up */
+#define TLM_SEC_CNT_UNIT                (100 * MILLISECOND)
+
+/* How late a sample may be, so that it can share a wake-up */
+#define TLM_SAMPLE_TOLERANCE            (BEACON_TLM_SAMPLE_PERIOD / 10)
+
+DISPATCH_CHECK_SPAN(sample, BEACON_TLM_SAMPLE_PERIOD + TLM_SAMPLE_TOLERANCE);
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    /* Whether the TLM frame is sent at all */
+    bool enabled;
+
+    /* Whether the census count follows the service data; set before
+     * TelemetryInit() and kept by it
+     */
+    bool census;
+
+    /* Sampling task */
+    dispatch_task task;
+
+    /* Counters and the time they were last brought up to date */
+    uint32 adv_interval;
+    uint32 last_time;
+    uint32 uptime_residue;
+    uint32 adv_residue;
+    uint32 uptime;
+    uint32 adv_count;
+} TELEMETRY_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static TELEMETRY_DATA_T g_telemetry;
+
+/* Eddystone-TLM frame, starting out as the compile-time template, with
+ * room for the census count
+ */
+static uint8 g_tlm_frame[TLM_CENSUS_FRAME_SIZE] = EDDYSTONE_TLM_FRAME_INIT;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+static void updateCounters(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      updateCounters
+ *
+ *  DESCRIPTION
+ *      This function brings the time since power-up and advertising count
+ *      up to date. The controller does not report advertising events to
+ *      the application, so the count is estimated from the interval. It
+ *      runs on every store of the frame, well inside the 71 minute wrap of
+ *      TimeGet32().
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void updateCounters(void)
+{
+    uint32 now = TimeGet32();
+    uint32 elapsed = now - g_telemetry.last_time;
+
+    g_telemetry.last_time = now;
+
+    g_telemetry.uptime_residue += elapsed;
+    g_telemetry.uptime += g_telemetry.uptime_residue / TLM_SEC_CNT_UNIT;
+    g_telemetry.uptime_residue %= TLM_SEC_CNT_UNIT;
+
+    if(g_telemetry.adv_interval != 0)
+    {
+        g_telemetry.adv_residue += elapsed;
+        g_telemetry.adv_count +=
+            g_telemetry.adv_residue / g_telemetry.adv_interval;
+        g_telemetry.adv_residue %= g_telemetry.adv_interval;
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetryInit
+ *
+ *  DESCRIPTION
+ *      This function takes the first sample and starts the sampling task.
+ *      It is only called if the TLM frame is in the rotation, so a beacon
+ *      that does not send it never reads the sensors.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void TelemetryInit(void)
+{
+    g_telemetry.enabled = TRUE;
+    g_telemetry.adv_interval = 0;
+    g_telemetry.last_time = TimeGet32();
+    g_telemetry.uptime_residue = 0;
+    g_telemetry.adv_residue = 0;
+    g_telemetry.uptime = 0;
+    g_telemetry.adv_count = 0;
+
+    TelemetrySample();
+
+    g_telemetry.task = DispatchAddTask(TelemetrySample,
+                                       TLM_SAMPLE_TOLERANCE);
+    DispatchStartTask(g_telemetry.task, BEACON_TLM_SAMPLE_PERIOD,
+                      BEACON_TLM_SAMPLE_PERIOD);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetryFrame
+ *
+ *  DESCRIPTION
+ *      This function returns the Eddystone-TLM frame.
+ *
+ *  RETURNS
+ *      The frame, TelemetryFrameSize() octets.
+ *
+ *---------------------------------------------------------------------------*/
+uint8 *TelemetryFrame(void)
+{
+    return g_tlm_frame;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetryFrameSize
+ *
+ *  DESCRIPTION
+ *      This function returns the length of the Eddystone-TLM frame, which
+ *      is longer once the census count has been set.
+ *
+ *  RETURNS
+ *      The length in octets.
+ *
+ *---------------------------------------------------------------------------*/
+uint8 TelemetryFrameSize(void)
+{
+    return g_telemetry.census ? TLM_CENSUS_FRAME_SIZE :
+                                EDDYSTONE_TLM_FRAME_SIZE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetrySetCensus
+ *
+ *  DESCRIPTION
+ *      This function appends the census AD structure to the frame, if it
+ *      is not there yet, and sets its count. It takes effect from the next
+ *      store of the frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void TelemetrySetCensus(uint16 count)
+{
+    uint8 *ad = &g_tlm_frame[EDDYSTONE_TLM_FRAME_SIZE];
+
+    if(!g_telemetry.census)
+    {
+        ad[0] = TLM_CENSUS_SIZE;
+        ad[1] = AD_TYPE_MANUF;
+        ad[2] = WORD_LSB(SCAN_RSP_CSR_COMPANY_ID);
+        ad[3] = WORD_MSB(SCAN_RSP_CSR_COMPANY_ID);
+        ad[4] = TLM_CENSUS_TAG;
+        g_telemetry.census = TRUE;
+    }
+
+    g_tlm_frame[TLM_CENSUS_COUNT_OFFSET] = WORD_LSB(count);
+    g_tlm_frame[TLM_CENSUS_COUNT_OFFSET + 1] = WORD_MSB(count);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetryAdvStart
+ *
+ *  DESCRIPTION
+ *      This function counts the adverts at the old interval up to now and
+ *      counts at the new one from then on.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void TelemetryAdvStart(uint32 adv_interval)
+{
+    if(g_telemetry.enabled)
+    {
+        updateCounters();
+        g_telemetry.adv_interval = adv_interval;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetryUpdate
+ *
+ *  DESCRIPTION
+ *      This function patches the advertising count and time since
+ *      power-up into the frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void TelemetryUpdate(void)
+{
+    updateCounters();
+
+    BEACON_FRAME_SET_LONG(g_tlm_frame, EDDYSTONE_TLM_ADV_CNT_OFFSET,
+                          g_telemetry.adv_count);
+    BEACON_FRAME_SET_LONG(g_tlm_frame, EDDYSTONE_TLM_SEC_CNT_OFFSET,
+                          g_telemetry.uptime);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TelemetrySample
+ *
+ *  DESCRIPTION
+ *      This function reads the battery voltage and die temperature and
+ *      encodes them into the frame, the temperature in 8.8 fixed point. It
+ *      takes effect from the next store of the frame.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void TelemetrySample(void)
+{
+    uint16 battery_mv;
+    int16 temperature;
+
+    if(!g_telemetry.enabled)
+    {
+        return;
+    }
+
+    battery_mv = BatteryReadVoltage();
+    temperature = ThermometerReadTemperature();
+
+    BEACON_FRAME_SET_WORD(g_tlm_frame, EDDYSTONE_TLM_VBATT_OFFSET,
+                          battery_mv);
+    BEACON_FRAME_SET_WORD(g_tlm_frame, EDDYSTONE_TLM_TEMP_OFFSET,
+                          (uint16)temperature << 8);
+
+    AppDebugLog2(DEBUG_MSG_TELEMETRY, battery_mv, temperature);
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_telemetry.h
+ *
+ *  DESCRIPTION
+ *      Header definitions for the telemetry cache, which samples the
+ *      battery and die temperature on a slow schedule and keeps the
+ *      Eddystone-TLM frame encoded from them
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_TELEMETRY_H__
+#define __BEACON_TELEMETRY_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Take the first sample and start sampling every BEACON_TLM_SAMPLE_PERIOD */
+extern void TelemetryInit(void);
+
+/* The Eddystone-TLM frame, TelemetryFrameSize() octets */
+extern uint8 *TelemetryFrame(void);
+
+/* Length of the Eddystone-TLM frame, with the census count if it is set */
+extern uint8 TelemetryFrameSize(void);
+
+/* Send the count of the last census window with the frame. Call before
+ * RotationInit(), which takes the length of the frame.
+ */
+extern void TelemetrySetCensus(uint16 count);
+
+/* Advertising (re)started with the given interval, which is used to keep
+ * the advertising count
+ */
+extern void TelemetryAdvStart(uint32 adv_interval);
+
+/* Bring the advertising count and time since power-up in the frame up to
+ * date, before the frame is stored
+ */
+extern void TelemetryUpdate(void);
+
+/* Sample the sensors now, if telemetry is in use */
+extern void TelemetrySample(void);
+
+#endif /* __BEACON_TELEMETRY_H__ */
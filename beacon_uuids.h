@@ -0,0 +1,45 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_uuids.h
+ *
+ *  DESCRIPTION
+ *      UUID MACROs for the beacon service
+ *
+ *****************************************************************************/
+
+#ifndef __BEACON_UUIDS_H__
+#define __BEACON_UUIDS_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Brackets should not be used around the value of a macros used in db files.
+ * The parser which creates .c and .h files from .db file doesn't understand
+ * brackets and will raise syntax errors.
+ */
+
+/* Beacon service */
+#define UUID_BEACON_SERVICE         0xD5BE00015B004A3C9E1F00025B00A5A5
+
+/* Runtime counters, read only */
+#define UUID_BEACON_COUNTERS        0xD5BE00025B004A3C9E1F00025B00A5A5
+
+/* Configuration service */
+#define UUID_CONFIG_SERVICE         0xD5BE01005B004A3C9E1F00025B00A5A5
+
+/* Beacon identity and TX power, staged until committed */
+#define UUID_CONFIG_UUID_MSW        0xD5BE01015B004A3C9E1F00025B00A5A5
+#define UUID_CONFIG_MAJOR           0xD5BE01025B004A3C9E1F00025B00A5A5
+#define UUID_CONFIG_MINOR           0xD5BE01035B004A3C9E1F00025B00A5A5
+#define UUID_CONFIG_TX_POWER        0xD5BE01045B004A3C9E1F00025B00A5A5
+
+/* Passcode which unlocks writes, write only */
+#define UUID_CONFIG_PASSCODE        0xD5BE01055B004A3C9E1F00025B00A5A5
+
+/* Commit (1) or discard (0) the staged writes, write only */
+#define UUID_CONFIG_COMMIT          0xD5BE01065B004A3C9E1F00025B00A5A5
+
+#endif /* __BEACON_UUIDS_H__ */
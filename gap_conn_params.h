@@ -34,6 +34,21 @@
 #define BEACON_ADVERTISING_INTERVAL_MIN     (60 * MILLISECOND)
 #define BEACON_ADVERTISING_INTERVAL_MAX     (60 * MILLISECOND)
 
+/* Battery ladder. Each tier gives the advertising interval, the transmit
+ * power in &TX_POWER_LEVEL steps (0 to 7) and the battery voltage in mV
+ * down to which the tier is used. Tiers run from a fresh cell to a flat
+ * one and the last tier is also used once the battery low event is seen.
+ */
+#define BEACON_LADDER_TIERS                                                 \
+{                                                                           \
+    { BEACON_ADVERTISING_INTERVAL_MIN, 0, 2700 },                           \
+    { 300 * MILLISECOND,               0, 2400 },                           \
+    { RP_ADVERTISING_INTERVAL_MIN,     0, 0    }                            \
+}
+
+/* How often the battery voltage is checked against the ladder */
+#define BEACON_LADDER_SAMPLE_PERIOD         (10 * MINUTE)
+
 /* Maximum number of connection parameter update requests that can be send when 
  * connected
  */
@@ -0,0 +1,867 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      adv_decode.c
+ *
+ *  DESCRIPTION
+ *      Picks the beacon's iBeacon frames out of captured HCI traffic.
+ *
+ *      adv_decode [-q] [file]
+ *          reads a btsnoop file or a raw H4 stream (standard input without
+ *          a file) and writes one CSV line per matching advertising report,
+ *          or with -q only the totals.
+ *
+ *      adv_decode -r
+ *          round trip check: builds every kind of frame the firmware can
+ *          send from beacon_frame.h, wraps them in advertising reports with
+ *          other traffic, decodes them in pieces of random size and checks
+ *          that each one comes back octet for octet.
+ *
+ *      adv_decode -b reports
+ *          decodes a made-up btsnoop capture of that many reports, half of
+ *          them beacon frames, and reports the rate on one core.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "adv_decoder.h"
+#include "beacon_frame.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define READ_BUFFER_SIZE                (64 * 1024)
+
+/* btsnoop times of the made-up captures start at 2014-01-01 */
+#define BTSNOOP_UNIX_EPOCH_US           (0x00DCDDB30F2F8000ULL)
+#define CAPTURE_START_US                (1388534400ULL * 1000000)
+
+/* Largest piece the round trip check feeds at once */
+#define ROUND_TRIP_PIECE_MAX            (700)
+
+/* Shortest benchmark run, in seconds */
+#define BENCH_MIN_SECONDS               (1.0)
+
+/* Flags AD structure the stack may put in front of the frame */
+#define FLAGS_AD_SIZE                   (3)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Capture being made up */
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+    size_t size;
+    adv_decoder_format format;
+    uint64_t time_us;
+} CAPTURE_T;
+
+/* Advertising report to put in a capture */
+typedef struct
+{
+    uint8_t address[ADV_DECODER_ADDRESS_SIZE];
+    int8_t rssi;
+    uint8_t data[31];
+    uint8_t len;
+} CAPTURE_REPORT_T;
+
+/* Reports expected back from the round trip check */
+typedef struct
+{
+    uint8_t (*frames)[ADV_DECODER_FRAME_SIZE];
+    CAPTURE_REPORT_T *reports;
+    uint64_t *times;
+    uint32_t count;
+    uint32_t next;
+    uint32_t wrong;
+} ROUND_TRIP_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Frames as the firmware builds them */
+static const uint8 g_ibeacon_frame[BEACON_FRAME_SIZE] = BEACON_FRAME_INIT;
+static const uint8 g_uid_frame[EDDYSTONE_UID_FRAME_SIZE] =
+    EDDYSTONE_UID_FRAME_INIT;
+static const uint8 g_url_frame[EDDYSTONE_URL_FRAME_SIZE] =
+    EDDYSTONE_URL_FRAME_INIT;
+static const uint8 g_tlm_frame[EDDYSTONE_TLM_FRAME_SIZE] =
+    EDDYSTONE_TLM_FRAME_INIT;
+static const uint8 g_eid_frame[EDDYSTONE_EID_FRAME_SIZE] =
+    EDDYSTONE_EID_FRAME_INIT;
+
+/* Values of the 16-bit fields worth trying in every combination */
+static const uint16_t g_edge_words[] = { 0x0000, 0x0001, 0x7FFF, 0x8000,
+                                         0xFFFF };
+
+#define EDGE_WORDS      (sizeof(g_edge_words) / sizeof(g_edge_words[0]))
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextRandom
+ *
+ *  DESCRIPTION
+ *      xorshift32, so that runs repeat exactly.
+ *
+ *  RETURNS
+ *      Next pseudo-random value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      seconds
+ *
+ *  DESCRIPTION
+ *      Monotonic time.
+ *
+ *  RETURNS
+ *      Time in seconds.
+ *
+ *---------------------------------------------------------------------------*/
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      putOctets
+ *
+ *  DESCRIPTION
+ *      Appends octets to a capture, growing it as needed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void putOctets(CAPTURE_T *capture, const void *data, size_t len)
+{
+    if(capture->len + len > capture->size)
+    {
+        size_t size = capture->size ? capture->size * 2 : READ_BUFFER_SIZE;
+
+        while(size < capture->len + len)
+        {
+            size *= 2;
+        }
+        capture->data = realloc(capture->data, size);
+        if(capture->data == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        capture->size = size;
+    }
+
+    memcpy(&capture->data[capture->len], data, len);
+    capture->len += len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      putBig32
+ *
+ *  DESCRIPTION
+ *      Appends a big endian 32-bit value to a capture.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void putBig32(CAPTURE_T *capture, uint32_t value)
+{
+    uint8_t octets[4];
+
+    octets[0] = (uint8_t)(value >> 24);
+    octets[1] = (uint8_t)(value >> 16);
+    octets[2] = (uint8_t)(value >> 8);
+    octets[3] = (uint8_t)value;
+    putOctets(capture, octets, sizeof(octets));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      startCapture
+ *
+ *  DESCRIPTION
+ *      Starts an empty capture, with the file header for btsnoop.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void startCapture(CAPTURE_T *capture, adv_decoder_format format)
+{
+    memset(capture, 0, sizeof(*capture));
+    capture->format = format;
+    capture->time_us = CAPTURE_START_US;
+
+    if(format == adv_decoder_btsnoop)
+    {
+        putOctets(capture, "btsnoop", 8);
+        putBig32(capture, 1);
+        putBig32(capture, 1002);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      putPacket
+ *
+ *  DESCRIPTION
+ *      Appends an H4 packet to a capture, in a btsnoop record if the
+ *      capture is btsnoop.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void putPacket(CAPTURE_T *capture, const uint8_t *packet, size_t len)
+{
+    if(capture->format == adv_decoder_btsnoop)
+    {
+        uint64_t time = capture->time_us + BTSNOOP_UNIX_EPOCH_US;
+
+        putBig32(capture, (uint32_t)len);
+        putBig32(capture, (uint32_t)len);
+        putBig32(capture, packet[0] == 0x04 ? 3 : 0);
+        putBig32(capture, 0);
+        putBig32(capture, (uint32_t)(time >> 32));
+        putBig32(capture, (uint32_t)time);
+    }
+    putOctets(capture, packet, len);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      putReports
+ *
+ *  DESCRIPTION
+ *      Appends an LE Advertising Report event carrying the given reports,
+ *      laid out one report after another as controllers send them.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void putReports(CAPTURE_T *capture, const CAPTURE_REPORT_T *reports,
+                       uint8_t count)
+{
+    uint8_t packet[3 + 255];
+    size_t len = 5;
+    uint8_t i;
+
+    packet[0] = 0x04;
+    packet[1] = 0x3E;
+    packet[3] = 0x02;
+    packet[4] = count;
+
+    for(i = 0; i < count; i++)
+    {
+        packet[len++] = 0x00;
+        packet[len++] = 0x01;
+        memcpy(&packet[len], reports[i].address, ADV_DECODER_ADDRESS_SIZE);
+        len += ADV_DECODER_ADDRESS_SIZE;
+        packet[len++] = reports[i].len;
+        memcpy(&packet[len], reports[i].data, reports[i].len);
+        len += reports[i].len;
+        packet[len++] = (uint8_t)reports[i].rssi;
+    }
+    packet[2] = (uint8_t)(len - 3);
+
+    putPacket(capture, packet, len);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      makeBeaconReport
+ *
+ *  DESCRIPTION
+ *      Builds a report of the iBeacon frame as the firmware patches it:
+ *      UUID MSW, major and minor (or the ephemeral ID in their place) and
+ *      TX power, optionally after a flags AD structure.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void makeBeaconReport(CAPTURE_REPORT_T *report, uint8 *frame,
+                             uint16_t uuid_msw, uint16_t major,
+                             uint16_t minor, uint8_t tx_power, int flags)
+{
+    uint8_t offset = 0;
+
+    memcpy(frame, g_ibeacon_frame, BEACON_FRAME_SIZE);
+    BEACON_FRAME_SET_WORD(frame, BEACON_FRAME_UUID_OFFSET, uuid_msw);
+    BEACON_FRAME_SET_WORD(frame, BEACON_FRAME_MAJOR_OFFSET, major);
+    BEACON_FRAME_SET_WORD(frame, BEACON_FRAME_MINOR_OFFSET, minor);
+    frame[BEACON_FRAME_TX_POWER_OFFSET] = tx_power;
+
+    if(flags)
+    {
+        report->data[offset++] = 0x02;
+        report->data[offset++] = 0x01;
+        report->data[offset++] = 0x04;
+    }
+    memcpy(&report->data[offset], frame, BEACON_FRAME_SIZE);
+    report->len = (uint8_t)(offset + BEACON_FRAME_SIZE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      makeOtherReport
+ *
+ *  DESCRIPTION
+ *      Builds a report that must not match: one of the Eddystone frames,
+ *      or the iBeacon frame with one octet of its prefix or its length
+ *      changed.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void makeOtherReport(CAPTURE_REPORT_T *report, uint32_t *state)
+{
+    uint32_t choice = nextRandom(state) % 6;
+
+    switch(choice)
+    {
+        case 0:
+            memcpy(report->data, g_uid_frame, sizeof(g_uid_frame));
+            report->len = sizeof(g_uid_frame);
+        break;
+
+        case 1:
+            memcpy(report->data, g_url_frame, sizeof(g_url_frame));
+            report->len = sizeof(g_url_frame);
+        break;
+
+        case 2:
+            memcpy(report->data, g_tlm_frame, sizeof(g_tlm_frame));
+            report->len = sizeof(g_tlm_frame);
+        break;
+
+        case 3:
+            memcpy(report->data, g_eid_frame, sizeof(g_eid_frame));
+            report->len = sizeof(g_eid_frame);
+        break;
+
+        case 4:
+            memcpy(report->data, g_ibeacon_frame, BEACON_FRAME_SIZE);
+            report->data[nextRandom(state) % BEACON_FRAME_UUID_OFFSET] ^=
+                (uint8_t)(1 + nextRandom(state) % 255);
+            report->len = BEACON_FRAME_SIZE;
+        break;
+
+        default:
+            memcpy(report->data, g_ibeacon_frame, BEACON_FRAME_SIZE);
+            report->len = BEACON_FRAME_SIZE - 1;
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkBatch
+ *
+ *  DESCRIPTION
+ *      Round trip handler: compares each decoded report with the frame it
+ *      was made from, re-encoding it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void checkBatch(const ADV_DECODER_BATCH_T *batch, void *context)
+{
+    ROUND_TRIP_T *expect = context;
+    uint32_t i;
+
+    for(i = 0; i < batch->count; i++)
+    {
+        uint8_t frame[ADV_DECODER_FRAME_SIZE];
+        uint32_t n = expect->next++;
+
+        if(n >= expect->count)
+        {
+            expect->wrong++;
+            continue;
+        }
+
+        AdvDecoderEncode(batch, i, frame);
+        if(memcmp(frame, expect->frames[n], sizeof(frame)) != 0 ||
+           memcmp(batch->address[i], expect->reports[n].address,
+                  ADV_DECODER_ADDRESS_SIZE) != 0 ||
+           batch->rssi[i] != expect->reports[n].rssi ||
+           batch->time_us[i] != expect->times[n])
+        {
+            expect->wrong++;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      roundTrip
+ *
+ *  DESCRIPTION
+ *      Builds captures of every TX power with every combination of edge
+ *      values of UUID MSW, major and minor, then as many random ones, with
+ *      and without flags and mixed with other frames, and decodes them in
+ *      both formats.
+ *
+ *  RETURNS
+ *      0 if every frame came back exactly and nothing else matched.
+ *
+ *---------------------------------------------------------------------------*/
+static int roundTrip(void)
+{
+    uint32_t edge = 256 * EDGE_WORDS * EDGE_WORDS * EDGE_WORDS;
+    uint32_t total = edge * 2;
+    ROUND_TRIP_T expect;
+    int format;
+    int failed = 0;
+
+    expect.frames = malloc((size_t)total * sizeof(*expect.frames));
+    expect.reports = malloc((size_t)total * sizeof(*expect.reports));
+    expect.times = malloc((size_t)total * sizeof(*expect.times));
+    if(expect.frames == NULL || expect.reports == NULL ||
+       expect.times == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for(format = adv_decoder_btsnoop; format <= adv_decoder_h4; format++)
+    {
+        ADV_DECODER_T decoder;
+        CAPTURE_T capture;
+        uint32_t state = 1;
+        uint32_t made = 0;
+        size_t offset;
+
+        startCapture(&capture, (adv_decoder_format)format);
+
+        while(made < total)
+        {
+            CAPTURE_REPORT_T reports[3];
+            uint8_t count = (uint8_t)(1 + nextRandom(&state) % 3);
+            uint8_t i;
+
+            for(i = 0; i < count && made < total; i++)
+            {
+                uint32_t n = made;
+                uint16_t uuid_msw, major, minor;
+                uint8_t tx_power;
+
+                if(nextRandom(&state) % 4 == 0)
+                {
+                    makeOtherReport(&reports[i], &state);
+                    memset(reports[i].address, 0xEE,
+                           ADV_DECODER_ADDRESS_SIZE);
+                    reports[i].rssi = -99;
+                    continue;
+                }
+
+                if(n < edge)
+                {
+                    tx_power = (uint8_t)(n % 256);
+                    uuid_msw = g_edge_words[n / 256 % EDGE_WORDS];
+                    major = g_edge_words[n / (256 * EDGE_WORDS) % EDGE_WORDS];
+                    minor = g_edge_words[n / (256 * EDGE_WORDS * EDGE_WORDS)];
+                }
+                else
+                {
+                    tx_power = (uint8_t)nextRandom(&state);
+                    uuid_msw = (uint16_t)nextRandom(&state);
+                    major = (uint16_t)nextRandom(&state);
+                    minor = (uint16_t)nextRandom(&state);
+                }
+
+                makeBeaconReport(&reports[i], expect.frames[n], uuid_msw,
+                                 major, minor, tx_power,
+                                 (int)(nextRandom(&state) & 1));
+                reports[i].address[0] = (uint8_t)n;
+                reports[i].address[1] = (uint8_t)(n >> 8);
+                reports[i].address[2] = (uint8_t)(n >> 16);
+                reports[i].address[3] = 0x00;
+                reports[i].address[4] = 0x5A;
+                reports[i].address[5] = 0xC0;
+                reports[i].rssi = (int8_t)(-(int)(n % 100) - 20);
+
+                expect.reports[n] = reports[i];
+                expect.times[n] = format == adv_decoder_btsnoop ?
+                                  capture.time_us : 0;
+                made++;
+            }
+            putReports(&capture, reports, i);
+
+            /* Something that is not an advertising report between events */
+            if(nextRandom(&state) % 8 == 0)
+            {
+                static const uint8_t complete[] =
+                    { 0x04, 0x0E, 0x04, 0x01, 0x0B, 0x20, 0x00 };
+
+                putPacket(&capture, complete, sizeof(complete));
+            }
+            capture.time_us += 1 + nextRandom(&state) % 100000;
+        }
+
+        expect.count = made;
+        expect.next = 0;
+        expect.wrong = 0;
+
+        AdvDecoderInit(&decoder, (adv_decoder_format)format, checkBatch,
+                       &expect);
+        for(offset = 0; offset < capture.len; )
+        {
+            size_t piece = 1 + nextRandom(&state) % ROUND_TRIP_PIECE_MAX;
+
+            if(piece > capture.len - offset)
+            {
+                piece = capture.len - offset;
+            }
+            AdvDecoderFeed(&decoder, &capture.data[offset], piece);
+            offset += piece;
+        }
+        if(AdvDecoderFlush(&decoder) || expect.next != expect.count ||
+           decoder.malformed != 0)
+        {
+            expect.wrong++;
+        }
+
+        printf("%-8s: %llu reports, %u beacon frames decoded, %u wrong\n",
+               format == adv_decoder_btsnoop ? "btsnoop" : "H4",
+               (unsigned long long)decoder.reports, expect.next,
+               expect.wrong);
+        failed |= expect.wrong != 0;
+
+        free(capture.data);
+    }
+
+    free(expect.frames);
+    free(expect.reports);
+    free(expect.times);
+
+    return failed;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sumBatch
+ *
+ *  DESCRIPTION
+ *      Benchmark handler: touches every decoded field, as a consumer would.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void sumBatch(const ADV_DECODER_BATCH_T *batch, void *context)
+{
+    uint64_t *sum = context;
+    uint32_t i;
+
+    for(i = 0; i < batch->count; i++)
+    {
+        *sum += batch->major[i] + batch->minor[i] + batch->tx_power[i] +
+                batch->rssi[i] + batch->uuid[i][15] + batch->address[i][0];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchmark
+ *
+ *  DESCRIPTION
+ *      Decodes a made-up btsnoop capture in READ_BUFFER_SIZE pieces until
+ *      at least BENCH_MIN_SECONDS have passed.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int benchmark(uint32_t reports)
+{
+    CAPTURE_T capture;
+    ADV_DECODER_T *decoder = malloc(sizeof(*decoder));
+    uint32_t state = 1;
+    uint32_t made = 0;
+    uint64_t sum = 0;
+    uint64_t decoded = 0;
+    uint32_t passes = 0;
+    double start, elapsed;
+
+    if(decoder == NULL)
+    {
+        return 1;
+    }
+
+    startCapture(&capture, adv_decoder_btsnoop);
+    while(made < reports)
+    {
+        CAPTURE_REPORT_T batch[3];
+        uint8_t count = (uint8_t)(1 + nextRandom(&state) % 3);
+        uint8_t i;
+
+        for(i = 0; i < count && made < reports; i++, made++)
+        {
+            uint8 frame[BEACON_FRAME_SIZE];
+
+            if(nextRandom(&state) & 1)
+            {
+                makeOtherReport(&batch[i], &state);
+            }
+            else
+            {
+                makeBeaconReport(&batch[i], frame, 0x0001,
+                                 (uint16_t)nextRandom(&state),
+                                 (uint16_t)nextRandom(&state), 0xC5,
+                                 (int)(nextRandom(&state) & 1));
+            }
+            memset(batch[i].address, (int)made, ADV_DECODER_ADDRESS_SIZE);
+            batch[i].rssi = -60;
+        }
+        putReports(&capture, batch, i);
+        capture.time_us += 100;
+    }
+
+    start = seconds();
+    do
+    {
+        size_t offset;
+
+        AdvDecoderInit(decoder, adv_decoder_btsnoop, sumBatch, &sum);
+        for(offset = 0; offset < capture.len; offset += READ_BUFFER_SIZE)
+        {
+            size_t piece = capture.len - offset;
+
+            AdvDecoderFeed(decoder, &capture.data[offset],
+                           piece < READ_BUFFER_SIZE ? piece :
+                                                      READ_BUFFER_SIZE);
+        }
+        AdvDecoderFlush(decoder);
+        decoded += decoder->reports;
+        passes++;
+        elapsed = seconds() - start;
+    } while(elapsed < BENCH_MIN_SECONDS);
+
+    printf("capture                             : %u reports, %.1f MB\n",
+           reports, capture.len / (1024.0 * 1024.0));
+    printf("beacon frames per pass              : %llu\n",
+           (unsigned long long)decoder->matched);
+    printf("passes                              : %u in %.2f s\n",
+           passes, elapsed);
+    printf("reports per second (one core)       : %.1f M\n",
+           decoded / elapsed / 1e6);
+    printf("throughput                          : %.0f MB/s\n",
+           passes * (capture.len / (1024.0 * 1024.0)) / elapsed);
+    printf("checksum                            : %llu\n",
+           (unsigned long long)sum);
+
+    free(capture.data);
+    free(decoder);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      printBatch
+ *
+ *  DESCRIPTION
+ *      Writes a CSV line per decoded report.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void printBatch(const ADV_DECODER_BATCH_T *batch, void *context)
+{
+    uint32_t i;
+
+    for(i = 0; i < batch->count; i++)
+    {
+        const uint8_t *a = batch->address[i];
+        int j;
+
+        printf("%llu,%02x:%02x:%02x:%02x:%02x:%02x,%u,%d,",
+               (unsigned long long)batch->time_us[i],
+               a[5], a[4], a[3], a[2], a[1], a[0],
+               batch->address_type[i], batch->rssi[i]);
+        for(j = 0; j < ADV_DECODER_UUID_SIZE; j++)
+        {
+            printf("%02x", batch->uuid[i][j]);
+        }
+        printf(",%u,%u,%d\n", batch->major[i], batch->minor[i],
+               batch->tx_power[i]);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      countBatch
+ *
+ *  DESCRIPTION
+ *      Handler for -q, which only wants the totals.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void countBatch(const ADV_DECODER_BATCH_T *batch, void *context)
+{
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-q] [file]\n"
+            "       %s -r\n"
+            "       %s -b reports\n"
+            "  -q  print only the totals\n"
+            "  -r  check that every frame the firmware sends round trips\n"
+            "  -b  benchmark with a made-up capture of that many reports\n",
+            name, name, name);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static ADV_DECODER_T decoder;
+    static uint8_t buffer[READ_BUFFER_SIZE];
+    adv_decoder_format format = adv_decoder_h4;
+    FILE *in = stdin;
+    int quiet = 0;
+    int incomplete;
+    size_t len;
+    int opt;
+
+    while((opt = getopt(argc, argv, "qrb:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'q':
+                quiet = 1;
+            break;
+
+            case 'r':
+                return roundTrip();
+
+            case 'b':
+                return benchmark((uint32_t)strtoul(optarg, NULL, 0));
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(argc - optind > 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(argc - optind == 1)
+    {
+        in = fopen(argv[optind], "rb");
+        if(in == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    /* The format is told from the start of the input */
+    len = fread(buffer, 1, sizeof(buffer), in);
+    if(len >= 8 && memcmp(buffer, "btsnoop", 8) == 0)
+    {
+        format = adv_decoder_btsnoop;
+    }
+
+    AdvDecoderInit(&decoder, format, quiet ? countBatch : printBatch, NULL);
+    if(!quiet)
+    {
+        printf("time_us,address,address_type,rssi,uuid,major,minor,"
+               "tx_power\n");
+    }
+
+    while(len != 0)
+    {
+        AdvDecoderFeed(&decoder, buffer, len);
+        len = fread(buffer, 1, sizeof(buffer), in);
+    }
+    incomplete = AdvDecoderFlush(&decoder);
+
+    if(in != stdin)
+    {
+        fclose(in);
+    }
+
+    fprintf(stderr, "%s: %llu %s, %llu advertising reports, %llu beacon "
+            "frames, %llu malformed\n",
+            format == adv_decoder_btsnoop ? "btsnoop" : "H4",
+            (unsigned long long)decoder.records,
+            format == adv_decoder_btsnoop ? "records" : "packets",
+            (unsigned long long)decoder.reports,
+            (unsigned long long)decoder.matched,
+            (unsigned long long)decoder.malformed);
+    if(incomplete)
+    {
+        fprintf(stderr, "input ends part way through a record\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,516 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      adv_decoder.c
+ *
+ *  DESCRIPTION
+ *      HCI LE advertising report decoder. Records are parsed in place when
+ *      they lie within one piece of input, and only a record split between
+ *      two pieces is copied. The frame prefix is compared sixteen octets at
+ *      a time, with SSE2 where the host has it.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "adv_decoder.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define BTSNOOP_HEADER_SIZE             (16)
+#define BTSNOOP_RECORD_HEADER_SIZE      (24)
+#define BTSNOOP_DATALINK_HCI            (1001)
+#define BTSNOOP_DATALINK_H4             (1002)
+
+/* Record flags of unencapsulated HCI: received, command or event */
+#define BTSNOOP_FLAGS_EVENT             (0x03)
+
+/* btsnoop times count from midnight, 1 January 0 AD */
+#define BTSNOOP_UNIX_EPOCH_US           (0x00DCDDB30F2F8000ULL)
+
+/* H4 packet types */
+#define H4_COMMAND                      (0x01)
+#define H4_ACL                          (0x02)
+#define H4_SCO                          (0x03)
+#define H4_EVENT                        (0x04)
+#define H4_ISO                          (0x05)
+
+#define HCI_EV_LE_META                  (0x3E)
+#define HCI_EV_LE_ADVERTISING_REPORT    (0x02)
+
+/* Report fields before the data: event type, address type, address and
+ * data length; the RSSI follows the data
+ */
+#define REPORT_HEADER_SIZE              (9)
+
+/* Advertising data lengths of the frame alone and after flags */
+#define FRAME_ALONE_LENGTH              (ADV_DECODER_FRAME_SIZE)
+#define FRAME_FLAGS_LENGTH              (ADV_DECODER_FRAME_SIZE + 3)
+#define FRAME_FLAGS_SKIP                (3)
+
+/* Frame field offsets, as BEACON_FRAME_*_OFFSET in beacon_frame.h */
+#define FRAME_UUID_OFFSET               (6)
+#define FRAME_MAJOR_OFFSET              (22)
+#define FRAME_MINOR_OFFSET              (24)
+#define FRAME_TX_POWER_OFFSET           (26)
+
+#define PREFIX_SIZE                     (16)
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Octets the prefix must have and which of them are compared, for the frame
+ * alone and after a flags AD structure (whose value is not compared)
+ */
+static const uint8_t g_prefix[2][PREFIX_SIZE] =
+{
+    { 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15 },
+    { 0x02, 0x01, 0x00, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15 }
+};
+
+static const uint8_t g_ignore[2][PREFIX_SIZE] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+    { 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readBig32
+ *
+ *  DESCRIPTION
+ *      Reads a big endian 32-bit value.
+ *
+ *  RETURNS
+ *      The value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t readBig32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      prefixMatches
+ *
+ *  DESCRIPTION
+ *      Compares the first sixteen octets of advertising data with a prefix
+ *      in one go. The caller makes sure sixteen octets can be read.
+ *
+ *  RETURNS
+ *      Non-zero on a match.
+ *
+ *---------------------------------------------------------------------------*/
+static int prefixMatches(const uint8_t *data, int layout)
+{
+#if defined(__SSE2__)
+    __m128i value = _mm_loadu_si128((const __m128i *)data);
+    __m128i equal = _mm_cmpeq_epi8(value,
+                        _mm_loadu_si128((const __m128i *)g_prefix[layout]));
+
+    equal = _mm_or_si128(equal,
+                _mm_loadu_si128((const __m128i *)g_ignore[layout]));
+
+    return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+    uint64_t value[2], prefix[2], ignore[2];
+
+    memcpy(value, data, PREFIX_SIZE);
+    memcpy(prefix, g_prefix[layout], PREFIX_SIZE);
+    memcpy(ignore, g_ignore[layout], PREFIX_SIZE);
+
+    return (((value[0] ^ prefix[0]) & ~ignore[0]) |
+            ((value[1] ^ prefix[1]) & ~ignore[1])) == 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findFrame
+ *
+ *  DESCRIPTION
+ *      Checks advertising data for the frame.
+ *
+ *  RETURNS
+ *      The frame, or NULL if the data does not match.
+ *
+ *---------------------------------------------------------------------------*/
+static const uint8_t *findFrame(const uint8_t *data, size_t len)
+{
+    if(len == FRAME_ALONE_LENGTH)
+    {
+        return prefixMatches(data, 0) ? data : NULL;
+    }
+
+    if(len == FRAME_FLAGS_LENGTH)
+    {
+        return prefixMatches(data, 1) ? data + FRAME_FLAGS_SKIP : NULL;
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addReport
+ *
+ *  DESCRIPTION
+ *      Decodes a matching report into the batch, handing the batch over
+ *      when it is full.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void addReport(ADV_DECODER_T *decoder, uint64_t time_us,
+                      const uint8_t *report, const uint8_t *frame,
+                      int8_t rssi)
+{
+    ADV_DECODER_BATCH_T *batch = &decoder->batch;
+    uint32_t i = batch->count;
+
+    batch->time_us[i] = time_us;
+    batch->event_type[i] = report[0];
+    batch->address_type[i] = report[1];
+    memcpy(batch->address[i], &report[2], ADV_DECODER_ADDRESS_SIZE);
+    batch->rssi[i] = rssi;
+
+    memcpy(batch->uuid[i], &frame[FRAME_UUID_OFFSET], ADV_DECODER_UUID_SIZE);
+    batch->major[i] = (uint16_t)((frame[FRAME_MAJOR_OFFSET] << 8) |
+                                 frame[FRAME_MAJOR_OFFSET + 1]);
+    batch->minor[i] = (uint16_t)((frame[FRAME_MINOR_OFFSET] << 8) |
+                                 frame[FRAME_MINOR_OFFSET + 1]);
+    batch->tx_power[i] = (int8_t)frame[FRAME_TX_POWER_OFFSET];
+
+    decoder->matched++;
+    batch->count = i + 1;
+    if(batch->count == ADV_DECODER_BATCH_SIZE)
+    {
+        decoder->handler(batch, decoder->context);
+        batch->count = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      processEvent
+ *
+ *  DESCRIPTION
+ *      Walks the reports of an LE Advertising Report event. Other events
+ *      are ignored.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void processEvent(ADV_DECODER_T *decoder, uint64_t time_us,
+                         const uint8_t *event, size_t len)
+{
+    const uint8_t *end;
+    const uint8_t *report;
+    uint8_t reports;
+
+    if(len < 4 || event[0] != HCI_EV_LE_META ||
+       event[2] != HCI_EV_LE_ADVERTISING_REPORT)
+    {
+        return;
+    }
+
+    if((size_t)event[1] + 2 > len)
+    {
+        decoder->malformed++;
+        return;
+    }
+
+    end = event + 2 + event[1];
+    report = &event[4];
+    for(reports = event[3]; reports != 0; reports--)
+    {
+        const uint8_t *frame;
+        size_t data_len;
+
+        if(report + REPORT_HEADER_SIZE > end ||
+           report + REPORT_HEADER_SIZE + report[8] + 1 > end)
+        {
+            decoder->malformed++;
+            return;
+        }
+
+        data_len = report[8];
+        decoder->reports++;
+
+        frame = findFrame(&report[REPORT_HEADER_SIZE], data_len);
+        if(frame != NULL)
+        {
+            addReport(decoder, time_us, report, frame,
+                      (int8_t)report[REPORT_HEADER_SIZE + data_len]);
+        }
+
+        report += REPORT_HEADER_SIZE + data_len + 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      recordLength
+ *
+ *  DESCRIPTION
+ *      Works out the length of the record starting at p from as much of it
+ *      as is available.
+ *
+ *  RETURNS
+ *      The length, or 0 if more of the record is needed to tell.
+ *
+ *---------------------------------------------------------------------------*/
+static size_t recordLength(const ADV_DECODER_T *decoder, const uint8_t *p,
+                           size_t available)
+{
+    if(decoder->format == adv_decoder_btsnoop)
+    {
+        if(!decoder->header_done)
+        {
+            return BTSNOOP_HEADER_SIZE;
+        }
+
+        return available < BTSNOOP_RECORD_HEADER_SIZE ? 0 :
+               BTSNOOP_RECORD_HEADER_SIZE + (size_t)readBig32(&p[4]);
+    }
+
+    if(available < 1)
+    {
+        return 0;
+    }
+
+    switch(p[0])
+    {
+        case H4_EVENT:
+            return available < 3 ? 0 : 3 + (size_t)p[2];
+
+        case H4_COMMAND:
+        case H4_SCO:
+            return available < 4 ? 0 : 4 + (size_t)p[3];
+
+        case H4_ACL:
+            return available < 5 ? 0 : 5 + (size_t)(p[3] | (p[4] << 8));
+
+        case H4_ISO:
+            return available < 5 ? 0 :
+                   5 + (size_t)((p[3] | (p[4] << 8)) & 0x3FFF);
+
+        default:
+            /* Not a packet type; step over it */
+            return 1;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      processRecord
+ *
+ *  DESCRIPTION
+ *      Handles one whole record: the btsnoop file header, a btsnoop record
+ *      or an H4 packet.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void processRecord(ADV_DECODER_T *decoder, const uint8_t *p,
+                          size_t len)
+{
+    if(decoder->format == adv_decoder_h4)
+    {
+        decoder->records++;
+        if(p[0] == H4_EVENT)
+        {
+            processEvent(decoder, 0, &p[1], len - 1);
+        }
+        else if(p[0] < H4_COMMAND || p[0] > H4_ISO)
+        {
+            decoder->malformed++;
+        }
+        return;
+    }
+
+    if(!decoder->header_done)
+    {
+        uint32_t datalink = readBig32(&p[12]);
+
+        decoder->header_done = 1;
+        decoder->h4_records = datalink == BTSNOOP_DATALINK_H4;
+        if(memcmp(p, "btsnoop", 8) != 0 ||
+           (datalink != BTSNOOP_DATALINK_H4 &&
+            datalink != BTSNOOP_DATALINK_HCI))
+        {
+            decoder->malformed++;
+        }
+        return;
+    }
+
+    decoder->records++;
+    {
+        uint64_t time_us = ((uint64_t)readBig32(&p[16]) << 32) |
+                           readBig32(&p[20]);
+        const uint8_t *packet = &p[BTSNOOP_RECORD_HEADER_SIZE];
+        size_t packet_len = len - BTSNOOP_RECORD_HEADER_SIZE;
+
+        time_us -= BTSNOOP_UNIX_EPOCH_US;
+
+        if(decoder->h4_records)
+        {
+            if(packet_len > 1 && packet[0] == H4_EVENT)
+            {
+                processEvent(decoder, time_us, &packet[1], packet_len - 1);
+            }
+        }
+        else if((readBig32(&p[8]) & BTSNOOP_FLAGS_EVENT) ==
+                BTSNOOP_FLAGS_EVENT)
+        {
+            processEvent(decoder, time_us, packet, packet_len);
+        }
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+void AdvDecoderInit(ADV_DECODER_T *decoder, adv_decoder_format format,
+                    adv_decoder_handler handler, void *context)
+{
+    decoder->format = format;
+    decoder->handler = handler;
+    decoder->context = context;
+    decoder->header_done = 0;
+    decoder->h4_records = 0;
+    decoder->carry_len = 0;
+    decoder->skip = 0;
+    decoder->batch.count = 0;
+    decoder->records = 0;
+    decoder->reports = 0;
+    decoder->matched = 0;
+    decoder->malformed = 0;
+}
+
+void AdvDecoderFeed(ADV_DECODER_T *decoder, const uint8_t *data, size_t len)
+{
+    while(len != 0)
+    {
+        size_t total;
+
+        if(decoder->skip != 0)
+        {
+            size_t take = len < decoder->skip ? len : decoder->skip;
+
+            decoder->skip -= take;
+            data += take;
+            len -= take;
+            continue;
+        }
+
+        if(decoder->carry_len != 0)
+        {
+            /* Top up the carried record; octets past its end are left in
+             * the input
+             */
+            size_t old = decoder->carry_len;
+            size_t take = ADV_DECODER_RECORD_MAX - old;
+
+            take = len < take ? len : take;
+            memcpy(&decoder->carry[old], data, take);
+            decoder->carry_len += take;
+
+            total = recordLength(decoder, decoder->carry, decoder->carry_len);
+            if(total > ADV_DECODER_RECORD_MAX)
+            {
+                decoder->records++;
+                decoder->skip = total - old;
+                decoder->carry_len = 0;
+            }
+            else if(total == 0 || total > decoder->carry_len)
+            {
+                data += take;
+                len -= take;
+            }
+            else
+            {
+                processRecord(decoder, decoder->carry, total);
+                data += total - old;
+                len -= total - old;
+                decoder->carry_len = 0;
+            }
+            continue;
+        }
+
+        total = recordLength(decoder, data, len);
+        if(total != 0 && total <= len)
+        {
+            processRecord(decoder, data, total);
+            data += total;
+            len -= total;
+        }
+        else if(total > ADV_DECODER_RECORD_MAX)
+        {
+            decoder->records++;
+            decoder->skip = total;
+        }
+        else
+        {
+            memcpy(decoder->carry, data, len);
+            decoder->carry_len = len;
+            len = 0;
+        }
+    }
+}
+
+int AdvDecoderFlush(ADV_DECODER_T *decoder)
+{
+    if(decoder->batch.count != 0)
+    {
+        decoder->handler(&decoder->batch, decoder->context);
+        decoder->batch.count = 0;
+    }
+
+    return decoder->carry_len != 0 || decoder->skip != 0;
+}
+
+int AdvDecoderMatch(const uint8_t *data, size_t len)
+{
+    return findFrame(data, len) != NULL;
+}
+
+void AdvDecoderEncode(const ADV_DECODER_BATCH_T *batch, uint32_t i,
+                      uint8_t frame[ADV_DECODER_FRAME_SIZE])
+{
+    memcpy(frame, g_prefix[0], FRAME_UUID_OFFSET);
+    memcpy(&frame[FRAME_UUID_OFFSET], batch->uuid[i], ADV_DECODER_UUID_SIZE);
+    frame[FRAME_MAJOR_OFFSET] = (uint8_t)(batch->major[i] >> 8);
+    frame[FRAME_MAJOR_OFFSET + 1] = (uint8_t)batch->major[i];
+    frame[FRAME_MINOR_OFFSET] = (uint8_t)(batch->minor[i] >> 8);
+    frame[FRAME_MINOR_OFFSET + 1] = (uint8_t)batch->minor[i];
+    frame[FRAME_TX_POWER_OFFSET] = (uint8_t)batch->tx_power[i];
+}
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      adv_decoder.h
+ *
+ *  DESCRIPTION
+ *      Decoder for HCI LE advertising reports, picking out the iBeacon
+ *      frames this firmware sends. Input is a btsnoop file or a raw H4
+ *      stream, fed in pieces of any size. Matching reports are decoded into
+ *      a batch held in the decoder, one array per field, which is handed to
+ *      a callback whenever it fills; nothing is allocated per report.
+ *
+ *      A report matches when its advertising data is the frame of
+ *      beacon_frame.h, alone or after a flags AD structure: length 0x1A,
+ *      manufacturer specific data, company 0x004C, type 0x02, length 0x15.
+ *
+ *****************************************************************************/
+
+#ifndef __ADV_DECODER_H__
+#define __ADV_DECODER_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Reports decoded before the batch is handed over */
+#define ADV_DECODER_BATCH_SIZE          (256)
+
+/* iBeacon AD structure, including its length octet */
+#define ADV_DECODER_FRAME_SIZE          (27)
+
+#define ADV_DECODER_UUID_SIZE           (16)
+#define ADV_DECODER_ADDRESS_SIZE        (6)
+
+/* Longest record kept whole between two pieces of input: btsnoop record
+ * header, H4 packet type and the largest HCI event. Longer records are
+ * never advertising reports and are skipped.
+ */
+#define ADV_DECODER_RECORD_MAX          (24 + 1 + 2 + 255)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef enum
+{
+    adv_decoder_btsnoop,        /* btsnoop file, H4 or unencapsulated HCI */
+    adv_decoder_h4              /* H4 packets with no framing */
+} adv_decoder_format;
+
+/* Decoded reports, entry i of each array belonging to report i. Addresses
+ * are as sent over HCI, least significant octet first; major and minor are
+ * host order. Times are microseconds since 1970 from btsnoop, 0 for H4.
+ */
+typedef struct
+{
+    uint32_t count;
+
+    uint64_t time_us[ADV_DECODER_BATCH_SIZE];
+    uint8_t address[ADV_DECODER_BATCH_SIZE][ADV_DECODER_ADDRESS_SIZE];
+    uint8_t address_type[ADV_DECODER_BATCH_SIZE];
+    uint8_t event_type[ADV_DECODER_BATCH_SIZE];
+    int8_t rssi[ADV_DECODER_BATCH_SIZE];
+
+    uint8_t uuid[ADV_DECODER_BATCH_SIZE][ADV_DECODER_UUID_SIZE];
+    uint16_t major[ADV_DECODER_BATCH_SIZE];
+    uint16_t minor[ADV_DECODER_BATCH_SIZE];
+    int8_t tx_power[ADV_DECODER_BATCH_SIZE];
+} ADV_DECODER_BATCH_T;
+
+typedef void (*adv_decoder_handler)(const ADV_DECODER_BATCH_T *batch,
+                                    void *context);
+
+typedef struct
+{
+    adv_decoder_format format;
+    adv_decoder_handler handler;
+    void *context;
+
+    /* btsnoop: whether the file header has been read, and whether records
+     * carry the H4 packet type
+     */
+    int header_done;
+    int h4_records;
+
+    /* Start of a record split between two pieces of input, or the number
+     * of octets of a long record still to skip
+     */
+    uint8_t carry[ADV_DECODER_RECORD_MAX];
+    size_t carry_len;
+    size_t skip;
+
+    ADV_DECODER_BATCH_T batch;
+
+    /* Totals: records (btsnoop) or packets (H4), advertising reports,
+     * reports matched and records that could not be parsed
+     */
+    uint64_t records;
+    uint64_t reports;
+    uint64_t matched;
+    uint64_t malformed;
+} ADV_DECODER_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Start decoding a stream; handler is called with each full batch */
+extern void AdvDecoderInit(ADV_DECODER_T *decoder, adv_decoder_format format,
+                           adv_decoder_handler handler, void *context);
+
+/* Decode the next part of the stream */
+extern void AdvDecoderFeed(ADV_DECODER_T *decoder, const uint8_t *data,
+                           size_t len);
+
+/* Hand over the reports decoded since the last full batch; returns
+ * whether a record has been left incomplete
+ */
+extern int AdvDecoderFlush(ADV_DECODER_T *decoder);
+
+/* Whether advertising data is a frame this firmware sends */
+extern int AdvDecoderMatch(const uint8_t *data, size_t len);
+
+/* Rebuild the iBeacon AD structure of report i of a batch, exactly as the
+ * firmware sends it
+ */
+extern void AdvDecoderEncode(const ADV_DECODER_BATCH_T *batch, uint32_t i,
+                             uint8_t frame[ADV_DECODER_FRAME_SIZE]);
+
+#endif /* __ADV_DECODER_H__ */
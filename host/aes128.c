@@ -0,0 +1,221 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      aes128.c
+ *
+ *  DESCRIPTION
+ *      Straightforward byte-oriented AES-128 encryption. It is not hardened
+ *      against timing attacks and is only meant for the host tools.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "aes128.h"
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const uint8_t g_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      xtime
+ *
+ *  DESCRIPTION
+ *      Multiplies by x in GF(2^8).
+ *
+ *  RETURNS
+ *      The product.
+ *
+ *---------------------------------------------------------------------------*/
+static uint8_t xtime(uint8_t value)
+{
+    return (uint8_t)((value << 1) ^ ((value & 0x80) ? 0x1b : 0x00));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      subShiftRows
+ *
+ *  DESCRIPTION
+ *      SubBytes and ShiftRows together. The state is column major, as the
+ *      block is laid out.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void subShiftRows(uint8_t *state)
+{
+    uint8_t copy[AES128_BLOCK_SIZE];
+    int row, column;
+
+    for(column = 0; column < 4; column++)
+    {
+        for(row = 0; row < 4; row++)
+        {
+            copy[4 * column + row] =
+                g_sbox[state[4 * ((column + row) & 3) + row]];
+        }
+    }
+
+    memcpy(state, copy, sizeof(copy));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mixColumns
+ *
+ *  DESCRIPTION
+ *      MixColumns.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void mixColumns(uint8_t *state)
+{
+    int column;
+
+    for(column = 0; column < 4; column++)
+    {
+        uint8_t *c = &state[4 * column];
+        uint8_t all = c[0] ^ c[1] ^ c[2] ^ c[3];
+        uint8_t first = c[0];
+
+        c[0] ^= all ^ xtime(c[0] ^ c[1]);
+        c[1] ^= all ^ xtime(c[1] ^ c[2]);
+        c[2] ^= all ^ xtime(c[2] ^ c[3]);
+        c[3] ^= all ^ xtime(c[3] ^ first);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addRoundKey
+ *
+ *  DESCRIPTION
+ *      AddRoundKey.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void addRoundKey(uint8_t *state, const uint8_t *round_key)
+{
+    int i;
+
+    for(i = 0; i < AES128_BLOCK_SIZE; i++)
+    {
+        state[i] ^= round_key[i];
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+void Aes128ExpandKey(AES128_KEY_T *expanded,
+                     const uint8_t key[AES128_KEY_SIZE])
+{
+    uint8_t *w = &expanded->round_keys[0][0];
+    uint8_t rcon = 0x01;
+    int i;
+
+    memcpy(w, key, AES128_KEY_SIZE);
+
+    for(i = AES128_KEY_SIZE; i < (int)sizeof(expanded->round_keys); i += 4)
+    {
+        uint8_t t[4];
+
+        memcpy(t, &w[i - 4], 4);
+
+        if(i % AES128_KEY_SIZE == 0)
+        {
+            uint8_t first = t[0];
+
+            t[0] = g_sbox[t[1]] ^ rcon;
+            t[1] = g_sbox[t[2]];
+            t[2] = g_sbox[t[3]];
+            t[3] = g_sbox[first];
+            rcon = xtime(rcon);
+        }
+
+        w[i] = w[i - AES128_KEY_SIZE] ^ t[0];
+        w[i + 1] = w[i - AES128_KEY_SIZE + 1] ^ t[1];
+        w[i + 2] = w[i - AES128_KEY_SIZE + 2] ^ t[2];
+        w[i + 3] = w[i - AES128_KEY_SIZE + 3] ^ t[3];
+    }
+}
+
+void Aes128Encrypt(const AES128_KEY_T *expanded,
+                   const uint8_t in[AES128_BLOCK_SIZE],
+                   uint8_t out[AES128_BLOCK_SIZE])
+{
+    uint8_t state[AES128_BLOCK_SIZE];
+    int round;
+
+    memcpy(state, in, AES128_BLOCK_SIZE);
+    addRoundKey(state, expanded->round_keys[0]);
+
+    for(round = 1; round < 10; round++)
+    {
+        subShiftRows(state);
+        mixColumns(state);
+        addRoundKey(state, expanded->round_keys[round]);
+    }
+
+    subShiftRows(state);
+    addRoundKey(state, expanded->round_keys[10]);
+
+    memcpy(out, state, AES128_BLOCK_SIZE);
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      aes128.h
+ *
+ *  DESCRIPTION
+ *      AES-128 block encryption (FIPS-197) for the host tools: the SDK
+ *      stand-in uses it in place of the hardware AES, and the ephemeral ID
+ *      resolver to derive the identifiers it looks for.
+ *
+ *****************************************************************************/
+
+#ifndef __AES128_H__
+#define __AES128_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdint.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+#define AES128_BLOCK_SIZE               (16)
+#define AES128_KEY_SIZE                 (16)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Expanded key, so that encrypting many blocks under one key does not
+ * repeat the key schedule
+ */
+typedef struct
+{
+    uint8_t round_keys[11][AES128_BLOCK_SIZE];
+} AES128_KEY_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Expand a key */
+extern void Aes128ExpandKey(AES128_KEY_T *expanded,
+                            const uint8_t key[AES128_KEY_SIZE]);
+
+/* Encrypt one block with an expanded key; in and out may be the same */
+extern void Aes128Encrypt(const AES128_KEY_T *expanded,
+                          const uint8_t in[AES128_BLOCK_SIZE],
+                          uint8_t out[AES128_BLOCK_SIZE]);
+
+#endif /* __AES128_H__ */
@@ -0,0 +1,894 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      beacon_profile.c
+ *
+ *  DESCRIPTION
+ *      Runs the beacon application on the host SDK stand-in for a simulated
+ *      period and reports boot cost, time-to-first-advert and the modelled
+ *      charge drawn per hour.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+#include "log_decoder.h"
+#include "app_gatt_db.h"
+#include "app_common.h"
+#include "beacon_frame.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define US_PER_SECOND                   (1000000ULL)
+#define SECONDS_PER_HOUR                (3600.0)
+
+/* Counters characteristic layout this tool decodes */
+#define COUNTERS_VERSION                (1)
+#define COUNTERS_SERIALISED_SIZE        (30)
+
+/* Longest wait for the configuration window, in seconds */
+#define CONFIG_CONNECT_WAIT             (600)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Where the UART output goes */
+typedef struct
+{
+    FILE *raw;
+    LOG_DECODER_T *decoder;
+} PROFILE_UART_T;
+
+/* Configuration session to run, from -p */
+typedef struct
+{
+    double time;
+    uint32_t passcode;
+
+    /* Fields to write, flagged in 'fields' by handle order */
+    uint16_t uuid_msw;
+    uint16_t major;
+    uint16_t minor;
+    int8_t tx_power;
+    unsigned fields;
+
+    /* Time to stay connected after the commit, and how the central
+     * connects and answers connection parameter requests
+     */
+    double hold;
+    uint16_t conn_interval;
+    int accept_updates;
+} PROFILE_CONFIG_T;
+
+#define CONFIG_FIELD_UUID_MSW           (1u << 0)
+#define CONFIG_FIELD_MAJOR              (1u << 1)
+#define CONFIG_FIELD_MINOR              (1u << 2)
+#define CONFIG_FIELD_TX_POWER           (1u << 3)
+
+/* Ephemeral ID key and counter as they sit in NVM, from -i */
+typedef struct
+{
+    uint16_t words[NVM_EID_KEY_WORDS + NVM_EID_COUNTER_WORDS];
+    int present;
+} PROFILE_EID_T;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeUart
+ *
+ *  DESCRIPTION
+ *      UART hook which saves the binary log and decodes it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeUart(const uint8_t *data, uint16_t len, void *context)
+{
+    PROFILE_UART_T *uart = (PROFILE_UART_T *)context;
+
+    if(uart->raw != NULL)
+    {
+        fwrite(data, 1, len, uart->raw);
+    }
+    if(uart->decoder != NULL)
+    {
+        LogDecoderFeed(uart->decoder, data, len);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeAdvEvent
+ *
+ *  DESCRIPTION
+ *      Advertising hook which writes each event as a CSV line.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeAdvEvent(const HARNESS_ADV_EVENT_T *event, void *context)
+{
+    FILE *out = (FILE *)context;
+    uint8_t i;
+
+    fprintf(out, "%llu,%u,%u,", (unsigned long long)event->time_us,
+            event->duration_us, event->tx_power_level);
+    for(i = 0; i < event->adv_len; i++)
+    {
+        fprintf(out, "%02x", event->adv_data[i]);
+    }
+    fputc('\n', out);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readKeyr
+ *
+ *  DESCRIPTION
+ *      Reads the &USER_KEYS words and the &nvm_size from a keyr file. The
+ *      NVM size is left alone if the file does not set it.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be read or has no user keys.
+ *
+ *---------------------------------------------------------------------------*/
+static int readKeyr(const char *path, uint16_t *keys, uint16_t *nvm_size)
+{
+    char line[256];
+    int found = -1;
+    FILE *in = fopen(path, "r");
+
+    if(in == NULL)
+    {
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char *p;
+        int i;
+
+        if(line[0] == '/')
+        {
+            continue;
+        }
+
+        if((p = strstr(line, "&nvm_size")) != NULL &&
+           (p = strchr(p, '=')) != NULL)
+        {
+            *nvm_size = (uint16_t)strtoul(p + 1, NULL, 16);
+            continue;
+        }
+
+        if((p = strstr(line, "&USER_KEYS")) == NULL ||
+           (p = strchr(p, '=')) == NULL)
+        {
+            continue;
+        }
+
+        p++;
+        for(i = 0; i < HARNESS_USER_KEY_COUNT; i++)
+        {
+            char *end;
+
+            keys[i] = (uint16_t)strtoul(p, &end, 16);
+            if(end == p)
+            {
+                break;
+            }
+            p = end;
+        }
+        found = 0;
+    }
+
+    fclose(in);
+
+    return found;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      unpackLong
+ *
+ *  DESCRIPTION
+ *      Reads a 32-bit little endian value.
+ *
+ *  RETURNS
+ *      The value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t unpackLong(const uint8_t *value)
+{
+    return (uint32_t)value[0] | ((uint32_t)value[1] << 8) |
+           ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      reportCounters
+ *
+ *  DESCRIPTION
+ *      Reads the runtime counters characteristic as a GATT client would
+ *      and prints it decoded.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void reportCounters(void)
+{
+    uint8_t value[HARNESS_GATT_VALUE_MAX];
+    uint16_t len = sizeof(value);
+    uint16_t status = HarnessGattRead(HANDLE_BEACON_COUNTERS, value, &len);
+
+    printf("\nruntime counters (handle 0x%04x)\n", HANDLE_BEACON_COUNTERS);
+    if(status != 0 || len != COUNTERS_SERIALISED_SIZE || value[0] != COUNTERS_VERSION)
+    {
+        printf("  read failed: status 0x%04x, %u octets\n", status, len);
+        return;
+    }
+
+    printf("  boots / last sleep state          : %u / %u\n",
+           unpackLong(&value[1]), value[5]);
+    printf("  advertising enables / events      : %u / %u\n",
+           unpackLong(&value[6]), unpackLong(&value[10]));
+    printf("  wake-ups timer / system / LM      : %u / %u / %u\n",
+           unpackLong(&value[14]), unpackLong(&value[18]),
+           unpackLong(&value[22]));
+    printf("  awake time                        : %u ms\n",
+           unpackLong(&value[26]));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseConfig
+ *
+ *  DESCRIPTION
+ *      Parses a -p session: "t=seconds,pass=hex" followed by any of
+ *      "uuid=hex", "major=n", "minor=n" and "tx=dBm".
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseConfig(char *arg, PROFILE_CONFIG_T *config)
+{
+    char *item;
+
+    memset(config, 0, sizeof(*config));
+    config->time = -1.0;
+    config->accept_updates = 1;
+
+    for(item = strtok(arg, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        char *value = strchr(item, '=');
+
+        if(value == NULL)
+        {
+            return -1;
+        }
+        *value++ = '\0';
+
+        if(strcmp(item, "t") == 0)
+        {
+            config->time = atof(value);
+        }
+        else if(strcmp(item, "pass") == 0)
+        {
+            config->passcode = (uint32_t)strtoul(value, NULL, 16);
+        }
+        else if(strcmp(item, "uuid") == 0)
+        {
+            config->uuid_msw = (uint16_t)strtoul(value, NULL, 16);
+            config->fields |= CONFIG_FIELD_UUID_MSW;
+        }
+        else if(strcmp(item, "major") == 0)
+        {
+            config->major = (uint16_t)strtoul(value, NULL, 0);
+            config->fields |= CONFIG_FIELD_MAJOR;
+        }
+        else if(strcmp(item, "minor") == 0)
+        {
+            config->minor = (uint16_t)strtoul(value, NULL, 0);
+            config->fields |= CONFIG_FIELD_MINOR;
+        }
+        else if(strcmp(item, "tx") == 0)
+        {
+            config->tx_power = (int8_t)strtol(value, NULL, 0);
+            config->fields |= CONFIG_FIELD_TX_POWER;
+        }
+        else if(strcmp(item, "hold") == 0)
+        {
+            config->hold = atof(value);
+        }
+        else if(strcmp(item, "ci") == 0)
+        {
+            config->conn_interval = (uint16_t)strtoul(value, NULL, 0);
+        }
+        else if(strcmp(item, "update") == 0)
+        {
+            config->accept_updates = atoi(value);
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    return config->time < 0.0 ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseEid
+ *
+ *  DESCRIPTION
+ *      Parses -i "keyhex[:counter]" into the NVM words the beacon reads its
+ *      ephemeral ID key and counter from.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseEid(const char *arg, PROFILE_EID_T *eid)
+{
+    uint16_t *counter = &eid->words[NVM_EID_KEY_WORDS];
+    unsigned long value = 0;
+    int i;
+
+    if(strspn(arg, "0123456789abcdefABCDEF") != 4 * NVM_EID_KEY_WORDS ||
+       (arg[4 * NVM_EID_KEY_WORDS] != '\0' &&
+        arg[4 * NVM_EID_KEY_WORDS] != ':'))
+    {
+        return -1;
+    }
+
+    for(i = 0; i < NVM_EID_KEY_WORDS; i++)
+    {
+        char word[5];
+
+        memcpy(word, &arg[4 * i], 4);
+        word[4] = '\0';
+        eid->words[i] = (uint16_t)strtoul(word, NULL, 16);
+    }
+
+    if(arg[4 * NVM_EID_KEY_WORDS] == ':')
+    {
+        value = strtoul(&arg[4 * NVM_EID_KEY_WORDS + 1], NULL, 0);
+    }
+    counter[0] = (uint16_t)(value >> 16);
+    counter[1] = (uint16_t)value;
+    counter[2] = (uint16_t)~(counter[0] ^ counter[1]);
+    eid->present = 1;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeConfigValue
+ *
+ *  DESCRIPTION
+ *      Writes a characteristic little endian and reports the result.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeConfigValue(const char *name, uint16_t handle,
+                             uint32_t value, uint16_t len)
+{
+    uint8_t data[4];
+    uint16_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        data[i] = (uint8_t)(value >> (8 * i));
+    }
+
+    printf("  write %-8s (handle 0x%04x)    : status 0x%04x\n", name, handle,
+           HarnessGattWrite(handle, data, len));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      runConfig
+ *
+ *  DESCRIPTION
+ *      Runs to the session time, waits for the configuration window,
+ *      connects, writes the passcode and fields, commits, stays connected
+ *      for the hold time and disconnects.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void runConfig(const PROFILE_CONFIG_T *config)
+{
+    uint64_t start = (uint64_t)(config->time * US_PER_SECOND);
+    int waited = 0;
+
+    if(start > HarnessNow())
+    {
+        HarnessRun(start - HarnessNow());
+    }
+
+    HarnessSetCentral(config->conn_interval, config->accept_updates);
+    while(!HarnessConnect())
+    {
+        if(waited++ == CONFIG_CONNECT_WAIT)
+        {
+            printf("configuration window not open by %.0f s\n\n",
+                   HarnessNow() / 1e6);
+            return;
+        }
+        HarnessRun(US_PER_SECOND);
+    }
+
+    printf("configuration session at %.3f s\n", HarnessNow() / 1e6);
+
+    writeConfigValue("passcode", HANDLE_CONFIG_PASSCODE,
+                     config->passcode, 4);
+    if(config->fields & CONFIG_FIELD_UUID_MSW)
+    {
+        writeConfigValue("uuid", HANDLE_CONFIG_UUID_MSW,
+                         config->uuid_msw, 2);
+    }
+    if(config->fields & CONFIG_FIELD_MAJOR)
+    {
+        writeConfigValue("major", HANDLE_CONFIG_MAJOR, config->major, 2);
+    }
+    if(config->fields & CONFIG_FIELD_MINOR)
+    {
+        writeConfigValue("minor", HANDLE_CONFIG_MINOR, config->minor, 2);
+    }
+    if(config->fields & CONFIG_FIELD_TX_POWER)
+    {
+        writeConfigValue("tx", HANDLE_CONFIG_TX_POWER,
+                         (uint8_t)config->tx_power, 1);
+    }
+    writeConfigValue("commit", HANDLE_CONFIG_COMMIT, 1, 1);
+
+    if(config->hold > 0.0)
+    {
+        HarnessRun((uint64_t)(config->hold * US_PER_SECOND));
+    }
+    HarnessDisconnect();
+    printf("\n");
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-t seconds] [-s seed] [-r file.keyr] "
+            "[-k index=value] [-b mV[:mV/h]] [-T celsius] [-a chance]\n"
+            "       [-n count[:ms]] [-y ms] [-d ppm] [-e events.csv] [-u log.bin]\n"
+            "       [-m pio:s:s[:ms]] [-p session] [-i key[:counter]] [-c] [-v]\n"
+            "  -t  simulated run time in seconds (default 3600)\n"
+            "  -s  advDelay generator seed (default 1)\n"
+            "  -r  take &USER_KEYS from a keyr file\n"
+            "  -k  set a &USER_KEYS word, value in hex\n"
+            "  -b  battery voltage in millivolts (default 3000), optionally\n"
+            "      falling at the given rate\n"
+            "  -T  die temperature in degrees Celsius (default 20)\n"
+            "  -a  chance, 0 to 1, of a scan request on each channel of a\n"
+            "      scannable advertising event (default 0)\n"
+            "  -n  surround the beacon with other advertisers, advertising\n"
+            "      every given milliseconds (default 1000), for the census\n"
+            "      (set bit 5 of &USER_KEYS word 7 to scan for them)\n"
+            "  -y  put a sync beacon in range whose frames start the given\n"
+            "      milliseconds into the run (set bits 6 and 7 of &USER_KEYS\n"
+            "      word 7 to 1 to follow it)\n"
+            "  -d  make the sleep clock gain the given parts per million\n"
+            "  -m  wire an accelerometer to a PIO, as pio:period:moving; the\n"
+            "      asset moves for the given seconds at the start of every\n"
+            "      period, pulsing the PIO every given milliseconds (default\n"
+            "      1000) (set bits 8 to 11 of &USER_KEYS word 7 to the PIO plus\n"
+            "      one, and bit 12 to hibernate while still)\n"
+            "  -e  write every advertising event to a CSV file\n"
+            "  -p  connect to the configuration service and write it, as\n"
+            "      t=seconds,pass=hex[,uuid=hex][,major=n][,minor=n][,tx=dBm]\n"
+            "      [,hold=seconds][,ci=1.25ms units][,update=0|1]; hold keeps\n"
+            "      the connection open, ci and update set the connection\n"
+            "      interval the central uses and whether it takes up the\n"
+            "      beacon's parameter requests\n"
+            "  -i  provision an ephemeral ID key, 32 hex digits, and counter\n"
+            "      (set bit 0 of &USER_KEYS word 7 to use it)\n"
+            "  -c  read and decode the runtime counters at the end\n"
+            "  -u  write the binary debug log from the UART to a file\n"
+            "  -v  decode the debug log to stdout as it is sent\n", name);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      report
+ *
+ *  DESCRIPTION
+ *      Prints the statistics of a run of the given length.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void report(const HARNESS_STATS_T *stats, double seconds)
+{
+    double charge = HarnessChargeUas(stats);
+    int worn;
+    int i;
+
+    printf("boot cycles (AppInit to advertise)  : %llu\n",
+           (unsigned long long)stats->boot_cycles);
+    printf("  of which startBeaconing           : %llu\n",
+           (unsigned long long)stats->adv_start_cycles);
+
+    if(stats->first_adv_us == HARNESS_NEVER)
+    {
+        printf("time to first advert                : never\n");
+    }
+    else
+    {
+        printf("time to advertising enable          : %llu us\n",
+               (unsigned long long)stats->adv_enable_us);
+        printf("time to first advert                : %llu us\n",
+               (unsigned long long)stats->first_adv_us);
+    }
+
+    if(stats->warm_boots != 0)
+    {
+        printf("warm boots (from hibernate/dormant) : %u\n",
+               stats->warm_boots);
+        printf("  boot cycles, last                 : %llu\n",
+               (unsigned long long)stats->warm_boot_cycles);
+        printf("  time to first advert, mean / max  : %llu / %llu us\n",
+               (unsigned long long)(stats->warm_first_adv_us /
+                                    stats->warm_boots),
+               (unsigned long long)stats->warm_first_adv_max_us);
+    }
+
+    printf("advertising events                  : %u\n", stats->adv_events);
+    printf("  scan responses                    : %u\n",
+           stats->scan_responses);
+    printf("scanning                            : %.1f s (%u reports)\n",
+           stats->scan_us / 1e6, stats->adv_reports);
+    printf("application wake-ups                : %u\n", stats->wakeups);
+    printf("  by timers                         : %u\n",
+           stats->timer_wakeups);
+    printf("hibernate / dormant periods         : %u (%.0f s)\n",
+           stats->hibernations, stats->hibernate_us / 1e6);
+    printf("PIO events / wakes                  : %u / %u\n",
+           stats->pio_events, stats->pio_wakes);
+    printf("NVM writes                          : %u (%u words)\n",
+           stats->nvm_writes, stats->nvm_words_written);
+    for(i = 0, worn = 0; i < HARNESS_NVM_MAX_WORDS; i++)
+    {
+        if(HarnessNvmWear((uint16_t)i) > HarnessNvmWear((uint16_t)worn))
+        {
+            worn = i;
+        }
+    }
+    printf("  most written word                 : %u at offset %d "
+           "(%.0f per year)\n", HarnessNvmWear((uint16_t)worn), worn,
+           HarnessNvmWear((uint16_t)worn) * (365.0 * 86400.0) / seconds);
+    printf("connections                         : %u (%.1f s)\n",
+           stats->connections, stats->connected_us / 1e6);
+    printf("  parameter requests / updates      : %u / %u\n",
+           stats->conn_param_requests, stats->conn_updates);
+
+    /* Charge per hour in uAh equals the average current in uA */
+    printf("charge per hour                     : %.3f uAh\n",
+           charge / seconds);
+    printf("  cpu / radio / uart / sleep        : "
+           "%.3f / %.3f / %.3f / %.3f uAh\n",
+           stats->cpu_uas / seconds, stats->radio_uas / seconds,
+           stats->uart_uas / seconds, stats->sleep_uas / seconds);
+
+    printf("\n%-26s %8s %12s\n", "SDK call", "count", "cycles");
+    for(i = 0; i < harness_call_count; i++)
+    {
+        printf("%-26s %8u %12llu\n", HarnessCallName((harness_call)i),
+               stats->calls[i].count,
+               (unsigned long long)stats->calls[i].cycles);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    double seconds = SECONDS_PER_HOUR;
+    uint32_t seed = 1;
+    FILE *events = NULL;
+    int echo = 0;
+    PROFILE_UART_T uart = { NULL, NULL };
+    LOG_DECODER_T decoder;
+    int counters = 0;
+    PROFILE_CONFIG_T config;
+    int configure = 0;
+    PROFILE_EID_T eid = { { 0 }, 0 };
+    uint16_t battery_mv = HARNESS_DEFAULT_BATTERY_MV;
+    double battery_droop = 0.0;
+    int16_t temperature = HARNESS_DEFAULT_TEMPERATURE;
+    double scan_requests = 0.0;
+    uint32_t neighbours = 0;
+    uint32_t neighbour_interval = 0;
+    double sync_phase = -1.0;
+    double clock_drift = 0.0;
+    uint8_t motion_pio = 0;
+    double motion_period = 0.0;
+    double motion_move = 0.0;
+    double motion_pulse = 1000.0;
+    uint16_t nvm_size = HARNESS_DEFAULT_NVM_WORDS;
+    int opt;
+
+    /* Keys are applied after the reset, so collect them first */
+    uint16_t keys[HARNESS_USER_KEY_COUNT] = { 0 };
+
+    while((opt = getopt(argc, argv, "t:s:r:k:b:T:a:n:y:d:m:e:u:p:i:cvh")) != -1)
+    {
+        switch(opt)
+        {
+            case 't':
+                seconds = atof(optarg);
+            break;
+
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+            case 'r':
+                if(readKeyr(optarg, keys, &nvm_size) != 0)
+                {
+                    fprintf(stderr, "%s: no &USER_KEYS\n", optarg);
+                    return 1;
+                }
+            break;
+
+            case 'k':
+            {
+                char *value = strchr(optarg, '=');
+                unsigned long index = strtoul(optarg, NULL, 0);
+
+                if(value == NULL || index >= HARNESS_USER_KEY_COUNT)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                keys[index] = (uint16_t)strtoul(value + 1, NULL, 16);
+            }
+            break;
+
+            case 'b':
+            {
+                char *rate;
+
+                battery_mv = (uint16_t)strtoul(optarg, &rate, 0);
+                if(*rate == ':')
+                {
+                    battery_droop = atof(rate + 1);
+                }
+            }
+            break;
+
+            case 'T':
+                temperature = (int16_t)atoi(optarg);
+            break;
+
+            case 'a':
+                scan_requests = atof(optarg);
+            break;
+
+            case 'n':
+            {
+                char *interval;
+
+                neighbours = (uint32_t)strtoul(optarg, &interval, 0);
+                if(*interval == ':')
+                {
+                    neighbour_interval = (uint32_t)(atof(interval + 1) *
+                                                    1000.0);
+                }
+            }
+            break;
+
+            case 'y':
+                sync_phase = atof(optarg);
+            break;
+
+            case 'd':
+                clock_drift = atof(optarg);
+            break;
+
+            case 'm':
+            {
+                char *field;
+
+                motion_pio = (uint8_t)strtoul(optarg, &field, 0);
+                if(*field != ':')
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                motion_period = strtod(field + 1, &field);
+                if(*field != ':')
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                motion_move = strtod(field + 1, &field);
+                if(*field == ':')
+                {
+                    motion_pulse = atof(field + 1);
+                }
+            }
+            break;
+
+            case 'e':
+                events = fopen(optarg, "w");
+                if(events == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+            break;
+
+            case 'u':
+                uart.raw = fopen(optarg, "wb");
+                if(uart.raw == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+            break;
+
+            case 'p':
+                if(parseConfig(optarg, &config) != 0)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                configure = 1;
+            break;
+
+            case 'i':
+                if(parseEid(optarg, &eid) != 0)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'c':
+                counters = 1;
+            break;
+
+            case 'v':
+                echo = 1;
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(seconds <= 0.0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    HarnessReset(seed);
+    for(opt = 0; opt < HARNESS_USER_KEY_COUNT; opt++)
+    {
+        HarnessSetUserKey((uint16_t)opt, keys[opt]);
+    }
+    HarnessSetDebugEcho(echo);
+    if(echo)
+    {
+        LogDecoderInit(&decoder, stdout);
+        uart.decoder = &decoder;
+    }
+    if(uart.raw != NULL || uart.decoder != NULL)
+    {
+        HarnessSetUartHook(writeUart, &uart);
+    }
+    HarnessSetBattery(battery_mv, battery_droop);
+    HarnessSetTemperature(temperature);
+    HarnessSetScanRequests(scan_requests);
+    HarnessSetNeighbours(neighbours, neighbour_interval);
+    if(sync_phase >= 0.0)
+    {
+        static const uint8 sync_frame[] = SLOT_SYNC_FRAME_INIT;
+
+        HarnessSetSyncBeacon(sync_frame, sizeof(sync_frame),
+                             BEACON_SLOT_FRAME,
+                             (uint64_t)(sync_phase * 1000.0));
+    }
+    HarnessSetClockDrift(clock_drift);
+    HarnessSetMotion(motion_pio, (uint64_t)(motion_period * 1e6),
+                     (uint64_t)(motion_move * 1e6),
+                     (uint32_t)(motion_pulse * 1000.0));
+    HarnessSetNvmSize(nvm_size);
+    if(eid.present)
+    {
+        HarnessNvmLoad(NVM_OFFSET_EID_KEY, eid.words,
+                       NVM_EID_KEY_WORDS + NVM_EID_COUNTER_WORDS);
+    }
+    if(events != NULL)
+    {
+        fprintf(events, "time_us,duration_us,tx_power_level,adv_data\n");
+        HarnessSetAdvHook(writeAdvEvent, events);
+    }
+
+    HarnessBoot();
+    if(configure && config.time < seconds)
+    {
+        runConfig(&config);
+    }
+    if((uint64_t)(seconds * US_PER_SECOND) > HarnessNow())
+    {
+        HarnessRun((uint64_t)(seconds * US_PER_SECOND) - HarnessNow());
+    }
+
+    if(echo)
+    {
+        printf("\n");
+    }
+    report(HarnessStats(), seconds);
+    if(counters)
+    {
+        reportCounters();
+    }
+
+    if(events != NULL)
+    {
+        fclose(events);
+    }
+    if(uart.raw != NULL)
+    {
+        fclose(uart.raw);
+    }
+
+    return 0;
+}
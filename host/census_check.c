@@ -0,0 +1,274 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      census_check.c
+ *
+ *  DESCRIPTION
+ *      Accuracy check of the advertiser census, beacon_census.c.
+ *
+ *      census_check
+ *          feeds N distinct advertiser addresses through CensusReport(),
+ *          each address heard three times, for N of 0, 1, 10, 100, 1000
+ *          and 10000, over CENSUS_CHECK_TRIALS sets of addresses each, and
+ *          checks the count of every window against N. The standard error
+ *          of the sketch is 1.04 / sqrt(512), 4.6%: every count must be
+ *          within four standard errors (plus one, for rounding), and for
+ *          N of 10 up the RMS and mean of the relative error over the
+ *          trials within 1.25 and 0.35 of one. Counts of 0 and 1 must be
+ *          exact. log2Fixed() is checked against log2() for every 16-bit
+ *          input.
+ *
+ *          The exit status is 1 if any of those fails.
+ *
+ *      The census source is built into this file, in place of the
+ *      application's object, so that the check reaches the sketch and the
+ *      count directly; windows are opened without scanning.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*============================================================================*
+ *  Census Under Check
+ *============================================================================*/
+
+#include "beacon_census.c"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Sets of addresses per advertiser count, and hearings of each address */
+#define CENSUS_CHECK_TRIALS             (100)
+#define CENSUS_CHECK_HEARINGS           (3)
+
+/* Standard error of the sketch, 1.04 / sqrt(CENSUS_REGISTERS) */
+#define CENSUS_CHECK_STD_ERROR          (1.04 / sqrt(CENSUS_REGISTERS))
+
+/* Bounds, in standard errors: each count, and the RMS and mean of the
+ * relative error over the trials for counts from CENSUS_CHECK_STATS_FROM
+ */
+#define CENSUS_CHECK_WORST              (4.0)
+#define CENSUS_CHECK_RMS                (1.25)
+#define CENSUS_CHECK_BIAS               (0.35)
+#define CENSUS_CHECK_STATS_FROM         (10)
+
+/* Largest error of log2Fixed(), in units of its last bit: its truncation
+ * and the rounding of the squarings
+ */
+#define CENSUS_CHECK_LOG2_ULPS          (1.5)
+
+/* Multiplier of a full period LCG modulo 2^48, making distinct indices
+ * into distinct, scattered addresses
+ */
+#define CENSUS_CHECK_LCG_A              (0x5DEECE66DULL)
+#define CENSUS_CHECK_LCG_C              (0xBULL)
+#define CENSUS_CHECK_ADDR_MASK          (0xFFFFFFFFFFFFULL)
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const uint32_t g_counts[] = { 0, 1, 10, 100, 1000, 10000 };
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkLog2
+ *
+ *  DESCRIPTION
+ *      Compares log2Fixed() with log2() for every non-zero 16-bit input.
+ *
+ *  RETURNS
+ *      Number of inputs out of bounds.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t checkLog2(void)
+{
+    double unit = 1.0 / (1 << CENSUS_LOG2_FRACTION_BITS);
+    double worst = 0.0;
+    uint32_t failures = 0;
+    uint32_t x;
+
+    for(x = 1; x <= 0xFFFF; x++)
+    {
+        double error = log2Fixed((uint16)x) * unit - log2((double)x);
+
+        if(fabs(error) > fabs(worst))
+        {
+            worst = error;
+        }
+        if(fabs(error) > CENSUS_CHECK_LOG2_ULPS * unit)
+        {
+            if(failures++ < 10)
+            {
+                fprintf(stderr, "log2Fixed(%u) off by %.5f\n", x, error);
+            }
+        }
+    }
+
+    printf("log2Fixed worst error               : %+.5f (%.2f of the last "
+           "bit)\n", worst, worst / unit);
+
+    return failures;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      countWindow
+ *
+ *  DESCRIPTION
+ *      Opens a window without scanning, reports a set of distinct
+ *      advertisers into it and counts them.
+ *
+ *  RETURNS
+ *      The count of the window.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 countWindow(uint32_t trial, uint32_t advertisers)
+{
+    LM_EV_ADVERTISING_REPORT_T report;
+    uint32_t hearing;
+    uint32_t i;
+
+    MemSet(g_census.registers, 0, sizeof(g_census.registers));
+    g_census.reports = 0;
+    g_census.scanning = TRUE;
+
+    for(hearing = 0; hearing < CENSUS_CHECK_HEARINGS; hearing++)
+    {
+        for(i = 0; i < advertisers; i++)
+        {
+            uint64_t address = (((uint64_t)trial << 24 | i) *
+                                CENSUS_CHECK_LCG_A + CENSUS_CHECK_LCG_C) &
+                               CENSUS_CHECK_ADDR_MASK;
+
+            report.data.address.type = (uint16)(address >> 47);
+            report.data.address.addr.nap = (uint16)(address >> 32);
+            report.data.address.addr.uap = (uint8)(address >> 24);
+            report.data.address.addr.lap = (uint24)(address & 0xFFFFFF);
+            CensusReport(&report);
+        }
+    }
+
+    g_census.scanning = FALSE;
+
+    return countAdvertisers();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkCount
+ *
+ *  DESCRIPTION
+ *      Counts CENSUS_CHECK_TRIALS sets of the given number of advertisers
+ *      and checks the errors.
+ *
+ *  RETURNS
+ *      Number of bounds broken.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t checkCount(uint32_t advertisers)
+{
+    double sigma = CENSUS_CHECK_STD_ERROR;
+    double worst_allowed = 1.0 + CENSUS_CHECK_WORST * sigma * advertisers;
+    double sum = 0.0;
+    double squares = 0.0;
+    double worst = 0.0;
+    double rms;
+    double bias;
+    uint32_t failures = 0;
+    uint32_t trial;
+
+    for(trial = 0; trial < CENSUS_CHECK_TRIALS; trial++)
+    {
+        uint16 count = countWindow(trial, advertisers);
+        double error = (double)count - advertisers;
+
+        if(fabs(error) > fabs(worst))
+        {
+            worst = error;
+        }
+        if(advertisers != 0)
+        {
+            sum += error / advertisers;
+            squares += (error / advertisers) * (error / advertisers);
+        }
+
+        if(advertisers <= 1 ? count != advertisers :
+                              fabs(error) > worst_allowed)
+        {
+            if(failures++ < 5)
+            {
+                fprintf(stderr, "%u advertisers, trial %u: counted %u\n",
+                        advertisers, trial, count);
+            }
+        }
+    }
+
+    bias = sum / CENSUS_CHECK_TRIALS;
+    rms = sqrt(squares / CENSUS_CHECK_TRIALS);
+
+    printf("%5u advertisers: mean %+6.2f%%, RMS %5.2f%%, worst %+6.0f\n",
+           advertisers, bias * 100.0, rms * 100.0, worst);
+
+    if(advertisers >= CENSUS_CHECK_STATS_FROM)
+    {
+        if(rms > CENSUS_CHECK_RMS * sigma)
+        {
+            fprintf(stderr, "%u advertisers: RMS error %.2f%% over %.2f%%\n",
+                    advertisers, rms * 100.0,
+                    CENSUS_CHECK_RMS * sigma * 100.0);
+            failures++;
+        }
+        if(fabs(bias) > CENSUS_CHECK_BIAS * sigma)
+        {
+            fprintf(stderr, "%u advertisers: mean error %+.2f%% over "
+                    "%.2f%%\n", advertisers, bias * 100.0,
+                    CENSUS_CHECK_BIAS * sigma * 100.0);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32_t failures;
+    uint32_t i;
+
+    if(argc != 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    failures = checkLog2();
+
+    printf("standard error of the sketch        : %.2f%%, %u trials "
+           "each\n", CENSUS_CHECK_STD_ERROR * 100.0, CENSUS_CHECK_TRIALS);
+    for(i = 0; i < sizeof(g_counts) / sizeof(g_counts[0]); i++)
+    {
+        failures += checkCount(g_counts[i]);
+    }
+
+    printf("bounds broken                       : %u\n", failures);
+
+    return failures != 0;
+}
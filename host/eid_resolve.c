@@ -0,0 +1,517 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      eid_resolve.c
+ *
+ *  DESCRIPTION
+ *      Resolves ephemeral IDs back to beacons.
+ *
+ *      eid_resolve [-w behind:ahead] devices [observations]
+ *          devices holds a line per beacon: name, key as 32 hex digits and
+ *          optionally the counter it was provisioned or last seen with.
+ *          observations is a beacon_profile -e CSV or a file of hex IDs,
+ *          8 or 4 octets, one per line; standard input without a file.
+ *          A line is printed each time a beacon is seen with a new ID.
+ *
+ *      eid_resolve [-w behind:ahead] -b devices
+ *          times building the index for that many made-up beacons and
+ *          resolving IDs they might send.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "eid_resolver.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Default window: the beacon saves its counter a batch ahead, so a reset
+ * can skip that many IDs
+ */
+#define DEFAULT_BEHIND                  (2)
+#define DEFAULT_AHEAD                   (48)
+
+/* Lookups made per beacon by the benchmark */
+#define BENCH_LOOKUPS_PER_DEVICE        (4)
+
+#define LINE_MAX_LENGTH                 (256)
+
+/* Prefixes of the frames that carry an ID, after the AD length octet */
+static const uint8_t g_ibeacon_prefix[] = { 0xFF, 0x4C, 0x00, 0x02, 0x15 };
+static const uint8_t g_eid_prefix[] = { 0x16, 0xAA, 0xFE, 0x30 };
+
+/* Offsets of the ID after the prefix: the UUID precedes the major, the
+ * TX power precedes the EID
+ */
+#define IBEACON_MAJOR_SKIP              (16)
+#define EID_ID_SKIP                     (1)
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseHex
+ *
+ *  DESCRIPTION
+ *      Converts hex digits to octets, stopping at the first non-digit.
+ *
+ *  RETURNS
+ *      Number of octets.
+ *
+ *---------------------------------------------------------------------------*/
+static size_t parseHex(const char *text, uint8_t *out, size_t max)
+{
+    size_t len = 0;
+
+    while(len < max)
+    {
+        unsigned value;
+
+        if(sscanf(text, "%2x", &value) != 1 ||
+           strspn(text, "0123456789abcdefABCDEF") < 2)
+        {
+            break;
+        }
+        out[len++] = (uint8_t)value;
+        text += 2;
+    }
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findId
+ *
+ *  DESCRIPTION
+ *      Walks the AD structures of an advert for an iBeacon major and minor
+ *      or an Eddystone-EID identifier.
+ *
+ *  RETURNS
+ *      Length of the ID found, 0 if none.
+ *
+ *---------------------------------------------------------------------------*/
+static size_t findId(const uint8_t *adv, size_t len, const uint8_t **id)
+{
+    size_t offset = 0;
+
+    while(offset < len && adv[offset] != 0 &&
+          offset + 1 + adv[offset] <= len)
+    {
+        const uint8_t *ad = &adv[offset + 1];
+        size_t ad_len = adv[offset];
+
+        if(ad_len >= sizeof(g_ibeacon_prefix) + IBEACON_MAJOR_SKIP +
+                     EID_RESOLVER_SHORT_ID_SIZE &&
+           memcmp(ad, g_ibeacon_prefix, sizeof(g_ibeacon_prefix)) == 0)
+        {
+            *id = ad + sizeof(g_ibeacon_prefix) + IBEACON_MAJOR_SKIP;
+            return EID_RESOLVER_SHORT_ID_SIZE;
+        }
+
+        if(ad_len >= sizeof(g_eid_prefix) + EID_ID_SKIP +
+                     EID_RESOLVER_ID_SIZE &&
+           memcmp(ad, g_eid_prefix, sizeof(g_eid_prefix)) == 0)
+        {
+            *id = ad + sizeof(g_eid_prefix) + EID_ID_SKIP;
+            return EID_RESOLVER_ID_SIZE;
+        }
+
+        offset += 1 + ad_len;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readDevices
+ *
+ *  DESCRIPTION
+ *      Adds the beacons listed in a file to the resolver.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int readDevices(EID_RESOLVER_T *resolver, const char *path)
+{
+    char line[LINE_MAX_LENGTH];
+    FILE *in = fopen(path, "r");
+    unsigned number = 0;
+
+    if(in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char name[EID_RESOLVER_NAME_MAX];
+        char key_text[2 * AES128_KEY_SIZE + 1];
+        uint8_t key[AES128_KEY_SIZE];
+        unsigned long counter = 0;
+        int fields;
+
+        number++;
+        if(line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+
+        fields = sscanf(line, "%31s %32s %lu", name, key_text, &counter);
+        if(fields < 2 || strlen(key_text) != 2 * AES128_KEY_SIZE ||
+           parseHex(key_text, key, sizeof(key)) != sizeof(key))
+        {
+            fprintf(stderr, "%s:%u: expected name, key and counter\n",
+                    path, number);
+            fclose(in);
+            return -1;
+        }
+
+        if(EidResolverAddDevice(resolver, name, key, (uint32_t)counter) ==
+           EID_RESOLVER_UNKNOWN)
+        {
+            fprintf(stderr, "out of memory\n");
+            fclose(in);
+            return -1;
+        }
+    }
+
+    fclose(in);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      resolveStream
+ *
+ *  DESCRIPTION
+ *      Resolves every observation in a stream, printing each beacon once
+ *      per counter value, whichever frame carried it.
+ *
+ *  RETURNS
+ *      Number of IDs that were not resolved.
+ *
+ *---------------------------------------------------------------------------*/
+static unsigned resolveStream(EID_RESOLVER_T *resolver, FILE *in)
+{
+    char line[LINE_MAX_LENGTH];
+    uint64_t *last_seen = malloc((resolver->device_count + 1) *
+                                 sizeof(*last_seen));
+    unsigned unknown = 0;
+    uint32_t i;
+
+    if(last_seen == NULL)
+    {
+        return 0;
+    }
+
+    /* Counter each beacon was last printed with, none to begin with */
+    for(i = 0; i <= resolver->device_count; i++)
+    {
+        last_seen[i] = UINT64_MAX;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        uint8_t data[LINE_MAX_LENGTH / 2];
+        const uint8_t *id = data;
+        const char *hex = strrchr(line, ',');
+        size_t len;
+        uint32_t device;
+        uint32_t counter;
+
+        /* CSV lines end in the advertising data; the header has no hex */
+        hex = hex != NULL ? hex + 1 : line;
+        len = parseHex(hex, data, sizeof(data));
+        if(hex != line)
+        {
+            len = findId(data, len, &id);
+        }
+        if(len == 0)
+        {
+            continue;
+        }
+
+        device = EidResolverResolve(resolver, id, len, &counter);
+        if(device == EID_RESOLVER_UNKNOWN)
+        {
+            unknown++;
+            continue;
+        }
+
+        if(last_seen[device] != counter)
+        {
+            last_seen[device] = counter;
+            if(hex != line)
+            {
+                printf("%.*s ", (int)strcspn(line, ","), line);
+            }
+            printf("%s counter %u\n", EidResolverName(resolver, device),
+                   counter);
+        }
+    }
+
+    free(last_seen);
+
+    return unknown;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextRandom
+ *
+ *  DESCRIPTION
+ *      xorshift32, so that benchmark runs repeat exactly.
+ *
+ *  RETURNS
+ *      Next pseudo-random value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      seconds
+ *
+ *  DESCRIPTION
+ *      Monotonic time.
+ *
+ *  RETURNS
+ *      Time in seconds.
+ *
+ *---------------------------------------------------------------------------*/
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchmark
+ *
+ *  DESCRIPTION
+ *      Indexes made-up beacons and resolves IDs each might send next, a
+ *      random number of periods on from where it was last seen. Half the
+ *      lookups use the four octets of the iBeacon major and minor.
+ *
+ *  RETURNS
+ *      0 if every full ID resolved to the beacon that made it.
+ *
+ *---------------------------------------------------------------------------*/
+static int benchmark(EID_RESOLVER_T *resolver, uint32_t devices)
+{
+    uint32_t state = 1;
+    uint32_t *counters = malloc((size_t)devices * sizeof(*counters));
+    uint32_t lookups = devices * BENCH_LOOKUPS_PER_DEVICE;
+    uint32_t wrong[2] = { 0, 0 };
+    double start, built, done;
+    uint32_t i;
+
+    if(counters == NULL)
+    {
+        return -1;
+    }
+
+    start = seconds();
+    for(i = 0; i < devices; i++)
+    {
+        uint8_t key[AES128_KEY_SIZE];
+        char name[EID_RESOLVER_NAME_MAX];
+        int j;
+
+        for(j = 0; j < AES128_KEY_SIZE; j++)
+        {
+            key[j] = (uint8_t)nextRandom(&state);
+        }
+        counters[i] = nextRandom(&state) % 100000;
+        snprintf(name, sizeof(name), "beacon%u", i);
+
+        if(EidResolverAddDevice(resolver, name, key, counters[i]) != i)
+        {
+            free(counters);
+            return -1;
+        }
+    }
+    built = seconds();
+
+    for(i = 0; i < lookups; i++)
+    {
+        uint32_t device = nextRandom(&state) % devices;
+        uint8_t id[EID_RESOLVER_ID_SIZE];
+        uint32_t counter;
+        size_t len = (i & 1) ? EID_RESOLVER_ID_SIZE :
+                               EID_RESOLVER_SHORT_ID_SIZE;
+
+        counters[device] += nextRandom(&state) % (resolver->ahead / 2 + 1);
+        EidResolverDerive(&resolver->devices[device].key, counters[device],
+                          id);
+
+        if(EidResolverResolve(resolver, id, len, &counter) != device ||
+           counter != counters[device])
+        {
+            wrong[i & 1]++;
+        }
+    }
+    done = seconds();
+
+    printf("beacons                             : %u\n", devices);
+    printf("window behind / ahead               : %u / %u\n",
+           resolver->behind, resolver->ahead);
+    printf("index entries / slots               : %u / %u (%.1f MB)\n",
+           resolver->entries, resolver->table_mask + 1,
+           (resolver->table_mask + 1.0) * sizeof(EID_RESOLVER_ENTRY_T) /
+           (1024 * 1024));
+    printf("index build                         : %.3f s\n", built - start);
+    printf("lookups, window moves included      : %u, %.2f us each\n",
+           lookups, (done - built) * 1e6 / lookups);
+    printf("wrong or unresolved, 8 / 4 octets   : %u / %u\n",
+           wrong[1], wrong[0]);
+
+    free(counters);
+
+    /* Four octets leave room for the odd clash between beacons */
+    return wrong[1] == 0 ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-w behind:ahead] devices [observations]\n"
+            "       %s [-w behind:ahead] -b count\n"
+            "  -w  counter values indexed around the last one seen "
+            "(default %u:%u)\n"
+            "  -b  benchmark with that many made-up beacons\n",
+            name, name, DEFAULT_BEHIND, DEFAULT_AHEAD);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    EID_RESOLVER_T resolver;
+    uint32_t behind = DEFAULT_BEHIND;
+    uint32_t ahead = DEFAULT_AHEAD;
+    uint32_t bench = 0;
+    FILE *in = stdin;
+    unsigned unknown;
+    int opt;
+
+    while((opt = getopt(argc, argv, "w:b:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'w':
+                if(sscanf(optarg, "%u:%u", &behind, &ahead) != 2)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'b':
+                bench = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(bench != 0)
+    {
+        int result;
+
+        if(optind != argc ||
+           EidResolverInit(&resolver, behind, ahead, bench) != 0)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        result = benchmark(&resolver, bench);
+        EidResolverFree(&resolver);
+        return result;
+    }
+
+    if(optind >= argc || argc - optind > 2 ||
+       EidResolverInit(&resolver, behind, ahead, 0) != 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(readDevices(&resolver, argv[optind]) != 0)
+    {
+        EidResolverFree(&resolver);
+        return 1;
+    }
+
+    if(argc - optind == 2)
+    {
+        in = fopen(argv[optind + 1], "r");
+        if(in == NULL)
+        {
+            perror(argv[optind + 1]);
+            EidResolverFree(&resolver);
+            return 1;
+        }
+    }
+
+    unknown = resolveStream(&resolver, in);
+    if(unknown != 0)
+    {
+        fprintf(stderr, "%u observations not resolved\n", unknown);
+    }
+
+    if(in != stdin)
+    {
+        fclose(in);
+    }
+    EidResolverFree(&resolver);
+
+    return 0;
+}
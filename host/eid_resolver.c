@@ -0,0 +1,444 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      eid_resolver.c
+ *
+ *  DESCRIPTION
+ *      Ephemeral ID resolver. The index is keyed by the first four octets
+ *      of the ID, so that both the full Eddystone-EID identifier and the
+ *      iBeacon major and minor find the same entry. IDs are AES output, so
+ *      their low bits are used as the hash directly.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "eid_resolver.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Smallest index, in entries */
+#define RESOLVER_MIN_TABLE_SIZE         (1024)
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      homeSlot
+ *
+ *  DESCRIPTION
+ *      Works out where the probe sequence for an ID starts.
+ *
+ *  RETURNS
+ *      The slot.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t homeSlot(const EID_RESOLVER_T *resolver, const uint8_t *id)
+{
+    return (((uint32_t)id[0] << 24) | ((uint32_t)id[1] << 16) |
+            ((uint32_t)id[2] << 8) | id[3]) & resolver->table_mask;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      allocTable
+ *
+ *  DESCRIPTION
+ *      Allocates an empty index of the given size, a power of two.
+ *
+ *  RETURNS
+ *      The index, or NULL if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static EID_RESOLVER_ENTRY_T *allocTable(uint32_t size)
+{
+    EID_RESOLVER_ENTRY_T *table = malloc((size_t)size * sizeof(*table));
+    uint32_t i;
+
+    if(table == NULL)
+    {
+        return NULL;
+    }
+
+    for(i = 0; i < size; i++)
+    {
+        table[i].device = EID_RESOLVER_UNKNOWN;
+    }
+
+    return table;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      place
+ *
+ *  DESCRIPTION
+ *      Puts an entry in the first free slot of its probe sequence. The
+ *      caller makes sure there is room.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void place(EID_RESOLVER_T *resolver, const EID_RESOLVER_ENTRY_T *entry)
+{
+    uint32_t slot = homeSlot(resolver, entry->id);
+
+    while(resolver->table[slot].device != EID_RESOLVER_UNKNOWN)
+    {
+        slot = (slot + 1) & resolver->table_mask;
+    }
+
+    resolver->table[slot] = *entry;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      grow
+ *
+ *  DESCRIPTION
+ *      Doubles the index.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int grow(EID_RESOLVER_T *resolver)
+{
+    EID_RESOLVER_ENTRY_T *old = resolver->table;
+    uint32_t old_size = resolver->table_mask + 1;
+    uint32_t i;
+
+    resolver->table = allocTable(old_size * 2);
+    if(resolver->table == NULL)
+    {
+        resolver->table = old;
+        return -1;
+    }
+    resolver->table_mask = old_size * 2 - 1;
+
+    for(i = 0; i < old_size; i++)
+    {
+        if(old[i].device != EID_RESOLVER_UNKNOWN)
+        {
+            place(resolver, &old[i]);
+        }
+    }
+
+    free(old);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addEntry
+ *
+ *  DESCRIPTION
+ *      Indexes the ID of a device for one counter value.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int addEntry(EID_RESOLVER_T *resolver, uint32_t device,
+                    uint32_t counter)
+{
+    EID_RESOLVER_ENTRY_T entry;
+
+    if((resolver->entries + 1) * 2 > resolver->table_mask + 1 &&
+       grow(resolver) != 0)
+    {
+        return -1;
+    }
+
+    EidResolverDerive(&resolver->devices[device].key, counter, entry.id);
+    entry.device = device;
+    entry.counter = counter;
+
+    place(resolver, &entry);
+    resolver->entries++;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      removeEntry
+ *
+ *  DESCRIPTION
+ *      Drops the ID of a device for one counter value, shifting later
+ *      entries of the probe sequence back so that no tombstones are left.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void removeEntry(EID_RESOLVER_T *resolver, uint32_t device,
+                        uint32_t counter)
+{
+    EID_RESOLVER_ENTRY_T *table = resolver->table;
+    uint8_t id[EID_RESOLVER_ID_SIZE];
+    uint32_t hole;
+    uint32_t next;
+
+    EidResolverDerive(&resolver->devices[device].key, counter, id);
+
+    for(hole = homeSlot(resolver, id);
+        table[hole].device != device || table[hole].counter != counter;
+        hole = (hole + 1) & resolver->table_mask)
+    {
+        if(table[hole].device == EID_RESOLVER_UNKNOWN)
+        {
+            return;
+        }
+    }
+
+    next = hole;
+    for(;;)
+    {
+        uint32_t home;
+
+        next = (next + 1) & resolver->table_mask;
+        if(table[next].device == EID_RESOLVER_UNKNOWN)
+        {
+            break;
+        }
+
+        /* Entries whose home lies cyclically in (hole, next] stay put */
+        home = homeSlot(resolver, table[next].id);
+        if(hole <= next ? (hole < home && home <= next) :
+                          (hole < home || home <= next))
+        {
+            continue;
+        }
+
+        table[hole] = table[next];
+        hole = next;
+    }
+
+    table[hole].device = EID_RESOLVER_UNKNOWN;
+    resolver->entries--;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      slideWindow
+ *
+ *  DESCRIPTION
+ *      Moves the window of a device forward to follow the counter it was
+ *      last seen with. It never moves back, so a replayed old ID does not
+ *      lose the device.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void slideWindow(EID_RESOLVER_T *resolver, uint32_t device,
+                        uint32_t counter)
+{
+    EID_RESOLVER_DEVICE_T *dev = &resolver->devices[device];
+    uint32_t first = counter > resolver->behind ?
+                     counter - resolver->behind : 0;
+    uint64_t end = (uint64_t)counter + resolver->ahead + 1;
+    uint64_t c;
+
+    if(end <= dev->end)
+    {
+        return;
+    }
+
+    for(c = dev->first; c < first && c < dev->end; c++)
+    {
+        removeEntry(resolver, device, (uint32_t)c);
+    }
+
+    for(c = dev->end > first ? dev->end : first; c < end; c++)
+    {
+        if(c > UINT32_MAX || addEntry(resolver, device, (uint32_t)c) != 0)
+        {
+            end = c;
+            break;
+        }
+    }
+
+    dev->first = first;
+    dev->end = end;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int EidResolverInit(EID_RESOLVER_T *resolver, uint32_t behind,
+                    uint32_t ahead, uint32_t expected_devices)
+{
+    uint64_t wanted = (uint64_t)expected_devices * (behind + ahead + 1) * 2;
+    uint32_t size = RESOLVER_MIN_TABLE_SIZE;
+
+    while(size < wanted && size < (1u << 31))
+    {
+        size *= 2;
+    }
+
+    memset(resolver, 0, sizeof(*resolver));
+    resolver->behind = behind;
+    resolver->ahead = ahead;
+
+    resolver->table = allocTable(size);
+    if(resolver->table == NULL)
+    {
+        return -1;
+    }
+    resolver->table_mask = size - 1;
+
+    if(expected_devices != 0)
+    {
+        resolver->devices = malloc((size_t)expected_devices *
+                                   sizeof(*resolver->devices));
+        if(resolver->devices == NULL)
+        {
+            free(resolver->table);
+            return -1;
+        }
+        resolver->device_capacity = expected_devices;
+    }
+
+    return 0;
+}
+
+void EidResolverFree(EID_RESOLVER_T *resolver)
+{
+    free(resolver->table);
+    free(resolver->devices);
+    memset(resolver, 0, sizeof(*resolver));
+}
+
+uint32_t EidResolverAddDevice(EID_RESOLVER_T *resolver, const char *name,
+                              const uint8_t key[AES128_KEY_SIZE],
+                              uint32_t counter)
+{
+    EID_RESOLVER_DEVICE_T *dev;
+    uint32_t device = resolver->device_count;
+
+    if(device == EID_RESOLVER_UNKNOWN)
+    {
+        return EID_RESOLVER_UNKNOWN;
+    }
+
+    if(device == resolver->device_capacity)
+    {
+        uint32_t capacity = device ? device * 2 : 16;
+        EID_RESOLVER_DEVICE_T *devices =
+            realloc(resolver->devices, (size_t)capacity * sizeof(*devices));
+
+        if(devices == NULL)
+        {
+            return EID_RESOLVER_UNKNOWN;
+        }
+        resolver->devices = devices;
+        resolver->device_capacity = capacity;
+    }
+
+    dev = &resolver->devices[device];
+    strncpy(dev->name, name, EID_RESOLVER_NAME_MAX - 1);
+    dev->name[EID_RESOLVER_NAME_MAX - 1] = '\0';
+    Aes128ExpandKey(&dev->key, key);
+    resolver->device_count++;
+
+    /* Start from an empty window and let slideWindow() fill it */
+    dev->first = counter > resolver->behind ? counter - resolver->behind : 0;
+    dev->end = dev->first;
+    slideWindow(resolver, device, counter);
+
+    return device;
+}
+
+void EidResolverDerive(const AES128_KEY_T *key, uint32_t counter,
+                       uint8_t id[EID_RESOLVER_ID_SIZE])
+{
+    uint8_t block[AES128_BLOCK_SIZE] = { 0 };
+
+    block[12] = (uint8_t)(counter >> 24);
+    block[13] = (uint8_t)(counter >> 16);
+    block[14] = (uint8_t)(counter >> 8);
+    block[15] = (uint8_t)counter;
+
+    Aes128Encrypt(key, block, block);
+    memcpy(id, block, EID_RESOLVER_ID_SIZE);
+}
+
+uint32_t EidResolverResolve(EID_RESOLVER_T *resolver, const uint8_t *id,
+                            size_t len, uint32_t *counter)
+{
+    const EID_RESOLVER_ENTRY_T *match = NULL;
+    uint32_t device;
+    uint32_t found;
+    uint32_t slot;
+
+    if(len != EID_RESOLVER_ID_SIZE && len != EID_RESOLVER_SHORT_ID_SIZE)
+    {
+        return EID_RESOLVER_UNKNOWN;
+    }
+
+    for(slot = homeSlot(resolver, id);
+        resolver->table[slot].device != EID_RESOLVER_UNKNOWN;
+        slot = (slot + 1) & resolver->table_mask)
+    {
+        const EID_RESOLVER_ENTRY_T *entry = &resolver->table[slot];
+
+        if(memcmp(entry->id, id, len) != 0)
+        {
+            continue;
+        }
+
+        /* A full ID is unique. Four octets can clash, and following the
+         * wrong device would move its window past where it really is, so
+         * a short ID that matches twice is not resolved.
+         */
+        if(match != NULL)
+        {
+            return EID_RESOLVER_UNKNOWN;
+        }
+        match = entry;
+        if(len == EID_RESOLVER_ID_SIZE)
+        {
+            break;
+        }
+    }
+
+    if(match == NULL)
+    {
+        return EID_RESOLVER_UNKNOWN;
+    }
+
+    device = match->device;
+    found = match->counter;
+    slideWindow(resolver, device, found);
+    if(counter != NULL)
+    {
+        *counter = found;
+    }
+
+    return device;
+}
+
+const char *EidResolverName(const EID_RESOLVER_T *resolver, uint32_t device)
+{
+    return device < resolver->device_count ?
+           resolver->devices[device].name : "?";
+}
@@ -0,0 +1,133 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      eid_resolver.h
+ *
+ *  DESCRIPTION
+ *      Maps ephemeral IDs seen on air back to the beacons that sent them.
+ *
+ *      Every device contributes the IDs of a window of counter values
+ *      around the last one it was seen with to a single hash index, so a
+ *      lookup is one probe sequence whatever the number of devices. When a
+ *      device is seen its window slides forward to follow it; the window
+ *      must be wide enough to cover the IDs a device may send between two
+ *      sightings.
+ *
+ *      IDs are derived as beacon_eid.h describes: the first eight octets of
+ *      AES-128 under the device key of twelve zero octets followed by the
+ *      counter, big endian. An iBeacon major and minor are the first four
+ *      octets.
+ *
+ *****************************************************************************/
+
+#ifndef __EID_RESOLVER_H__
+#define __EID_RESOLVER_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "aes128.h"
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Full ID length, and the length carried by the iBeacon major and minor */
+#define EID_RESOLVER_ID_SIZE            (8)
+#define EID_RESOLVER_SHORT_ID_SIZE      (4)
+
+/* Longest device name kept */
+#define EID_RESOLVER_NAME_MAX           (32)
+
+/* Returned by EidResolverResolve() when the ID is not known */
+#define EID_RESOLVER_UNKNOWN            (UINT32_MAX)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    char name[EID_RESOLVER_NAME_MAX];
+    AES128_KEY_T key;
+
+    /* Counter values whose IDs are in the index, from first up to but not
+     * including end
+     */
+    uint32_t first;
+    uint64_t end;
+} EID_RESOLVER_DEVICE_T;
+
+/* Index entry; device is EID_RESOLVER_UNKNOWN for an empty slot */
+typedef struct
+{
+    uint8_t id[EID_RESOLVER_ID_SIZE];
+    uint32_t device;
+    uint32_t counter;
+} EID_RESOLVER_ENTRY_T;
+
+typedef struct
+{
+    EID_RESOLVER_DEVICE_T *devices;
+    uint32_t device_count;
+    uint32_t device_capacity;
+
+    /* Open addressing with linear probing, kept at most half full */
+    EID_RESOLVER_ENTRY_T *table;
+    uint32_t table_mask;
+    uint32_t entries;
+
+    /* Counter values indexed behind and ahead of the last one seen */
+    uint32_t behind;
+    uint32_t ahead;
+} EID_RESOLVER_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Start an empty resolver, sized for the expected number of devices;
+ * returns 0 on success
+ */
+extern int EidResolverInit(EID_RESOLVER_T *resolver, uint32_t behind,
+                           uint32_t ahead, uint32_t expected_devices);
+
+/* Release a resolver */
+extern void EidResolverFree(EID_RESOLVER_T *resolver);
+
+/* Add a device, last seen (or provisioned) with the given counter; returns
+ * its number, or EID_RESOLVER_UNKNOWN if out of memory
+ */
+extern uint32_t EidResolverAddDevice(EID_RESOLVER_T *resolver,
+                                     const char *name,
+                                     const uint8_t key[AES128_KEY_SIZE],
+                                     uint32_t counter);
+
+/* Derive the ID of a key and counter */
+extern void EidResolverDerive(const AES128_KEY_T *key, uint32_t counter,
+                              uint8_t id[EID_RESOLVER_ID_SIZE]);
+
+/* Look up an ID of EID_RESOLVER_ID_SIZE or EID_RESOLVER_SHORT_ID_SIZE
+ * octets; a short ID matching more than one device is not resolved. On a
+ * match the device's window moves to follow it and the counter is returned
+ * through counter if not NULL. Returns the device number or
+ * EID_RESOLVER_UNKNOWN.
+ */
+extern uint32_t EidResolverResolve(EID_RESOLVER_T *resolver,
+                                   const uint8_t *id, size_t len,
+                                   uint32_t *counter);
+
+/* Name of a device */
+extern const char *EidResolverName(const EID_RESOLVER_T *resolver,
+                                   uint32_t device);
+
+#endif /* __EID_RESOLVER_H__ */
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      energy_model.h
+ *
+ *  DESCRIPTION
+ *      Cycle and current figures used by the host SDK stand-in. Currents are
+ *      CSR101x datasheet typicals at 3V; SDK call costs are estimates of the
+ *      firmware work behind each call. The figures are a model, so compare
+ *      results between firmware builds rather than against a bench meter.
+ *
+ *****************************************************************************/
+
+#ifndef __ENERGY_MODEL_H__
+#define __ENERGY_MODEL_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* XAP2 core clock */
+#define MODEL_CPU_HZ                    (16000000UL)
+
+/* Currents in microamps */
+#define MODEL_CPU_ACTIVE_UA             (3000.0)
+#define MODEL_DEEP_SLEEP_UA             (5.0)
+#define MODEL_HIBERNATE_UA              (1.2)
+#define MODEL_DORMANT_UA                (0.6)
+#define MODEL_RADIO_IDLE_UA             (8000.0)
+#define MODEL_RADIO_TX_UA               (18000.0)
+#define MODEL_RADIO_RX_UA               (16000.0)
+
+/* Average radio current while connected at the connection interval the
+ * central opens with (1.25 ms units) and no slave latency, and the time to
+ * tear a connection down. The current scales with the connection events
+ * the slave has to listen to.
+ */
+#define MODEL_RADIO_CONNECTED_UA        (200.0)
+#define MODEL_CONN_DEFAULT_INTERVAL     (24)
+#define MODEL_DISCONNECT_US             (50000)
+
+/* Time for the central to answer a connection parameter update request,
+ * and from the answer to the instant the new parameters apply
+ */
+#define MODEL_CONN_PARAM_RSP_US         (60000)
+#define MODEL_CONN_UPDATE_US            (200000)
+
+/* Extra TX current for each &TX_POWER_LEVEL step above level 0 */
+#define MODEL_RADIO_TX_UA_PER_LEVEL     (800.0)
+
+/* Battery voltage below which the firmware raises sys_event_battery_low */
+#define MODEL_BATTERY_LOW_MV            (1800)
+
+/* Advertising event timing in microseconds. Each channel carries preamble,
+ * access address, PDU header, AdvA and CRC (16 octets) plus the AD data at
+ * 1 Mbps.
+ */
+#define MODEL_ADV_WAKE_US               (400)
+#define MODEL_ADV_CHANNEL_GAP_US        (150)
+#define MODEL_ADV_PDU_OVERHEAD_OCTETS   (16)
+#define MODEL_US_PER_OCTET              (8)
+
+/* Connectable and scannable advertising listen for a connection or scan
+ * request after the PDU on each channel
+ */
+#define MODEL_ADV_CONN_RX_US            (200)
+
+/* A scan response follows a scan request after the inter-frame space, and
+ * carries the same overhead as an advertising PDU
+ */
+#define MODEL_SCAN_RSP_IFS_US           (150)
+
+/* Pseudo-random advDelay added to every advertising interval */
+#define MODEL_ADV_DELAY_MAX_US          (10000)
+
+/* Delay from advertising enable to the first event */
+#define MODEL_ADV_FIRST_EVENT_US        (1250)
+
+/* UART debug output is blocking: 10 bits per character at 115200 baud */
+#define MODEL_UART_US_PER_CHAR          (87)
+
+/* Extra current while the UART sends in the background, which keeps the
+ * chip out of deep sleep
+ */
+#define MODEL_UART_ACTIVE_UA            (900.0)
+
+/* Cycle cost of each SDK call */
+#define MODEL_CYCLES_USER_KEY           (120)
+#define MODEL_CYCLES_GAP_SET_MODE       (900)
+#define MODEL_CYCLES_GAP_SET_ADV_INTVL  (350)
+#define MODEL_CYCLES_GAP_SET_ADV_CHAN   (350)
+#define MODEL_CYCLES_STORE_ADV_BASE     (450)
+#define MODEL_CYCLES_STORE_ADV_OCTET    (24)
+#define MODEL_CYCLES_START_STOP_ADV     (1600)
+#define MODEL_CYCLES_GAP_SET_SCAN_INTVL (350)
+#define MODEL_CYCLES_START_STOP_SCAN    (1600)
+#define MODEL_CYCLES_MEM_COPY_BASE      (12)
+#define MODEL_CYCLES_MEM_COPY_UNIT      (4)
+#define MODEL_CYCLES_DEBUG_INIT         (600)
+#define MODEL_CYCLES_DEBUG_CHAR         (MODEL_UART_US_PER_CHAR * \
+                                         (MODEL_CPU_HZ / 1000000UL))
+#define MODEL_CYCLES_GATT_INIT          (4000)
+#define MODEL_CYCLES_TIMER              (150)
+#define MODEL_CYCLES_BATTERY_READ       (1600)
+#define MODEL_CYCLES_TEMPERATURE_READ   (1600)
+#define MODEL_CYCLES_SET_TX_POWER       (300)
+#define MODEL_CYCLES_SLEEP_REQUEST      (400)
+#define MODEL_CYCLES_GATT_ADD_DB_BASE   (1200)
+#define MODEL_CYCLES_GATT_ADD_DB_WORD   (20)
+#define MODEL_CYCLES_GATT_ACCESS_RSP    (700)
+#define MODEL_CYCLES_GATT_CONNECT       (1800)
+#define MODEL_CYCLES_CONN_PARAM_UPDATE  (900)
+#define MODEL_CYCLES_UART_INIT          (600)
+#define MODEL_CYCLES_UART_WRITE_BASE    (150)
+#define MODEL_CYCLES_UART_WRITE_WORD    (8)
+
+/* One block through the AES hardware the link layer uses, loading the key
+ * and data and reading the result back
+ */
+#define MODEL_CYCLES_AES_ENCRYPT        (700)
+
+/* Delay from GattAddDatabaseReq() to GATT_ADD_DB_CFM */
+#define MODEL_GATT_ADD_DB_US            (2000)
+
+/* I2C EEPROM access: 100 kHz bus, a word is two octets plus addressing,
+ * and every write waits out a 5 ms page write cycle
+ */
+#define MODEL_CYCLES_NVM_ACCESS         (4000)
+#define MODEL_CYCLES_NVM_WORD           (2900)
+#define MODEL_CYCLES_NVM_PAGE_WRITE     (80000)
+
+/* Cycles to wake from deep sleep, dispatch to the application and return */
+#define MODEL_CYCLES_WAKE               (800)
+
+/* Setting up a PIO or reading its level */
+#define MODEL_CYCLES_PIO                (100)
+
+#endif /* __ENERGY_MODEL_H__ */
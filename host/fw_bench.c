@@ -0,0 +1,1073 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      fw_bench.c
+ *
+ *  DESCRIPTION
+ *      Footprint and cycle regression check for the application.
+ *
+ *      fw_bench [-r file.keyr] [-b baseline] [-u] [-v] file...
+ *
+ *          Each file is an ELF object or image, or a gcc -fstack-usage
+ *          file. Code, constant, initialised data and zero-initialised
+ *          data are added up per symbol and per section from the ELF
+ *          symbol and section tables, as 32 or 64-bit ELF of either byte
+ *          order, so the XAP2 image from xIDE reads the same way as the
+ *          host objects. Stack usage files give each function's frame.
+ *
+ *          The application, linked into this tool, is booted on the SDK
+ *          stand-in to count the cycles from AppInit() to advertising
+ *          enable, the part of them spent in startBeaconing(), and the
+ *          cycles of an hour of advertising.
+ *
+ *          The totals and cycle counts are compared with the baseline; any
+ *          that went up is a regression and the exit status is 1. Symbols
+ *          that changed are listed to show where. -u writes the baseline
+ *          instead.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define US_PER_SECOND                   (1000000ULL)
+#define BENCH_SECONDS                   (3600)
+
+#define NAME_MAX_LENGTH                 (64)
+#define LINE_MAX_LENGTH                 (256)
+
+/* ELF */
+#define ELF_MAGIC                       "\177ELF"
+#define ELFCLASS32                      (1)
+#define ELFCLASS64                      (2)
+#define ELFDATA2LSB                     (1)
+#define ELFDATA2MSB                     (2)
+
+#define SHT_SYMTAB                      (2)
+#define SHT_NOTE                        (7)
+#define SHT_NOBITS                      (8)
+
+#define SHF_WRITE                       (0x1)
+#define SHF_ALLOC                       (0x2)
+#define SHF_EXECINSTR                   (0x4)
+
+#define SHN_LORESERVE                   (0xFF00)
+#define SHN_COMMON                      (0xFFF2)
+
+#define STT_OBJECT                      (1)
+#define STT_FUNC                        (2)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* What an entry counts; the order is the order of the report */
+typedef enum
+{
+    kind_cycles,
+    kind_total,
+    kind_code,
+    kind_const,
+    kind_data,
+    kind_bss,
+    kind_stack,
+    kind_count
+} kind;
+
+typedef struct
+{
+    kind kind;
+    char name[NAME_MAX_LENGTH];
+    uint64_t value;
+} ENTRY_T;
+
+typedef struct
+{
+    ENTRY_T *entries;
+    uint32_t count;
+    uint32_t capacity;
+} TABLE_T;
+
+/* ELF file in memory */
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+    int is64;
+    int big_endian;
+} ELF_T;
+
+/* Section header fields used here */
+typedef struct
+{
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint64_t entsize;
+} SECTION_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const char *const g_kind_names[kind_count] =
+{
+    "cycles", "total", "code", "const", "data", "bss", "stack"
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addEntry
+ *
+ *  DESCRIPTION
+ *      Adds a value to an entry of a table, making the entry if needed.
+ *      Stack entries keep the largest value instead, since a function
+ *      built more than once has one frame.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static int addEntry(TABLE_T *table, kind kind, const char *name,
+                    uint64_t value)
+{
+    ENTRY_T *entry;
+    uint32_t i;
+
+    for(i = 0; i < table->count; i++)
+    {
+        entry = &table->entries[i];
+        if(entry->kind == kind && strcmp(entry->name, name) == 0)
+        {
+            if(kind != kind_stack)
+            {
+                entry->value += value;
+            }
+            else if(value > entry->value)
+            {
+                entry->value = value;
+            }
+            return 0;
+        }
+    }
+
+    if(table->count == table->capacity)
+    {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : 256;
+        ENTRY_T *entries = realloc(table->entries,
+                                   capacity * sizeof(*entries));
+
+        if(entries == NULL)
+        {
+            return -1;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    entry = &table->entries[table->count++];
+    entry->kind = kind;
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->value = value;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findEntry
+ *
+ *  DESCRIPTION
+ *      Looks an entry up by kind and name.
+ *
+ *  RETURNS
+ *      The entry, or NULL.
+ *
+ *---------------------------------------------------------------------------*/
+static const ENTRY_T *findEntry(const TABLE_T *table, kind kind,
+                                const char *name)
+{
+    uint32_t i;
+
+    for(i = 0; i < table->count; i++)
+    {
+        if(table->entries[i].kind == kind &&
+           strcmp(table->entries[i].name, name) == 0)
+        {
+            return &table->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      compareEntries
+ *
+ *  DESCRIPTION
+ *      qsort comparison by kind and then name.
+ *
+ *  RETURNS
+ *      <0, 0 or >0.
+ *
+ *---------------------------------------------------------------------------*/
+static int compareEntries(const void *a, const void *b)
+{
+    const ENTRY_T *x = (const ENTRY_T *)a;
+    const ENTRY_T *y = (const ENTRY_T *)b;
+
+    if(x->kind != y->kind)
+    {
+        return (int)x->kind - (int)y->kind;
+    }
+
+    return strcmp(x->name, y->name);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readValue
+ *
+ *  DESCRIPTION
+ *      Reads an unsigned field of 1, 2, 4 or 8 octets in the file's byte
+ *      order.
+ *
+ *  RETURNS
+ *      The value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t readValue(const ELF_T *elf, uint64_t offset, uint8_t width)
+{
+    uint64_t value = 0;
+    uint8_t i;
+
+    for(i = 0; i < width; i++)
+    {
+        uint8_t octet = elf->data[offset + (elf->big_endian ?
+                                            i : width - 1 - i)];
+
+        value = (value << 8) | octet;
+    }
+
+    return value;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readSection
+ *
+ *  DESCRIPTION
+ *      Reads a section header.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if it is outside the file.
+ *
+ *---------------------------------------------------------------------------*/
+static int readSection(const ELF_T *elf, uint32_t index, SECTION_T *section)
+{
+    uint64_t shoff = readValue(elf, elf->is64 ? 0x28 : 0x20,
+                               elf->is64 ? 8 : 4);
+    uint16_t shentsize = (uint16_t)readValue(elf, elf->is64 ? 0x3A : 0x2E, 2);
+    uint64_t at = shoff + (uint64_t)index * shentsize;
+
+    if(shentsize < (elf->is64 ? 64 : 40) || at + shentsize > elf->size)
+    {
+        return -1;
+    }
+
+    section->name = (uint32_t)readValue(elf, at, 4);
+    section->type = (uint32_t)readValue(elf, at + 4, 4);
+    if(elf->is64)
+    {
+        section->flags = readValue(elf, at + 8, 8);
+        section->offset = readValue(elf, at + 24, 8);
+        section->size = readValue(elf, at + 32, 8);
+        section->link = (uint32_t)readValue(elf, at + 40, 4);
+        section->entsize = readValue(elf, at + 56, 8);
+    }
+    else
+    {
+        section->flags = readValue(elf, at + 8, 4);
+        section->offset = readValue(elf, at + 16, 4);
+        section->size = readValue(elf, at + 20, 4);
+        section->link = (uint32_t)readValue(elf, at + 24, 4);
+        section->entsize = readValue(elf, at + 36, 4);
+    }
+
+    if(section->type != SHT_NOBITS &&
+       (section->offset > elf->size ||
+        section->size > elf->size - section->offset))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      stringAt
+ *
+ *  DESCRIPTION
+ *      Finds a string in a string table section.
+ *
+ *  RETURNS
+ *      The string, or "" if it is outside the table.
+ *
+ *---------------------------------------------------------------------------*/
+static const char *stringAt(const ELF_T *elf, const SECTION_T *strtab,
+                            uint32_t offset)
+{
+    const char *text = (const char *)&elf->data[strtab->offset];
+
+    if(offset >= strtab->size || memchr(&text[offset], '\0',
+                                        strtab->size - offset) == NULL)
+    {
+        return "";
+    }
+
+    return &text[offset];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sectionKind
+ *
+ *  DESCRIPTION
+ *      Classifies a section by its type and flags. Notes and unwind tables
+ *      are left out: they are host build artefacts with no XAP2 equivalent.
+ *
+ *  RETURNS
+ *      kind_code, kind_const, kind_data or kind_bss, or kind_count if the
+ *      section is not part of the image.
+ *
+ *---------------------------------------------------------------------------*/
+static kind sectionKind(const SECTION_T *section, const char *name)
+{
+    if(!(section->flags & SHF_ALLOC) || section->type == SHT_NOTE ||
+       strncmp(name, ".eh_frame", 9) == 0)
+    {
+        return kind_count;
+    }
+    if(section->flags & SHF_EXECINSTR)
+    {
+        return kind_code;
+    }
+    if(section->type == SHT_NOBITS)
+    {
+        return kind_bss;
+    }
+
+    return (section->flags & SHF_WRITE) ? kind_data : kind_const;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readElf
+ *
+ *  DESCRIPTION
+ *      Adds the allocated sections and the sized function and object
+ *      symbols of an ELF file to the table.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be read or is not ELF.
+ *
+ *---------------------------------------------------------------------------*/
+static int readElf(const char *path, const uint8_t *data, size_t size,
+                   TABLE_T *table)
+{
+    ELF_T elf;
+    SECTION_T shstrtab;
+    uint16_t shnum;
+    uint16_t i;
+
+    if(size < 0x40 || memcmp(data, ELF_MAGIC, 4) != 0 ||
+       (data[4] != ELFCLASS32 && data[4] != ELFCLASS64) ||
+       (data[5] != ELFDATA2LSB && data[5] != ELFDATA2MSB))
+    {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        return -1;
+    }
+
+    elf.data = data;
+    elf.size = size;
+    elf.is64 = data[4] == ELFCLASS64;
+    elf.big_endian = data[5] == ELFDATA2MSB;
+
+    shnum = (uint16_t)readValue(&elf, elf.is64 ? 0x3C : 0x30, 2);
+    if(readSection(&elf, (uint16_t)readValue(&elf, elf.is64 ? 0x3E : 0x32, 2),
+                   &shstrtab) != 0)
+    {
+        fprintf(stderr, "%s: bad section headers\n", path);
+        return -1;
+    }
+
+    for(i = 0; i < shnum; i++)
+    {
+        SECTION_T section;
+        kind section_kind;
+
+        if(readSection(&elf, i, &section) != 0)
+        {
+            fprintf(stderr, "%s: bad section header %u\n", path, i);
+            return -1;
+        }
+
+        section_kind = sectionKind(&section,
+                                   stringAt(&elf, &shstrtab, section.name));
+        if(section_kind != kind_count &&
+           addEntry(table, kind_total, g_kind_names[section_kind],
+                    section.size) != 0)
+        {
+            return -1;
+        }
+    }
+
+    for(i = 0; i < shnum; i++)
+    {
+        SECTION_T symtab;
+        SECTION_T strtab;
+        uint64_t entsize = elf.is64 ? 24 : 16;
+        uint64_t at;
+
+        if(readSection(&elf, i, &symtab) != 0 || symtab.type != SHT_SYMTAB)
+        {
+            continue;
+        }
+        if(symtab.entsize < entsize ||
+           readSection(&elf, symtab.link, &strtab) != 0)
+        {
+            fprintf(stderr, "%s: bad symbol table\n", path);
+            return -1;
+        }
+
+        for(at = symtab.offset; at + entsize <= symtab.offset + symtab.size;
+            at += symtab.entsize)
+        {
+            uint32_t name = (uint32_t)readValue(&elf, at, 4);
+            uint8_t info = (uint8_t)readValue(&elf, at + (elf.is64 ? 4 : 12),
+                                              1);
+            uint16_t shndx = (uint16_t)readValue(&elf,
+                                                 at + (elf.is64 ? 6 : 14), 2);
+            uint64_t value_size = readValue(&elf, at + (elf.is64 ? 16 : 8),
+                                            elf.is64 ? 8 : 4);
+            kind symbol_kind;
+
+            if(value_size == 0 ||
+               ((info & 0xF) != STT_FUNC && (info & 0xF) != STT_OBJECT))
+            {
+                continue;
+            }
+
+            if(shndx == SHN_COMMON)
+            {
+                symbol_kind = kind_bss;
+            }
+            else if(shndx == 0 || shndx >= SHN_LORESERVE || shndx >= shnum)
+            {
+                continue;
+            }
+            else
+            {
+                SECTION_T section;
+
+                if(readSection(&elf, shndx, &section) != 0)
+                {
+                    continue;
+                }
+                symbol_kind = sectionKind(&section,
+                                          stringAt(&elf, &shstrtab,
+                                                   section.name));
+            }
+
+            if(symbol_kind != kind_count &&
+               addEntry(table, symbol_kind, stringAt(&elf, &strtab, name),
+                        value_size) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readStackUsage
+ *
+ *  DESCRIPTION
+ *      Adds the frames in a gcc -fstack-usage file to the table. Lines look
+ *      like "file.c:296:6:startBeaconing<tab>16<tab>static".
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be read.
+ *
+ *---------------------------------------------------------------------------*/
+static int readStackUsage(const char *path, TABLE_T *table)
+{
+    char line[LINE_MAX_LENGTH];
+    FILE *in = fopen(path, "r");
+    int result = 0;
+
+    if(in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while(result == 0 && fgets(line, sizeof(line), in) != NULL)
+    {
+        char *tab = strchr(line, '\t');
+        char *name;
+
+        if(tab == NULL)
+        {
+            continue;
+        }
+        *tab = '\0';
+        name = strrchr(line, ':');
+        name = name != NULL ? name + 1 : line;
+
+        result = addEntry(table, kind_stack, name,
+                          strtoull(tab + 1, NULL, 10));
+    }
+
+    fclose(in);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readFile
+ *
+ *  DESCRIPTION
+ *      Reads an ELF or stack usage file into the table.
+ *
+ *  RETURNS
+ *      Zero on success, -1 on failure.
+ *
+ *---------------------------------------------------------------------------*/
+static int readFile(const char *path, TABLE_T *table)
+{
+    size_t length = strlen(path);
+    FILE *in;
+    uint8_t *data;
+    long size;
+    int result;
+
+    if(length > 3 && strcmp(&path[length - 3], ".su") == 0)
+    {
+        return readStackUsage(path, table);
+    }
+
+    in = fopen(path, "rb");
+    if(in == NULL || fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) < 0 ||
+       fseek(in, 0, SEEK_SET) != 0)
+    {
+        perror(path);
+        if(in != NULL)
+        {
+            fclose(in);
+        }
+        return -1;
+    }
+
+    data = malloc((size_t)size + 1);
+    if(data == NULL || fread(data, 1, (size_t)size, in) != (size_t)size)
+    {
+        perror(path);
+        fclose(in);
+        free(data);
+        return -1;
+    }
+    fclose(in);
+
+    result = readElf(path, data, (size_t)size, table);
+    free(data);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readKeyr
+ *
+ *  DESCRIPTION
+ *      Reads the &USER_KEYS words and the &nvm_size from a keyr file. The
+ *      NVM size is left alone if the file does not set it.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be read or has no user keys.
+ *
+ *---------------------------------------------------------------------------*/
+static int readKeyr(const char *path, uint16_t *keys, uint16_t *nvm_size)
+{
+    char line[256];
+    int found = -1;
+    FILE *in = fopen(path, "r");
+
+    if(in == NULL)
+    {
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char *p;
+        int i;
+
+        if(line[0] == '/')
+        {
+            continue;
+        }
+
+        if((p = strstr(line, "&nvm_size")) != NULL &&
+           (p = strchr(p, '=')) != NULL)
+        {
+            *nvm_size = (uint16_t)strtoul(p + 1, NULL, 16);
+            continue;
+        }
+
+        if((p = strstr(line, "&USER_KEYS")) == NULL ||
+           (p = strchr(p, '=')) == NULL)
+        {
+            continue;
+        }
+
+        p++;
+        for(i = 0; i < HARNESS_USER_KEY_COUNT; i++)
+        {
+            char *end;
+
+            keys[i] = (uint16_t)strtoul(p, &end, 16);
+            if(end == p)
+            {
+                break;
+            }
+            p = end;
+        }
+        found = 0;
+    }
+
+    fclose(in);
+
+    return found;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      measureCycles
+ *
+ *  DESCRIPTION
+ *      Boots the application on the SDK stand-in and adds its boot,
+ *      startBeaconing() and per-hour cycle counts to the table, then the
+ *      boot cycles of a wake from hibernate.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the application never advertised.
+ *
+ *---------------------------------------------------------------------------*/
+static int measureCycles(const uint16_t *keys, uint16_t nvm_size,
+                         TABLE_T *table)
+{
+    const HARNESS_STATS_T *stats;
+    uint16_t i;
+
+    HarnessReset(1);
+    for(i = 0; i < HARNESS_USER_KEY_COUNT; i++)
+    {
+        HarnessSetUserKey(i, keys[i]);
+    }
+    HarnessSetNvmSize(nvm_size);
+
+    HarnessBoot();
+    HarnessRun(BENCH_SECONDS * US_PER_SECOND);
+
+    stats = HarnessStats();
+    if(stats->adv_enable_us == HARNESS_NEVER)
+    {
+        fprintf(stderr, "the application did not advertise\n");
+        return -1;
+    }
+
+    if(addEntry(table, kind_cycles, "boot", stats->boot_cycles) != 0 ||
+       addEntry(table, kind_cycles, "start_beaconing",
+                stats->adv_start_cycles) != 0 ||
+       addEntry(table, kind_cycles, "hour", stats->cycles) != 0)
+    {
+        return -1;
+    }
+
+    /* then wake from hibernate, as a scheduled or motion-woken beacon does */
+    HarnessWarmBoot(0);
+    HarnessRun(US_PER_SECOND);
+    if(stats->warm_boots == 0)
+    {
+        fprintf(stderr, "the application did not advertise after a wake\n");
+        return -1;
+    }
+
+    if(addEntry(table, kind_cycles, "warm_boot",
+                stats->warm_boot_cycles) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addTotals
+ *
+ *  DESCRIPTION
+ *      Adds flash, RAM and the largest stack frame to the totals. Flash
+ *      holds code, constants and the initial values of data; RAM holds
+ *      data and bss.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static int addTotals(TABLE_T *table)
+{
+    uint64_t value[kind_count] = { 0 };
+    uint64_t stack = 0;
+    const ENTRY_T *entry;
+    uint32_t i;
+
+    for(i = kind_code; i <= kind_bss; i++)
+    {
+        entry = findEntry(table, kind_total, g_kind_names[i]);
+        value[i] = entry != NULL ? entry->value : 0;
+    }
+    for(i = 0; i < table->count; i++)
+    {
+        if(table->entries[i].kind == kind_stack &&
+           table->entries[i].value > stack)
+        {
+            stack = table->entries[i].value;
+        }
+    }
+
+    if(addEntry(table, kind_total, "flash", value[kind_code] +
+                value[kind_const] + value[kind_data]) != 0 ||
+       addEntry(table, kind_total, "ram", value[kind_data] +
+                value[kind_bss]) != 0 ||
+       addEntry(table, kind_total, "largest_frame", stack) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readBaseline
+ *
+ *  DESCRIPTION
+ *      Reads a baseline written by writeBaseline().
+ *
+ *  RETURNS
+ *      Zero on success, -1 if it cannot be read.
+ *
+ *---------------------------------------------------------------------------*/
+static int readBaseline(const char *path, TABLE_T *table)
+{
+    char line[LINE_MAX_LENGTH];
+    FILE *in = fopen(path, "r");
+    int result = 0;
+
+    if(in == NULL)
+    {
+        return -1;
+    }
+
+    while(result == 0 && fgets(line, sizeof(line), in) != NULL)
+    {
+        char kind_name[16];
+        char name[NAME_MAX_LENGTH];
+        unsigned long long value;
+        int k;
+
+        if(line[0] == '#' ||
+           sscanf(line, "%15s %63s %llu", kind_name, name, &value) != 3)
+        {
+            continue;
+        }
+        for(k = 0; k < kind_count; k++)
+        {
+            if(strcmp(kind_name, g_kind_names[k]) == 0)
+            {
+                result = addEntry(table, (kind)k, name, value);
+                break;
+            }
+        }
+    }
+
+    fclose(in);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeBaseline
+ *
+ *  DESCRIPTION
+ *      Writes the table as a baseline, one "kind name value" line each.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if it cannot be written.
+ *
+ *---------------------------------------------------------------------------*/
+static int writeBaseline(const char *path, const TABLE_T *table)
+{
+    FILE *out = fopen(path, "w");
+    uint32_t i;
+
+    if(out == NULL)
+    {
+        return -1;
+    }
+
+    fprintf(out, "# fw_bench baseline: kind name value. Sizes are in the "
+            "units of the\n# ELF files measured; rewrite with fw_bench -u.\n");
+    for(i = 0; i < table->count; i++)
+    {
+        fprintf(out, "%s %s %llu\n", g_kind_names[table->entries[i].kind],
+                table->entries[i].name,
+                (unsigned long long)table->entries[i].value);
+    }
+
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      printChange
+ *
+ *  DESCRIPTION
+ *      Prints an entry against its baseline value.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void printChange(const char *kind_name, const char *name,
+                        uint64_t was, uint64_t now, int regression)
+{
+    printf("%-7s %-32s %10llu %10llu %+10lld%s\n", kind_name, name,
+           (unsigned long long)was, (unsigned long long)now,
+           (long long)(now - was), regression ? "  REGRESSION" : "");
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      compare
+ *
+ *  DESCRIPTION
+ *      Prints the totals and cycle counts, and the symbols that changed,
+ *      against the baseline. With verbose every symbol is printed.
+ *
+ *  RETURNS
+ *      Number of regressions.
+ *
+ *---------------------------------------------------------------------------*/
+static unsigned compare(const TABLE_T *table, const TABLE_T *baseline,
+                        int verbose)
+{
+    unsigned regressions = 0;
+    uint32_t i;
+
+    printf("%-7s %-32s %10s %10s %10s\n", "", "", "baseline", "now",
+           "change");
+
+    for(i = 0; i < table->count; i++)
+    {
+        const ENTRY_T *entry = &table->entries[i];
+        const ENTRY_T *was = findEntry(baseline, entry->kind, entry->name);
+        uint64_t was_value = was != NULL ? was->value : 0;
+        int checked = entry->kind == kind_cycles ||
+                      entry->kind == kind_total;
+        int regression = checked && entry->value > was_value;
+
+        if(checked || verbose || was_value != entry->value)
+        {
+            printChange(g_kind_names[entry->kind], entry->name, was_value,
+                        entry->value, regression);
+        }
+        regressions += regression;
+    }
+
+    /* Symbols that have gone */
+    for(i = 0; i < baseline->count; i++)
+    {
+        const ENTRY_T *was = &baseline->entries[i];
+
+        if(findEntry(table, was->kind, was->name) == NULL)
+        {
+            printChange(g_kind_names[was->kind], was->name, was->value, 0,
+                        0);
+        }
+    }
+
+    return regressions;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-r file.keyr] [-b baseline] [-u] [-v] file...\n"
+            "  file  ELF objects or image, and gcc -fstack-usage files\n"
+            "  -r    take &USER_KEYS from a keyr file for the cycle counts\n"
+            "  -b    baseline to compare with; exit status 1 if a total or\n"
+            "        cycle count went up\n"
+            "  -u    write the baseline instead of comparing\n"
+            "  -v    list every symbol, not just those that changed\n",
+            name);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint16_t keys[HARNESS_USER_KEY_COUNT] = { 0 };
+    uint16_t nvm_size = HARNESS_DEFAULT_NVM_WORDS;
+    const char *baseline_path = NULL;
+    int update = 0;
+    int verbose = 0;
+    TABLE_T table = { NULL, 0, 0 };
+    TABLE_T baseline = { NULL, 0, 0 };
+    unsigned regressions;
+    int opt;
+
+    while((opt = getopt(argc, argv, "r:b:uvh")) != -1)
+    {
+        switch(opt)
+        {
+            case 'r':
+                if(readKeyr(optarg, keys, &nvm_size) != 0)
+                {
+                    fprintf(stderr, "%s: no &USER_KEYS\n", optarg);
+                    return 1;
+                }
+            break;
+
+            case 'b':
+                baseline_path = optarg;
+            break;
+
+            case 'u':
+                update = 1;
+            break;
+
+            case 'v':
+                verbose = 1;
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(optind == argc || (update && baseline_path == NULL))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(measureCycles(keys, nvm_size, &table) != 0)
+    {
+        return 1;
+    }
+    for(; optind < argc; optind++)
+    {
+        if(readFile(argv[optind], &table) != 0)
+        {
+            return 1;
+        }
+    }
+    if(addTotals(&table) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    qsort(table.entries, table.count, sizeof(*table.entries),
+          compareEntries);
+
+    if(update)
+    {
+        if(writeBaseline(baseline_path, &table) != 0)
+        {
+            perror(baseline_path);
+            return 1;
+        }
+        printf("%s: %u entries written\n", baseline_path, table.count);
+        return 0;
+    }
+
+    if(baseline_path != NULL && readBaseline(baseline_path, &baseline) != 0)
+    {
+        fprintf(stderr, "%s: no baseline, write one with -u\n",
+                baseline_path);
+        return 1;
+    }
+
+    if(baseline_path == NULL)
+    {
+        compare(&table, &baseline, 1);
+        return 0;
+    }
+
+    regressions = compare(&table, &baseline, verbose);
+    if(regressions != 0)
+    {
+        printf("%u regressions against %s\n", regressions, baseline_path);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+###############################################################################
+#  Stand-in for the SDK gattdbgen tool. Gives every service, characteristic
+#  and descriptor in a .db file a handle, in the order gattdbgen does, and
+#  writes the HANDLE_ (and service HANDLE_..._END) definitions and an empty
+#  GattGetDatabase(). The host build never serves the database itself, so
+#  its contents are not produced.
+#
+#  awk -f gattdbgen.awk -v header=app_gatt_db.h -v source=app_gatt_db.c x.db
+###############################################################################
+
+BEGIN {
+    handle = 0
+    print "/* Generated by gattdbgen.awk, do not edit */\n" > header
+    print "#ifndef __APP_GATT_DB_H__" > header
+    print "#define __APP_GATT_DB_H__\n" > header
+    print "#include <types.h>\n" > header
+}
+
+function endService() {
+    if(service != "")
+        printf("#define HANDLE_%-32s (0x%04x)\n", service "_END", handle) > header
+    service = ""
+}
+
+# Service declarations take one handle, characteristics a declaration and a
+# value handle. A service ends at the last handle before the next one.
+/^[ \t]*primary_service[ \t]*\{/    { endService(); handle++; pending = 2 }
+/^[ \t]*characteristic[ \t]*\{/     { handle += 2; pending = 1 }
+/^[ \t]*client_config[ \t]*\{/      { handle++; pending = 1 }
+
+pending && /name[ \t]*:/ {
+    name = $0
+    sub(/.*name[ \t]*:[ \t]*"/, "", name)
+    sub(/".*/, "", name)
+    printf("#define HANDLE_%-32s (0x%04x)\n", name, handle) > header
+    if(pending == 2)
+        service = name
+    pending = 0
+}
+
+END {
+    endService()
+    print "\nextern uint16 *GattGetDatabase(uint16 *len);\n" > header
+    print "#endif /* __APP_GATT_DB_H__ */" > header
+
+    print "/* Generated by gattdbgen.awk, do not edit */\n" > source
+    print "#include \"app_gatt_db.h\"\n" > source
+    print "static uint16 gattDatabase[1];\n" > source
+    print "uint16 *GattGetDatabase(uint16 *len)\n{" > source
+    print "    *len = 0;\n    return gattDatabase;\n}" > source
+}
@@ -0,0 +1,365 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      harness.h
+ *
+ *  DESCRIPTION
+ *      Control interface of the host SDK stand-in. The harness owns a
+ *      simulated clock, delivers the application entry points and charges
+ *      modelled cycles and charge to every SDK call the application makes.
+ *
+ *****************************************************************************/
+
+#ifndef __HARNESS_H__
+#define __HARNESS_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdint.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Returned for times which have not happened yet */
+#define HARNESS_NEVER                   (UINT64_MAX)
+
+/* Number of words in &USER_KEYS */
+#define HARNESS_USER_KEY_COUNT          (10)
+
+/* Largest advertising or scan response payload */
+#define HARNESS_ADV_DATA_MAX            (31)
+
+/* Most application timers the stand-in will run at once */
+#define HARNESS_MAX_TIMERS              (16)
+
+/* Largest user NVM store, and its size until HarnessSetNvmSize() is called
+ * (the &nvm_size default of the keyr files)
+ */
+#define HARNESS_NVM_MAX_WORDS           (4096)
+#define HARNESS_DEFAULT_NVM_WORDS       (128)
+
+/* No limit on the words NvmWrite() may still put in the user NVM */
+#define HARNESS_NVM_NO_BROWN_OUT        (UINT32_MAX)
+
+/* LM events the stand-in can hold for delivery */
+#define HARNESS_LM_QUEUE_SIZE           (8)
+
+/* Largest GATT attribute value, and the connection the harness uses for
+ * GATT access
+ */
+#define HARNESS_GATT_VALUE_MAX          (64)
+#define HARNESS_GATT_CID                (0x0040)
+
+/* Largest UART transmit buffer in octets */
+#define HARNESS_UART_TX_MAX             (512)
+
+/* Advertising interval of the simulated neighbours until
+ * HarnessSetNeighbours() gives one
+ */
+#define HARNESS_DEFAULT_NEIGHBOUR_INTERVAL_US (1000000)
+
+/* Battery voltage reported until HarnessSetBattery() is called */
+#define HARNESS_DEFAULT_BATTERY_MV      (3000)
+#define HARNESS_DEFAULT_TEMPERATURE     (20)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* SDK calls the harness accounts for */
+typedef enum
+{
+    harness_call_user_key,
+    harness_call_gap_set_mode,
+    harness_call_gap_set_adv_interval,
+    harness_call_gap_set_adv_chan_mask,
+    harness_call_store_adv_scan_data,
+    harness_call_start_stop_advertise,
+    harness_call_mem_copy,
+    harness_call_debug_write,
+    harness_call_debug_init,
+    harness_call_gatt_init,
+    harness_call_timer,
+    harness_call_wake,
+    harness_call_battery_read,
+    harness_call_set_tx_power,
+    harness_call_nvm_read,
+    harness_call_nvm_write,
+    harness_call_sleep,
+    harness_call_gatt_access_rsp,
+    harness_call_uart_write,
+    harness_call_gatt_connect,
+    harness_call_aes,
+    harness_call_conn_param_update,
+    harness_call_temperature_read,
+    harness_call_gap_set_scan_interval,
+    harness_call_start_stop_scan,
+    harness_call_pio,
+
+    harness_call_count
+} harness_call;
+
+/* Per-call accounting */
+typedef struct
+{
+    uint32_t count;
+    uint64_t cycles;
+} HARNESS_CALL_STATS_T;
+
+/* Totals since the last HarnessReset() */
+typedef struct
+{
+    /* Modelled CPU cycles spent in application context */
+    uint64_t cycles;
+
+    /* Cycles spent between AppInit() entry and advertising enable */
+    uint64_t boot_cycles;
+
+    /* Of those, the cycles from the GapSetMode() call that set up the
+     * advertising to the enable, i.e. startBeaconing()
+     */
+    uint64_t adv_start_cycles;
+
+    /* Simulated time of advertising enable and of the first event on air */
+    uint64_t adv_enable_us;
+    uint64_t first_adv_us;
+
+    /* Wakes from hibernate or dormant that reached an advertising event,
+     * the cycles from AppInit() entry to advertising enable on the last
+     * one, and the total and longest time from a wake to its first event
+     */
+    uint32_t warm_boots;
+    uint64_t warm_boot_cycles;
+    uint64_t warm_first_adv_us;
+    uint64_t warm_first_adv_max_us;
+
+    /* Number of advertising events put on air, and of scan responses
+     * sent from them
+     */
+    uint32_t adv_events;
+    uint32_t scan_responses;
+
+    /* Time spent scanning, and advertising reports delivered from it */
+    uint64_t scan_us;
+    uint32_t adv_reports;
+
+    /* Number of times the CPU was woken to run application code, and of
+     * those the wake-ups by an application timer
+     */
+    uint32_t wakeups;
+    uint32_t timer_wakeups;
+
+    /* Number of hibernate or dormant periods and their total length */
+    uint32_t hibernations;
+    uint64_t hibernate_us;
+
+    /* PIO edges delivered as sys_event_pio_changed, and wakes from
+     * hibernate by a PIO edge
+     */
+    uint32_t pio_events;
+    uint32_t pio_wakes;
+
+    /* Number of connections and their total length */
+    uint32_t connections;
+    uint64_t connected_us;
+
+    /* Connection parameter update requests, and updates that took effect */
+    uint32_t conn_param_requests;
+    uint32_t conn_updates;
+
+    /* Number of NVM writes and words written */
+    uint32_t nvm_writes;
+    uint32_t nvm_words_written;
+
+    /* Charge in microamp-seconds, split by consumer */
+    double cpu_uas;
+    double radio_uas;
+    double uart_uas;
+    double sleep_uas;
+
+    HARNESS_CALL_STATS_T calls[harness_call_count];
+} HARNESS_STATS_T;
+
+/* One advertising event as seen on air */
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t duration_us;
+    uint8_t  tx_power_level;
+    uint8_t  adv_len;
+    uint8_t  adv_data[HARNESS_ADV_DATA_MAX];
+
+    /* Advertising interval in force, before advDelay, and whether the
+     * event listens for connection or scan requests after each channel
+     */
+    uint32_t interval_min_us;
+    uint32_t interval_max_us;
+    uint8_t  connectable;
+    uint8_t  scannable;
+
+    /* Channels the event is sent on, GAP_ADV_CHANNEL_* bits, in order
+     * from channel 37
+     */
+    uint8_t  channels;
+
+    /* Scan response, and the number of channels it was sent on */
+    uint8_t  scan_rsp_len;
+    uint8_t  scan_rsp_data[HARNESS_ADV_DATA_MAX];
+    uint8_t  scan_rsp_count;
+} HARNESS_ADV_EVENT_T;
+
+typedef void (*harness_adv_hook)(const HARNESS_ADV_EVENT_T *event,
+                                 void *context);
+
+typedef void (*harness_uart_hook)(const uint8_t *data, uint16_t len,
+                                  void *context);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Return the stand-in to power-off, zero all statistics and seed the
+ * advDelay generator.
+ */
+extern void HarnessReset(uint32_t seed);
+
+/* Set a word of &USER_KEYS before boot */
+extern void HarnessSetUserKey(uint16_t index, uint16_t value);
+
+/* Power the chip up through AppPowerOnReset() and AppInit() */
+extern void HarnessBoot(void);
+
+/* Take the chip through hibernate, or dormant if dormant is set, as if the
+ * application had asked for it, and wake it at once through AppInit()
+ */
+extern void HarnessWarmBoot(int dormant);
+
+/* Advance simulated time, running advertising events as they fall due */
+extern void HarnessRun(uint64_t duration_us);
+
+/* Read a GATT attribute through the application, as a connected client
+ * would. len gives the size of value and returns the length read.
+ * Returns the status the application answered with.
+ */
+extern uint16_t HarnessGattRead(uint16_t handle, uint8_t *value,
+                                uint16_t *len);
+
+/* Write a GATT attribute through the application, as a connected client
+ * would. Returns the status the application answered with.
+ */
+extern uint16_t HarnessGattWrite(uint16_t handle, const uint8_t *value,
+                                 uint16_t len);
+
+/* Connect as a central. Only succeeds while the application advertises
+ * connectable; GATT_CONNECT_CFM is delivered at once.
+ */
+extern int HarnessConnect(void);
+
+/* Drop the connection from the central side */
+extern void HarnessDisconnect(void);
+
+/* Whether a central is connected */
+extern int HarnessConnected(void);
+
+/* Current simulated time in microseconds */
+extern uint64_t HarnessNow(void);
+
+/* Statistics accumulated so far */
+extern const HARNESS_STATS_T *HarnessStats(void);
+
+/* Name of an accounted SDK call */
+extern const char *HarnessCallName(harness_call call);
+
+/* Total charge in microamp-seconds */
+extern double HarnessChargeUas(const HARNESS_STATS_T *stats);
+
+/* Called for every advertising event put on air */
+extern void HarnessSetAdvHook(harness_adv_hook hook, void *context);
+
+/* Route DebugWrite output to stdout instead of discarding it */
+extern void HarnessSetDebugEcho(int echo);
+
+/* Called with the UART output as it finishes sending. Octets still being
+ * sent when the chip hibernates are lost.
+ */
+extern void HarnessSetUartHook(harness_uart_hook hook, void *context);
+
+/* Set the size of the user NVM store in words, as &nvm_size */
+extern void HarnessSetNvmSize(uint16_t words);
+
+/* Load words into the user NVM without charging for it, as a programmed
+ * image would; call after HarnessSetNvmSize() and before HarnessBoot()
+ */
+extern void HarnessNvmLoad(uint16_t offset, const uint16_t *words,
+                           uint16_t count);
+
+/* Number of times a word of the user NVM has been written */
+extern uint32_t HarnessNvmWear(uint16_t offset);
+
+/* Let only the given number of words more reach the user NVM, as if the
+ * supply failed after them; later words of the same write and later writes
+ * are lost. HARNESS_NVM_NO_BROWN_OUT restores the supply.
+ */
+extern void HarnessNvmBrownOut(uint32_t words);
+
+/* Set the voltage returned by BatteryReadVoltage() now, and the rate in
+ * millivolts per hour at which it falls from then on. sys_event_battery_low
+ * is raised when it drops below MODEL_BATTERY_LOW_MV.
+ */
+extern void HarnessSetBattery(uint16_t mv, double mv_per_hour);
+
+/* Set the chance, 0 to 1, that an active scanner sends a scan request on
+ * each channel of a scannable advertising event (0 until called)
+ */
+extern void HarnessSetScanRequests(double probability);
+
+/* Surround the chip with count other advertisers, each with its own
+ * address and advertising every adv_interval_us (none until called).
+ * While the application scans, their PDUs are heard at random times at the
+ * rate their advertising and the scan duty cycle give, and reported as
+ * LM_EV_ADVERTISING_REPORT.
+ */
+extern void HarnessSetNeighbours(uint32_t count, uint32_t adv_interval_us);
+
+/* Put a sync beacon in range, advertising adv_data as a slotted beacon does:
+ * it enables advertising at phase_us and every interval_us after, and each
+ * event goes on air MODEL_ADV_FIRST_EVENT_US after the enable, without
+ * advDelay. While the application scans it hears the PDU of one channel of
+ * each event, at random, with the chance the scan duty cycle gives. A zero
+ * len takes the sync beacon away.
+ */
+extern void HarnessSetSyncBeacon(const uint8_t *adv_data, uint8_t len,
+                                 uint32_t interval_us, uint64_t phase_us);
+
+/* Make the sleep clock, which TimeGet32() and the application timers run
+ * on, gain ppm parts per million on simulated time, or lose for a negative
+ * value (0 until called)
+ */
+extern void HarnessSetClockDrift(double ppm);
+
+/* Set the die temperature in degrees Celsius returned by
+ * ThermometerReadTemperature()
+ */
+extern void HarnessSetTemperature(int16_t celsius);
+
+/* Set the connection interval, in 1.25 ms units, the central connects with
+ * (MODEL_CONN_DEFAULT_INTERVAL until called) and whether it takes up
+ * connection parameter update requests
+ */
+extern void HarnessSetCentral(uint16_t conn_interval, int accept_updates);
+
+/* Wire an accelerometer interrupt to a PIO: from now the asset moves for
+ * move_us at the start of every period_us, and while it moves the line
+ * pulses high every pulse_us. A pulse is delivered as
+ * sys_event_pio_changed if the PIO's event mask takes either edge, and
+ * wakes the chip from hibernate if it asked to be woken by a PIO. A zero
+ * period takes the accelerometer away.
+ */
+extern void HarnessSetMotion(uint8_t pio, uint64_t period_us,
+                             uint64_t move_us, uint32_t pulse_us);
+
+#endif /* __HARNESS_H__ */
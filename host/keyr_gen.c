@@ -0,0 +1,1403 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      keyr_gen.c
+ *
+ *  DESCRIPTION
+ *      Writes a keyr image per beacon for a fleet, from the keyr files of
+ *      the chip families as templates.
+ *
+ *      keyr_gen -t template.keyr [-t template.keyr] [-o dir] [-j jobs] [-n]
+ *               devices.csv | -r spec
+ *
+ *          devices.csv starts with a header naming its columns, any of
+ *              name            image file name, default the address
+ *              family          100x or 101x, needed with two templates
+ *              bdaddr          12 hex digits, ':' allowed between octets
+ *              uuid_msw        hex
+ *              major, minor    0x for hex
+ *              tx_power        dBm
+ *              user_key4 to user_key7      hex
+ *              passcode        8 hex digits, not all zeros or all ones
+ *              identity_root   hex, as many octets as the template has
+ *          Columns left out keep the template's values.
+ *
+ *          spec describes a run of beacons instead, as comma separated
+ *          count=n, bdaddr=, uuid_msw=, major=, minor=, tx_power=,
+ *          identity_root=, family= and name= (a prefix). The address, the
+ *          identity root and major:minor, as one 32-bit number, count up
+ *          from the values given.
+ *
+ *      Every beacon must have its own address, its own UUID MSW, major and
+ *      minor as the firmware will use them (zero meaning the default), and
+ *      its own identity root where the template has one; otherwise nothing
+ *      is written. Images are identical to the template apart from those
+ *      keys' digits and the configuration passcode.
+ *
+ *      Where the template has the passcode keys, a beacon not given a
+ *      passcode gets one drawn from /dev/urandom, never one made from
+ *      its identity. The passcodes of the fleet are listed in
+ *      passcodes.csv in the output directory, readable by the owner only,
+ *      before any image is written.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "keyr_template.h"
+#include "user_config.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define MAX_TEMPLATES                   (2)
+#define MAX_THREADS                     (64)
+#define NAME_MAX_LENGTH                 (40)
+#define LINE_MAX_LENGTH                 (512)
+#define MAX_COLUMNS                     (16)
+
+/* &USER_KEYS words the firmware reads */
+#define USER_KEY_UUID_MSW               (0)
+#define USER_KEY_MAJOR                  (1)
+#define USER_KEY_MINOR                  (2)
+#define USER_KEY_TX_POWER               (3)
+#define USER_KEY_PASSCODE_LSW           (8)
+#define USER_KEY_PASSCODE_MSW           (9)
+
+/* Passcodes that lock the configuration service */
+#define PASSCODE_BLANK                  (0x00000000UL)
+#define PASSCODE_ERASED                 (0xFFFFFFFFUL)
+
+#define PASSCODES_FILE                  "passcodes.csv"
+
+#define BDADDR_MASK                     (0xFFFFFFFFFFFFULL)
+
+#define NO_DEVICE                       (UINT32_MAX)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    char name[NAME_MAX_LENGTH];
+    uint8_t family;
+    unsigned line;
+    KEYR_VALUES_T values;
+} DEVICE_T;
+
+typedef struct
+{
+    DEVICE_T *devices;
+    uint32_t count;
+    uint32_t capacity;
+} FLEET_T;
+
+/* Open addressing on 64-bit keys, at most half full */
+typedef struct
+{
+    uint64_t *keys;
+    uint32_t *devices;
+    uint32_t mask;
+} INDEX_T;
+
+/* Column of the devices file */
+typedef enum
+{
+    column_name,
+    column_family,
+    column_bdaddr,
+    column_uuid_msw,
+    column_major,
+    column_minor,
+    column_tx_power,
+    column_user_key4,
+    column_user_key5,
+    column_user_key6,
+    column_user_key7,
+    column_passcode,
+    column_identity_root,
+    column_count
+} column;
+
+/* Work for one rendering thread */
+typedef struct
+{
+    pthread_t thread;
+    const FLEET_T *fleet;
+    const KEYR_TEMPLATE_T *templates;
+    const char *dir;
+    uint32_t first;
+    uint32_t end;
+    uint32_t failed;
+    int error;
+    char failed_name[NAME_MAX_LENGTH];
+} WORKER_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const char * const g_column_names[column_count] =
+{
+    "name", "family", "bdaddr", "uuid_msw", "major", "minor", "tx_power",
+    "user_key4", "user_key5", "user_key6", "user_key7", "passcode",
+    "identity_root"
+};
+
+static KEYR_TEMPLATE_T g_templates[MAX_TEMPLATES];
+static unsigned g_template_count;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      seconds
+ *
+ *  DESCRIPTION
+ *      Monotonic time.
+ *
+ *  RETURNS
+ *      Time in seconds.
+ *
+ *---------------------------------------------------------------------------*/
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseHexDigits
+ *
+ *  DESCRIPTION
+ *      Reads a hex number of exactly the given number of digits, skipping
+ *      ':' and '-' between them.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseHexDigits(const char *text, unsigned digits, uint8_t *octets)
+{
+    unsigned n = 0;
+
+    for(; *text != '\0'; text++)
+    {
+        char c = *text;
+        unsigned value;
+
+        if(c == ':' || c == '-')
+        {
+            continue;
+        }
+        if(c >= '0' && c <= '9')
+        {
+            value = (unsigned)(c - '0');
+        }
+        else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            value = (unsigned)((c | 0x20) - 'a' + 10);
+        }
+        else
+        {
+            return -1;
+        }
+
+        if(n == digits)
+        {
+            return -1;
+        }
+        if((n & 1) == 0)
+        {
+            octets[n / 2] = (uint8_t)(value << 4);
+        }
+        else
+        {
+            octets[n / 2] |= (uint8_t)value;
+        }
+        n++;
+    }
+
+    return n == digits ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseNumber
+ *
+ *  DESCRIPTION
+ *      Reads a whole number in the given base (0 for C notation) and checks
+ *      its range.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseNumber(const char *text, int base, long min, long max,
+                       long *value)
+{
+    char *end;
+
+    errno = 0;
+    *value = strtol(text, &end, base);
+
+    return (end == text || *end != '\0' || errno != 0 || *value < min ||
+            *value > max) ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findFamily
+ *
+ *  DESCRIPTION
+ *      Looks up a template by chip family name: 100x, 101x, with or
+ *      without CSR in front.
+ *
+ *  RETURNS
+ *      Template number, or -1 if there is none for that family.
+ *
+ *---------------------------------------------------------------------------*/
+static int findFamily(const char *text)
+{
+    unsigned version = 0;
+    unsigned i;
+
+    if(strncasecmp(text, "CSR", 3) == 0)
+    {
+        text += 3;
+    }
+    if(strcasecmp(text, "100x") == 0)
+    {
+        version = KEYR_CS_VERSION_CSR100X;
+    }
+    else if(strcasecmp(text, "101x") == 0)
+    {
+        version = KEYR_CS_VERSION_CSR101X;
+    }
+
+    for(i = 0; i < g_template_count; i++)
+    {
+        if(g_templates[i].cs_version == version)
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      setField
+ *
+ *  DESCRIPTION
+ *      Sets one value of a device from its text.
+ *
+ *  RETURNS
+ *      0 on success, -1 with a message in error otherwise.
+ *
+ *---------------------------------------------------------------------------*/
+static int setField(DEVICE_T *device, column field, const char *text,
+                    char *error, size_t error_size)
+{
+    const KEYR_TEMPLATE_T *keyr = &g_templates[device->family];
+    uint8_t octets[KEYR_IDENTITY_ROOT_MAX];
+    long value;
+    int i;
+
+    switch(field)
+    {
+        case column_name:
+            if(strlen(text) == 0 || strlen(text) >= NAME_MAX_LENGTH ||
+               strspn(text, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuv"
+                            "wxyz0123456789_.-") != strlen(text) ||
+               text[0] == '.')
+            {
+                snprintf(error, error_size, "bad name '%s'", text);
+                return -1;
+            }
+            strcpy(device->name, text);
+        break;
+
+        case column_family:
+            /* Handled before the other columns */
+        break;
+
+        case column_bdaddr:
+            if(keyr->bdaddr_count == 0 || parseHexDigits(text, 12, octets))
+            {
+                snprintf(error, error_size, "bad bdaddr '%s'", text);
+                return -1;
+            }
+            device->values.bdaddr = 0;
+            for(i = 0; i < 6; i++)
+            {
+                device->values.bdaddr = (device->values.bdaddr << 8) |
+                                        octets[i];
+            }
+        break;
+
+        case column_uuid_msw:
+        case column_user_key4:
+        case column_user_key5:
+        case column_user_key6:
+        case column_user_key7:
+        {
+            int key = field == column_uuid_msw ? USER_KEY_UUID_MSW :
+                      4 + (int)(field - column_user_key4);
+
+            if(key >= keyr->user_key_count ||
+               parseNumber(text, 16, 0, 0xFFFF, &value) != 0)
+            {
+                snprintf(error, error_size, "bad %s '%s'",
+                         g_column_names[field], text);
+                return -1;
+            }
+            device->values.user_keys[key] = (uint16_t)value;
+        }
+        break;
+
+        case column_major:
+        case column_minor:
+            if(parseNumber(text, 0, 0, 0xFFFF, &value) != 0)
+            {
+                snprintf(error, error_size, "bad %s '%s'",
+                         g_column_names[field], text);
+                return -1;
+            }
+            device->values.user_keys[field == column_major ?
+                                     USER_KEY_MAJOR : USER_KEY_MINOR] =
+                (uint16_t)value;
+        break;
+
+        case column_tx_power:
+            /* Zero in the key selects the default */
+            if(parseNumber(text, 10, -128, 127, &value) != 0 || value == 0)
+            {
+                snprintf(error, error_size, "bad tx_power '%s' (dBm, not 0)",
+                         text);
+                return -1;
+            }
+            device->values.user_keys[USER_KEY_TX_POWER] =
+                (uint16_t)(uint8_t)(int8_t)value;
+        break;
+
+        case column_passcode:
+        {
+            uint32_t passcode;
+
+            if(keyr->user_key_count <= USER_KEY_PASSCODE_MSW ||
+               parseHexDigits(text, 8, octets) != 0 ||
+               (passcode = ((uint32_t)octets[0] << 24) |
+                           ((uint32_t)octets[1] << 16) |
+                           ((uint32_t)octets[2] << 8) | octets[3]) ==
+               PASSCODE_BLANK || passcode == PASSCODE_ERASED)
+            {
+                snprintf(error, error_size, "bad passcode '%s'", text);
+                return -1;
+            }
+            device->values.user_keys[USER_KEY_PASSCODE_LSW] =
+                (uint16_t)passcode;
+            device->values.user_keys[USER_KEY_PASSCODE_MSW] =
+                (uint16_t)(passcode >> 16);
+        }
+        break;
+
+        case column_identity_root:
+            if(keyr->identity_root_count == 0 ||
+               parseHexDigits(text, 2u * keyr->identity_root_count,
+                              device->values.identity_root) != 0)
+            {
+                snprintf(error, error_size, "bad identity_root '%s'", text);
+                return -1;
+            }
+        break;
+
+        default:
+        break;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addDevice
+ *
+ *  DESCRIPTION
+ *      Appends a device with the values of its template.
+ *
+ *  RETURNS
+ *      The device.
+ *
+ *---------------------------------------------------------------------------*/
+static DEVICE_T *addDevice(FLEET_T *fleet, int family, unsigned line)
+{
+    DEVICE_T *device;
+
+    if(fleet->count == fleet->capacity)
+    {
+        fleet->capacity = fleet->capacity ? fleet->capacity * 2 : 1024;
+        fleet->devices = realloc(fleet->devices,
+                                 fleet->capacity * sizeof(*fleet->devices));
+        if(fleet->devices == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    device = &fleet->devices[fleet->count++];
+    device->name[0] = '\0';
+    device->family = (uint8_t)family;
+    device->line = line;
+    KeyrTemplateValues(&g_templates[family], &device->values);
+
+    return device;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readCsv
+ *
+ *  DESCRIPTION
+ *      Reads the devices file.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int readCsv(FLEET_T *fleet, const char *path)
+{
+    char line[LINE_MAX_LENGTH];
+    column columns[MAX_COLUMNS];
+    int column_total = -1;
+    int family_column = -1;
+    unsigned number = 0;
+    FILE *in = fopen(path, "r");
+
+    if(in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char *fields[MAX_COLUMNS];
+        char error[128];
+        DEVICE_T *device;
+        int family = 0;
+        int count = 0;
+        char *p;
+        int i;
+
+        number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(line[0] == '#' || line[strspn(line, " \t")] == '\0')
+        {
+            continue;
+        }
+
+        for(p = strtok(line, ","); p != NULL && count < MAX_COLUMNS;
+            p = strtok(NULL, ","))
+        {
+            char *end;
+
+            p += strspn(p, " \t");
+            for(end = p + strlen(p); end > p && (end[-1] == ' ' ||
+                end[-1] == '\t'); end--)
+            {
+            }
+            *end = '\0';
+            fields[count++] = p;
+        }
+
+        if(column_total < 0)
+        {
+            for(i = 0; i < count; i++)
+            {
+                column c;
+
+                for(c = column_name; c < column_count; c++)
+                {
+                    if(strcmp(fields[i], g_column_names[c]) == 0)
+                    {
+                        break;
+                    }
+                }
+                if(c == column_count)
+                {
+                    fprintf(stderr, "%s:%u: unknown column '%s'\n", path,
+                            number, fields[i]);
+                    fclose(in);
+                    return -1;
+                }
+                columns[i] = c;
+                if(c == column_family)
+                {
+                    family_column = i;
+                }
+            }
+            column_total = count;
+
+            if(family_column < 0 && g_template_count > 1)
+            {
+                fprintf(stderr, "%s: a family column is needed with two "
+                        "templates\n", path);
+                fclose(in);
+                return -1;
+            }
+            continue;
+        }
+
+        if(count != column_total)
+        {
+            fprintf(stderr, "%s:%u: expected %d columns\n", path, number,
+                    column_total);
+            fclose(in);
+            return -1;
+        }
+
+        if(family_column >= 0 &&
+           (family = findFamily(fields[family_column])) < 0)
+        {
+            fprintf(stderr, "%s:%u: no template for family '%s'\n", path,
+                    number, fields[family_column]);
+            fclose(in);
+            return -1;
+        }
+
+        device = addDevice(fleet, family, number);
+        for(i = 0; i < count; i++)
+        {
+            if(setField(device, columns[i], fields[i], error,
+                        sizeof(error)) != 0)
+            {
+                fprintf(stderr, "%s:%u: %s\n", path, number, error);
+                fclose(in);
+                return -1;
+            }
+        }
+    }
+
+    fclose(in);
+
+    if(column_total < 0)
+    {
+        fprintf(stderr, "%s: no header\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      makeRange
+ *
+ *  DESCRIPTION
+ *      Makes the devices of a range spec.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int makeRange(FLEET_T *fleet, char *spec)
+{
+    char error[128];
+    DEVICE_T first;
+    const char *prefix = NULL;
+    long count = -1;
+    int family = 0;
+    char *item;
+    uint32_t identity;
+    uint32_t i;
+    int j;
+
+    /* The family decides the starting values, so find it first */
+    item = strstr(spec, "family=");
+    if(item != NULL)
+    {
+        char name[16];
+
+        sscanf(item + 7, "%15[^,]", name);
+        family = findFamily(name);
+    }
+    if(family < 0 || (item == NULL && g_template_count > 1))
+    {
+        fprintf(stderr, "-r: a family that has a template is needed\n");
+        return -1;
+    }
+
+    memset(&first, 0, sizeof(first));
+    first.family = (uint8_t)family;
+    KeyrTemplateValues(&g_templates[family], &first.values);
+
+    for(item = strtok(spec, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        char *value = strchr(item, '=');
+        column c;
+
+        if(value == NULL)
+        {
+            fprintf(stderr, "-r: expected name=value, not '%s'\n", item);
+            return -1;
+        }
+        *value++ = '\0';
+
+        if(strcmp(item, "count") == 0)
+        {
+            if(parseNumber(value, 0, 1, 10000000, &count) != 0)
+            {
+                fprintf(stderr, "-r: bad count '%s'\n", value);
+                return -1;
+            }
+            continue;
+        }
+        if(strcmp(item, "name") == 0)
+        {
+            prefix = value;
+            continue;
+        }
+
+        for(c = column_family; c < column_count; c++)
+        {
+            if(strcmp(item, g_column_names[c]) == 0)
+            {
+                break;
+            }
+        }
+        if(c == column_passcode)
+        {
+            fprintf(stderr, "-r: passcodes are drawn for each beacon\n");
+            return -1;
+        }
+        if(c == column_count || setField(&first, c, value, error,
+                                         sizeof(error)) != 0)
+        {
+            fprintf(stderr, "-r: %s\n",
+                    c == column_count ? "unknown setting" : error);
+            return -1;
+        }
+    }
+
+    if(count < 0)
+    {
+        fprintf(stderr, "-r: count is needed\n");
+        return -1;
+    }
+    if(prefix != NULL && strlen(prefix) > NAME_MAX_LENGTH - 9)
+    {
+        fprintf(stderr, "-r: name prefix too long\n");
+        return -1;
+    }
+
+    identity = ((uint32_t)first.values.user_keys[USER_KEY_MAJOR] << 16) |
+               first.values.user_keys[USER_KEY_MINOR];
+
+    for(i = 0; i < (uint32_t)count; i++)
+    {
+        DEVICE_T *device = addDevice(fleet, family, i + 1);
+        uint32_t carry = i;
+
+        device->values = first.values;
+        device->values.bdaddr = (first.values.bdaddr + i) & BDADDR_MASK;
+        device->values.user_keys[USER_KEY_MAJOR] =
+            (uint16_t)((identity + i) >> 16);
+        device->values.user_keys[USER_KEY_MINOR] = (uint16_t)(identity + i);
+
+        for(j = g_templates[family].identity_root_count - 1; j >= 0; j--)
+        {
+            carry += device->values.identity_root[j];
+            device->values.identity_root[j] = (uint8_t)carry;
+            carry >>= 8;
+        }
+
+        if(prefix != NULL)
+        {
+            snprintf(device->name, NAME_MAX_LENGTH, "%s%05u", prefix, i);
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      indexInit
+ *
+ *  DESCRIPTION
+ *      Allocates an empty index for the given number of keys.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int indexInit(INDEX_T *index, uint32_t count)
+{
+    uint32_t size = 16;
+    uint32_t i;
+
+    while(size < count * 2)
+    {
+        size *= 2;
+    }
+
+    index->keys = malloc(size * sizeof(*index->keys));
+    index->devices = malloc(size * sizeof(*index->devices));
+    index->mask = size - 1;
+    if(index->keys == NULL || index->devices == NULL)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < size; i++)
+    {
+        index->devices[i] = NO_DEVICE;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      indexFree
+ *
+ *  DESCRIPTION
+ *      Releases an index.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void indexFree(INDEX_T *index)
+{
+    free(index->keys);
+    free(index->devices);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      indexAdd
+ *
+ *  DESCRIPTION
+ *      Adds a key unless it is already there. Keys that are hashes of a
+ *      longer value are confirmed with same(), when given.
+ *
+ *  RETURNS
+ *      NO_DEVICE if added, otherwise the device that already has it.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t indexAdd(INDEX_T *index, uint64_t key, uint32_t device,
+                         const FLEET_T *fleet,
+                         int (*same)(const DEVICE_T *, const DEVICE_T *))
+{
+    uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) &
+                    index->mask;
+
+    while(index->devices[slot] != NO_DEVICE)
+    {
+        if(index->keys[slot] == key &&
+           (same == NULL || same(&fleet->devices[index->devices[slot]],
+                                 &fleet->devices[device])))
+        {
+            return index->devices[slot];
+        }
+        slot = (slot + 1) & index->mask;
+    }
+
+    index->keys[slot] = key;
+    index->devices[slot] = device;
+
+    return NO_DEVICE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      effectiveKey
+ *
+ *  DESCRIPTION
+ *      A user key as the firmware will use it, zero selecting the default.
+ *
+ *  RETURNS
+ *      The value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16_t effectiveKey(const DEVICE_T *device, int key)
+{
+    static const uint16_t defaults[] =
+    {
+        ((uint16_t)BEACON_UUID_00 << 8) | BEACON_UUID_01,
+        BEACON_DEFAULT_MAJOR,
+        BEACON_DEFAULT_MINOR
+    };
+    uint16_t value = device->values.user_keys[key];
+
+    return value != 0 ? value : defaults[key];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sameRoot
+ *
+ *  DESCRIPTION
+ *      Compares the identity roots of two devices.
+ *
+ *  RETURNS
+ *      Non-zero if they are the same.
+ *
+ *---------------------------------------------------------------------------*/
+static int sameRoot(const DEVICE_T *a, const DEVICE_T *b)
+{
+    return memcmp(a->values.identity_root, b->values.identity_root,
+                  KEYR_IDENTITY_ROOT_MAX) == 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      reportClash
+ *
+ *  DESCRIPTION
+ *      Reports two devices that share a value.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void reportClash(const FLEET_T *fleet, uint32_t a, uint32_t b,
+                        const char *what)
+{
+    fprintf(stderr, "entries %u and %u have the same %s\n",
+            fleet->devices[a].line, fleet->devices[b].line, what);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkFleet
+ *
+ *  DESCRIPTION
+ *      Looks for devices sharing an address, identity, identity root or
+ *      image name.
+ *
+ *  RETURNS
+ *      Number of clashes.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t checkFleet(FLEET_T *fleet)
+{
+    INDEX_T addresses, identities, roots;
+    uint32_t clashes = 0;
+    uint32_t i;
+
+    if(indexInit(&addresses, fleet->count) != 0 ||
+       indexInit(&identities, fleet->count) != 0 ||
+       indexInit(&roots, fleet->count) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for(i = 0; i < fleet->count; i++)
+    {
+        DEVICE_T *device = &fleet->devices[i];
+        const KEYR_TEMPLATE_T *keyr = &g_templates[device->family];
+        uint64_t identity = ((uint64_t)effectiveKey(device,
+                                                    USER_KEY_UUID_MSW) << 32) |
+                            ((uint32_t)effectiveKey(device,
+                                                    USER_KEY_MAJOR) << 16) |
+                            effectiveKey(device, USER_KEY_MINOR);
+        uint32_t other;
+        uint64_t hash;
+        int j;
+
+        if(device->name[0] == '\0')
+        {
+            snprintf(device->name, NAME_MAX_LENGTH, "%012llx",
+                     (unsigned long long)device->values.bdaddr);
+        }
+
+        if(keyr->bdaddr_count != 0 &&
+           (other = indexAdd(&addresses, device->values.bdaddr, i, fleet,
+                             NULL)) != NO_DEVICE)
+        {
+            reportClash(fleet, other, i, "bdaddr");
+            clashes++;
+        }
+
+        if((other = indexAdd(&identities, identity, i, fleet, NULL)) !=
+           NO_DEVICE)
+        {
+            reportClash(fleet, other, i, "UUID MSW, major and minor");
+            clashes++;
+        }
+
+        if(keyr->identity_root_count != 0)
+        {
+            /* FNV-1a over the root */
+            hash = 0xCBF29CE484222325ULL;
+            for(j = 0; j < KEYR_IDENTITY_ROOT_MAX; j++)
+            {
+                hash = (hash ^ device->values.identity_root[j]) *
+                       0x100000001B3ULL;
+            }
+            if((other = indexAdd(&roots, hash, i, fleet, sameRoot)) !=
+               NO_DEVICE)
+            {
+                reportClash(fleet, other, i, "identity_root");
+                clashes++;
+            }
+        }
+    }
+
+    indexFree(&addresses);
+    indexFree(&identities);
+    indexFree(&roots);
+
+    /* Names are made from addresses when not given; check them as well,
+     * hashing the text
+     */
+    if(indexInit(&addresses, fleet->count) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for(i = 0; i < fleet->count; i++)
+    {
+        const char *p;
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        uint32_t other;
+
+        for(p = fleet->devices[i].name; *p != '\0'; p++)
+        {
+            hash = (hash ^ (uint8_t)*p) * 0x100000001B3ULL;
+        }
+        if((other = indexAdd(&addresses, hash, i, fleet, NULL)) !=
+           NO_DEVICE &&
+           strcmp(fleet->devices[other].name, fleet->devices[i].name) == 0)
+        {
+            reportClash(fleet, other, i, "name");
+            clashes++;
+        }
+    }
+    indexFree(&addresses);
+
+    return clashes;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hasPasscode
+ *
+ *  DESCRIPTION
+ *      Checks whether a device's template has the passcode keys.
+ *
+ *  RETURNS
+ *      Non-zero if it has.
+ *
+ *---------------------------------------------------------------------------*/
+static int hasPasscode(const DEVICE_T *device)
+{
+    return g_templates[device->family].user_key_count > USER_KEY_PASSCODE_MSW;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      devicePasscode
+ *
+ *  DESCRIPTION
+ *      A device's configuration passcode.
+ *
+ *  RETURNS
+ *      The passcode.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t devicePasscode(const DEVICE_T *device)
+{
+    return ((uint32_t)device->values.user_keys[USER_KEY_PASSCODE_MSW] << 16) |
+           device->values.user_keys[USER_KEY_PASSCODE_LSW];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      drawPasscodes
+ *
+ *  DESCRIPTION
+ *      Gives every device that has the passcode keys but no passcode one
+ *      drawn from /dev/urandom.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int drawPasscodes(FLEET_T *fleet)
+{
+    int fd = -1;
+    uint32_t i;
+
+    for(i = 0; i < fleet->count; i++)
+    {
+        DEVICE_T *device = &fleet->devices[i];
+        uint32_t passcode = devicePasscode(device);
+
+        if(!hasPasscode(device))
+        {
+            continue;
+        }
+
+        while(passcode == PASSCODE_BLANK || passcode == PASSCODE_ERASED)
+        {
+            if(fd < 0 && (fd = open("/dev/urandom", O_RDONLY)) < 0)
+            {
+                perror("/dev/urandom");
+                return -1;
+            }
+            if(read(fd, &passcode, sizeof(passcode)) !=
+               (ssize_t)sizeof(passcode))
+            {
+                perror("/dev/urandom");
+                close(fd);
+                return -1;
+            }
+        }
+        device->values.user_keys[USER_KEY_PASSCODE_LSW] = (uint16_t)passcode;
+        device->values.user_keys[USER_KEY_PASSCODE_MSW] =
+            (uint16_t)(passcode >> 16);
+    }
+
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writePasscodes
+ *
+ *  DESCRIPTION
+ *      Lists the name, address and passcode of every device that has one,
+ *      in a file only the owner can read.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int writePasscodes(const FLEET_T *fleet, const char *dir)
+{
+    char path[4096];
+    FILE *out;
+    uint32_t i;
+    int fd;
+
+    for(i = 0; i < fleet->count && !hasPasscode(&fleet->devices[i]); i++)
+    {
+    }
+    if(i == fleet->count)
+    {
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", dir, PASSCODES_FILE);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(fd < 0 || fchmod(fd, 0600) != 0 || (out = fdopen(fd, "w")) == NULL)
+    {
+        perror(path);
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    fprintf(out, "name,bdaddr,passcode\n");
+    for(i = 0; i < fleet->count; i++)
+    {
+        const DEVICE_T *device = &fleet->devices[i];
+
+        if(hasPasscode(device))
+        {
+            fprintf(out, "%s,%012llx,%08x\n", device->name,
+                    (unsigned long long)device->values.bdaddr,
+                    (unsigned)devicePasscode(device));
+        }
+    }
+
+    if(fclose(out) != 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      renderWorker
+ *
+ *  DESCRIPTION
+ *      Thread writing the images of a share of the fleet.
+ *
+ *  RETURNS
+ *      NULL.
+ *
+ *---------------------------------------------------------------------------*/
+static void *renderWorker(void *context)
+{
+    WORKER_T *worker = context;
+    size_t size = 0;
+    char *image;
+    char path[4096];
+    uint32_t i;
+    unsigned t;
+
+    for(t = 0; t < g_template_count; t++)
+    {
+        size = worker->templates[t].len > size ?
+               worker->templates[t].len : size;
+    }
+    image = malloc(size);
+    if(image == NULL)
+    {
+        worker->failed = worker->end - worker->first;
+        worker->error = ENOMEM;
+        return NULL;
+    }
+
+    for(i = worker->first; i < worker->end; i++)
+    {
+        const DEVICE_T *device = &worker->fleet->devices[i];
+        const KEYR_TEMPLATE_T *keyr = &worker->templates[device->family];
+        int fd;
+
+        KeyrTemplateRender(keyr, &device->values, image);
+
+        snprintf(path, sizeof(path), "%s/%s.keyr", worker->dir, device->name);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0 || write(fd, image, keyr->len) != (ssize_t)keyr->len ||
+           close(fd) != 0)
+        {
+            if(worker->failed++ == 0)
+            {
+                worker->error = errno;
+                strcpy(worker->failed_name, device->name);
+            }
+        }
+    }
+
+    free(image);
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s -t template.keyr [-t template.keyr] [-o dir] "
+            "[-j jobs] [-n]\n"
+            "          devices.csv | -r spec\n"
+            "  -t  keyr file of a chip family (up to one per family)\n"
+            "  -o  directory for the images (default .)\n"
+            "  -j  threads (default one per core)\n"
+            "  -n  check the fleet only\n"
+            "  -r  count=n[,bdaddr=][,uuid_msw=][,major=][,minor=]"
+            "[,tx_power=]\n"
+            "      [,identity_root=][,family=][,name=prefix]\n", name);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static WORKER_T workers[MAX_THREADS];
+    FLEET_T fleet = { NULL, 0, 0 };
+    const char *dir = ".";
+    char *range = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int check_only = 0;
+    uint32_t failed = 0;
+    double start;
+    unsigned i;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:o:j:r:nh")) != -1)
+    {
+        switch(opt)
+        {
+            case 't':
+            {
+                char error[256];
+                unsigned j;
+
+                if(g_template_count == MAX_TEMPLATES ||
+                   KeyrTemplateLoad(&g_templates[g_template_count], optarg,
+                                    error, sizeof(error)) != 0)
+                {
+                    fprintf(stderr, "%s\n", g_template_count ==
+                            MAX_TEMPLATES ? "too many templates" : error);
+                    return 1;
+                }
+                for(j = 0; j < g_template_count; j++)
+                {
+                    if(g_templates[j].cs_version ==
+                       g_templates[g_template_count].cs_version)
+                    {
+                        fprintf(stderr, "%s: second template for "
+                                "DECIMAL_CS_VERSION %u\n", optarg,
+                                g_templates[j].cs_version);
+                        return 1;
+                    }
+                }
+                g_template_count++;
+            }
+            break;
+
+            case 'o':
+                dir = optarg;
+            break;
+
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+            break;
+
+            case 'r':
+                range = optarg;
+            break;
+
+            case 'n':
+                check_only = 1;
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(g_template_count == 0 || (range == NULL) != (argc - optind == 1) ||
+       (range != NULL && argc != optind))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if(jobs < 1)
+    {
+        jobs = 1;
+    }
+    if(jobs > MAX_THREADS)
+    {
+        jobs = MAX_THREADS;
+    }
+
+    start = seconds();
+    if((range != NULL ? makeRange(&fleet, range) :
+                        readCsv(&fleet, argv[optind])) != 0)
+    {
+        return 1;
+    }
+
+    if(checkFleet(&fleet) != 0 || drawPasscodes(&fleet) != 0)
+    {
+        fprintf(stderr, "nothing written\n");
+        return 1;
+    }
+
+    if(check_only)
+    {
+        fprintf(stderr, "%u devices checked in %.2f s\n", fleet.count,
+                seconds() - start);
+        return 0;
+    }
+
+    if(writePasscodes(&fleet, dir) != 0)
+    {
+        fprintf(stderr, "nothing written\n");
+        return 1;
+    }
+
+    if((uint32_t)jobs > fleet.count)
+    {
+        jobs = fleet.count ? (long)fleet.count : 1;
+    }
+
+    for(i = 0; i < (unsigned)jobs; i++)
+    {
+        workers[i].fleet = &fleet;
+        workers[i].templates = g_templates;
+        workers[i].dir = dir;
+        workers[i].first = (uint32_t)((uint64_t)fleet.count * i / jobs);
+        workers[i].end = (uint32_t)((uint64_t)fleet.count * (i + 1) / jobs);
+        if(pthread_create(&workers[i].thread, NULL, renderWorker,
+                          &workers[i]) != 0)
+        {
+            renderWorker(&workers[i]);
+            workers[i].thread = pthread_self();
+        }
+    }
+    for(i = 0; i < (unsigned)jobs; i++)
+    {
+        if(!pthread_equal(workers[i].thread, pthread_self()))
+        {
+            pthread_join(workers[i].thread, NULL);
+        }
+        if(workers[i].failed != 0)
+        {
+            fprintf(stderr, "%s/%s.keyr: %s\n", dir, workers[i].failed_name,
+                    strerror(workers[i].error));
+            failed += workers[i].failed;
+        }
+    }
+
+    fprintf(stderr, "%u images written with %ld threads in %.2f s\n",
+            fleet.count - failed, jobs, seconds() - start);
+
+    for(i = 0; i < g_template_count; i++)
+    {
+        KeyrTemplateFree(&g_templates[i]);
+    }
+    free(fleet.devices);
+
+    return failed != 0;
+}
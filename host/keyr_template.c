@@ -0,0 +1,377 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      keyr_template.c
+ *
+ *  DESCRIPTION
+ *      keyr template parsing and rendering. Only &BDADDR, &USER_KEYS and
+ *      &IDENTITY_ROOT are rendered per device; everything else, comments
+ *      and line endings included, is copied as it is.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "keyr_template.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define CS_VERSION_TAG                  ">DECIMAL_CS_VERSION="
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const char g_digits[2][16] =
+{
+    { '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' },
+    { '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' }
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      isHex
+ *
+ *  DESCRIPTION
+ *      Checks for a hex digit.
+ *
+ *  RETURNS
+ *      Non-zero for a hex digit.
+ *
+ *---------------------------------------------------------------------------*/
+static int isHex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseFields
+ *
+ *  DESCRIPTION
+ *      Finds the hex fields of the value of a key, from just after its '='
+ *      up to the end of the line or a comment.
+ *
+ *  RETURNS
+ *      Number of fields, or -1 if there are more than max or the value has
+ *      something other than hex fields in it.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseFields(const char *text, size_t offset, size_t end,
+                       KEYR_FIELD_T *fields, int max)
+{
+    int count = 0;
+
+    while(offset < end)
+    {
+        char c = text[offset];
+        size_t start;
+        int upper = 0;
+
+        if(c == ' ' || c == '\t' || c == '\r')
+        {
+            offset++;
+            continue;
+        }
+
+        if(c == '/' && offset + 1 < end && text[offset + 1] == '/')
+        {
+            break;
+        }
+
+        if(!isHex(c) || count == max)
+        {
+            return -1;
+        }
+
+        for(start = offset; offset < end && isHex(text[offset]); offset++)
+        {
+            upper |= text[offset] >= 'A' && text[offset] <= 'F';
+        }
+        if(offset - start > 4)
+        {
+            return -1;
+        }
+
+        fields[count].offset = start;
+        fields[count].width = (uint8_t)(offset - start);
+        fields[count].upper = (uint8_t)upper;
+        count++;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkWidths
+ *
+ *  DESCRIPTION
+ *      Checks that every field of a key has the number of digits its values
+ *      need, so that rendering never has to move the rest of the text.
+ *
+ *  RETURNS
+ *      count, or -1 if a field has another width.
+ *
+ *---------------------------------------------------------------------------*/
+static int checkWidths(const KEYR_FIELD_T *fields, int count, uint8_t width)
+{
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        if(fields[i].width != width)
+        {
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fieldValue
+ *
+ *  DESCRIPTION
+ *      Reads a field of the template.
+ *
+ *  RETURNS
+ *      The value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16_t fieldValue(const KEYR_TEMPLATE_T *keyr,
+                           const KEYR_FIELD_T *field)
+{
+    char digits[5];
+
+    memcpy(digits, &keyr->text[field->offset], field->width);
+    digits[field->width] = '\0';
+
+    return (uint16_t)strtoul(digits, NULL, 16);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeField
+ *
+ *  DESCRIPTION
+ *      Writes a value into a field of a rendered image.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeField(char *out, const KEYR_FIELD_T *field, uint16_t value)
+{
+    const char *digits = g_digits[field->upper];
+    char *p = &out[field->offset + field->width];
+    uint8_t i;
+
+    for(i = 0; i < field->width; i++)
+    {
+        *--p = digits[value & 0xF];
+        value >>= 4;
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int KeyrTemplateLoad(KEYR_TEMPLATE_T *keyr, const char *path,
+                     char *error, size_t error_size)
+{
+    FILE *in = fopen(path, "rb");
+    size_t line;
+    long size;
+    int i;
+
+    memset(keyr, 0, sizeof(*keyr));
+
+    if(in == NULL || fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) < 0 ||
+       fseek(in, 0, SEEK_SET) != 0)
+    {
+        snprintf(error, error_size, "%s: cannot read", path);
+        if(in != NULL)
+        {
+            fclose(in);
+        }
+        return -1;
+    }
+
+    keyr->text = malloc((size_t)size + 1);
+    if(keyr->text == NULL ||
+       fread(keyr->text, 1, (size_t)size, in) != (size_t)size)
+    {
+        snprintf(error, error_size, "%s: cannot read", path);
+        fclose(in);
+        KeyrTemplateFree(keyr);
+        return -1;
+    }
+    fclose(in);
+    keyr->len = (size_t)size;
+    keyr->text[keyr->len] = '\0';
+
+    for(line = 0; line < keyr->len; )
+    {
+        const char *text = keyr->text;
+        size_t end = line;
+        size_t name_end;
+        size_t equals;
+        int count = 0;
+
+        while(end < keyr->len && text[end] != '\n')
+        {
+            end++;
+        }
+
+        if(strncmp(&text[line], CS_VERSION_TAG,
+                   sizeof(CS_VERSION_TAG) - 1) == 0)
+        {
+            keyr->cs_version = (unsigned)strtoul(
+                &text[line + sizeof(CS_VERSION_TAG) - 1], NULL, 10);
+        }
+        else if(text[line] == '&')
+        {
+            for(name_end = line; name_end < end && text[name_end] != ' ' &&
+                text[name_end] != '\t' && text[name_end] != '=';
+                name_end++)
+            {
+            }
+            for(equals = name_end; equals < end && text[equals] != '=';
+                equals++)
+            {
+            }
+
+#define KEY_IS(name)    (name_end - line == sizeof(name) - 1 &&             \
+                         strncmp(&text[line], name, sizeof(name) - 1) == 0)
+
+            if(KEY_IS("&BDADDR"))
+            {
+                count = parseFields(text, equals + 1, end, keyr->bdaddr,
+                                    KEYR_BDADDR_WORDS);
+                keyr->bdaddr_count = (uint8_t)count;
+                if(count != KEYR_BDADDR_WORDS)
+                {
+                    count = -1;
+                }
+                count = checkWidths(keyr->bdaddr, count, 4);
+            }
+            else if(KEY_IS("&USER_KEYS"))
+            {
+                count = parseFields(text, equals + 1, end, keyr->user_keys,
+                                    KEYR_USER_KEYS);
+                keyr->user_key_count = (uint8_t)count;
+                count = checkWidths(keyr->user_keys, count, 4);
+            }
+            else if(KEY_IS("&IDENTITY_ROOT"))
+            {
+                count = parseFields(text, equals + 1, end,
+                                    keyr->identity_root,
+                                    KEYR_IDENTITY_ROOT_MAX);
+                keyr->identity_root_count = (uint8_t)count;
+                count = checkWidths(keyr->identity_root, count, 2);
+            }
+
+#undef KEY_IS
+
+            if(count < 0 || equals == end)
+            {
+                snprintf(error, error_size, "%s: cannot parse %.*s", path,
+                         (int)(name_end - line), &text[line]);
+                KeyrTemplateFree(keyr);
+                return -1;
+            }
+        }
+
+        line = end + 1;
+    }
+
+    if(keyr->cs_version == 0)
+    {
+        snprintf(error, error_size, "%s: no %s line", path, CS_VERSION_TAG);
+        KeyrTemplateFree(keyr);
+        return -1;
+    }
+
+    if(keyr->bdaddr_count != 0)
+    {
+        uint16_t lap = fieldValue(keyr, &keyr->bdaddr[0]);
+        uint16_t uap_lap = fieldValue(keyr, &keyr->bdaddr[1]);
+        uint16_t nap = fieldValue(keyr, &keyr->bdaddr[2]);
+
+        keyr->bdaddr_value = ((uint64_t)nap << 32) |
+                             ((uint64_t)uap_lap << 16) | lap;
+    }
+    for(i = 0; i < keyr->user_key_count; i++)
+    {
+        keyr->user_key_values[i] = fieldValue(keyr, &keyr->user_keys[i]);
+    }
+    for(i = 0; i < keyr->identity_root_count; i++)
+    {
+        keyr->identity_root_values[i] =
+            (uint8_t)fieldValue(keyr, &keyr->identity_root[i]);
+    }
+
+    return 0;
+}
+
+void KeyrTemplateFree(KEYR_TEMPLATE_T *keyr)
+{
+    free(keyr->text);
+    memset(keyr, 0, sizeof(*keyr));
+}
+
+void KeyrTemplateValues(const KEYR_TEMPLATE_T *keyr, KEYR_VALUES_T *values)
+{
+    memset(values, 0, sizeof(*values));
+    values->bdaddr = keyr->bdaddr_value;
+    memcpy(values->user_keys, keyr->user_key_values,
+           sizeof(values->user_keys));
+    memcpy(values->identity_root, keyr->identity_root_values,
+           sizeof(values->identity_root));
+}
+
+void KeyrTemplateRender(const KEYR_TEMPLATE_T *keyr,
+                        const KEYR_VALUES_T *values, char *out)
+{
+    uint8_t i;
+
+    memcpy(out, keyr->text, keyr->len);
+
+    if(keyr->bdaddr_count != 0)
+    {
+        writeField(out, &keyr->bdaddr[0], (uint16_t)values->bdaddr);
+        writeField(out, &keyr->bdaddr[1], (uint16_t)(values->bdaddr >> 16));
+        writeField(out, &keyr->bdaddr[2], (uint16_t)(values->bdaddr >> 32));
+    }
+    for(i = 0; i < keyr->user_key_count; i++)
+    {
+        writeField(out, &keyr->user_keys[i], values->user_keys[i]);
+    }
+    for(i = 0; i < keyr->identity_root_count; i++)
+    {
+        writeField(out, &keyr->identity_root[i], values->identity_root[i]);
+    }
+}
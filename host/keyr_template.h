@@ -0,0 +1,106 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      keyr_template.h
+ *
+ *  DESCRIPTION
+ *      keyr files as templates for per-device images. A template is parsed
+ *      once; rendering copies its text and overwrites the hex fields of the
+ *      keys that differ per device in place, keeping each field's width and
+ *      letter case, so an image differs from the template only in those
+ *      digits.
+ *
+ *****************************************************************************/
+
+#ifndef __KEYR_TEMPLATE_H__
+#define __KEYR_TEMPLATE_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* &BDADDR words: LAP bits 15-0, UAP and LAP bits 23-16, NAP */
+#define KEYR_BDADDR_WORDS               (3)
+
+#define KEYR_USER_KEYS                  (10)
+
+/* Longest &IDENTITY_ROOT, in fields */
+#define KEYR_IDENTITY_ROOT_MAX          (16)
+
+/* DECIMAL_CS_VERSION of each chip family */
+#define KEYR_CS_VERSION_CSR100X         (66)
+#define KEYR_CS_VERSION_CSR101X         (67)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Hex field in the template text */
+typedef struct
+{
+    size_t offset;
+    uint8_t width;
+    uint8_t upper;
+} KEYR_FIELD_T;
+
+typedef struct
+{
+    char *text;
+    size_t len;
+
+    unsigned cs_version;
+
+    /* Fields of the per-device keys; a count of 0 means the key is not in
+     * the template
+     */
+    KEYR_FIELD_T bdaddr[KEYR_BDADDR_WORDS];
+    uint8_t bdaddr_count;
+    KEYR_FIELD_T user_keys[KEYR_USER_KEYS];
+    uint8_t user_key_count;
+    KEYR_FIELD_T identity_root[KEYR_IDENTITY_ROOT_MAX];
+    uint8_t identity_root_count;
+
+    /* Values in the template */
+    uint64_t bdaddr_value;
+    uint16_t user_key_values[KEYR_USER_KEYS];
+    uint8_t identity_root_values[KEYR_IDENTITY_ROOT_MAX];
+} KEYR_TEMPLATE_T;
+
+/* Per-device values to render */
+typedef struct
+{
+    uint64_t bdaddr;
+    uint16_t user_keys[KEYR_USER_KEYS];
+    uint8_t identity_root[KEYR_IDENTITY_ROOT_MAX];
+} KEYR_VALUES_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Read and parse a keyr file; returns 0 on success, with a message in error
+ * otherwise
+ */
+extern int KeyrTemplateLoad(KEYR_TEMPLATE_T *keyr, const char *path,
+                            char *error, size_t error_size);
+
+/* Release a template */
+extern void KeyrTemplateFree(KEYR_TEMPLATE_T *keyr);
+
+/* Values of the template itself */
+extern void KeyrTemplateValues(const KEYR_TEMPLATE_T *keyr,
+                               KEYR_VALUES_T *values);
+
+/* Render an image into out, keyr->len octets */
+extern void KeyrTemplateRender(const KEYR_TEMPLATE_T *keyr,
+                               const KEYR_VALUES_T *values, char *out);
+
+#endif /* __KEYR_TEMPLATE_H__ */
@@ -0,0 +1,72 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      log_decode.c
+ *
+ *  DESCRIPTION
+ *      Decodes a binary debug log captured from the UART (or written by
+ *      beacon_profile -u) into text.
+ *
+ *      log_decode [file]       reads standard input without a file
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "log_decoder.h"
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    LOG_DECODER_T decoder;
+    uint8_t buffer[4096];
+    FILE *in = stdin;
+    size_t len;
+
+    if(argc > 2)
+    {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+
+    if(argc == 2)
+    {
+        in = fopen(argv[1], "rb");
+        if(in == NULL)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    LogDecoderInit(&decoder, stdout);
+    while((len = fread(buffer, 1, sizeof(buffer), in)) != 0)
+    {
+        LogDecoderFeed(&decoder, buffer, len);
+    }
+
+    if(in != stdin)
+    {
+        fclose(in);
+    }
+
+    if(LogDecoderPending(&decoder))
+    {
+        fprintf(stderr, "log ends part way through a record\n");
+        return 1;
+    }
+
+    return 0;
+}
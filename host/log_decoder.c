@@ -0,0 +1,234 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      log_decoder.c
+ *
+ *  DESCRIPTION
+ *      Turns the binary debug log back into text, one line per record:
+ *      time in seconds, level and the formatted message.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "log_decoder.h"
+#include "app_debug.h"
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    uint16_t level;
+    const char *format;
+} LOG_MESSAGE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+#define LOG_MESSAGE_ENTRY(id, level, format)    { (level), (format) },
+
+static const LOG_MESSAGE_T g_messages[] =
+{
+    APP_DEBUG_MESSAGES(LOG_MESSAGE_ENTRY)
+};
+
+static const char * const g_level_names[] =
+{
+    "NONE", "ERROR", "WARN", "INFO", "VERB"
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeMessage
+ *
+ *  DESCRIPTION
+ *      Formats the arguments of a record. Arguments the format does not
+ *      use are written as hex after it, and missing ones as '?'.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeMessage(FILE *out, const char *format,
+                         const uint16_t *args, uint16_t count)
+{
+    uint16_t used = 0;
+    const char *p;
+
+    for(p = format; *p != '\0'; p++)
+    {
+        int is_long = 0;
+        uint32_t value;
+
+        if(*p != '%')
+        {
+            fputc(*p, out);
+            continue;
+        }
+
+        p++;
+        if(*p == '%')
+        {
+            fputc('%', out);
+            continue;
+        }
+        if(*p == 'l')
+        {
+            is_long = 1;
+            p++;
+        }
+        if(*p == '\0')
+        {
+            break;
+        }
+
+        if(used + (is_long ? 2 : 1) > count)
+        {
+            fputc('?', out);
+            continue;
+        }
+
+        value = args[used++];
+        if(is_long)
+        {
+            value |= (uint32_t)args[used++] << 16;
+        }
+
+        switch(*p)
+        {
+            case 'd':
+                fprintf(out, "%ld", is_long ? (long)(int32_t)value :
+                                              (long)(int16_t)value);
+            break;
+
+            case 'x':
+                fprintf(out, is_long ? "%08lx" : "%04lx",
+                        (unsigned long)value);
+            break;
+
+            default:
+                fprintf(out, "%lu", (unsigned long)value);
+            break;
+        }
+    }
+
+    for(; used < count; used++)
+    {
+        fprintf(out, " %04x", args[used]);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeRecord
+ *
+ *  DESCRIPTION
+ *      Writes a complete record as a line of text.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeRecord(LOG_DECODER_T *decoder)
+{
+    uint16_t id = decoder->words[0] & APP_DEBUG_RECORD_ID_MASK;
+    uint16_t count = decoder->words[0] >> APP_DEBUG_RECORD_ARGS_SHIFT;
+    uint32_t time = decoder->words[1] | ((uint32_t)decoder->words[2] << 16);
+    const uint16_t *args = &decoder->words[APP_DEBUG_RECORD_HEADER_WORDS];
+
+    if(decoder->records != 0 && time < decoder->last_time)
+    {
+        decoder->time_base += (uint64_t)1 << 32;
+    }
+    decoder->last_time = time;
+    decoder->records++;
+
+    fprintf(decoder->out, "%12.6f ",
+            (double)(decoder->time_base + time) / 1e6);
+
+    if(id < sizeof(g_messages) / sizeof(g_messages[0]))
+    {
+        fprintf(decoder->out, "%-5s ", g_level_names[g_messages[id].level]);
+        writeMessage(decoder->out, g_messages[id].format, args, count);
+    }
+    else
+    {
+        fprintf(decoder->out, "?     message %u", id);
+        writeMessage(decoder->out, "", args, count);
+    }
+
+    fputc('\n', decoder->out);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      addWord
+ *
+ *  DESCRIPTION
+ *      Adds a word to the record being assembled and writes the record out
+ *      once it is complete.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void addWord(LOG_DECODER_T *decoder, uint16_t word)
+{
+    decoder->words[decoder->count++] = word;
+
+    if(decoder->count >= APP_DEBUG_RECORD_HEADER_WORDS &&
+       decoder->count == APP_DEBUG_RECORD_HEADER_WORDS +
+                         (decoder->words[0] >> APP_DEBUG_RECORD_ARGS_SHIFT))
+    {
+        writeRecord(decoder);
+        decoder->count = 0;
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+void LogDecoderInit(LOG_DECODER_T *decoder, FILE *out)
+{
+    decoder->out = out;
+    decoder->have_octet = 0;
+    decoder->count = 0;
+    decoder->last_time = 0;
+    decoder->time_base = 0;
+    decoder->records = 0;
+}
+
+void LogDecoderFeed(LOG_DECODER_T *decoder, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        if(!decoder->have_octet)
+        {
+            decoder->octet = data[i];
+            decoder->have_octet = 1;
+        }
+        else
+        {
+            decoder->have_octet = 0;
+            addWord(decoder, (uint16_t)(decoder->octet | (data[i] << 8)));
+        }
+    }
+}
+
+int LogDecoderPending(const LOG_DECODER_T *decoder)
+{
+    return decoder->have_octet || decoder->count != 0;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      log_decoder.h
+ *
+ *  DESCRIPTION
+ *      Decoder for the binary debug log the application writes to the UART.
+ *      Message formats come from app_debug_msgs.h, so the decoder must be
+ *      built from the same tree as the firmware.
+ *
+ *****************************************************************************/
+
+#ifndef __LOG_DECODER_H__
+#define __LOG_DECODER_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Largest record: header, timestamp and 31 argument words */
+#define LOG_DECODER_MAX_WORDS           (34)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    FILE *out;
+
+    /* Low octet of a word still waiting for its high octet */
+    int have_octet;
+    uint8_t octet;
+
+    /* Record being assembled */
+    uint16_t words[LOG_DECODER_MAX_WORDS];
+    uint16_t count;
+
+    /* Timestamps are 32-bit microseconds; wraps are counted to unroll
+     * them, which holds as long as records are less than 71 minutes apart
+     */
+    uint32_t last_time;
+    uint64_t time_base;
+
+    uint32_t records;
+} LOG_DECODER_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Start decoding a stream, writing one line per record to out */
+extern void LogDecoderInit(LOG_DECODER_T *decoder, FILE *out);
+
+/* Decode the next part of the stream */
+extern void LogDecoderFeed(LOG_DECODER_T *decoder, const uint8_t *data,
+                           size_t len);
+
+/* Whether a record has been left incomplete */
+extern int LogDecoderPending(const LOG_DECODER_T *decoder);
+
+#endif /* __LOG_DECODER_H__ */
@@ -0,0 +1,1521 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      rf_sim.c
+ *
+ *  DESCRIPTION
+ *      Discrete-event simulation of a venue full of beacons, for choosing
+ *      advertising intervals: how long receivers take to discover each
+ *      beacon and how many advertising PDUs are lost to collisions.
+ *
+ *      rf_sim [-n beacons] [-t seconds] [-w seconds] [-j jobs] [-s seed]
+ *             [-r file.keyr] [-k index=value] [-a ms[:ms]] [-v WxH]
+ *             [-p x,y[;x,y...]] [-g CxR] [-l window:interval] [-d dBm]
+ *             [-c dB] [-o beacons.csv]
+ *
+ *      The application runs once on the SDK stand-in, with the keys given,
+ *      and its advertising events (time, programmed interval, length, TX
+ *      level) make up the programme every simulated beacon follows. Beacons
+ *      with the same keys only differ in when they were switched on and in
+ *      the controller's choice of interval and advDelay, so each beacon
+ *      replays the programme from its own boot time with its own generator;
+ *      gaps the firmware made by stopping and restarting advertising are
+ *      kept as they are.
+ *
+ *      Each event sends the PDU on the firmware's channels, in turn from
+ *      37 to 39, timed as the stand-in does. Path loss is log-distance from the beacons'
+ *      random positions to the receivers. A PDU is lost at a receiver if
+ *      another PDU on the same channel overlaps it and is not at least the
+ *      capture margin weaker; it is received if it is not lost and the
+ *      receiver is scanning that channel for all of it. Receivers scan the
+ *      channels in turn, one per scan interval. PDUs below the sensitivity
+ *      are neither received nor counted as interference.
+ *
+ *      The work is split by receiver, channel and stretch of time over a
+ *      pool of threads. Each beacon's generator state at the start of every
+ *      stretch is worked out first, so that any stretch can be simulated on
+ *      its own.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+#include "energy_model.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define US_PER_SECOND                   (1000000ULL)
+#define US_PER_MS                       (1000.0)
+
+#define MAX_THREADS                     (64)
+#define MAX_RECEIVERS                   (1024)
+#define MAX_CHUNKS                      (64)
+
+#define CHANNEL_COUNT                   (3)
+
+/* Marks a channel an event is not sent on */
+#define NO_SLOT                         (0xFF)
+
+/* Number of &TX_POWER_LEVEL steps */
+#define TX_POWER_LEVEL_COUNT            (8)
+
+/* Longest PDU on air and the longest advertising event */
+#define MAX_PDU_US                      ((MODEL_ADV_PDU_OVERHEAD_OCTETS +     \
+                                          HARNESS_ADV_DATA_MAX) *             \
+                                         MODEL_US_PER_OCTET)
+#define MAX_EVENT_US                    (MODEL_ADV_WAKE_US +                  \
+                                         CHANNEL_COUNT *                      \
+                                         (MAX_PDU_US +                        \
+                                          MODEL_ADV_CHANNEL_GAP_US +          \
+                                          MODEL_ADV_CONN_RX_US))
+
+/* Events starting this long before a stretch of time can put PDUs in it */
+#define CHUNK_GUARD_US                  (MAX_EVENT_US + MAX_PDU_US)
+
+/* Time judged per pass over the PDUs; with the guard either side, PDU start
+ * times in a pass fit the two 11-bit radix digits
+ */
+#define SLICE_US                        (1u << 20)
+#define RADIX_BITS                      (11)
+#define RADIX_SIZE                      (1u << RADIX_BITS)
+
+/* Shortest stretch of time worth a task of its own */
+#define MIN_CHUNK_US                    (10 * US_PER_SECOND)
+
+/* Log-distance path loss */
+#define PATH_LOSS_1M_DB                 (40.0)
+#define PATH_LOSS_EXPONENT              (2.5)
+
+#define DEFAULT_SENSITIVITY_DBM         (-90.0)
+#define DEFAULT_CAPTURE_DB              (6.0)
+#define DEFAULT_SCAN_MS                 (100.0)
+
+#define NOT_RECEIVED                    (UINT64_MAX)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Advertising event of the firmware run, relative to boot */
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t interval_min_us;
+    uint32_t interval_max_us;
+    uint16_t air_us;
+    uint16_t channel_step_us;
+    uint8_t tx_power_level;
+
+    /* Position of each channel in the event, or NO_SLOT if the event is
+     * not sent on it
+     */
+    uint8_t slot[CHANNEL_COUNT];
+
+    /* Advertising was stopped and started again before this event, so the
+     * gap from the last event is the firmware's rather than the controller's
+     */
+    uint8_t restart;
+} PROGRAM_EVENT_T;
+
+typedef struct
+{
+    PROGRAM_EVENT_T *events;
+    uint32_t count;
+    uint32_t capacity;
+} PROGRAM_T;
+
+typedef struct
+{
+    double x;
+    double y;
+    uint64_t boot_us;
+    uint32_t seed;
+} BEACON_T;
+
+/* Where a beacon is in the programme */
+typedef struct
+{
+    uint64_t next_us;
+    uint32_t event;
+    uint32_t rng;
+} GENERATOR_T;
+
+/* Beacon a receiver can hear */
+typedef struct
+{
+    uint32_t beacon;
+    float path_loss;
+} AUDIBLE_T;
+
+typedef struct
+{
+    double x;
+    double y;
+    uint32_t scan_phase_us;
+    AUDIBLE_T *audible;
+    uint32_t audible_count;
+} RECEIVER_T;
+
+typedef struct
+{
+    uint64_t start_us;
+    uint32_t audible;
+    uint16_t air_us;
+    int16_t rssi;
+} PDU_T;
+
+/* Outcome for one beacon */
+typedef struct
+{
+    uint64_t first_rx_us;
+    uint64_t pdus;
+    uint64_t lost;
+    uint64_t received;
+} RESULT_T;
+
+/* Worker thread */
+typedef struct
+{
+    pthread_t thread;
+    uint32_t first;
+    uint32_t end;
+    uint64_t pdus;
+} WORKER_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Radio output in dBm at each &TX_POWER_LEVEL step */
+static const int8_t g_tx_power_dbm[TX_POWER_LEVEL_COUNT] =
+    { -18, -14, -10, -6, -2, 2, 6, 8 };
+
+static PROGRAM_T g_program;
+
+static BEACON_T *g_beacons;
+static uint32_t g_beacon_count = 1000;
+
+static RECEIVER_T g_receivers[MAX_RECEIVERS];
+static uint32_t g_receiver_count;
+
+static uint64_t g_duration_us;
+static uint64_t g_chunk_us;
+static uint32_t g_chunk_count;
+
+/* Generator of every beacon at the start of every chunk, by chunk; only
+ * beacons some receiver can hear are filled in
+ */
+static GENERATOR_T *g_checkpoints;
+static uint8_t *g_in_range;
+
+static double g_sensitivity_dbm = DEFAULT_SENSITIVITY_DBM;
+static double g_capture_db = DEFAULT_CAPTURE_DB;
+static uint32_t g_scan_window_us;
+static uint32_t g_scan_interval_us;
+
+static RESULT_T *g_results;
+static pthread_mutex_t g_results_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Next task for the pool, and how many there are */
+static uint32_t g_next_task;
+static uint32_t g_task_count;
+static pthread_mutex_t g_task_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      seconds
+ *
+ *  DESCRIPTION
+ *      Reads the monotonic clock.
+ *
+ *  RETURNS
+ *      Seconds.
+ *
+ *---------------------------------------------------------------------------*/
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextRandom
+ *
+ *  DESCRIPTION
+ *      Steps a xorshift generator.
+ *
+ *  RETURNS
+ *      The next value.
+ *
+ *---------------------------------------------------------------------------*/
+static inline uint32_t nextRandom(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      mixSeed
+ *
+ *  DESCRIPTION
+ *      Spreads a seed and an index over 32 bits, for independent generators.
+ *
+ *  RETURNS
+ *      A non-zero seed.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t mixSeed(uint32_t seed, uint32_t index)
+{
+    uint64_t z = ((uint64_t)seed << 32 | index) + 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    return (uint32_t)z ? (uint32_t)z : 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readKeyr
+ *
+ *  DESCRIPTION
+ *      Reads the &USER_KEYS words and the &nvm_size from a keyr file. The
+ *      NVM size is left alone if the file does not set it.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be read or has no user keys.
+ *
+ *---------------------------------------------------------------------------*/
+static int readKeyr(const char *path, uint16_t *keys, uint16_t *nvm_size)
+{
+    char line[256];
+    int found = -1;
+    FILE *in = fopen(path, "r");
+
+    if(in == NULL)
+    {
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        char *p;
+        int i;
+
+        if(line[0] == '/')
+        {
+            continue;
+        }
+
+        if((p = strstr(line, "&nvm_size")) != NULL &&
+           (p = strchr(p, '=')) != NULL)
+        {
+            *nvm_size = (uint16_t)strtoul(p + 1, NULL, 16);
+            continue;
+        }
+
+        if((p = strstr(line, "&USER_KEYS")) == NULL ||
+           (p = strchr(p, '=')) == NULL)
+        {
+            continue;
+        }
+
+        p++;
+        for(i = 0; i < HARNESS_USER_KEY_COUNT; i++)
+        {
+            char *end;
+
+            keys[i] = (uint16_t)strtoul(p, &end, 16);
+            if(end == p)
+            {
+                break;
+            }
+            p = end;
+        }
+        found = 0;
+    }
+
+    fclose(in);
+
+    return found;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      recordEvent
+ *
+ *  DESCRIPTION
+ *      Advertising hook which adds each event of the firmware run to the
+ *      programme.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void recordEvent(const HARNESS_ADV_EVENT_T *event, void *context)
+{
+    PROGRAM_T *program = (PROGRAM_T *)context;
+    PROGRAM_EVENT_T *entry;
+    uint8_t slots = 0;
+    uint32_t channel;
+
+    if(program->count == program->capacity)
+    {
+        uint32_t capacity = program->capacity ? program->capacity * 2 : 4096;
+        PROGRAM_EVENT_T *events = realloc(program->events,
+                                          capacity * sizeof(*events));
+
+        if(events == NULL)
+        {
+            return;
+        }
+        program->events = events;
+        program->capacity = capacity;
+    }
+
+    entry = &program->events[program->count];
+    entry->time_us = event->time_us;
+    entry->interval_min_us = event->interval_min_us;
+    entry->interval_max_us = event->interval_max_us;
+    entry->air_us = (uint16_t)((MODEL_ADV_PDU_OVERHEAD_OCTETS +
+                                event->adv_len) * MODEL_US_PER_OCTET);
+    entry->channel_step_us = (uint16_t)(entry->air_us +
+                                        MODEL_ADV_CHANNEL_GAP_US +
+                                        (event->scannable ?
+                                         MODEL_ADV_CONN_RX_US : 0));
+    for(channel = 0; channel < CHANNEL_COUNT; channel++)
+    {
+        entry->slot[channel] = (event->channels >> channel) & 1 ?
+                               slots++ : NO_SLOT;
+    }
+    entry->tx_power_level = event->tx_power_level < TX_POWER_LEVEL_COUNT ?
+                            event->tx_power_level : TX_POWER_LEVEL_COUNT - 1;
+    entry->restart = 0;
+
+    if(program->count != 0)
+    {
+        const PROGRAM_EVENT_T *last = entry - 1;
+        uint64_t gap = entry->time_us - last->time_us;
+
+        entry->restart = gap < last->interval_min_us ||
+                         gap > (uint64_t)last->interval_max_us +
+                               MODEL_ADV_DELAY_MAX_US;
+    }
+
+    program->count++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      startGenerator
+ *
+ *  DESCRIPTION
+ *      Puts a beacon at the first event of the programme.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void startGenerator(const BEACON_T *beacon, GENERATOR_T *gen)
+{
+    gen->next_us = g_program.count != 0 ?
+                   beacon->boot_us + g_program.events[0].time_us :
+                   HARNESS_NEVER;
+    gen->event = 0;
+    gen->rng = beacon->seed;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      advanceGenerator
+ *
+ *  DESCRIPTION
+ *      Moves a beacon on from its next event to the one after, drawing the
+ *      interval and advDelay as the controller does.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static inline void advanceGenerator(GENERATOR_T *gen)
+{
+    const PROGRAM_EVENT_T *event = &g_program.events[gen->event];
+
+    if(gen->event + 1 >= g_program.count)
+    {
+        gen->next_us = HARNESS_NEVER;
+        return;
+    }
+
+    if(event[1].restart)
+    {
+        gen->next_us += event[1].time_us - event->time_us;
+    }
+    else
+    {
+        uint32_t spread = event->interval_max_us - event->interval_min_us;
+        uint32_t interval = event->interval_min_us;
+
+        if(spread != 0)
+        {
+            interval += nextRandom(&gen->rng) % (spread + 1);
+        }
+        interval += nextRandom(&gen->rng) % (MODEL_ADV_DELAY_MAX_US + 1);
+        gen->next_us += interval;
+    }
+    gen->event++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkpointWorker
+ *
+ *  DESCRIPTION
+ *      Runs the generators of a range of beacons through the simulated time,
+ *      keeping their state at the start of each chunk.
+ *
+ *  RETURNS
+ *      NULL.
+ *
+ *---------------------------------------------------------------------------*/
+static void *checkpointWorker(void *context)
+{
+    WORKER_T *worker = (WORKER_T *)context;
+    uint32_t b;
+
+    for(b = worker->first; b < worker->end; b++)
+    {
+        GENERATOR_T gen;
+        uint32_t chunk;
+
+        if(!g_in_range[b])
+        {
+            continue;
+        }
+
+        startGenerator(&g_beacons[b], &gen);
+        for(chunk = 0; chunk < g_chunk_count; chunk++)
+        {
+            uint64_t start = chunk * g_chunk_us;
+
+            start = start > CHUNK_GUARD_US ? start - CHUNK_GUARD_US : 0;
+            while(gen.next_us < start)
+            {
+                advanceGenerator(&gen);
+            }
+            g_checkpoints[(size_t)chunk * g_beacon_count + b] = gen;
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sortPdus
+ *
+ *  DESCRIPTION
+ *      Sorts PDUs by start time, all within 2^22 us after base, with a
+ *      two digit LSD radix sort through scratch.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void sortPdus(PDU_T *pdus, PDU_T *scratch, uint32_t count,
+                     uint64_t base)
+{
+    uint32_t low[RADIX_SIZE];
+    uint32_t high[RADIX_SIZE];
+    uint32_t i;
+    uint32_t low_sum = 0;
+    uint32_t high_sum = 0;
+
+    memset(low, 0, sizeof(low));
+    memset(high, 0, sizeof(high));
+    for(i = 0; i < count; i++)
+    {
+        uint32_t key = (uint32_t)(pdus[i].start_us - base);
+
+        low[key & (RADIX_SIZE - 1)]++;
+        high[key >> RADIX_BITS]++;
+    }
+    for(i = 0; i < RADIX_SIZE; i++)
+    {
+        uint32_t n = low[i];
+
+        low[i] = low_sum;
+        low_sum += n;
+        n = high[i];
+        high[i] = high_sum;
+        high_sum += n;
+    }
+    for(i = 0; i < count; i++)
+    {
+        uint32_t key = (uint32_t)(pdus[i].start_us - base);
+
+        scratch[low[key & (RADIX_SIZE - 1)]++] = pdus[i];
+    }
+    for(i = 0; i < count; i++)
+    {
+        uint32_t key = (uint32_t)(scratch[i].start_us - base);
+
+        pdus[high[key >> RADIX_BITS]++] = scratch[i];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      isLost
+ *
+ *  DESCRIPTION
+ *      Looks for a PDU overlapping pdus[i] that it cannot capture against.
+ *
+ *  RETURNS
+ *      Non-zero if pdus[i] is lost.
+ *
+ *---------------------------------------------------------------------------*/
+static inline int isLost(const PDU_T *pdus, uint32_t count, uint32_t i)
+{
+    uint64_t start = pdus[i].start_us;
+    uint64_t end = start + pdus[i].air_us;
+    double survives_below = pdus[i].rssi - g_capture_db;
+    uint32_t j;
+
+    for(j = i; j-- > 0 && pdus[j].start_us + MAX_PDU_US > start; )
+    {
+        if(pdus[j].start_us + pdus[j].air_us > start &&
+           pdus[j].rssi > survives_below)
+        {
+            return 1;
+        }
+    }
+    for(j = i + 1; j < count && pdus[j].start_us < end; j++)
+    {
+        if(pdus[j].rssi > survives_below)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      isScanning
+ *
+ *  DESCRIPTION
+ *      Checks that a receiver is scanning a channel for the whole of a PDU.
+ *
+ *  RETURNS
+ *      Non-zero if it is.
+ *
+ *---------------------------------------------------------------------------*/
+static inline int isScanning(const RECEIVER_T *receiver, uint32_t channel,
+                             const PDU_T *pdu)
+{
+    uint64_t t = pdu->start_us + receiver->scan_phase_us;
+    uint64_t period = t / g_scan_interval_us;
+
+    return period % CHANNEL_COUNT == channel &&
+           t - period * g_scan_interval_us + pdu->air_us <= g_scan_window_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      runTask
+ *
+ *  DESCRIPTION
+ *      Simulates one channel at one receiver for one chunk of time, and adds
+ *      the outcome to the results.
+ *
+ *  RETURNS
+ *      Number of PDUs judged.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t runTask(uint32_t task)
+{
+    uint32_t chunk = task % g_chunk_count;
+    uint32_t channel = task / g_chunk_count % CHANNEL_COUNT;
+    const RECEIVER_T *receiver =
+        &g_receivers[task / g_chunk_count / CHANNEL_COUNT];
+    uint32_t audible_count = receiver->audible_count;
+    uint64_t chunk_start = chunk * g_chunk_us;
+    uint64_t chunk_end = chunk_start + g_chunk_us;
+    uint64_t judged_from = chunk_start;
+    GENERATOR_T *gens;
+    RESULT_T *results;
+    PDU_T *pdus = NULL;
+    PDU_T *scratch = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    uint64_t judged = 0;
+    uint32_t a;
+
+    if(chunk_end > g_duration_us)
+    {
+        chunk_end = g_duration_us;
+    }
+
+    gens = malloc(audible_count * sizeof(*gens));
+    results = malloc(audible_count * sizeof(*results));
+    if(audible_count != 0 && (gens == NULL || results == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for(a = 0; a < audible_count; a++)
+    {
+        gens[a] = g_checkpoints[(size_t)chunk * g_beacon_count +
+                                receiver->audible[a].beacon];
+        results[a].first_rx_us = NOT_RECEIVED;
+        results[a].pdus = 0;
+        results[a].lost = 0;
+        results[a].received = 0;
+    }
+
+    while(judged_from < chunk_end)
+    {
+        uint64_t slice_end = judged_from + SLICE_US;
+        uint64_t limit;
+        uint32_t i;
+        uint32_t kept;
+
+        if(slice_end > chunk_end)
+        {
+            slice_end = chunk_end;
+        }
+        limit = slice_end + MAX_PDU_US;
+
+        /* Every PDU that can overlap one starting in the slice */
+        for(a = 0; a < audible_count; a++)
+        {
+            GENERATOR_T *gen = &gens[a];
+
+            while(gen->next_us < limit)
+            {
+                const PROGRAM_EVENT_T *event = &g_program.events[gen->event];
+                int16_t rssi = (int16_t)lrint(
+                    g_tx_power_dbm[event->tx_power_level] -
+                    receiver->audible[a].path_loss);
+
+                if(rssi >= g_sensitivity_dbm &&
+                   event->slot[channel] != NO_SLOT)
+                {
+                    if(count == capacity)
+                    {
+                        capacity = capacity ? capacity * 2 : 65536;
+                        pdus = realloc(pdus, capacity * sizeof(*pdus));
+                        scratch = realloc(scratch,
+                                          capacity * sizeof(*scratch));
+                        if(pdus == NULL || scratch == NULL)
+                        {
+                            fprintf(stderr, "out of memory\n");
+                            exit(1);
+                        }
+                    }
+                    pdus[count].start_us = gen->next_us +
+                                           MODEL_ADV_WAKE_US +
+                                           event->slot[channel] *
+                                           event->channel_step_us;
+                    pdus[count].audible = a;
+                    pdus[count].air_us = event->air_us;
+                    pdus[count].rssi = rssi;
+                    count++;
+                }
+                advanceGenerator(gen);
+            }
+        }
+
+        sortPdus(pdus, scratch, count,
+                 judged_from > CHUNK_GUARD_US ?
+                 judged_from - CHUNK_GUARD_US : 0);
+
+        for(i = 0; i < count && pdus[i].start_us < slice_end; i++)
+        {
+            RESULT_T *result;
+
+            if(pdus[i].start_us < judged_from)
+            {
+                continue;
+            }
+
+            result = &results[pdus[i].audible];
+            result->pdus++;
+            judged++;
+            if(isLost(pdus, count, i))
+            {
+                result->lost++;
+            }
+            else if(isScanning(receiver, channel, &pdus[i]))
+            {
+                uint64_t end = pdus[i].start_us + pdus[i].air_us;
+
+                result->received++;
+                if(end < result->first_rx_us)
+                {
+                    result->first_rx_us = end;
+                }
+            }
+        }
+
+        /* Keep what the next slice judges, or needs as earlier interferers */
+        for(i = 0, kept = 0; i < count; i++)
+        {
+            if(pdus[i].start_us + MAX_PDU_US >= slice_end)
+            {
+                pdus[kept++] = pdus[i];
+            }
+        }
+        count = kept;
+        judged_from = slice_end;
+    }
+
+    pthread_mutex_lock(&g_results_lock);
+    for(a = 0; a < audible_count; a++)
+    {
+        RESULT_T *total = &g_results[receiver->audible[a].beacon];
+
+        total->pdus += results[a].pdus;
+        total->lost += results[a].lost;
+        total->received += results[a].received;
+        if(results[a].first_rx_us < total->first_rx_us)
+        {
+            total->first_rx_us = results[a].first_rx_us;
+        }
+    }
+    pthread_mutex_unlock(&g_results_lock);
+
+    free(pdus);
+    free(scratch);
+    free(gens);
+    free(results);
+
+    return judged;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      taskWorker
+ *
+ *  DESCRIPTION
+ *      Takes tasks from the pool until there are none left.
+ *
+ *  RETURNS
+ *      NULL.
+ *
+ *---------------------------------------------------------------------------*/
+static void *taskWorker(void *context)
+{
+    WORKER_T *worker = (WORKER_T *)context;
+
+    for(;;)
+    {
+        uint32_t task;
+
+        pthread_mutex_lock(&g_task_lock);
+        task = g_next_task++;
+        pthread_mutex_unlock(&g_task_lock);
+
+        if(task >= g_task_count)
+        {
+            break;
+        }
+        worker->pdus += runTask(task);
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      runWorkers
+ *
+ *  DESCRIPTION
+ *      Runs a function on a number of threads, on this one if a thread
+ *      cannot be started.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void runWorkers(WORKER_T *workers, long jobs, void *(*run)(void *))
+{
+    long i;
+
+    for(i = 0; i < jobs; i++)
+    {
+        if(pthread_create(&workers[i].thread, NULL, run, &workers[i]) != 0)
+        {
+            run(&workers[i]);
+            workers[i].thread = pthread_self();
+        }
+    }
+    for(i = 0; i < jobs; i++)
+    {
+        if(!pthread_equal(workers[i].thread, pthread_self()))
+        {
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      parseReceivers
+ *
+ *  DESCRIPTION
+ *      Reads receiver positions given as x,y[;x,y...] in metres.
+ *
+ *  RETURNS
+ *      Zero on success, -1 on a parse error or too many receivers.
+ *
+ *---------------------------------------------------------------------------*/
+static int parseReceivers(const char *text)
+{
+    while(*text != '\0')
+    {
+        char *end;
+        RECEIVER_T *receiver = &g_receivers[g_receiver_count];
+
+        if(g_receiver_count == MAX_RECEIVERS)
+        {
+            return -1;
+        }
+        receiver->x = strtod(text, &end);
+        if(end == text || *end != ',')
+        {
+            return -1;
+        }
+        text = end + 1;
+        receiver->y = strtod(text, &end);
+        if(end == text || (*end != ';' && *end != '\0'))
+        {
+            return -1;
+        }
+        text = *end == ';' ? end + 1 : end;
+        g_receiver_count++;
+    }
+
+    return g_receiver_count != 0 ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findAudible
+ *
+ *  DESCRIPTION
+ *      Lists the beacons a receiver can hear at the highest TX level in the
+ *      programme, with their path loss.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static int findAudible(RECEIVER_T *receiver, int geometry, int8_t max_dbm)
+{
+    uint32_t b;
+
+    receiver->audible = malloc(g_beacon_count * sizeof(*receiver->audible));
+    if(receiver->audible == NULL)
+    {
+        return -1;
+    }
+
+    receiver->audible_count = 0;
+    for(b = 0; b < g_beacon_count; b++)
+    {
+        double loss = PATH_LOSS_1M_DB;
+
+        if(geometry)
+        {
+            double dx = g_beacons[b].x - receiver->x;
+            double dy = g_beacons[b].y - receiver->y;
+            double d = sqrt(dx * dx + dy * dy);
+
+            if(d > 1.0)
+            {
+                loss += 10.0 * PATH_LOSS_EXPONENT * log10(d);
+            }
+        }
+
+        if(max_dbm - loss >= g_sensitivity_dbm)
+        {
+            receiver->audible[receiver->audible_count].beacon = b;
+            receiver->audible[receiver->audible_count].path_loss =
+                (float)loss;
+            receiver->audible_count++;
+            g_in_range[b] = 1;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      compareLatency
+ *
+ *  DESCRIPTION
+ *      qsort comparison of discovery latencies.
+ *
+ *  RETURNS
+ *      <0, 0 or >0.
+ *
+ *---------------------------------------------------------------------------*/
+static int compareLatency(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      compareRate
+ *
+ *  DESCRIPTION
+ *      qsort comparison of collision rates.
+ *
+ *  RETURNS
+ *      <0, 0 or >0.
+ *
+ *---------------------------------------------------------------------------*/
+static int compareRate(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      firstAdvert
+ *
+ *  DESCRIPTION
+ *      Time of a beacon's first advertising event.
+ *
+ *  RETURNS
+ *      Microseconds since the start of the simulation.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t firstAdvert(const BEACON_T *beacon)
+{
+    return beacon->boot_us + g_program.events[0].time_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      report
+ *
+ *  DESCRIPTION
+ *      Prints discovery latency and collision figures over the beacons.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void report(void)
+{
+    uint64_t *latency = malloc(g_beacon_count * sizeof(*latency));
+    double *rate = malloc(g_beacon_count * sizeof(*rate));
+    uint32_t found = 0;
+    uint32_t heard = 0;
+    uint32_t out_of_range = 0;
+    uint64_t pdus = 0;
+    uint64_t lost = 0;
+    uint64_t received = 0;
+    double latency_sum = 0.0;
+    uint32_t b;
+
+    if(latency == NULL || rate == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for(b = 0; b < g_beacon_count; b++)
+    {
+        const RESULT_T *result = &g_results[b];
+
+        pdus += result->pdus;
+        lost += result->lost;
+        received += result->received;
+        out_of_range += !g_in_range[b];
+        if(result->pdus != 0)
+        {
+            rate[heard++] = (double)result->lost / result->pdus;
+        }
+        if(result->first_rx_us != NOT_RECEIVED)
+        {
+            latency[found] = result->first_rx_us - firstAdvert(&g_beacons[b]);
+            latency_sum += latency[found];
+            found++;
+        }
+    }
+
+    qsort(latency, found, sizeof(*latency), compareLatency);
+    qsort(rate, heard, sizeof(*rate), compareRate);
+
+    printf("PDUs at receivers          %12llu\n", (unsigned long long)pdus);
+    printf("  lost to collisions       %12llu  (%.3f %%)\n",
+           (unsigned long long)lost, pdus ? 100.0 * lost / pdus : 0.0);
+    printf("  received                 %12llu\n",
+           (unsigned long long)received);
+    if(heard != 0)
+    {
+        printf("collision rate per beacon  p50 %.3f %%  p95 %.3f %%  "
+               "max %.3f %%\n", 100.0 * rate[heard / 2],
+               100.0 * rate[(size_t)heard * 95 / 100],
+               100.0 * rate[heard - 1]);
+    }
+    printf("beacons discovered         %12u of %u, %u out of range\n", found,
+           g_beacon_count, out_of_range);
+    if(found != 0)
+    {
+        printf("discovery latency (ms)     mean %.1f  p50 %.1f  p95 %.1f  "
+               "p99 %.1f  max %.1f\n",
+               latency_sum / found / US_PER_MS, latency[found / 2] / US_PER_MS,
+               latency[(size_t)found * 95 / 100] / US_PER_MS,
+               latency[(size_t)found * 99 / 100] / US_PER_MS,
+               latency[found - 1] / US_PER_MS);
+    }
+
+    free(latency);
+    free(rate);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeBeacons
+ *
+ *  DESCRIPTION
+ *      Writes each beacon's position and outcome as a CSV line.
+ *
+ *  RETURNS
+ *      Zero on success, -1 if the file cannot be written.
+ *
+ *---------------------------------------------------------------------------*/
+static int writeBeacons(const char *path)
+{
+    FILE *out = fopen(path, "w");
+    uint32_t b;
+
+    if(out == NULL)
+    {
+        return -1;
+    }
+
+    fprintf(out, "beacon,x,y,first_advert_ms,latency_ms,pdus,lost,"
+            "received\n");
+    for(b = 0; b < g_beacon_count; b++)
+    {
+        const RESULT_T *result = &g_results[b];
+
+        fprintf(out, "%u,%.2f,%.2f,%.3f,", b, g_beacons[b].x, g_beacons[b].y,
+                firstAdvert(&g_beacons[b]) / US_PER_MS);
+        if(result->first_rx_us != NOT_RECEIVED)
+        {
+            fprintf(out, "%.3f", (result->first_rx_us -
+                                  firstAdvert(&g_beacons[b])) / US_PER_MS);
+        }
+        fprintf(out, ",%llu,%llu,%llu\n", (unsigned long long)result->pdus,
+                (unsigned long long)result->lost,
+                (unsigned long long)result->received);
+    }
+
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n beacons] [-t seconds] [-w seconds] [-j jobs] "
+            "[-s seed]\n"
+            "       [-r file.keyr] [-k index=value] [-a ms[:ms]] [-v WxH]\n"
+            "       [-p x,y[;x,y...]] [-g CxR] [-l window:interval] "
+            "[-d dBm] [-c dB]\n"
+            "       [-o beacons.csv]\n"
+            "  -n  number of beacons (default 1000)\n"
+            "  -t  simulated time in seconds (default 3600)\n"
+            "  -w  beacons are switched on over this many seconds from the\n"
+            "      start (default 10)\n"
+            "  -j  threads (default the number of CPUs)\n"
+            "  -s  seed for placement, boot times and advDelay (default 1)\n"
+            "  -r  take &USER_KEYS from a keyr file\n"
+            "  -k  set a &USER_KEYS word, value in hex\n"
+            "  -a  advertising interval in ms, or a min:max range, in place\n"
+            "      of the firmware's\n"
+            "  -v  venue size in metres; without it every receiver hears\n"
+            "      every beacon at 1 m\n"
+            "  -p  receiver positions in metres (default the venue centre)\n"
+            "  -g  receivers on a grid of C by R, at the cell centres\n"
+            "  -l  scan window and interval in ms (default 100:100)\n"
+            "  -d  receiver sensitivity in dBm (default -90)\n"
+            "  -c  capture margin in dB (default 6)\n"
+            "  -o  write each beacon's outcome to a CSV file\n", name);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    double sim_seconds = 3600.0;
+    double spread_seconds = 10.0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t seed = 1;
+    uint16_t nvm_size = HARNESS_DEFAULT_NVM_WORDS;
+    uint16_t keys[HARNESS_USER_KEY_COUNT] = { 0 };
+    double interval_min_ms = 0.0;
+    double interval_max_ms = 0.0;
+    double venue_w = 0.0;
+    double venue_h = 0.0;
+    unsigned grid_c = 0;
+    unsigned grid_r = 0;
+    double scan_window_ms = DEFAULT_SCAN_MS;
+    double scan_interval_ms = DEFAULT_SCAN_MS;
+    const char *csv = NULL;
+    WORKER_T workers[MAX_THREADS];
+    int8_t max_dbm = INT8_MIN;
+    uint64_t judged = 0;
+    uint64_t audible = 0;
+    uint32_t rng;
+    double start;
+    double phase;
+    uint32_t i;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:t:w:j:s:r:k:a:v:p:g:l:d:c:o:h")) !=
+          -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                g_beacon_count = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+            case 't':
+                sim_seconds = atof(optarg);
+            break;
+
+            case 'w':
+                spread_seconds = atof(optarg);
+            break;
+
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+            break;
+
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+            case 'r':
+                if(readKeyr(optarg, keys, &nvm_size) != 0)
+                {
+                    fprintf(stderr, "%s: no &USER_KEYS\n", optarg);
+                    return 1;
+                }
+            break;
+
+            case 'k':
+            {
+                char *value = strchr(optarg, '=');
+                unsigned long index = strtoul(optarg, NULL, 0);
+
+                if(value == NULL || index >= HARNESS_USER_KEY_COUNT)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                keys[index] = (uint16_t)strtoul(value + 1, NULL, 16);
+            }
+            break;
+
+            case 'a':
+            {
+                char *max;
+
+                interval_min_ms = strtod(optarg, &max);
+                interval_max_ms = *max == ':' ? atof(max + 1) :
+                                                interval_min_ms;
+            }
+            break;
+
+            case 'v':
+                if(sscanf(optarg, "%lfx%lf", &venue_w, &venue_h) != 2)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'p':
+                if(parseReceivers(optarg) != 0)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'g':
+                if(sscanf(optarg, "%ux%u", &grid_c, &grid_r) != 2)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'l':
+                if(sscanf(optarg, "%lf:%lf", &scan_window_ms,
+                          &scan_interval_ms) != 2)
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+            break;
+
+            case 'd':
+                g_sensitivity_dbm = atof(optarg);
+            break;
+
+            case 'c':
+                g_capture_db = atof(optarg);
+            break;
+
+            case 'o':
+                csv = optarg;
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(argc != optind || g_beacon_count == 0 || sim_seconds <= 0.0 ||
+       spread_seconds < 0.0 || interval_max_ms < interval_min_ms ||
+       (interval_min_ms != 0.0 && interval_min_ms < 20.0) ||
+       venue_w < 0.0 || venue_h < 0.0 || scan_interval_ms <= 0.0 ||
+       scan_window_ms <= 0.0 || scan_window_ms > scan_interval_ms ||
+       (grid_c != 0) != (grid_r != 0) ||
+       (grid_c != 0 && g_receiver_count != 0) ||
+       (size_t)grid_c * grid_r > MAX_RECEIVERS)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if(jobs < 1)
+    {
+        jobs = 1;
+    }
+    if(jobs > MAX_THREADS)
+    {
+        jobs = MAX_THREADS;
+    }
+
+    start = seconds();
+
+    /* The firmware's advertising, long enough for the last beacon on */
+    g_duration_us = (uint64_t)(sim_seconds * US_PER_SECOND);
+    HarnessReset(seed);
+    for(i = 0; i < HARNESS_USER_KEY_COUNT; i++)
+    {
+        HarnessSetUserKey((uint16_t)i, keys[i]);
+    }
+    HarnessSetNvmSize(nvm_size);
+    HarnessSetAdvHook(recordEvent, &g_program);
+    HarnessBoot();
+    HarnessRun(g_duration_us + (uint64_t)(spread_seconds * US_PER_SECOND));
+    HarnessSetAdvHook(NULL, NULL);
+
+    if(g_program.count == 0)
+    {
+        fprintf(stderr, "the firmware did not advertise\n");
+        return 1;
+    }
+    for(i = 0; i < g_program.count; i++)
+    {
+        PROGRAM_EVENT_T *event = &g_program.events[i];
+
+        if(interval_min_ms != 0.0)
+        {
+            event->interval_min_us = (uint32_t)(interval_min_ms * US_PER_MS);
+            event->interval_max_us = (uint32_t)(interval_max_ms * US_PER_MS);
+        }
+        if(g_tx_power_dbm[event->tx_power_level] > max_dbm)
+        {
+            max_dbm = g_tx_power_dbm[event->tx_power_level];
+        }
+    }
+
+    /* Beacons and receivers */
+    g_beacons = malloc(g_beacon_count * sizeof(*g_beacons));
+    g_results = malloc(g_beacon_count * sizeof(*g_results));
+    g_in_range = calloc(g_beacon_count, sizeof(*g_in_range));
+    if(g_beacons == NULL || g_results == NULL || g_in_range == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    rng = mixSeed(seed, UINT32_MAX);
+    for(i = 0; i < g_beacon_count; i++)
+    {
+        g_beacons[i].x = venue_w * (nextRandom(&rng) / 4294967296.0);
+        g_beacons[i].y = venue_h * (nextRandom(&rng) / 4294967296.0);
+        g_beacons[i].boot_us = (uint64_t)(spread_seconds * US_PER_SECOND *
+                                          (nextRandom(&rng) / 4294967296.0));
+        g_beacons[i].seed = mixSeed(seed, i);
+        g_results[i].first_rx_us = NOT_RECEIVED;
+        g_results[i].pdus = 0;
+        g_results[i].lost = 0;
+        g_results[i].received = 0;
+    }
+
+    if(grid_c != 0)
+    {
+        for(i = 0; i < grid_c * grid_r; i++)
+        {
+            g_receivers[i].x = venue_w * (i % grid_c + 0.5) / grid_c;
+            g_receivers[i].y = venue_h * (i / grid_c + 0.5) / grid_r;
+        }
+        g_receiver_count = grid_c * grid_r;
+    }
+    else if(g_receiver_count == 0)
+    {
+        g_receivers[0].x = venue_w / 2.0;
+        g_receivers[0].y = venue_h / 2.0;
+        g_receiver_count = 1;
+    }
+
+    g_scan_window_us = (uint32_t)(scan_window_ms * US_PER_MS);
+    g_scan_interval_us = (uint32_t)(scan_interval_ms * US_PER_MS);
+    for(i = 0; i < g_receiver_count; i++)
+    {
+        if(findAudible(&g_receivers[i], venue_w != 0.0 || venue_h != 0.0,
+                       max_dbm) != 0)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        phase = nextRandom(&rng) / 4294967296.0;
+        g_receivers[i].scan_phase_us =
+            (uint32_t)(phase * CHANNEL_COUNT * g_scan_interval_us);
+        audible += g_receivers[i].audible_count;
+    }
+
+    /* Enough chunks to keep the threads busy, each long enough to be worth
+     * the checkpoint
+     */
+    g_chunk_count = (uint32_t)((jobs * 4 + CHANNEL_COUNT * g_receiver_count -
+                                1) / (CHANNEL_COUNT * g_receiver_count));
+    if(g_chunk_count > MAX_CHUNKS)
+    {
+        g_chunk_count = MAX_CHUNKS;
+    }
+    if(g_chunk_count > g_duration_us / MIN_CHUNK_US)
+    {
+        g_chunk_count = (uint32_t)(g_duration_us / MIN_CHUNK_US);
+    }
+    if(g_chunk_count == 0)
+    {
+        g_chunk_count = 1;
+    }
+    g_chunk_us = (g_duration_us + g_chunk_count - 1) / g_chunk_count;
+
+    g_checkpoints = malloc((size_t)g_chunk_count * g_beacon_count *
+                           sizeof(*g_checkpoints));
+    if(g_checkpoints == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("programme                  %12u events, interval %.1f to "
+           "%.1f ms at the first\n", g_program.count,
+           g_program.events[0].interval_min_us / US_PER_MS,
+           g_program.events[0].interval_max_us / US_PER_MS);
+    printf("beacons / receivers        %12u / %u, %.1f audible each\n",
+           g_beacon_count, g_receiver_count,
+           (double)audible / g_receiver_count);
+    printf("simulated time             %12.0f s\n", sim_seconds);
+
+    memset(workers, 0, sizeof(workers));
+    for(i = 0; i < (uint32_t)jobs; i++)
+    {
+        workers[i].first = (uint32_t)((uint64_t)g_beacon_count * i / jobs);
+        workers[i].end = (uint32_t)((uint64_t)g_beacon_count * (i + 1) /
+                                    jobs);
+    }
+    runWorkers(workers, jobs, checkpointWorker);
+
+    g_task_count = g_receiver_count * CHANNEL_COUNT * g_chunk_count;
+    runWorkers(workers, jobs, taskWorker);
+    for(i = 0; i < (uint32_t)jobs; i++)
+    {
+        judged += workers[i].pdus;
+    }
+
+    report();
+    printf("wall time                  %12.2f s on %ld threads, "
+           "%.1f M PDUs/s\n", seconds() - start, jobs,
+           judged / 1e6 / (seconds() - start));
+
+    if(csv != NULL && writeBeacons(csv) != 0)
+    {
+        perror(csv);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,664 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      rssi_range.c
+ *
+ *  DESCRIPTION
+ *      Ranges the beacon's iBeacon frames heard by a set of receivers.
+ *
+ *      rssi_range [-j jobs] [-x exponent] [-a] capture...
+ *          decodes one btsnoop file or raw H4 stream per receiver, numbered
+ *          from 0 in the order given, and writes the latest estimate of
+ *          every beacon and receiver as CSV, or with -a every estimate as
+ *          it is made. A beacon is told by its major and minor.
+ *
+ *      rssi_range -b beacons:receivers [-j jobs] [-n batch]
+ *          benchmark: streams made-up reports, each from a random link at
+ *          a fixed distance, with 4 dB of noise on the RSSI, and reports
+ *          the sustained rate and the latency of a batch from handing it
+ *          over to its last estimate. Every report of a batch waits that
+ *          long, so the batch latency percentiles are those of a report.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "adv_decoder.h"
+#include "rssi_ranger.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+#define READ_BUFFER_SIZE                (64 * 1024)
+
+/* Shortest benchmark run, in seconds of ingesting */
+#define BENCH_MIN_SECONDS               (2.0)
+
+#define DEFAULT_BENCH_BATCH             (4096)
+
+/* Made-up links: distance range in metres, TX power at 1 m and noise */
+#define BENCH_MIN_DISTANCE_M            (1.0)
+#define BENCH_MAX_DISTANCE_M            (30.0)
+#define BENCH_TX_POWER                  (-74)
+#define BENCH_NOISE_DB                  (4.0)
+
+/* Draws giving the error of a single sample */
+#define BENCH_NOISE_DRAWS               (100001)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Capture being ranged */
+typedef struct
+{
+    RSSI_RANGER_T *ranger;
+    uint32_t receiver;
+    int all;
+    RSSI_RANGER_REPORT_T reports[ADV_DECODER_BATCH_SIZE];
+} CAPTURE_CONTEXT_T;
+
+/* Benchmark accuracy, over the latest estimate of every link */
+typedef struct
+{
+    const float *distance_m;
+    uint32_t receivers;
+    double *errors;
+    uint32_t count;
+} BENCH_ACCURACY_T;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextRandom
+ *
+ *  DESCRIPTION
+ *      xorshift32, so that runs repeat exactly.
+ *
+ *  RETURNS
+ *      Next pseudo-random value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextNoise
+ *
+ *  DESCRIPTION
+ *      Roughly normal noise of unit variance, the sum of twelve uniform
+ *      draws less six.
+ *
+ *  RETURNS
+ *      The noise.
+ *
+ *---------------------------------------------------------------------------*/
+static double nextNoise(uint32_t *state)
+{
+    double sum = -6.0;
+    int i;
+
+    for(i = 0; i < 12; i++)
+    {
+        sum += nextRandom(state) / 4294967296.0;
+    }
+
+    return sum;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      seconds
+ *
+ *  DESCRIPTION
+ *      Monotonic time.
+ *
+ *  RETURNS
+ *      Time in seconds.
+ *
+ *---------------------------------------------------------------------------*/
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      printEstimates
+ *
+ *  DESCRIPTION
+ *      Writes a CSV line per estimate.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void printEstimates(const RSSI_RANGER_ESTIMATE_T *estimates,
+                           uint32_t count, void *context)
+{
+    uint32_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        const RSSI_RANGER_ESTIMATE_T *e = &estimates[i];
+
+        printf("%llu,%u,%u,%u,%u,%.1f,%.2f,%.2f\n",
+               (unsigned long long)e->time_us, e->receiver,
+               e->beacon >> 16, e->beacon & 0xFFFF, e->samples,
+               e->path_loss, e->distance_m, e->error_m);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      rangeBatch
+ *
+ *  DESCRIPTION
+ *      Hands the frames of a decoded batch to the ranger as reports of the
+ *      capture's receiver.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void rangeBatch(const ADV_DECODER_BATCH_T *batch, void *context)
+{
+    CAPTURE_CONTEXT_T *capture = context;
+    uint32_t i;
+
+    for(i = 0; i < batch->count; i++)
+    {
+        RSSI_RANGER_REPORT_T *report = &capture->reports[i];
+
+        report->time_us = batch->time_us[i];
+        report->beacon = ((uint32_t)batch->major[i] << 16) | batch->minor[i];
+        report->receiver = capture->receiver;
+        report->rssi = batch->rssi[i];
+        report->tx_power = batch->tx_power[i];
+    }
+
+    RssiRangerIngest(capture->ranger, capture->reports, batch->count,
+                     capture->all ? printEstimates : NULL, NULL);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      rangeCapture
+ *
+ *  DESCRIPTION
+ *      Decodes a capture and ranges its frames.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int rangeCapture(const char *path, CAPTURE_CONTEXT_T *capture)
+{
+    static ADV_DECODER_T decoder;
+    static uint8_t buffer[READ_BUFFER_SIZE];
+    adv_decoder_format format = adv_decoder_h4;
+    FILE *in = fopen(path, "rb");
+    int incomplete;
+    size_t len;
+
+    if(in == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    /* The format is told from the start of the input */
+    len = fread(buffer, 1, sizeof(buffer), in);
+    if(len >= 8 && memcmp(buffer, "btsnoop", 8) == 0)
+    {
+        format = adv_decoder_btsnoop;
+    }
+
+    AdvDecoderInit(&decoder, format, rangeBatch, capture);
+    while(len != 0)
+    {
+        AdvDecoderFeed(&decoder, buffer, len);
+        len = fread(buffer, 1, sizeof(buffer), in);
+    }
+    incomplete = AdvDecoderFlush(&decoder);
+    fclose(in);
+
+    fprintf(stderr, "%s: receiver %u, %llu beacon frames\n", path,
+            capture->receiver, (unsigned long long)decoder.matched);
+    if(incomplete)
+    {
+        fprintf(stderr, "%s: input ends part way through a record\n", path);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sumEstimates
+ *
+ *  DESCRIPTION
+ *      Benchmark handler: touches every estimate, as a consumer would.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void sumEstimates(const RSSI_RANGER_ESTIMATE_T *estimates,
+                         uint32_t count, void *context)
+{
+    double *sum = context;
+    uint32_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        *sum += estimates[i].distance_m;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      collectErrors
+ *
+ *  DESCRIPTION
+ *      Benchmark snapshot handler: the error of each link's latest
+ *      distance, relative to the true one.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void collectErrors(const RSSI_RANGER_ESTIMATE_T *estimates,
+                          uint32_t count, void *context)
+{
+    BENCH_ACCURACY_T *accuracy = context;
+    uint32_t i;
+
+    for(i = 0; i < count; i++)
+    {
+        double truth = accuracy->distance_m[estimates[i].beacon *
+                                            accuracy->receivers +
+                                            estimates[i].receiver];
+
+        accuracy->errors[accuracy->count++] =
+            fabs(estimates[i].distance_m - truth) / truth;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      compareDoubles
+ *
+ *  DESCRIPTION
+ *      qsort comparison, ascending.
+ *
+ *  RETURNS
+ *      Negative, zero or positive.
+ *
+ *---------------------------------------------------------------------------*/
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sampleError
+ *
+ *  DESCRIPTION
+ *      Works out the median error of the distance from a single report,
+ *      relative to the true one, for comparison with the filter's.
+ *
+ *  RETURNS
+ *      The error, or a negative value if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static double sampleError(const RSSI_RANGER_PARAMS_T *params,
+                          uint32_t *state)
+{
+    double *errors = malloc(BENCH_NOISE_DRAWS * sizeof(*errors));
+    double median;
+    uint32_t i;
+
+    if(errors == NULL)
+    {
+        return -1.0;
+    }
+
+    for(i = 0; i < BENCH_NOISE_DRAWS; i++)
+    {
+        errors[i] = fabs(pow(10.0, BENCH_NOISE_DB * nextNoise(state) /
+                                   (10.0 * params->exponent)) - 1.0);
+    }
+    qsort(errors, BENCH_NOISE_DRAWS, sizeof(*errors), compareDoubles);
+    median = errors[BENCH_NOISE_DRAWS / 2];
+    free(errors);
+
+    return median;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      makeReport
+ *
+ *  DESCRIPTION
+ *      Makes up a report from a random link. Reports come evenly spaced,
+ *      so that each link is heard about once a second.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void makeReport(RSSI_RANGER_REPORT_T *report, uint64_t n,
+                       uint32_t links, uint32_t receivers,
+                       const float *loss, uint32_t *state)
+{
+    uint32_t link = nextRandom(state) % links;
+    double rssi = BENCH_TX_POWER - loss[link] +
+                  BENCH_NOISE_DB * nextNoise(state);
+
+    report->time_us = n * 1000000ULL / links;
+    report->beacon = link / receivers;
+    report->receiver = link % receivers;
+    report->rssi = (int8_t)lround(rssi < -127.0 ? -127.0 : rssi);
+    report->tx_power = BENCH_TX_POWER;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      benchmark
+ *
+ *  DESCRIPTION
+ *      Hears every link once to fill the tables, then streams batches for
+ *      at least BENCH_MIN_SECONDS, timing each RssiRangerIngest() call.
+ *      Making up the reports is not timed.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int benchmark(uint32_t beacons, uint32_t receivers, uint32_t jobs,
+                     uint32_t batch_size, const RSSI_RANGER_PARAMS_T *params)
+{
+    RSSI_RANGER_T *ranger = malloc(sizeof(*ranger));
+    uint32_t links = beacons * receivers;
+    RSSI_RANGER_REPORT_T *batch = malloc(batch_size * sizeof(*batch));
+    float *distance_m = malloc(links * sizeof(*distance_m));
+    float *loss = malloc(links * sizeof(*loss));
+    double *latencies = NULL;
+    uint32_t latency_count = 0;
+    uint32_t latency_size = 0;
+    BENCH_ACCURACY_T accuracy;
+    uint32_t state = 1;
+    uint64_t n = 0;
+    double busy = 0.0;
+    double sum = 0.0;
+    double start;
+    uint32_t i;
+
+    if(ranger == NULL || batch == NULL || distance_m == NULL ||
+       loss == NULL || RssiRangerInit(ranger, params, jobs, links) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for(i = 0; i < links; i++)
+    {
+        distance_m[i] = (float)(BENCH_MIN_DISTANCE_M +
+                                (BENCH_MAX_DISTANCE_M -
+                                 BENCH_MIN_DISTANCE_M) *
+                                (nextRandom(&state) / 4294967296.0));
+        loss[i] = (float)(10.0 * params->exponent * log10(distance_m[i]));
+    }
+
+    /* every link once, in order, untimed */
+    for(i = 0; i < links; i++)
+    {
+        RSSI_RANGER_REPORT_T *report = &batch[i % batch_size];
+
+        makeReport(report, n++, links, receivers, loss, &state);
+        report->beacon = i / receivers;
+        report->receiver = i % receivers;
+        if(i % batch_size == batch_size - 1 || i == links - 1)
+        {
+            RssiRangerIngest(ranger, batch, i % batch_size + 1, NULL, NULL);
+        }
+    }
+
+    start = seconds();
+    while(busy < BENCH_MIN_SECONDS)
+    {
+        double before;
+
+        for(i = 0; i < batch_size; i++)
+        {
+            makeReport(&batch[i], n++, links, receivers, loss, &state);
+        }
+
+        before = seconds();
+        RssiRangerIngest(ranger, batch, batch_size, sumEstimates, &sum);
+        if(latency_count == latency_size)
+        {
+            latency_size = latency_size == 0 ? 4096 : latency_size * 2;
+            latencies = realloc(latencies, latency_size * sizeof(*latencies));
+            if(latencies == NULL)
+            {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+        latencies[latency_count] = seconds() - before;
+        busy += latencies[latency_count++];
+    }
+
+    qsort(latencies, latency_count, sizeof(*latencies), compareDoubles);
+
+    accuracy.distance_m = distance_m;
+    accuracy.receivers = receivers;
+    accuracy.errors = malloc(links * sizeof(*accuracy.errors));
+    accuracy.count = 0;
+    if(accuracy.errors == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    RssiRangerSnapshot(ranger, collectErrors, &accuracy);
+    qsort(accuracy.errors, accuracy.count, sizeof(*accuracy.errors),
+          compareDoubles);
+
+    printf("links                               : %u beacons x %u "
+           "receivers = %u\n", beacons, receivers, links);
+    printf("threads                             : %u\n",
+           ranger->shard_count);
+    printf("batches                             : %u of %u in %.2f s "
+           "(%.2f s wall)\n", latency_count, batch_size, busy,
+           seconds() - start);
+    printf("updates per second (sustained)      : %.2f M\n",
+           (double)latency_count * batch_size / busy / 1e6);
+    printf("batch latency p50 / p99 / max       : %.0f / %.0f / %.0f us\n",
+           latencies[latency_count / 2] * 1e6,
+           latencies[(uint32_t)(latency_count * 0.99)] * 1e6,
+           latencies[latency_count - 1] * 1e6);
+    printf("median distance error               : %.1f %% (one sample "
+           "%.1f %%)\n", accuracy.errors[accuracy.count / 2] * 100.0,
+           sampleError(params, &state) * 100.0);
+    printf("checksum                            : %.0f\n", sum);
+
+    RssiRangerFree(ranger);
+    free(ranger);
+    free(batch);
+    free(distance_m);
+    free(loss);
+    free(latencies);
+    free(accuracy.errors);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      usage
+ *
+ *  DESCRIPTION
+ *      Prints the command line help.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-j jobs] [-x exponent] [-a] capture...\n"
+            "       %s -b beacons:receivers [-j jobs] [-n batch]\n"
+            "  -j  threads (default the number of CPUs)\n"
+            "  -x  path loss exponent (default %.1f)\n"
+            "  -a  write every estimate, not only the latest of each link\n"
+            "  -b  benchmark with made-up reports from that many links\n"
+            "  -n  reports per batch in the benchmark (default %u)\n",
+            name, name, RSSI_RANGER_DEFAULT_EXPONENT, DEFAULT_BENCH_BATCH);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    static RSSI_RANGER_T ranger;
+    static CAPTURE_CONTEXT_T capture;
+    RSSI_RANGER_PARAMS_T params;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t beacons = 0;
+    uint32_t receivers = 0;
+    uint32_t batch_size = DEFAULT_BENCH_BATCH;
+    int opt;
+
+    RssiRangerDefaults(&params);
+
+    while((opt = getopt(argc, argv, "j:x:ab:n:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'j':
+                jobs = strtol(optarg, NULL, 0);
+            break;
+
+            case 'x':
+                params.exponent = (float)atof(optarg);
+            break;
+
+            case 'a':
+                capture.all = 1;
+            break;
+
+            case 'b':
+            {
+                char *field;
+
+                beacons = (uint32_t)strtoul(optarg, &field, 0);
+                if(*field != ':')
+                {
+                    usage(argv[0]);
+                    return 2;
+                }
+                receivers = (uint32_t)strtoul(field + 1, NULL, 0);
+            }
+            break;
+
+            case 'n':
+                batch_size = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if(jobs < 1)
+    {
+        jobs = 1;
+    }
+    if(params.exponent <= 0.0f || batch_size == 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(beacons != 0 || receivers != 0)
+    {
+        if(beacons == 0 || receivers == 0 || beacons > 0xFFFFFFFFu / receivers)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        return benchmark(beacons, receivers, (uint32_t)jobs, batch_size,
+                         &params);
+    }
+
+    if(optind == argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if(RssiRangerInit(&ranger, &params, (uint32_t)jobs, 0) != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("time_us,receiver,major,minor,samples,path_loss,distance_m,"
+           "error_m\n");
+    capture.ranger = &ranger;
+    for(; optind < argc; optind++, capture.receiver++)
+    {
+        if(rangeCapture(argv[optind], &capture) != 0)
+        {
+            RssiRangerFree(&ranger);
+            return 1;
+        }
+    }
+
+    if(!capture.all)
+    {
+        RssiRangerSnapshot(&ranger, printEstimates, NULL);
+    }
+    RssiRangerFree(&ranger);
+
+    return 0;
+}
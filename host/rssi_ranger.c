@@ -0,0 +1,774 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      rssi_ranger.c
+ *
+ *  DESCRIPTION
+ *      RSSI ranging engine. A link is keyed by beacon and receiver in one
+ *      64-bit word. The key is mixed by the MurmurHash3 finaliser: the high
+ *      half of the hash picks the shard and the low half the home slot, so
+ *      neither depends on only part of the key.
+ *
+ *      The filter predicts by adding the drift variance for the time since
+ *      the link's last report, then corrects towards the new path loss by
+ *      the Kalman gain. A link's first report, or its first after
+ *      params.reset_us of silence, starts it again from that sample alone.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "rssi_ranger.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Smallest and largest table of a shard, in entries */
+#define RANGER_MIN_TABLE_SIZE           (1024)
+#define RANGER_MAX_TABLE_SIZE           (1u << 30)
+
+/* Tables start on a cache line, so no entry straddles two */
+#define RANGER_TABLE_ALIGN              (64)
+
+/* Estimates handed over at once by RssiRangerSnapshot() */
+#define RANGER_SNAPSHOT_BATCH           (256)
+
+#define RANGER_SECONDS_PER_US           (1e-6f)
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      hashLink
+ *
+ *  DESCRIPTION
+ *      Mixes a link key.
+ *
+ *  RETURNS
+ *      The hash.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t hashLink(uint64_t link)
+{
+    link ^= link >> 33;
+    link *= 0xFF51AFD7ED558CCDULL;
+    link ^= link >> 33;
+    link *= 0xC4CEB9FE1A85EC53ULL;
+    link ^= link >> 33;
+
+    return link;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      shardOf
+ *
+ *  DESCRIPTION
+ *      Works out which shard holds a link.
+ *
+ *  RETURNS
+ *      The shard number.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t shardOf(const RSSI_RANGER_T *ranger, uint64_t hash)
+{
+    return (uint32_t)(((hash >> 32) * ranger->shard_count) >> 32);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      allocTable
+ *
+ *  DESCRIPTION
+ *      Allocates an empty table of the given size, a power of two.
+ *
+ *  RETURNS
+ *      The table, or NULL if out of memory.
+ *
+ *---------------------------------------------------------------------------*/
+static RSSI_RANGER_LINK_T *allocTable(uint32_t size)
+{
+    void *memory;
+    RSSI_RANGER_LINK_T *table;
+    uint32_t i;
+
+    if(posix_memalign(&memory, RANGER_TABLE_ALIGN,
+                      (size_t)size * sizeof(*table)) != 0)
+    {
+        return NULL;
+    }
+
+    table = memory;
+    for(i = 0; i < size; i++)
+    {
+        table[i].link = RSSI_RANGER_NO_LINK;
+    }
+
+    return table;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      place
+ *
+ *  DESCRIPTION
+ *      Puts a link in the first free entry of its probe sequence. The
+ *      caller makes sure there is room.
+ *
+ *  RETURNS
+ *      The entry.
+ *
+ *---------------------------------------------------------------------------*/
+static RSSI_RANGER_LINK_T *place(RSSI_RANGER_SHARD_T *shard,
+                                 const RSSI_RANGER_LINK_T *link)
+{
+    uint32_t slot = (uint32_t)hashLink(link->link) & shard->table_mask;
+
+    while(shard->table[slot].link != RSSI_RANGER_NO_LINK)
+    {
+        slot = (slot + 1) & shard->table_mask;
+    }
+
+    shard->table[slot] = *link;
+
+    return &shard->table[slot];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      rebuild
+ *
+ *  DESCRIPTION
+ *      Moves the links of a shard heard at or after a given time to a new
+ *      table of the given size.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int rebuild(RSSI_RANGER_SHARD_T *shard, uint32_t size,
+                   uint64_t since_us)
+{
+    RSSI_RANGER_LINK_T *old = shard->table;
+    uint32_t old_size = shard->table_mask + 1;
+    uint32_t i;
+
+    shard->table = allocTable(size);
+    if(shard->table == NULL)
+    {
+        shard->table = old;
+        return -1;
+    }
+    shard->table_mask = size - 1;
+    shard->links = 0;
+
+    for(i = 0; i < old_size; i++)
+    {
+        if(old[i].link != RSSI_RANGER_NO_LINK && old[i].time_us >= since_us)
+        {
+            place(shard, &old[i]);
+            shard->links++;
+        }
+    }
+
+    free(old);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findLink
+ *
+ *  DESCRIPTION
+ *      Finds a link in its shard, adding it with no samples if it is new.
+ *
+ *  RETURNS
+ *      The entry, or NULL if a new link does not fit and the table cannot
+ *      grow.
+ *
+ *---------------------------------------------------------------------------*/
+static RSSI_RANGER_LINK_T *findLink(RSSI_RANGER_SHARD_T *shard,
+                                    uint64_t link, uint64_t hash)
+{
+    RSSI_RANGER_LINK_T entry;
+    uint32_t slot;
+
+    for(slot = (uint32_t)hash & shard->table_mask;
+        shard->table[slot].link != RSSI_RANGER_NO_LINK;
+        slot = (slot + 1) & shard->table_mask)
+    {
+        if(shard->table[slot].link == link)
+        {
+            return &shard->table[slot];
+        }
+    }
+
+    if((shard->links + 1) * 2 > shard->table_mask + 1)
+    {
+        if(shard->table_mask + 1 == RANGER_MAX_TABLE_SIZE ||
+           rebuild(shard, (shard->table_mask + 1) * 2, 0) != 0)
+        {
+            return NULL;
+        }
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.link = link;
+    shard->links++;
+
+    return place(shard, &entry);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fillEstimate
+ *
+ *  DESCRIPTION
+ *      Turns the state of a link into an estimate.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void fillEstimate(const RSSI_RANGER_T *ranger,
+                         const RSSI_RANGER_LINK_T *entry,
+                         RSSI_RANGER_ESTIMATE_T *estimate)
+{
+    float distance = expf(entry->path_loss * ranger->loss_to_ln_m);
+
+    estimate->time_us = entry->time_us;
+    estimate->beacon = (uint32_t)(entry->link >> 32);
+    estimate->receiver = (uint32_t)entry->link;
+    estimate->path_loss = entry->path_loss;
+    estimate->distance_m = distance;
+    estimate->error_m = distance * ranger->loss_to_ln_m *
+                        sqrtf(entry->variance);
+    estimate->samples = entry->samples;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      updateShard
+ *
+ *  DESCRIPTION
+ *      Runs the reports of the batch in hand through the filters of their
+ *      links.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void updateShard(RSSI_RANGER_SHARD_T *shard)
+{
+    const RSSI_RANGER_T *ranger = shard->ranger;
+    const RSSI_RANGER_PARAMS_T *params = &ranger->params;
+    uint32_t emitted = 0;
+    uint32_t i;
+
+    for(i = 0; i < shard->count; i++)
+    {
+        const RSSI_RANGER_REPORT_T *report = &shard->reports[i];
+        uint64_t link = ((uint64_t)report->beacon << 32) | report->receiver;
+        float loss = (float)(report->tx_power - report->rssi);
+        RSSI_RANGER_LINK_T *entry = findLink(shard, link, hashLink(link));
+
+        if(entry == NULL)
+        {
+            continue;
+        }
+
+        if(entry->samples == 0 ||
+           report->time_us > entry->time_us + params->reset_us)
+        {
+            entry->path_loss = loss;
+            entry->variance = params->sample_var;
+            entry->samples = 0;
+        }
+        else
+        {
+            float gain;
+
+            /* a report out of order is taken as simultaneous */
+            if(report->time_us > entry->time_us)
+            {
+                entry->variance += params->drift_var *
+                                   (float)(report->time_us - entry->time_us) *
+                                   RANGER_SECONDS_PER_US;
+            }
+            gain = entry->variance / (entry->variance + params->sample_var);
+            entry->path_loss += gain * (loss - entry->path_loss);
+            entry->variance *= 1.0f - gain;
+        }
+
+        if(report->time_us > entry->time_us)
+        {
+            entry->time_us = report->time_us;
+        }
+        entry->samples++;
+
+        fillEstimate(ranger, entry, &shard->estimates[emitted++]);
+    }
+
+    shard->emitted = emitted;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      shardWorker
+ *
+ *  DESCRIPTION
+ *      Updates one shard for every batch handed out, until the ranger
+ *      stops.
+ *
+ *  RETURNS
+ *      NULL.
+ *
+ *---------------------------------------------------------------------------*/
+static void *shardWorker(void *context)
+{
+    RSSI_RANGER_SHARD_T *shard = (RSSI_RANGER_SHARD_T *)context;
+    RSSI_RANGER_T *ranger = shard->ranger;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&ranger->lock);
+    for(;;)
+    {
+        while(ranger->generation == seen && !ranger->stopping)
+        {
+            pthread_cond_wait(&ranger->start, &ranger->lock);
+        }
+        if(ranger->stopping)
+        {
+            break;
+        }
+        seen = ranger->generation;
+        pthread_mutex_unlock(&ranger->lock);
+
+        updateShard(shard);
+
+        pthread_mutex_lock(&ranger->lock);
+        if(--ranger->busy == 0)
+        {
+            pthread_cond_signal(&ranger->done);
+        }
+    }
+    pthread_mutex_unlock(&ranger->lock);
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      reserve
+ *
+ *  DESCRIPTION
+ *      Makes room for a batch of the given size.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+static int reserve(RSSI_RANGER_T *ranger, uint32_t count)
+{
+    RSSI_RANGER_REPORT_T *sorted;
+    RSSI_RANGER_ESTIMATE_T *estimates;
+
+    if(count <= ranger->capacity)
+    {
+        return 0;
+    }
+
+    sorted = realloc(ranger->sorted, (size_t)count * sizeof(*sorted));
+    if(sorted == NULL)
+    {
+        return -1;
+    }
+    ranger->sorted = sorted;
+
+    estimates = realloc(ranger->estimates,
+                        (size_t)count * sizeof(*estimates));
+    if(estimates == NULL)
+    {
+        return -1;
+    }
+    ranger->estimates = estimates;
+    ranger->capacity = count;
+
+    return 0;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerDefaults
+ *
+ *  DESCRIPTION
+ *      Fills in the default model and filter.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RssiRangerDefaults(RSSI_RANGER_PARAMS_T *params)
+{
+    params->exponent = RSSI_RANGER_DEFAULT_EXPONENT;
+    params->sample_var = RSSI_RANGER_DEFAULT_SAMPLE_VAR;
+    params->drift_var = RSSI_RANGER_DEFAULT_DRIFT_VAR;
+    params->reset_us = RSSI_RANGER_DEFAULT_RESET_US;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerInit
+ *
+ *  DESCRIPTION
+ *      Starts an empty ranger. A worker thread that cannot be started takes
+ *      its shard with it, so the ranger may run fewer threads than asked.
+ *
+ *  RETURNS
+ *      0 on success.
+ *
+ *---------------------------------------------------------------------------*/
+int RssiRangerInit(RSSI_RANGER_T *ranger, const RSSI_RANGER_PARAMS_T *params,
+                   uint32_t threads, uint32_t expected_links)
+{
+    uint32_t size = RANGER_MIN_TABLE_SIZE;
+    uint32_t i;
+
+    memset(ranger, 0, sizeof(*ranger));
+    ranger->params = *params;
+    ranger->loss_to_ln_m = logf(10.0f) / (10.0f * params->exponent);
+
+    if(threads == 0)
+    {
+        threads = 1;
+    }
+    if(threads > RSSI_RANGER_MAX_SHARDS)
+    {
+        threads = RSSI_RANGER_MAX_SHARDS;
+    }
+
+    /* half full with the expected links */
+    while(size < RANGER_MAX_TABLE_SIZE &&
+          size / 2 < expected_links / threads + 1)
+    {
+        size *= 2;
+    }
+
+    for(i = 0; i < threads; i++)
+    {
+        RSSI_RANGER_SHARD_T *shard = &ranger->shards[i];
+
+        shard->ranger = ranger;
+        shard->table = allocTable(size);
+        if(shard->table == NULL)
+        {
+            break;
+        }
+        shard->table_mask = size - 1;
+        ranger->shard_count++;
+    }
+    if(ranger->shard_count == 0)
+    {
+        return -1;
+    }
+
+    pthread_mutex_init(&ranger->lock, NULL);
+    pthread_cond_init(&ranger->start, NULL);
+    pthread_cond_init(&ranger->done, NULL);
+
+    for(i = 1; i < ranger->shard_count; i++)
+    {
+        if(pthread_create(&ranger->threads[ranger->thread_count], NULL,
+                          shardWorker, &ranger->shards[i]) != 0)
+        {
+            break;
+        }
+        ranger->thread_count++;
+    }
+
+    /* shards without a thread are given up before they hold any links */
+    while(ranger->shard_count > ranger->thread_count + 1)
+    {
+        free(ranger->shards[--ranger->shard_count].table);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerFree
+ *
+ *  DESCRIPTION
+ *      Stops the worker threads and releases a ranger.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RssiRangerFree(RSSI_RANGER_T *ranger)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&ranger->lock);
+    ranger->stopping = 1;
+    pthread_cond_broadcast(&ranger->start);
+    pthread_mutex_unlock(&ranger->lock);
+
+    for(i = 0; i < ranger->thread_count; i++)
+    {
+        pthread_join(ranger->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&ranger->done);
+    pthread_cond_destroy(&ranger->start);
+    pthread_mutex_destroy(&ranger->lock);
+
+    for(i = 0; i < ranger->shard_count; i++)
+    {
+        free(ranger->shards[i].table);
+    }
+    free(ranger->sorted);
+    free(ranger->estimates);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerIngest
+ *
+ *  DESCRIPTION
+ *      Sorts a batch by shard, stably, updates every shard at once and
+ *      hands the estimates over shard by shard. With one shard the batch
+ *      is taken as it is.
+ *
+ *  RETURNS
+ *      0, or -1 if reports were dropped.
+ *
+ *---------------------------------------------------------------------------*/
+int RssiRangerIngest(RSSI_RANGER_T *ranger,
+                     const RSSI_RANGER_REPORT_T *reports, uint32_t count,
+                     rssi_ranger_handler handler, void *context)
+{
+    uint32_t offsets[RSSI_RANGER_MAX_SHARDS];
+    uint32_t emitted = 0;
+    uint32_t i;
+
+    if(reserve(ranger, count) != 0)
+    {
+        ranger->dropped += count;
+        return -1;
+    }
+
+    if(ranger->shard_count == 1)
+    {
+        ranger->shards[0].reports = reports;
+        ranger->shards[0].count = count;
+        ranger->shards[0].estimates = ranger->estimates;
+    }
+    else
+    {
+        memset(offsets, 0, sizeof(offsets));
+        for(i = 0; i < count; i++)
+        {
+            uint64_t link = ((uint64_t)reports[i].beacon << 32) |
+                            reports[i].receiver;
+
+            ranger->shards[shardOf(ranger, hashLink(link))].count++;
+        }
+
+        for(i = 0; i < ranger->shard_count; i++)
+        {
+            RSSI_RANGER_SHARD_T *shard = &ranger->shards[i];
+
+            offsets[i] = i == 0 ? 0 : offsets[i - 1] +
+                                      ranger->shards[i - 1].count;
+            shard->reports = &ranger->sorted[offsets[i]];
+            shard->estimates = &ranger->estimates[offsets[i]];
+        }
+
+        for(i = 0; i < count; i++)
+        {
+            uint64_t link = ((uint64_t)reports[i].beacon << 32) |
+                            reports[i].receiver;
+
+            ranger->sorted[offsets[shardOf(ranger, hashLink(link))]++] =
+                reports[i];
+        }
+
+        pthread_mutex_lock(&ranger->lock);
+        ranger->busy = ranger->thread_count;
+        ranger->generation++;
+        pthread_cond_broadcast(&ranger->start);
+        pthread_mutex_unlock(&ranger->lock);
+    }
+
+    updateShard(&ranger->shards[0]);
+
+    if(ranger->shard_count > 1)
+    {
+        pthread_mutex_lock(&ranger->lock);
+        while(ranger->busy != 0)
+        {
+            pthread_cond_wait(&ranger->done, &ranger->lock);
+        }
+        pthread_mutex_unlock(&ranger->lock);
+    }
+
+    for(i = 0; i < ranger->shard_count; i++)
+    {
+        RSSI_RANGER_SHARD_T *shard = &ranger->shards[i];
+
+        if(handler != NULL && shard->emitted != 0)
+        {
+            handler(shard->estimates, shard->emitted, context);
+        }
+        emitted += shard->emitted;
+        shard->count = 0;
+    }
+
+    ranger->updates += emitted;
+    ranger->dropped += count - emitted;
+
+    return emitted == count ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerLookup
+ *
+ *  DESCRIPTION
+ *      Finds the latest estimate of a link.
+ *
+ *  RETURNS
+ *      0 if the link is known.
+ *
+ *---------------------------------------------------------------------------*/
+int RssiRangerLookup(const RSSI_RANGER_T *ranger, uint32_t beacon,
+                     uint32_t receiver, RSSI_RANGER_ESTIMATE_T *estimate)
+{
+    uint64_t link = ((uint64_t)beacon << 32) | receiver;
+    uint64_t hash = hashLink(link);
+    const RSSI_RANGER_SHARD_T *shard = &ranger->shards[shardOf(ranger, hash)];
+    uint32_t slot;
+
+    for(slot = (uint32_t)hash & shard->table_mask;
+        shard->table[slot].link != RSSI_RANGER_NO_LINK;
+        slot = (slot + 1) & shard->table_mask)
+    {
+        if(shard->table[slot].link == link)
+        {
+            fillEstimate(ranger, &shard->table[slot], estimate);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerExpire
+ *
+ *  DESCRIPTION
+ *      Forgets links last heard before a given time. Each shard with any
+ *      to forget is rebuilt at the same size, leaving no tombstones; one
+ *      that cannot be keeps its links.
+ *
+ *  RETURNS
+ *      The number of links forgotten.
+ *
+ *---------------------------------------------------------------------------*/
+uint32_t RssiRangerExpire(RSSI_RANGER_T *ranger, uint64_t before_us)
+{
+    uint32_t expired = 0;
+    uint32_t i;
+
+    for(i = 0; i < ranger->shard_count; i++)
+    {
+        RSSI_RANGER_SHARD_T *shard = &ranger->shards[i];
+        uint32_t links = shard->links;
+        uint32_t stale = 0;
+        uint32_t slot;
+
+        for(slot = 0; slot <= shard->table_mask; slot++)
+        {
+            if(shard->table[slot].link != RSSI_RANGER_NO_LINK &&
+               shard->table[slot].time_us < before_us)
+            {
+                stale++;
+            }
+        }
+
+        if(stale != 0 &&
+           rebuild(shard, shard->table_mask + 1, before_us) == 0)
+        {
+            expired += links - shard->links;
+        }
+    }
+
+    return expired;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RssiRangerSnapshot
+ *
+ *  DESCRIPTION
+ *      Hands the latest estimate of every link to a handler.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+void RssiRangerSnapshot(const RSSI_RANGER_T *ranger,
+                        rssi_ranger_handler handler, void *context)
+{
+    RSSI_RANGER_ESTIMATE_T batch[RANGER_SNAPSHOT_BATCH];
+    uint32_t count = 0;
+    uint32_t i;
+
+    for(i = 0; i < ranger->shard_count; i++)
+    {
+        const RSSI_RANGER_SHARD_T *shard = &ranger->shards[i];
+        uint32_t slot;
+
+        for(slot = 0; slot <= shard->table_mask; slot++)
+        {
+            if(shard->table[slot].link == RSSI_RANGER_NO_LINK)
+            {
+                continue;
+            }
+
+            fillEstimate(ranger, &shard->table[slot], &batch[count++]);
+            if(count == RANGER_SNAPSHOT_BATCH)
+            {
+                handler(batch, count, context);
+                count = 0;
+            }
+        }
+    }
+
+    if(count != 0)
+    {
+        handler(batch, count, context);
+    }
+}
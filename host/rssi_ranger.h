@@ -0,0 +1,202 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      rssi_ranger.h
+ *
+ *  DESCRIPTION
+ *      Streaming range estimates for every pair of beacon and receiver,
+ *      from the RSSI of the beacon's frames and the TX power, the RSSI at
+ *      1 m, they carry.
+ *
+ *      Each report gives a path loss, TX power less RSSI, so a change of
+ *      battery ladder tier, which moves the two together, does not upset
+ *      the estimate. The path loss of each link is smoothed by a scalar
+ *      Kalman filter, a random walk seen through noisy samples, and turned
+ *      into a distance by the log-distance model.
+ *
+ *      Links live in open-addressed tables of 32-octet entries, two to a
+ *      cache line, split into one shard per thread by the hash of the link.
+ *      A batch of reports is sorted by shard, keeping the order of each
+ *      link's reports, and the shards are updated at once, each by its own
+ *      thread without locks. The estimates come back in that order.
+ *
+ *****************************************************************************/
+
+#ifndef __RSSI_RANGER_H__
+#define __RSSI_RANGER_H__
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Most shards, and so threads, a ranger runs */
+#define RSSI_RANGER_MAX_SHARDS          (64)
+
+/* Model and filter defaults: path loss exponent, variance of one RSSI
+ * sample in dB^2, how far the path loss may wander in dB^2 per second,
+ * and the silence after which a link starts again
+ */
+#define RSSI_RANGER_DEFAULT_EXPONENT    (2.5f)
+#define RSSI_RANGER_DEFAULT_SAMPLE_VAR  (16.0f)
+#define RSSI_RANGER_DEFAULT_DRIFT_VAR   (1.0f)
+#define RSSI_RANGER_DEFAULT_RESET_US    (30000000ULL)
+
+/* Link of a free table entry; beacon and receiver may not both be
+ * UINT32_MAX
+ */
+#define RSSI_RANGER_NO_LINK             (UINT64_MAX)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    float exponent;
+    float sample_var;
+    float drift_var;
+    uint64_t reset_us;
+} RSSI_RANGER_PARAMS_T;
+
+/* Sighting of a beacon by a receiver. A beacon is whatever number the
+ * caller gives it, such as its major and minor; TX power is the RSSI at
+ * 1 m the frame carries.
+ */
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t beacon;
+    uint32_t receiver;
+    int8_t rssi;
+    int8_t tx_power;
+} RSSI_RANGER_REPORT_T;
+
+/* Smoothed state of a link after a report. error_m is one standard
+ * deviation of the distance from the filter's variance alone, not from
+ * the model.
+ */
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t beacon;
+    uint32_t receiver;
+    float path_loss;
+    float distance_m;
+    float error_m;
+    uint32_t samples;
+} RSSI_RANGER_ESTIMATE_T;
+
+typedef void (*rssi_ranger_handler)(const RSSI_RANGER_ESTIMATE_T *estimates,
+                                    uint32_t count, void *context);
+
+/* Table entry */
+typedef struct
+{
+    uint64_t link;
+    uint64_t time_us;
+    float path_loss;
+    float variance;
+    uint32_t samples;
+    uint32_t reserved;
+} RSSI_RANGER_LINK_T;
+
+/* Links of one shard; open addressing with linear probing, kept at most
+ * half full
+ */
+typedef struct
+{
+    struct RSSI_RANGER *ranger;
+
+    RSSI_RANGER_LINK_T *table;
+    uint32_t table_mask;
+    uint32_t links;
+
+    /* Reports of the batch in hand, and the estimates made from them;
+     * reports of new links are dropped if the table cannot grow
+     */
+    const RSSI_RANGER_REPORT_T *reports;
+    uint32_t count;
+    RSSI_RANGER_ESTIMATE_T *estimates;
+    uint32_t emitted;
+} RSSI_RANGER_SHARD_T;
+
+typedef struct RSSI_RANGER
+{
+    RSSI_RANGER_PARAMS_T params;
+
+    /* ln(10) / (10 * exponent), taking path loss to the log of distance */
+    float loss_to_ln_m;
+
+    RSSI_RANGER_SHARD_T shards[RSSI_RANGER_MAX_SHARDS];
+    uint32_t shard_count;
+
+    /* Batch sorted by shard, and its estimates */
+    RSSI_RANGER_REPORT_T *sorted;
+    RSSI_RANGER_ESTIMATE_T *estimates;
+    uint32_t capacity;
+
+    /* Worker threads, one for each shard after the first, which the
+     * calling thread updates; generation counts the batches handed out
+     */
+    pthread_t threads[RSSI_RANGER_MAX_SHARDS];
+    uint32_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    uint32_t busy;
+    int stopping;
+
+    /* Totals: reports taken, and reports dropped for want of memory */
+    uint64_t updates;
+    uint64_t dropped;
+} RSSI_RANGER_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Fill in the default model and filter */
+extern void RssiRangerDefaults(RSSI_RANGER_PARAMS_T *params);
+
+/* Start an empty ranger with the given number of threads, sized for the
+ * expected number of links; returns 0 on success
+ */
+extern int RssiRangerInit(RSSI_RANGER_T *ranger,
+                          const RSSI_RANGER_PARAMS_T *params,
+                          uint32_t threads, uint32_t expected_links);
+
+/* Stop the threads and release a ranger */
+extern void RssiRangerFree(RSSI_RANGER_T *ranger);
+
+/* Take a batch of reports, each link's in time order, and hand the
+ * estimate after each to handler, if not NULL, in one or more calls
+ * before returning. Returns 0, or -1 if reports had to be dropped for
+ * want of memory.
+ */
+extern int RssiRangerIngest(RSSI_RANGER_T *ranger,
+                            const RSSI_RANGER_REPORT_T *reports,
+                            uint32_t count, rssi_ranger_handler handler,
+                            void *context);
+
+/* Latest estimate of a link; returns 0 if the link is known */
+extern int RssiRangerLookup(const RSSI_RANGER_T *ranger, uint32_t beacon,
+                            uint32_t receiver,
+                            RSSI_RANGER_ESTIMATE_T *estimate);
+
+/* Forget links last heard before the given time; returns how many */
+extern uint32_t RssiRangerExpire(RSSI_RANGER_T *ranger, uint64_t before_us);
+
+/* Hand the latest estimate of every link to handler, in batches */
+extern void RssiRangerSnapshot(const RSSI_RANGER_T *ranger,
+                               rssi_ranger_handler handler, void *context);
+
+#endif /* __RSSI_RANGER_H__ */
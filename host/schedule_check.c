@@ -0,0 +1,163 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      schedule_check.c
+ *
+ *  DESCRIPTION
+ *      Check of the advertising schedule, beacon_schedule.c, with windows
+ *      that meet and overlap.
+ *
+ *      schedule_check
+ *          runs the application under the stand-in from power-up at 8:30
+ *          to 8:30 the next day, with the windows 8:00-9:00, 9:00-12:00
+ *          and 11:00-18:00, and checks every stretch of the day between
+ *          the transitions: the beacon must keep advertising across the
+ *          close at 9:00, where the next window opens, and the one at
+ *          12:00, inside the next window; it must hibernate once, at
+ *          18:00, send nothing overnight and advertise again from 8:00.
+ *
+ *          The exit status is 1 if any stretch is not as expected.
+ *
+ *      The schedule source is built into this file, in place of the
+ *      application's object, so that it takes the windows above instead
+ *      of BEACON_SCHEDULE_WINDOWS.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+#include "user_config.h"
+
+/*============================================================================*
+ *  Schedule Under Check
+ *============================================================================*/
+
+#undef BEACON_SCHEDULE_WINDOWS
+#define BEACON_SCHEDULE_WINDOWS { { 8 * 60, 9 * 60 },                      \
+                                  { 9 * 60, 12 * 60 },                     \
+                                  { 11 * 60, 18 * 60 } }
+
+#include "beacon_schedule.c"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Time of day at power-up, in minutes, and user key 5 giving it */
+#define CHECK_POWER_UP                  (8 * 60 + 30)
+#define CHECK_CLOCK_USER_KEY_IDX        (5)
+#define CHECK_CLOCK_KEY                 (CHECK_POWER_UP + 1)
+
+/* Minutes left either side of a transition, for the timers to settle */
+#define CHECK_MARGIN                    (1)
+
+#define US_PER_MINUTE                   (60ULL * 1000000ULL)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* A stretch of the day, in minutes since midnight of the first day, and
+ * what the beacon must do in it
+ */
+typedef struct
+{
+    uint32_t from;
+    uint32_t to;
+    int advertising;
+    uint32_t hibernations;
+} CHECK_STRETCH_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const CHECK_STRETCH_T g_stretches[] =
+{
+    { 8 * 60 + 30,              9 * 60 - CHECK_MARGIN,  1, 0 },
+    { 9 * 60 - CHECK_MARGIN,    9 * 60 + CHECK_MARGIN,  1, 0 },
+    { 9 * 60 + CHECK_MARGIN,    12 * 60 - CHECK_MARGIN, 1, 0 },
+    { 12 * 60 - CHECK_MARGIN,   12 * 60 + CHECK_MARGIN, 1, 0 },
+    { 12 * 60 + CHECK_MARGIN,   18 * 60 - CHECK_MARGIN, 1, 0 },
+    { 18 * 60 - CHECK_MARGIN,   18 * 60 + CHECK_MARGIN, 1, 1 },
+    { 18 * 60 + CHECK_MARGIN,   32 * 60 - CHECK_MARGIN, 0, 0 },
+    { 32 * 60 + CHECK_MARGIN,   32 * 60 + 30,           1, 0 }
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      runStretch
+ *
+ *  DESCRIPTION
+ *      Runs the application to the end of a stretch, from its start, and
+ *      checks the advertising events and hibernations in it.
+ *
+ *  RETURNS
+ *      1 if the stretch is not as expected, else 0.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t runStretch(const CHECK_STRETCH_T *stretch)
+{
+    const HARNESS_STATS_T *stats = HarnessStats();
+    uint32_t adv_events = stats->adv_events;
+    uint32_t hibernations = stats->hibernations;
+    int ok;
+
+    HarnessRun((stretch->to - stretch->from) * US_PER_MINUTE);
+
+    adv_events = stats->adv_events - adv_events;
+    hibernations = stats->hibernations - hibernations;
+    ok = (adv_events != 0) == stretch->advertising &&
+         hibernations == stretch->hibernations;
+
+    printf("%02u:%02u-%02u:%02u  advertising events %6u, hibernations %u"
+           "%s\n", stretch->from / 60 % 24, stretch->from % 60,
+           stretch->to / 60 % 24, stretch->to % 60, adv_events,
+           hibernations, ok ? "" : "  FAILED");
+
+    return !ok;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32_t failures = 0;
+    uint32_t i;
+
+    if(argc != 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    HarnessReset(1);
+    HarnessSetUserKey(CHECK_CLOCK_USER_KEY_IDX, CHECK_CLOCK_KEY);
+    HarnessBoot();
+
+    for(i = 0; i < sizeof(g_stretches) / sizeof(g_stretches[0]); i++)
+    {
+        failures += runStretch(&g_stretches[i]);
+    }
+
+    printf("stretches not as expected           : %u\n", failures);
+
+    return failures != 0;
+}
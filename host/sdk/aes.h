@@ -0,0 +1,34 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      aes.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK access to the AES hardware
+ *
+ *****************************************************************************/
+
+#ifndef __AES_H__
+#define __AES_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Key and block size in words */
+#define AES_BLOCK_WORDS                 (8)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Encrypt one block with AES-128. Key and blocks are big endian: the first
+ * word holds the first two octets, the first in its MSB. in and out may be
+ * the same.
+ */
+extern void AesEncrypt(const uint16 *key, const uint16 *in, uint16 *out);
+
+#endif /* __AES_H__ */
@@ -0,0 +1,24 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      battery.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK battery monitor
+ *
+ *****************************************************************************/
+
+#ifndef __BATTERY_H__
+#define __BATTERY_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Battery voltage in millivolts, measured with the ADC */
+extern uint16 BatteryReadVoltage(void);
+
+#endif /* __BATTERY_H__ */
@@ -0,0 +1,34 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      bluetooth.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK Bluetooth address types
+ *
+ *****************************************************************************/
+
+#ifndef __BLUETOOTH_H__
+#define __BLUETOOTH_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    uint24 lap;
+    uint8  uap;
+    uint16 nap;
+} BD_ADDR_T;
+
+typedef struct
+{
+    uint16    type;
+    BD_ADDR_T addr;
+} TYPED_BD_ADDR_T;
+
+#endif /* __BLUETOOTH_H__ */
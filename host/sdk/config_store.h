@@ -0,0 +1,24 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      config_store.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK CS key access
+ *
+ *****************************************************************************/
+
+#ifndef __CONFIG_STORE_H__
+#define __CONFIG_STORE_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Read one of the eight words of &USER_KEYS */
+extern uint16 CSReadUserKey(uint16 index);
+
+#endif /* __CONFIG_STORE_H__ */
@@ -0,0 +1,37 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      debug.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK UART debug output. Writes are
+ *      blocking on the real part and are charged as such by the stand-in.
+ *
+ *****************************************************************************/
+
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef uint16 (*debug_rx_callback)(void *data, uint16 len, uint16 *req);
+typedef void (*debug_tx_callback)(void);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+extern void DebugInit(uint16 rx_threshold, debug_rx_callback rx_cb,
+                      debug_tx_callback tx_cb);
+extern void DebugWriteChar(char c);
+extern void DebugWriteString(const char *string);
+extern void DebugWriteUint8(uint8 val);
+extern void DebugWriteUint16(uint16 val);
+extern void DebugWriteUint32(uint32 val);
+
+#endif /* __DEBUG_H__ */
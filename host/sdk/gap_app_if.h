@@ -0,0 +1,89 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      gap_app_if.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK GAP interface
+ *
+ *****************************************************************************/
+
+#ifndef __GAP_APP_IF_H__
+#define __GAP_APP_IF_H__
+
+#include <types.h>
+#include <ls_app_if.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Advertising channels, for GapSetAdvChanMask() */
+#define GAP_ADV_CHANNEL_37              (0x01)
+#define GAP_ADV_CHANNEL_38              (0x02)
+#define GAP_ADV_CHANNEL_39              (0x04)
+#define GAP_ADV_CHANNELS_ALL            (0x07)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef enum
+{
+    gap_role_broadcaster,
+    gap_role_observer,
+    gap_role_peripheral,
+    gap_role_central
+} gap_role;
+
+typedef enum
+{
+    gap_mode_discover_no,
+    gap_mode_discover_limited,
+    gap_mode_discover_general
+} gap_mode_discover;
+
+typedef enum
+{
+    gap_mode_connect_no,
+    gap_mode_connect_directed,
+    gap_mode_connect_undirected
+} gap_mode_connect;
+
+typedef enum
+{
+    gap_mode_bond_no,
+    gap_mode_bond_yes
+} gap_mode_bond;
+
+typedef enum
+{
+    gap_mode_security_none,
+    gap_mode_security_unauthenticate,
+    gap_mode_security_authenticated
+} gap_mode_security;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+extern ls_err GapSetMode(gap_role role, gap_mode_discover discover,
+                         gap_mode_connect connect, gap_mode_bond bond,
+                         gap_mode_security security);
+
+/* Advertising interval in microseconds */
+extern ls_err GapSetAdvInterval(uint32 adv_interval_min,
+                                uint32 adv_interval_max);
+
+/* Advertising channels to use, GAP_ADV_CHANNEL_* bits. The mask holds
+ * until it is set again, whatever the mode, interval or data.
+ */
+extern ls_err GapSetAdvChanMask(uint8 channel_mask);
+
+/* Scan interval and scan window in microseconds: the controller listens
+ * for scan_window out of every scan_interval while scanning
+ */
+extern ls_err GapSetScanInterval(uint32 scan_interval, uint32 scan_window);
+
+#endif /* __GAP_APP_IF_H__ */
@@ -0,0 +1,51 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      gatt.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK GATT interface
+ *
+ *****************************************************************************/
+
+#ifndef __GATT_H__
+#define __GATT_H__
+
+#include <types.h>
+#include <status.h>
+#include <bluetooth.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* GattConnectReq() flags: advertise connectable to any central */
+#define L2CAP_CONNECTION_SLAVE_UNDIRECTED   (0x1000)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Initialise the GATT entity */
+extern void GattInit(void);
+
+/* Register the database built by gattdbgen, confirmed by GATT_ADD_DB_CFM */
+extern void GattAddDatabaseReq(uint16 db_length, uint16 *db);
+
+/* Advertise connectable in the mode set by GapSetMode(); the connection is
+ * confirmed by GATT_CONNECT_CFM. A NULL address accepts any central.
+ */
+extern void GattConnectReq(TYPED_BD_ADDR_T *address, uint16 flags);
+
+/* Stop connectable advertising, confirmed by GATT_CANCEL_CONNECT_CFM */
+extern void GattCancelConnectReq(void);
+
+/* Drop a connection, confirmed by LM_EV_DISCONNECT_COMPLETE */
+extern void GattDisconnectReq(uint16 cid);
+
+/* Answer a GATT_ACCESS_IND */
+extern void GattAccessRsp(uint16 cid, uint16 handle, sys_status rc,
+                          uint16 size_value, uint8 *value);
+
+#endif /* __GATT_H__ */
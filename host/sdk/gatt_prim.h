@@ -0,0 +1,74 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      gatt_prim.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK GATT primitives
+ *
+ *****************************************************************************/
+
+#ifndef __GATT_PRIM_H__
+#define __GATT_PRIM_H__
+
+#include <types.h>
+#include <status.h>
+#include <bluetooth.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* GATT events delivered to AppProcessLmEvent() */
+#define GATT_ADD_DB_CFM                 (0x0501)
+#define GATT_ACCESS_IND                 (0x0502)
+#define GATT_CONNECT_CFM                (0x0503)
+#define GATT_CANCEL_CONNECT_CFM         (0x0504)
+
+/* Access flags of GATT_ACCESS_IND */
+#define ATT_ACCESS_READ                 (0x0001)
+#define ATT_ACCESS_WRITE                (0x0002)
+#define ATT_ACCESS_PERMISSION           (0x8000)
+#define ATT_ACCESS_WRITE_COMPLETE       (0x4000)
+
+/* ATT error codes returned with GattAccessRsp() */
+#define gatt_status_invalid_handle      ((sys_status)0x7f01)
+#define gatt_status_read_not_permitted  ((sys_status)0x7f02)
+#define gatt_status_write_not_permitted ((sys_status)0x7f03)
+#define gatt_status_insufficient_authentication ((sys_status)0x7f05)
+#define gatt_status_invalid_offset      ((sys_status)0x7f07)
+#define gatt_status_invalid_length      ((sys_status)0x7f0d)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    sys_status result;
+} GATT_ADD_DB_CFM_T;
+
+typedef struct
+{
+    sys_status result;
+    uint16 cid;
+    TYPED_BD_ADDR_T bd_addr;
+} GATT_CONNECT_CFM_T;
+
+typedef struct
+{
+    sys_status result;
+} GATT_CANCEL_CONNECT_CFM_T;
+
+typedef struct
+{
+    uint16 cid;
+    uint16 handle;
+    uint16 flags;
+    uint16 offset;
+    uint16 size_value;
+    uint8 *value;
+} GATT_ACCESS_IND_T;
+
+#endif /* __GATT_PRIM_H__ */
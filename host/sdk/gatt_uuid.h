@@ -0,0 +1,17 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      gatt_uuid.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK GATT UUID definitions
+ *
+ *****************************************************************************/
+
+#ifndef __GATT_UUID_H__
+#define __GATT_UUID_H__
+
+#include <types.h>
+
+#endif /* __GATT_UUID_H__ */
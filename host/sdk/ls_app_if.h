@@ -0,0 +1,106 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      ls_app_if.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK link supervisor interface
+ *
+ *****************************************************************************/
+
+#ifndef __LS_APP_IF_H__
+#define __LS_APP_IF_H__
+
+#include <types.h>
+#include <bluetooth.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* AD types */
+#define AD_TYPE_FLAGS                   (0x01)
+#define AD_TYPE_SERVICE_UUID_16BIT_LIST (0x03)
+#define AD_TYPE_LOCAL_NAME_SHORT        (0x08)
+#define AD_TYPE_LOCAL_NAME_COMPLETE     (0x09)
+#define AD_TYPE_TX_POWER                (0x0A)
+#define AD_TYPE_SERVICE_DATA_UUID_16BIT (0x16)
+#define AD_TYPE_MANUF                   (0xFF)
+
+/* Maximum length of the advertising or scan response data */
+#define MAX_ADV_DATA_LEN                (31)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef enum
+{
+    ls_err_none = 0,
+    ls_err_arg,
+    ls_err_state
+} ls_err;
+
+typedef enum
+{
+    ad_src_advertise,
+    ad_src_scan_rsp
+} ad_src;
+
+typedef enum
+{
+    whitelist_disabled,
+    whitelist_enabled
+} whitelist_mode;
+
+typedef enum
+{
+    ls_addr_type_public,
+    ls_addr_type_random
+} ls_addr_type;
+
+/* Connection parameters: intervals in 1.25 ms units, latency in connection
+ * events and supervision timeout in 10 ms units
+ */
+typedef struct
+{
+    uint16 con_min_interval;
+    uint16 con_max_interval;
+    uint16 con_slave_latency;
+    uint16 con_super_timeout;
+} ble_con_params;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Append an AD structure to the advertising or scan response data. A zero
+ * length clears the data. Non-connectable advertising is scannable while
+ * there is scan response data.
+ */
+extern ls_err LsStoreAdvScanData(uint8 len, uint8 *data, ad_src src);
+
+/* Set the radio transmit power, in the 0 to 7 steps of &TX_POWER_LEVEL */
+extern ls_err LsSetTransmitPowerLevel(uint8 power_level);
+
+/* Start or stop advertising */
+extern ls_err LsStartStopAdvertise(bool start, whitelist_mode white_list,
+                                   ls_addr_type addr_type);
+
+/* Start or stop passive scanning. The controller scans in the gaps
+ * between advertising events, so a broadcaster can scan while it
+ * advertises. Every advertising PDU heard is reported as
+ * LM_EV_ADVERTISING_REPORT.
+ */
+extern ls_err LsStartStopScan(bool start, whitelist_mode white_list,
+                              ls_addr_type addr_type);
+
+/* Ask the central for new connection parameters. The answer comes as
+ * LS_CONNECTION_PARAM_UPDATE_CFM and, if the central takes them up, the
+ * new parameters as LM_EV_CONNECTION_UPDATE.
+ */
+extern ls_err LsConnectionParamUpdateReq(TYPED_BD_ADDR_T *p_bd_addr,
+                                         ble_con_params *new_params);
+
+#endif /* __LS_APP_IF_H__ */
@@ -0,0 +1,135 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      main.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK application entry points
+ *
+ *****************************************************************************/
+
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#include <types.h>
+#include <timer.h>
+#include <gatt_prim.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* State the chip was in before AppInit() was called */
+typedef enum
+{
+    sleep_state_cold_powerup,
+    sleep_state_warm_powerup,
+    sleep_state_dormant,
+    sleep_state_hibernate
+} sleep_state;
+
+/* System events delivered to AppProcessSystemEvent() */
+typedef enum
+{
+    sys_event_wakeup,
+    sys_event_battery_low,
+    sys_event_pio_changed,
+    sys_event_pio_ctrlr
+} sys_event_id;
+
+/* LM events delivered to AppProcessLmEvent() */
+typedef uint16 lm_event_code;
+
+#define LM_EV_DISCONNECT_COMPLETE       ((lm_event_code)0x0005)
+#define LM_EV_CONNECTION_UPDATE         ((lm_event_code)0x0012)
+#define LM_EV_ADVERTISING_REPORT        ((lm_event_code)0x0013)
+#define LS_CONNECTION_PARAM_UPDATE_CFM  ((lm_event_code)0x0601)
+
+typedef struct
+{
+    uint16 handle;
+    uint16 reason;
+} HCI_EV_DATA_DISCONNECT_COMPLETE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_DISCONNECT_COMPLETE_T data;
+} LM_EV_DISCONNECT_COMPLETE_T;
+
+/* Parameters in force after a connection update: interval in 1.25 ms
+ * units, latency in connection events, supervision timeout in 10 ms units
+ */
+typedef struct
+{
+    uint16 status;
+    uint16 handle;
+    uint16 conn_interval;
+    uint16 conn_latency;
+    uint16 supervision_timeout;
+} HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T;
+
+typedef struct
+{
+    HCI_EV_DATA_ULP_CONNECTION_UPDATE_COMPLETE_T data;
+} LM_EV_CONNECTION_UPDATE_T;
+
+/* Advertising PDU types of an advertising report */
+#define HCI_EV_ADV_TYPE_ADV_IND         (0x00)
+#define HCI_EV_ADV_TYPE_ADV_DIRECT_IND  (0x01)
+#define HCI_EV_ADV_TYPE_ADV_SCAN_IND    (0x02)
+#define HCI_EV_ADV_TYPE_ADV_NONCONN_IND (0x03)
+#define HCI_EV_ADV_TYPE_SCAN_RSP        (0x04)
+
+/* Largest advertising data of a report */
+#define HCI_EV_ADV_DATA_MAX             (31)
+
+/* An advertising PDU heard while scanning: its type, the advertiser's
+ * address and the AD structures it carried
+ */
+typedef struct
+{
+    uint16 event_type;
+    TYPED_BD_ADDR_T address;
+    uint16 length_data;
+    uint8 data[HCI_EV_ADV_DATA_MAX];
+} HCI_EV_DATA_ADVERTISING_REPORT_T;
+
+/* A report with the signal strength it was heard at, in dBm */
+typedef struct
+{
+    HCI_EV_DATA_ADVERTISING_REPORT_T data;
+    int8 rssi;
+} LM_EV_ADVERTISING_REPORT_T;
+
+/* Answer to LsConnectionParamUpdateReq() */
+typedef struct
+{
+    TYPED_BD_ADDR_T address;
+    sys_status status;
+} LS_CONNECTION_PARAM_UPDATE_CFM_T;
+
+typedef union
+{
+    LM_EV_DISCONNECT_COMPLETE_T lm_ev_disconnect_complete;
+    LM_EV_CONNECTION_UPDATE_T lm_ev_connection_update;
+    LM_EV_ADVERTISING_REPORT_T lm_ev_advertising_report;
+    LS_CONNECTION_PARAM_UPDATE_CFM_T ls_connection_param_update_cfm;
+    GATT_ADD_DB_CFM_T gatt_add_db_cfm;
+    GATT_ACCESS_IND_T gatt_access_ind;
+    GATT_CONNECT_CFM_T gatt_connect_cfm;
+    GATT_CANCEL_CONNECT_CFM_T gatt_cancel_connect_cfm;
+} LM_EVENT_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Application entry points, implemented by the application */
+extern void AppPowerOnReset(void);
+extern void AppInit(sleep_state last_sleep_state);
+extern void AppProcessSystemEvent(sys_event_id id, void *data);
+extern bool AppProcessLmEvent(lm_event_code event_code,
+                              LM_EVENT_T *p_event_data);
+
+#endif /* __MAIN_H__ */
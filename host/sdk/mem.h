@@ -0,0 +1,27 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      mem.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK memory routines
+ *
+ *****************************************************************************/
+
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Copy n addressable units (one uint8 per word on the XAP) */
+extern void MemCopy(void *dst, const void *src, uint16 n);
+
+/* Fill n addressable units of dst with value */
+extern void MemSet(void *dst, uint16 value, uint16 n);
+
+#endif /* __MEM_H__ */
@@ -0,0 +1,34 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      nvm.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK user NVM access. The store is the
+ *      region given by &nvm_start_address and &nvm_size in the keyr file,
+ *      addressed in words from its start.
+ *
+ *****************************************************************************/
+
+#ifndef __NVM_H__
+#define __NVM_H__
+
+#include <types.h>
+#include <status.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Enable the I2C EEPROM holding the user NVM */
+extern sys_status NvmConfigureI2cEeprom(void);
+
+/* Power the NVM down until the next access */
+extern sys_status NvmDisable(void);
+
+/* Read or write length words at a word offset into the user NVM */
+extern sys_status NvmRead(uint16 *buffer, uint16 length, uint16 offset);
+extern sys_status NvmWrite(uint16 *buffer, uint16 length, uint16 offset);
+
+#endif /* __NVM_H__ */
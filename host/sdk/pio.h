@@ -0,0 +1,87 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      pio.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK programmable I/O control
+ *
+ *****************************************************************************/
+
+#ifndef __PIO_H__
+#define __PIO_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of PIOs, each a bit of the masks below */
+#define PIO_COUNT                       (32)
+
+/* Directions for PioSetDir() */
+#define PIO_DIRECTION_INPUT             (FALSE)
+#define PIO_DIRECTION_OUTPUT            (TRUE)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Function of a PIO */
+typedef enum
+{
+    pio_mode_user,
+    pio_mode_pwm0,
+    pio_mode_pwm1,
+    pio_mode_pwm2,
+    pio_mode_pwm3,
+    pio_mode_uart,
+    pio_mode_i2c,
+    pio_mode_spi
+} pio_mode;
+
+/* Pull of an input */
+typedef enum
+{
+    pio_mode_no_pulls,
+    pio_mode_weak_pull_up,
+    pio_mode_weak_pull_down,
+    pio_mode_strong_pull_up,
+    pio_mode_strong_pull_down
+} pio_pull_mode;
+
+/* Edges of an input that raise sys_event_pio_changed, and wake the chip
+ * from hibernate when it asked to be woken by a PIO
+ */
+typedef enum
+{
+    pio_event_mode_disable,
+    pio_event_mode_rising,
+    pio_event_mode_falling,
+    pio_event_mode_both
+} pio_event_mode;
+
+/* Data of sys_event_pio_changed: the PIOs whose edge raised it and the
+ * level of every PIO
+ */
+typedef struct
+{
+    uint32 pio_cause;
+    uint32 pio_state;
+} pio_changed_data;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+extern void PioSetModes(uint32 pio_mask, pio_mode mode);
+extern void PioSetDir(uint16 pio, bool dir);
+extern void PioSetPullModes(uint32 pio_mask, pio_pull_mode pull_mode);
+extern void PioSetEventMask(uint32 pio_mask, pio_event_mode mode);
+
+/* Level of an input */
+extern bool PioGet(uint16 pio);
+
+#endif /* __PIO_H__ */
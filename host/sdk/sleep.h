@@ -0,0 +1,44 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      sleep.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK sleep control
+ *
+ *****************************************************************************/
+
+#ifndef __SLEEP_H__
+#define __SLEEP_H__
+
+#include <types.h>
+#include <main.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Sleep the firmware may enter between events */
+typedef enum
+{
+    sleep_mode_never,
+    sleep_mode_shallow,
+    sleep_mode_deep
+} sleep_mode;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+extern void SleepModeChange(sleep_mode mode);
+
+/* Enter hibernate or dormant once the application returns. RAM is lost and
+ * the application restarts in AppInit() with the state given here. From
+ * hibernate the chip wakes after *wakeup_time seconds, or only on a PIO if
+ * wakeup_time is NULL; dormant wakes on a PIO only.
+ */
+extern void SleepRequest(sleep_state new_state, bool pio_wake,
+                         uint32 *wakeup_time);
+
+#endif /* __SLEEP_H__ */
@@ -0,0 +1,29 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      status.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK status codes
+ *
+ *****************************************************************************/
+
+#ifndef __STATUS_H__
+#define __STATUS_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef enum
+{
+    sys_status_success = 0,
+    sys_status_failed,
+    nvm_status_invalid_offset,
+    nvm_status_not_configured
+} sys_status;
+
+#endif /* __STATUS_H__ */
@@ -0,0 +1,24 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      thermometer.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK on-chip temperature sensor
+ *
+ *****************************************************************************/
+
+#ifndef __THERMOMETER_H__
+#define __THERMOMETER_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Die temperature in degrees Celsius, measured with the ADC */
+extern int16 ThermometerReadTemperature(void);
+
+#endif /* __THERMOMETER_H__ */
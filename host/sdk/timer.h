@@ -0,0 +1,61 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      timer.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK timers and time units. The SDK
+ *      keeps the units and TimeGet32() in its own time.h, which would shadow
+ *      the C library header on the host, so they live here instead.
+ *
+ *****************************************************************************/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Time is expressed in microseconds */
+#define MILLISECOND                     ((uint32)1000)
+#define SECOND                          (1000 * MILLISECOND)
+#define MINUTE                          (60 * SECOND)
+
+/* Words of timer memory the application reserves per timer */
+#define SIZEOF_APP_TIMER                (5)
+
+/* Returned by TimerCreate() when no timer is free */
+#define TIMER_INVALID                   ((timer_id)0xFFFF)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+typedef uint16 timer_id;
+
+typedef void (*timer_callback_arg)(timer_id const id);
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Give the timer module memory for num_timers application timers */
+extern void TimerInit(uint16 num_timers, void *buffer);
+
+/* Create a one-shot timer, time is relative to now unless is_relative is
+ * FALSE, in which case it is an absolute TimeGet32() value
+ */
+extern timer_id TimerCreate(uint32 time, bool is_relative,
+                            timer_callback_arg handler);
+
+/* Delete a timer which has not yet fired */
+extern bool TimerDelete(timer_id const id);
+
+/* Microseconds since power-up, wrapping every 71 minutes */
+extern uint32 TimeGet32(void);
+
+#endif /* __TIMER_H__ */
@@ -0,0 +1,39 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      types.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK basic types. Only what the beacon
+ *      application uses is provided.
+ *
+ *****************************************************************************/
+
+#ifndef __TYPES_H__
+#define __TYPES_H__
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+typedef unsigned char           uint8;
+typedef unsigned short          uint16;
+typedef unsigned int            uint24;
+typedef unsigned int            uint32;
+typedef signed char             int8;
+typedef signed short            int16;
+typedef signed int              int32;
+typedef uint16                  bool;
+
+#ifndef NULL
+#define NULL                    ((void *)0)
+#endif
+
+#define FALSE                   (0)
+#define TRUE                    (1)
+
+#define WORD_MSB(x)             ((uint8)(((x) >> 8) & 0xFF))
+#define WORD_LSB(x)             ((uint8)((x) & 0xFF))
+
+#endif /* __TYPES_H__ */
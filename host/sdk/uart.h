@@ -0,0 +1,66 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      uart.h
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK UART interface. The application
+ *      hands the firmware whole buffers which are sent in the background;
+ *      the transmit handler is called once everything written has left the
+ *      UART.
+ *
+ *****************************************************************************/
+
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <types.h>
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Buffer sizes in words */
+#define BUFFER_SIZE_32                  (0x05)
+#define BUFFER_SIZE_64                  (0x06)
+#define BUFFER_SIZE_128                 (0x07)
+
+/* Number of words in a buffer of the given size */
+#define UART_BUFFER_WORDS(size)         (1U << (size))
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Received data; returns the number of words consumed */
+typedef uint16 (*uart_data_in_fn)(void *p_data, uint16 data_count,
+                                  uint16 *p_num_additional_words);
+
+/* Everything written has been sent */
+typedef void (*uart_data_out_fn)(void);
+
+typedef enum
+{
+    uart_data_unpacked,     /* one octet in the LSB of each word */
+    uart_data_packed        /* two octets per word, LSB first */
+} uart_data_unit;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+extern void UartInit(uart_data_in_fn rx_event_handler,
+                     uart_data_out_fn tx_event_handler,
+                     uint16 *rx_buffer, uint16 rx_buffer_size,
+                     uint16 *tx_buffer, uint16 tx_buffer_size,
+                     uart_data_unit data_unit);
+
+extern void UartEnable(bool enable);
+
+/* Queue length words for transmission. Returns FALSE, writing nothing,
+ * if they do not fit in the transmit buffer.
+ */
+extern bool UartWrite(const void *p_data, uint16 length);
+
+#endif /* __UART_H__ */
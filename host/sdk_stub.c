@@ -0,0 +1,2317 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      sdk_stub.c
+ *
+ *  DESCRIPTION
+ *      Host stand-in for the uEnergy SDK calls made by the beacon
+ *      application. Every call is charged a modelled cycle cost, advertising
+ *      events are run against a simulated clock and the charge drawn by the
+ *      CPU, the radio and sleep is accumulated in microamp-seconds.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <main.h>
+#include <mem.h>
+#include <gatt.h>
+#include <ls_app_if.h>
+#include <gap_app_if.h>
+#include <config_store.h>
+#include <debug.h>
+#include <uart.h>
+#include <timer.h>
+#include <battery.h>
+#include <thermometer.h>
+#include <nvm.h>
+#include <aes.h>
+#include <sleep.h>
+#include <pio.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+#include "energy_model.h"
+#include "aes128.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of advertising channels */
+#define ADV_CHANNEL_COUNT               (3)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+typedef struct
+{
+    bool active;
+    uint64_t due_us;
+    timer_callback_arg handler;
+} HARNESS_TIMER_T;
+
+/* LM event waiting to be delivered to the application */
+typedef struct
+{
+    uint64_t time_us;
+    lm_event_code code;
+    LM_EVENT_T event;
+} HARNESS_LM_EVENT_T;
+
+typedef struct
+{
+    /* Simulated time in microseconds */
+    uint64_t now_us;
+
+    /* Cycles not yet converted into whole microseconds of simulated time */
+    uint64_t cycle_residue;
+
+    /* Cycle count at AppInit() entry */
+    uint64_t boot_start_cycles;
+
+    /* Cycle count at the last GapSetMode() entry */
+    uint64_t mode_start_cycles;
+
+    uint16 user_keys[HARNESS_USER_KEY_COUNT];
+
+    /* Controller copy of the advertising and scan response data, AD
+     * structures included
+     */
+    uint8 adv_data[HARNESS_ADV_DATA_MAX];
+    uint8 adv_len;
+    uint8 scan_rsp_data[HARNESS_ADV_DATA_MAX];
+    uint8 scan_rsp_len;
+
+    /* Chance of a scan request on each channel of a scannable event */
+    double scan_request_probability;
+
+    bool advertising;
+    bool connectable;
+    uint32 adv_interval_min;
+    uint32 adv_interval_max;
+    uint8 adv_channels;
+    uint64_t next_adv_us;
+
+    /* Scanning with its interval and window, the time up to which its
+     * radio charge has been added up and when the next report is heard
+     */
+    bool scanning;
+    uint32 scan_interval;
+    uint32 scan_window;
+    uint64_t scan_charged_us;
+    uint64_t next_report_us;
+
+    /* Other advertisers in range and their advertising interval */
+    uint32_t neighbours;
+    uint32_t neighbour_interval_us;
+
+    /* Sync beacon: its advertising data, when it enables advertising and
+     * when its next PDU is heard
+     */
+    uint8 sync_data[HARNESS_ADV_DATA_MAX];
+    uint8 sync_len;
+    uint32_t sync_interval_us;
+    uint64_t sync_phase_us;
+    uint64_t next_sync_us;
+
+    /* Sleep clock gain in parts per million */
+    double clock_ppm;
+
+    /* PIOs whose rising and falling edges raise sys_event_pio_changed */
+    uint32 pio_rising;
+    uint32 pio_falling;
+
+    /* Accelerometer interrupt: its PIO, when it was wired, the motion
+     * pattern and its next pulse
+     */
+    uint8 motion_pio;
+    uint64_t motion_origin_us;
+    uint64_t motion_period_us;
+    uint64_t motion_move_us;
+    uint32_t motion_pulse_us;
+    uint64_t next_motion_us;
+
+    uint32_t prng;
+
+    /* Application timers, limited to the number given to TimerInit() */
+    HARNESS_TIMER_T timers[HARNESS_MAX_TIMERS];
+    uint16 num_timers;
+
+    /* Battery voltage at battery_set_us and its rate of fall */
+    uint16 battery_mv;
+    uint64_t battery_set_us;
+    double battery_mv_per_us;
+    uint64_t battery_low_us;
+
+    /* Die temperature in degrees Celsius */
+    int16 temperature;
+
+    uint8 tx_power_level;
+
+    /* User NVM, the number of writes to each word and the words left to
+     * write before a brown-out
+     */
+    uint16 nvm[HARNESS_NVM_MAX_WORDS];
+    uint32_t nvm_wear[HARNESS_NVM_MAX_WORDS];
+    uint16 nvm_words;
+    uint32_t nvm_brown_out;
+    bool nvm_configured;
+
+    /* LM events waiting for delivery, in time order */
+    HARNESS_LM_EVENT_T lm_queue[HARNESS_LM_QUEUE_SIZE];
+    uint16 lm_head;
+    uint16 lm_count;
+
+    /* Connection to the harness central, with the parameters in force and
+     * the time up to which its radio charge has been added up
+     */
+    bool connected;
+    uint64_t connect_us;
+    uint64_t link_charged_us;
+    uint16 conn_interval;
+    uint16 conn_latency;
+
+    /* How the harness central connects and answers update requests */
+    uint16 central_interval;
+    bool central_accepts_updates;
+
+    /* Last GattAccessRsp() */
+    sys_status gatt_rsp_status;
+    uint16 gatt_rsp_len;
+    uint8 gatt_rsp_value[HARNESS_GATT_VALUE_MAX];
+
+    /* Sleep state requested by the application, entered when it returns,
+     * the state the chip is in and when it wakes from it
+     */
+    bool sleep_requested;
+    sleep_state requested_state;
+    uint64_t requested_wake_us;
+    bool requested_pio_wake;
+    bool hibernating;
+    sleep_state state;
+    uint64_t wake_us;
+    bool pio_wake;
+
+    /* Time of the last wake from hibernate or dormant until its first
+     * advertising event, and whether advertising has been enabled since
+     */
+    uint64_t woke_us;
+    bool woke_enabled;
+
+    harness_adv_hook adv_hook;
+    void *adv_hook_context;
+
+    /* UART transmit buffer, the octets in it and when they are all sent */
+    bool uart_enabled;
+    uart_data_out_fn uart_tx_handler;
+    uint16 uart_tx_size;
+    uint8 uart_tx[HARNESS_UART_TX_MAX];
+    uint16 uart_tx_len;
+    uint64_t uart_done_us;
+
+    harness_uart_hook uart_hook;
+    void *uart_hook_context;
+
+    int debug_echo;
+
+    HARNESS_STATS_T stats;
+} HARNESS_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static HARNESS_DATA_T g_harness;
+
+static const char * const g_call_names[harness_call_count] =
+{
+    "CSReadUserKey",
+    "GapSetMode",
+    "GapSetAdvInterval",
+    "GapSetAdvChanMask",
+    "LsStoreAdvScanData",
+    "LsStartStopAdvertise",
+    "MemCopy",
+    "DebugWrite",
+    "DebugInit",
+    "GattInit",
+    "TimerCreate/Delete",
+    "Wake-up",
+    "BatteryReadVoltage",
+    "LsSetTransmitPowerLevel",
+    "NvmRead",
+    "NvmWrite",
+    "SleepRequest",
+    "GattAccessRsp",
+    "UartWrite",
+    "GattConnect",
+    "AesEncrypt",
+    "LsConnectionParamUpdateReq",
+    "ThermometerReadTemperature",
+    "GapSetScanInterval",
+    "LsStartStopScan",
+    "Pio*"
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextRandom
+ *
+ *  DESCRIPTION
+ *      xorshift32 generator, so that runs with the same seed repeat exactly.
+ *
+ *  RETURNS
+ *      Next pseudo-random value.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t nextRandom(void)
+{
+    uint32_t x = g_harness.prng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_harness.prng = x;
+
+    return x;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      chargeCycles
+ *
+ *  DESCRIPTION
+ *      Charges CPU cycles to an SDK call. The CPU is awake while they run,
+ *      so simulated time moves on with them.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void chargeCycles(harness_call call, uint64_t cycles)
+{
+    const uint64_t cycles_per_us = MODEL_CPU_HZ / 1000000UL;
+
+    g_harness.stats.calls[call].count++;
+    g_harness.stats.calls[call].cycles += cycles;
+    g_harness.stats.cycles += cycles;
+    g_harness.stats.cpu_uas +=
+        (double)cycles * MODEL_CPU_ACTIVE_UA / (double)MODEL_CPU_HZ;
+
+    g_harness.cycle_residue += cycles;
+    g_harness.now_us += g_harness.cycle_residue / cycles_per_us;
+    g_harness.cycle_residue %= cycles_per_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      sleepUntil
+ *
+ *  DESCRIPTION
+ *      Moves simulated time forward with the chip in deep sleep.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void sleepUntil(uint64_t time_us)
+{
+    double sleep_ua = MODEL_DEEP_SLEEP_UA;
+
+    if(g_harness.hibernating)
+    {
+        sleep_ua = g_harness.state == sleep_state_dormant ?
+                   MODEL_DORMANT_UA : MODEL_HIBERNATE_UA;
+    }
+
+    if(time_us > g_harness.now_us)
+    {
+        g_harness.stats.sleep_uas +=
+            (double)(time_us - g_harness.now_us) * sleep_ua / 1e6;
+        if(g_harness.hibernating)
+        {
+            g_harness.stats.hibernate_us += time_us - g_harness.now_us;
+        }
+        g_harness.now_us = time_us;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      chargeLink
+ *
+ *  DESCRIPTION
+ *      Charges the radio for the connection up to now, at the current for
+ *      the connection events the parameters in force leave the slave to
+ *      listen to.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void chargeLink(void)
+{
+    double events_interval = (double)g_harness.conn_interval *
+                             (1 + g_harness.conn_latency);
+
+    g_harness.stats.radio_uas +=
+        (double)(g_harness.now_us - g_harness.link_charged_us) *
+        MODEL_RADIO_CONNECTED_UA * MODEL_CONN_DEFAULT_INTERVAL /
+        events_interval / 1e6;
+    g_harness.link_charged_us = g_harness.now_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      linkDown
+ *
+ *  DESCRIPTION
+ *      Ends the connection and charges the radio for the rest of it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void linkDown(void)
+{
+    if(!g_harness.connected)
+    {
+        return;
+    }
+
+    chargeLink();
+    g_harness.connected = FALSE;
+    g_harness.stats.connected_us += g_harness.now_us - g_harness.connect_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      chargeScan
+ *
+ *  DESCRIPTION
+ *      Charges the radio for scanning up to now, at the receive current for
+ *      the share of the time the scan window covers.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void chargeScan(void)
+{
+    uint64_t elapsed_us = g_harness.now_us - g_harness.scan_charged_us;
+
+    g_harness.stats.radio_uas += (double)elapsed_us * MODEL_RADIO_RX_UA *
+                                 g_harness.scan_window /
+                                 g_harness.scan_interval / 1e6;
+    g_harness.stats.scan_us += elapsed_us;
+    g_harness.scan_charged_us = g_harness.now_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      scanDown
+ *
+ *  DESCRIPTION
+ *      Stops scanning and charges the radio for the rest of it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void scanDown(void)
+{
+    if(!g_harness.scanning)
+    {
+        return;
+    }
+
+    chargeScan();
+    g_harness.scanning = FALSE;
+    g_harness.next_report_us = HARNESS_NEVER;
+    g_harness.next_sync_us = HARNESS_NEVER;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      scheduleNextReport
+ *
+ *  DESCRIPTION
+ *      Picks the time the next neighbour PDU is heard, a random gap after
+ *      the last whose mean gives the rate the neighbours advertise at,
+ *      thinned by the scan duty cycle.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void scheduleNextReport(uint64_t from_us)
+{
+    double mean_us;
+
+    if(g_harness.neighbours == 0)
+    {
+        g_harness.next_report_us = HARNESS_NEVER;
+        return;
+    }
+
+    mean_us = (double)g_harness.neighbour_interval_us *
+              g_harness.scan_interval /
+              ((double)g_harness.neighbours * g_harness.scan_window);
+
+    g_harness.next_report_us = from_us + 1 +
+        (uint64_t)(2.0 * mean_us * nextRandom() / (double)UINT32_MAX);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      scheduleNextSync
+ *
+ *  DESCRIPTION
+ *      Picks the next sync beacon PDU heard after the given time: the PDU
+ *      of a channel picked at random from each event in turn, until one
+ *      falls in the scan window by the chance of its duty cycle.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void scheduleNextSync(uint64_t from_us)
+{
+    uint32 air_us = (MODEL_ADV_PDU_OVERHEAD_OCTETS + g_harness.sync_len) *
+                    MODEL_US_PER_OCTET;
+    double duty = (double)g_harness.scan_window / g_harness.scan_interval;
+    uint64_t enable_us = g_harness.sync_phase_us;
+
+    g_harness.next_sync_us = HARNESS_NEVER;
+    if(g_harness.sync_len == 0 || !g_harness.scanning)
+    {
+        return;
+    }
+
+    if(from_us > enable_us)
+    {
+        enable_us += (from_us - enable_us) / g_harness.sync_interval_us *
+                     g_harness.sync_interval_us;
+    }
+
+    for(;; enable_us += g_harness.sync_interval_us)
+    {
+        uint32 channel = nextRandom() % 3;
+        uint64_t heard_us = enable_us + MODEL_ADV_FIRST_EVENT_US +
+                            MODEL_ADV_WAKE_US +
+                            channel * (air_us + MODEL_ADV_CHANNEL_GAP_US) +
+                            air_us;
+
+        if(heard_us > from_us &&
+           nextRandom() < duty * (double)UINT32_MAX)
+        {
+            g_harness.next_sync_us = heard_us;
+            return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      trueSpan
+ *
+ *  DESCRIPTION
+ *      Converts a span of the sleep clock into simulated time, rounded up
+ *      so that TimeGet32() has reached the end of the span by then.
+ *
+ *  RETURNS
+ *      The span in simulated microseconds.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t trueSpan(uint32 local_us)
+{
+    if(g_harness.clock_ppm == 0.0)
+    {
+        return local_us;
+    }
+
+    return (uint64_t)((double)local_us * 1e6 /
+                      (1e6 + g_harness.clock_ppm) + 1.0) + 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextMotionPulse
+ *
+ *  DESCRIPTION
+ *      Finds the first accelerometer pulse at or after a time.
+ *
+ *  RETURNS
+ *      Time of the pulse, or HARNESS_NEVER without an accelerometer.
+ *
+ *---------------------------------------------------------------------------*/
+static uint64_t nextMotionPulse(uint64_t from_us)
+{
+    uint64_t period_us = g_harness.motion_period_us;
+    uint64_t start_us;
+    uint64_t pulse;
+
+    if(period_us == 0)
+    {
+        return HARNESS_NEVER;
+    }
+
+    if(from_us < g_harness.motion_origin_us)
+    {
+        from_us = g_harness.motion_origin_us;
+    }
+
+    start_us = from_us - (from_us - g_harness.motion_origin_us) % period_us;
+    pulse = (from_us - start_us + g_harness.motion_pulse_us - 1) /
+            g_harness.motion_pulse_us;
+    if(pulse * g_harness.motion_pulse_us < g_harness.motion_move_us)
+    {
+        return start_us + pulse * g_harness.motion_pulse_us;
+    }
+
+    return start_us + period_us;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      motionListened
+ *
+ *  DESCRIPTION
+ *      Works out whether the event mask takes an edge of the accelerometer
+ *      PIO.
+ *
+ *  RETURNS
+ *      TRUE if a pulse raises an event.
+ *
+ *---------------------------------------------------------------------------*/
+static bool motionListened(void)
+{
+    return ((g_harness.pio_rising | g_harness.pio_falling) &
+            (1UL << g_harness.motion_pio)) != 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appReturned
+ *
+ *  DESCRIPTION
+ *      Called whenever the application returns to the firmware. A pending
+ *      hibernate or dormant request is entered here: advertising stops and
+ *      the application timers are lost with the RAM.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void appReturned(void)
+{
+    if(!g_harness.sleep_requested)
+    {
+        return;
+    }
+
+    g_harness.sleep_requested = FALSE;
+    g_harness.hibernating = TRUE;
+    g_harness.state = g_harness.requested_state;
+    g_harness.wake_us = g_harness.requested_wake_us;
+    g_harness.pio_wake = g_harness.requested_pio_wake;
+    g_harness.advertising = FALSE;
+    g_harness.connectable = FALSE;
+    linkDown();
+    scanDown();
+    g_harness.adv_len = 0;
+    g_harness.scan_rsp_len = 0;
+    g_harness.adv_channels = GAP_ADV_CHANNELS_ALL;
+    memset(g_harness.timers, 0, sizeof(g_harness.timers));
+    g_harness.num_timers = 0;
+    g_harness.lm_count = 0;
+    g_harness.uart_enabled = FALSE;
+    g_harness.uart_tx_len = 0;
+    g_harness.uart_done_us = HARNESS_NEVER;
+    g_harness.woke_us = HARNESS_NEVER;
+    g_harness.nvm_brown_out = HARNESS_NVM_NO_BROWN_OUT;
+    g_harness.stats.hibernations++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wakeFromSleep
+ *
+ *  DESCRIPTION
+ *      Restarts the application from hibernate or dormant.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void wakeFromSleep(void)
+{
+    g_harness.hibernating = FALSE;
+    g_harness.wake_us = HARNESS_NEVER;
+
+    /* pulses while the chip slept without listening to them are lost */
+    g_harness.next_motion_us = nextMotionPulse(g_harness.now_us);
+    g_harness.woke_us = g_harness.now_us;
+    g_harness.woke_enabled = FALSE;
+
+    g_harness.stats.wakeups++;
+    chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+    g_harness.boot_start_cycles = g_harness.stats.cycles;
+    AppInit(g_harness.state);
+    appReturned();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      channelCount
+ *
+ *  DESCRIPTION
+ *      Counts the channels in an advertising channel mask.
+ *
+ *  RETURNS
+ *      Number of channels, 1 to ADV_CHANNEL_COUNT.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32 channelCount(uint8 channel_mask)
+{
+    uint32 count = 0;
+    uint32 channel;
+
+    for(channel = 0; channel < ADV_CHANNEL_COUNT; channel++)
+    {
+        count += (channel_mask >> channel) & 1;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      scheduleNextAdvert
+ *
+ *  DESCRIPTION
+ *      Schedules the next advertising event one interval plus a random
+ *      advDelay after the previous one.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void scheduleNextAdvert(uint64_t from_us)
+{
+    uint32 interval = g_harness.adv_interval_min;
+
+    if(g_harness.adv_interval_max > g_harness.adv_interval_min)
+    {
+        interval += nextRandom() %
+            (g_harness.adv_interval_max - g_harness.adv_interval_min + 1);
+    }
+
+    g_harness.next_adv_us = from_us + interval +
+                            nextRandom() % (MODEL_ADV_DELAY_MAX_US + 1);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      runAdvertisingEvent
+ *
+ *  DESCRIPTION
+ *      Puts one advertising event on air on the channels in the mask and
+ *      charges the radio for it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void runAdvertisingEvent(void)
+{
+    HARNESS_ADV_EVENT_T event;
+    uint32 channels = channelCount(g_harness.adv_channels);
+    uint32 air_us = (MODEL_ADV_PDU_OVERHEAD_OCTETS + g_harness.adv_len) *
+                    MODEL_US_PER_OCTET;
+    uint32 gap_us = (channels - 1) * MODEL_ADV_CHANNEL_GAP_US;
+    double tx_ua = MODEL_RADIO_TX_UA +
+                   g_harness.tx_power_level * MODEL_RADIO_TX_UA_PER_LEVEL;
+
+    event.time_us = g_harness.now_us;
+    event.duration_us = MODEL_ADV_WAKE_US + gap_us + channels * air_us;
+    event.tx_power_level = g_harness.tx_power_level;
+    event.adv_len = g_harness.adv_len;
+    memcpy(event.adv_data, g_harness.adv_data, g_harness.adv_len);
+    event.interval_min_us = g_harness.adv_interval_min;
+    event.interval_max_us = g_harness.adv_interval_max;
+    event.connectable = g_harness.connectable;
+    event.scannable = g_harness.connectable || g_harness.scan_rsp_len != 0;
+    event.scan_rsp_len = g_harness.scan_rsp_len;
+    memcpy(event.scan_rsp_data, g_harness.scan_rsp_data,
+           g_harness.scan_rsp_len);
+    event.scan_rsp_count = 0;
+    event.channels = g_harness.adv_channels;
+
+    g_harness.stats.radio_uas +=
+        ((double)(MODEL_ADV_WAKE_US + gap_us) * MODEL_RADIO_IDLE_UA +
+         (double)(channels * air_us) * tx_ua) / 1e6;
+
+    if(event.scannable)
+    {
+        uint32 rsp_us = MODEL_SCAN_RSP_IFS_US +
+                        (MODEL_ADV_PDU_OVERHEAD_OCTETS +
+                         g_harness.scan_rsp_len) * MODEL_US_PER_OCTET;
+        uint32 channel;
+
+        event.duration_us += channels * MODEL_ADV_CONN_RX_US;
+        g_harness.stats.radio_uas += (double)(channels *
+            MODEL_ADV_CONN_RX_US) * MODEL_RADIO_RX_UA / 1e6;
+
+        /* The controller answers scan requests on its own; the application
+         * never hears of them
+         */
+        for(channel = 0; channel < channels; channel++)
+        {
+            if(g_harness.scan_request_probability > 0.0 &&
+               nextRandom() < g_harness.scan_request_probability *
+                              (double)UINT32_MAX)
+            {
+                event.scan_rsp_count++;
+                event.duration_us += rsp_us;
+                g_harness.stats.radio_uas +=
+                    (double)rsp_us * tx_ua / 1e6;
+            }
+        }
+        g_harness.stats.scan_responses += event.scan_rsp_count;
+    }
+
+    g_harness.stats.adv_events++;
+    if(g_harness.stats.first_adv_us == HARNESS_NEVER)
+    {
+        g_harness.stats.first_adv_us = g_harness.now_us;
+    }
+    if(g_harness.woke_us != HARNESS_NEVER)
+    {
+        uint64_t latency_us = g_harness.now_us - g_harness.woke_us;
+
+        g_harness.stats.warm_boots++;
+        g_harness.stats.warm_first_adv_us += latency_us;
+        if(latency_us > g_harness.stats.warm_first_adv_max_us)
+        {
+            g_harness.stats.warm_first_adv_max_us = latency_us;
+        }
+        g_harness.woke_us = HARNESS_NEVER;
+    }
+
+    if(g_harness.adv_hook != NULL)
+    {
+        g_harness.adv_hook(&event, g_harness.adv_hook_context);
+    }
+
+    g_harness.now_us += event.duration_us;
+    scheduleNextAdvert(event.time_us);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nextTimer
+ *
+ *  DESCRIPTION
+ *      Finds the application timer which fires first.
+ *
+ *  RETURNS
+ *      Index of the timer, or HARNESS_MAX_TIMERS if none is running.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 nextTimer(void)
+{
+    uint16 next = HARNESS_MAX_TIMERS;
+    uint16 i;
+
+    for(i = 0; i < g_harness.num_timers; i++)
+    {
+        if(g_harness.timers[i].active &&
+           (next == HARNESS_MAX_TIMERS ||
+            g_harness.timers[i].due_us < g_harness.timers[next].due_us))
+        {
+            next = i;
+        }
+    }
+
+    return next;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      fireTimer
+ *
+ *  DESCRIPTION
+ *      Wakes the CPU and runs the handler of an expired timer.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void fireTimer(uint16 index)
+{
+    timer_callback_arg handler = g_harness.timers[index].handler;
+
+    g_harness.timers[index].active = FALSE;
+
+    g_harness.stats.wakeups++;
+    g_harness.stats.timer_wakeups++;
+    chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+    handler((timer_id)index);
+    appReturned();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      queueLmEvent
+ *
+ *  DESCRIPTION
+ *      Queues an LM event for delivery after the given delay. Events are
+ *      delivered in the order they are queued.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void queueLmEvent(uint32 delay_us, lm_event_code code,
+                         const LM_EVENT_T *event)
+{
+    HARNESS_LM_EVENT_T *queued;
+    uint64_t time_us = g_harness.now_us + delay_us;
+
+    if(g_harness.lm_count == HARNESS_LM_QUEUE_SIZE)
+    {
+        return;
+    }
+
+    /* keep the queue in time order */
+    if(g_harness.lm_count != 0)
+    {
+        uint16 last = (g_harness.lm_head + g_harness.lm_count - 1) %
+                      HARNESS_LM_QUEUE_SIZE;
+
+        if(g_harness.lm_queue[last].time_us > time_us)
+        {
+            time_us = g_harness.lm_queue[last].time_us;
+        }
+    }
+
+    queued = &g_harness.lm_queue[(g_harness.lm_head + g_harness.lm_count) %
+                                 HARNESS_LM_QUEUE_SIZE];
+    queued->time_us = time_us;
+    queued->code = code;
+    queued->event = *event;
+    g_harness.lm_count++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      callLmEvent
+ *
+ *  DESCRIPTION
+ *      Wakes the CPU and passes an LM event to the application.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void callLmEvent(lm_event_code code, LM_EVENT_T *event)
+{
+    g_harness.stats.wakeups++;
+    chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+    AppProcessLmEvent(code, event);
+    appReturned();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      deliverLmEvent
+ *
+ *  DESCRIPTION
+ *      Delivers the LM event at the head of the queue.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void deliverLmEvent(void)
+{
+    HARNESS_LM_EVENT_T event = g_harness.lm_queue[g_harness.lm_head];
+
+    g_harness.lm_head = (g_harness.lm_head + 1) % HARNESS_LM_QUEUE_SIZE;
+    g_harness.lm_count--;
+
+    if(event.code == LM_EV_DISCONNECT_COMPLETE)
+    {
+        linkDown();
+    }
+    else if(event.code == LM_EV_CONNECTION_UPDATE)
+    {
+        if(!g_harness.connected)
+        {
+            return;
+        }
+        chargeLink();
+        g_harness.conn_interval =
+            event.event.lm_ev_connection_update.data.conn_interval;
+        g_harness.conn_latency =
+            event.event.lm_ev_connection_update.data.conn_latency;
+        g_harness.stats.conn_updates++;
+    }
+
+    callLmEvent(event.code, &event.event);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      reportAdvert
+ *
+ *  DESCRIPTION
+ *      Passes a non-connectable advert heard from a static random address
+ *      to the application as an advertising report.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void reportAdvert(uint32_t address, uint16 nap, const uint8 *data,
+                         uint8 len)
+{
+    LM_EVENT_T event;
+
+    chargeScan();
+
+    memset(&event, 0, sizeof(event));
+    event.lm_ev_advertising_report.data.event_type =
+        HCI_EV_ADV_TYPE_ADV_NONCONN_IND;
+    event.lm_ev_advertising_report.data.address.type = ls_addr_type_random;
+    event.lm_ev_advertising_report.data.address.addr.lap =
+        address & 0xFFFFFF;
+    event.lm_ev_advertising_report.data.address.addr.uap =
+        (uint8)(address >> 24);
+    event.lm_ev_advertising_report.data.address.addr.nap = nap;
+    event.lm_ev_advertising_report.data.length_data = len;
+    memcpy(event.lm_ev_advertising_report.data.data, data, len);
+    event.lm_ev_advertising_report.rssi = (int8)(-40 -
+                                                 (int)(nextRandom() % 60));
+
+    g_harness.stats.adv_reports++;
+    callLmEvent(LM_EV_ADVERTISING_REPORT, &event);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      deliverReport
+ *
+ *  DESCRIPTION
+ *      Reports a non-connectable advert from a neighbour picked at random.
+ *      Each neighbour has a static random address of its own.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void deliverReport(void)
+{
+    static const uint8 flags[] = { 0x02, AD_TYPE_FLAGS, 0x06 };
+    uint64_t heard_us = g_harness.next_report_us;
+    uint32_t neighbour = nextRandom() % g_harness.neighbours;
+
+    reportAdvert((neighbour + 1) * 0x9E3779B1u,
+                 (uint16)(((neighbour + 1) * 0x85EBCA6Bu) >> 16) | 0xC000,
+                 flags, sizeof(flags));
+
+    if(g_harness.scanning)
+    {
+        scheduleNextReport(heard_us);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      deliverSyncReport
+ *
+ *  DESCRIPTION
+ *      Reports the sync beacon PDU that falls due.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void deliverSyncReport(void)
+{
+    uint64_t heard_us = g_harness.next_sync_us;
+
+    reportAdvert(0x5EC0FFEEu, 0xC5A1, g_harness.sync_data,
+                 g_harness.sync_len);
+
+    if(g_harness.scanning)
+    {
+        scheduleNextSync(heard_us);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      gattAccess
+ *
+ *  DESCRIPTION
+ *      Passes a GATT access to the application and collects its answer.
+ *
+ *  RETURNS
+ *      The status the application answered with.
+ *
+ *---------------------------------------------------------------------------*/
+static sys_status gattAccess(uint16 handle, uint16 flags, uint8 *value,
+                             uint16 len)
+{
+    LM_EVENT_T event;
+
+    memset(&event, 0, sizeof(event));
+    event.gatt_access_ind.cid = HARNESS_GATT_CID;
+    event.gatt_access_ind.handle = handle;
+    event.gatt_access_ind.flags = flags;
+    event.gatt_access_ind.size_value = len;
+    event.gatt_access_ind.value = value;
+
+    g_harness.gatt_rsp_status = gatt_status_invalid_handle;
+    g_harness.gatt_rsp_len = 0;
+
+    callLmEvent(GATT_ACCESS_IND, &event);
+
+    return g_harness.gatt_rsp_status;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      startAdvertising
+ *
+ *  DESCRIPTION
+ *      Starts advertising, connectable or not, and notes the first time
+ *      advertising is enabled.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void startAdvertising(bool connectable)
+{
+    g_harness.connectable = connectable;
+
+    if(g_harness.advertising)
+    {
+        return;
+    }
+
+    g_harness.advertising = TRUE;
+    g_harness.next_adv_us = g_harness.now_us + MODEL_ADV_FIRST_EVENT_US;
+
+    if(g_harness.stats.adv_enable_us == HARNESS_NEVER)
+    {
+        g_harness.stats.adv_enable_us = g_harness.now_us;
+        g_harness.stats.boot_cycles =
+            g_harness.stats.cycles - g_harness.boot_start_cycles;
+        g_harness.stats.adv_start_cycles =
+            g_harness.stats.cycles - g_harness.mode_start_cycles;
+    }
+
+    if(g_harness.woke_us != HARNESS_NEVER && !g_harness.woke_enabled)
+    {
+        g_harness.woke_enabled = TRUE;
+        g_harness.stats.warm_boot_cycles =
+            g_harness.stats.cycles - g_harness.boot_start_cycles;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      batteryMv
+ *
+ *  DESCRIPTION
+ *      Works out the battery voltage at the current simulated time.
+ *
+ *  RETURNS
+ *      Battery voltage in millivolts.
+ *
+ *---------------------------------------------------------------------------*/
+static uint16 batteryMv(void)
+{
+    double mv = g_harness.battery_mv - g_harness.battery_mv_per_us *
+                (double)(g_harness.now_us - g_harness.battery_set_us);
+
+    return mv > 0.0 ? (uint16)mv : 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      raiseBatteryLow
+ *
+ *  DESCRIPTION
+ *      Wakes the CPU and delivers sys_event_battery_low.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void raiseBatteryLow(void)
+{
+    g_harness.battery_low_us = HARNESS_NEVER;
+
+    g_harness.stats.wakeups++;
+    chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+    AppProcessSystemEvent(sys_event_battery_low, NULL);
+    appReturned();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      deliverMotionPulse
+ *
+ *  DESCRIPTION
+ *      Wakes the CPU and delivers sys_event_pio_changed for the
+ *      accelerometer pulse that falls due, if the event mask takes it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void deliverMotionPulse(void)
+{
+    pio_changed_data data;
+
+    g_harness.next_motion_us = nextMotionPulse(g_harness.next_motion_us + 1);
+
+    if(!motionListened())
+    {
+        return;
+    }
+
+    /* the line is read high at the rising edge */
+    data.pio_cause = 1UL << g_harness.motion_pio;
+    data.pio_state = 1UL << g_harness.motion_pio;
+
+    g_harness.stats.pio_events++;
+    g_harness.stats.wakeups++;
+    chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+    AppProcessSystemEvent(sys_event_pio_changed, &data);
+    appReturned();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      uartSent
+ *
+ *  DESCRIPTION
+ *      Passes the UART output to the hook once it has been sent, then wakes
+ *      the CPU for the application transmit handler.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void uartSent(void)
+{
+    if(g_harness.uart_hook != NULL)
+    {
+        g_harness.uart_hook(g_harness.uart_tx, g_harness.uart_tx_len,
+                            g_harness.uart_hook_context);
+    }
+
+    g_harness.uart_tx_len = 0;
+    g_harness.uart_done_us = HARNESS_NEVER;
+
+    if(g_harness.uart_tx_handler != NULL)
+    {
+        g_harness.stats.wakeups++;
+        chargeCycles(harness_call_wake, MODEL_CYCLES_WAKE);
+
+        g_harness.uart_tx_handler();
+        appReturned();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      debugWrite
+ *
+ *  DESCRIPTION
+ *      Charges a blocking UART write and optionally echoes it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void debugWrite(const char *string)
+{
+    uint16 len = (uint16)strlen(string);
+
+    chargeCycles(harness_call_debug_write,
+                 (uint64_t)len * MODEL_CYCLES_DEBUG_CHAR);
+
+    if(g_harness.debug_echo)
+    {
+        fputs(string, stdout);
+    }
+}
+
+/*============================================================================*
+ *  Harness Function Implementations
+ *============================================================================*/
+
+void HarnessReset(uint32_t seed)
+{
+    memset(&g_harness, 0, sizeof(g_harness));
+
+    g_harness.prng = seed ? seed : 1;
+    g_harness.battery_mv = HARNESS_DEFAULT_BATTERY_MV;
+    g_harness.battery_low_us = HARNESS_NEVER;
+    g_harness.temperature = HARNESS_DEFAULT_TEMPERATURE;
+    g_harness.adv_channels = GAP_ADV_CHANNELS_ALL;
+    g_harness.stats.adv_enable_us = HARNESS_NEVER;
+    g_harness.stats.first_adv_us = HARNESS_NEVER;
+    g_harness.uart_done_us = HARNESS_NEVER;
+    g_harness.central_interval = MODEL_CONN_DEFAULT_INTERVAL;
+    g_harness.central_accepts_updates = TRUE;
+    g_harness.next_report_us = HARNESS_NEVER;
+    g_harness.neighbour_interval_us = HARNESS_DEFAULT_NEIGHBOUR_INTERVAL_US;
+    g_harness.next_sync_us = HARNESS_NEVER;
+    g_harness.next_motion_us = HARNESS_NEVER;
+    g_harness.woke_us = HARNESS_NEVER;
+
+    /* The controller's scan parameters until GapSetScanInterval() */
+    g_harness.scan_interval = 10000;
+    g_harness.scan_window = 10000;
+}
+
+void HarnessSetUserKey(uint16_t index, uint16_t value)
+{
+    if(index < HARNESS_USER_KEY_COUNT)
+    {
+        g_harness.user_keys[index] = value;
+    }
+}
+
+void HarnessBoot(void)
+{
+    g_harness.boot_start_cycles = g_harness.stats.cycles;
+
+    AppPowerOnReset();
+    AppInit(sleep_state_cold_powerup);
+    appReturned();
+}
+
+void HarnessWarmBoot(int dormant)
+{
+    g_harness.sleep_requested = TRUE;
+    g_harness.requested_state = dormant ? sleep_state_dormant :
+                                          sleep_state_hibernate;
+    g_harness.requested_wake_us = HARNESS_NEVER;
+    g_harness.requested_pio_wake = FALSE;
+    appReturned();
+
+    wakeFromSleep();
+}
+
+void HarnessRun(uint64_t duration_us)
+{
+    uint64_t end_us = g_harness.now_us + duration_us;
+
+    for(;;)
+    {
+        uint16 timer = nextTimer();
+        uint64_t timer_us = timer < HARNESS_MAX_TIMERS ?
+                            g_harness.timers[timer].due_us : HARNESS_NEVER;
+        uint64_t adv_us = g_harness.advertising ?
+                          g_harness.next_adv_us : HARNESS_NEVER;
+        uint64_t lm_us = g_harness.lm_count != 0 ?
+                         g_harness.lm_queue[g_harness.lm_head].time_us :
+                         HARNESS_NEVER;
+        uint64_t report_us = g_harness.next_report_us;
+        uint64_t sync_us = g_harness.next_sync_us;
+        uint64_t low_us = g_harness.battery_low_us;
+        uint64_t uart_us = g_harness.uart_done_us;
+        uint64_t motion_us = g_harness.next_motion_us;
+        uint64_t next_us;
+
+        /* Nothing runs while the chip hibernates or is dormant, but a PIO
+         * edge can wake it
+         */
+        if(g_harness.hibernating)
+        {
+            next_us = g_harness.wake_us;
+            if(g_harness.pio_wake && motionListened() && motion_us < next_us)
+            {
+                next_us = motion_us;
+            }
+
+            if(next_us >= end_us)
+            {
+                break;
+            }
+
+            sleepUntil(next_us);
+            if(next_us == motion_us)
+            {
+                g_harness.stats.pio_wakes++;
+            }
+            wakeFromSleep();
+            continue;
+        }
+
+        next_us = timer_us;
+        if(adv_us < next_us)
+        {
+            next_us = adv_us;
+        }
+        if(lm_us < next_us)
+        {
+            next_us = lm_us;
+        }
+        if(report_us < next_us)
+        {
+            next_us = report_us;
+        }
+        if(sync_us < next_us)
+        {
+            next_us = sync_us;
+        }
+        if(low_us < next_us)
+        {
+            next_us = low_us;
+        }
+        if(uart_us < next_us)
+        {
+            next_us = uart_us;
+        }
+        if(motion_us < next_us)
+        {
+            next_us = motion_us;
+        }
+
+        if(next_us >= end_us)
+        {
+            break;
+        }
+
+        sleepUntil(next_us);
+
+        if(next_us == low_us)
+        {
+            raiseBatteryLow();
+        }
+        else if(next_us == motion_us)
+        {
+            deliverMotionPulse();
+        }
+        else if(next_us == lm_us)
+        {
+            deliverLmEvent();
+        }
+        else if(next_us == timer_us)
+        {
+            fireTimer(timer);
+        }
+        else if(next_us == uart_us)
+        {
+            uartSent();
+        }
+        else if(next_us == report_us)
+        {
+            deliverReport();
+        }
+        else if(next_us == sync_us)
+        {
+            deliverSyncReport();
+        }
+        else
+        {
+            runAdvertisingEvent();
+        }
+    }
+
+    sleepUntil(end_us);
+
+    if(g_harness.scanning)
+    {
+        chargeScan();
+    }
+}
+
+uint16_t HarnessGattRead(uint16_t handle, uint8_t *value, uint16_t *len)
+{
+    sys_status status = gattAccess(handle,
+                                   ATT_ACCESS_READ | ATT_ACCESS_PERMISSION,
+                                   NULL, 0);
+
+    if(*len > g_harness.gatt_rsp_len)
+    {
+        *len = g_harness.gatt_rsp_len;
+    }
+    memcpy(value, g_harness.gatt_rsp_value, *len);
+
+    return (uint16_t)status;
+}
+
+uint16_t HarnessGattWrite(uint16_t handle, const uint8_t *value,
+                          uint16_t len)
+{
+    uint8 data[HARNESS_GATT_VALUE_MAX];
+
+    if(len > HARNESS_GATT_VALUE_MAX)
+    {
+        return (uint16_t)gatt_status_invalid_length;
+    }
+    memcpy(data, value, len);
+
+    return (uint16_t)gattAccess(handle, ATT_ACCESS_WRITE |
+                                ATT_ACCESS_PERMISSION |
+                                ATT_ACCESS_WRITE_COMPLETE, data, len);
+}
+
+int HarnessConnect(void)
+{
+    LM_EVENT_T event;
+
+    if(!g_harness.advertising || !g_harness.connectable)
+    {
+        return 0;
+    }
+
+    g_harness.advertising = FALSE;
+    g_harness.connectable = FALSE;
+    g_harness.connected = TRUE;
+    g_harness.connect_us = g_harness.now_us;
+    g_harness.link_charged_us = g_harness.now_us;
+    g_harness.conn_interval = g_harness.central_interval;
+    g_harness.conn_latency = 0;
+    g_harness.stats.connections++;
+
+    memset(&event, 0, sizeof(event));
+    event.gatt_connect_cfm.result = sys_status_success;
+    event.gatt_connect_cfm.cid = HARNESS_GATT_CID;
+    callLmEvent(GATT_CONNECT_CFM, &event);
+
+    return 1;
+}
+
+void HarnessDisconnect(void)
+{
+    LM_EVENT_T event;
+
+    if(!g_harness.connected)
+    {
+        return;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.lm_ev_disconnect_complete.data.reason = 0x13;
+    linkDown();
+    callLmEvent(LM_EV_DISCONNECT_COMPLETE, &event);
+}
+
+void HarnessSetCentral(uint16_t conn_interval, int accept_updates)
+{
+    g_harness.central_interval = conn_interval ? conn_interval :
+                                 MODEL_CONN_DEFAULT_INTERVAL;
+    g_harness.central_accepts_updates = accept_updates != 0;
+}
+
+int HarnessConnected(void)
+{
+    return g_harness.connected;
+}
+
+uint64_t HarnessNow(void)
+{
+    return g_harness.now_us;
+}
+
+const HARNESS_STATS_T *HarnessStats(void)
+{
+    return &g_harness.stats;
+}
+
+const char *HarnessCallName(harness_call call)
+{
+    return call < harness_call_count ? g_call_names[call] : "?";
+}
+
+double HarnessChargeUas(const HARNESS_STATS_T *stats)
+{
+    return stats->cpu_uas + stats->radio_uas + stats->uart_uas +
+           stats->sleep_uas;
+}
+
+void HarnessSetAdvHook(harness_adv_hook hook, void *context)
+{
+    g_harness.adv_hook = hook;
+    g_harness.adv_hook_context = context;
+}
+
+void HarnessSetDebugEcho(int echo)
+{
+    g_harness.debug_echo = echo;
+}
+
+void HarnessSetUartHook(harness_uart_hook hook, void *context)
+{
+    g_harness.uart_hook = hook;
+    g_harness.uart_hook_context = context;
+}
+
+void HarnessSetNvmSize(uint16_t words)
+{
+    g_harness.nvm_words = words < HARNESS_NVM_MAX_WORDS ?
+                          words : HARNESS_NVM_MAX_WORDS;
+}
+
+void HarnessNvmLoad(uint16_t offset, const uint16_t *words, uint16_t count)
+{
+    if((uint32_t)offset + count <= g_harness.nvm_words)
+    {
+        memcpy(&g_harness.nvm[offset], words, count * sizeof(uint16));
+    }
+}
+
+uint32_t HarnessNvmWear(uint16_t offset)
+{
+    return offset < HARNESS_NVM_MAX_WORDS ? g_harness.nvm_wear[offset] : 0;
+}
+
+void HarnessNvmBrownOut(uint32_t words)
+{
+    g_harness.nvm_brown_out = words;
+}
+
+void HarnessSetBattery(uint16_t mv, double mv_per_hour)
+{
+    g_harness.battery_mv = mv;
+    g_harness.battery_set_us = g_harness.now_us;
+    g_harness.battery_mv_per_us = mv_per_hour / 3600e6;
+    g_harness.battery_low_us = HARNESS_NEVER;
+
+    if(mv < MODEL_BATTERY_LOW_MV)
+    {
+        g_harness.battery_low_us = g_harness.now_us;
+    }
+    else if(mv_per_hour > 0.0)
+    {
+        g_harness.battery_low_us = g_harness.now_us + (uint64_t)
+            ((mv - MODEL_BATTERY_LOW_MV) / g_harness.battery_mv_per_us);
+    }
+}
+
+void HarnessSetScanRequests(double probability)
+{
+    g_harness.scan_request_probability = probability;
+}
+
+void HarnessSetNeighbours(uint32_t count, uint32_t adv_interval_us)
+{
+    g_harness.neighbours = count;
+    g_harness.neighbour_interval_us = adv_interval_us != 0 ?
+        adv_interval_us : HARNESS_DEFAULT_NEIGHBOUR_INTERVAL_US;
+
+    if(g_harness.scanning)
+    {
+        scheduleNextReport(g_harness.now_us);
+    }
+}
+
+void HarnessSetSyncBeacon(const uint8_t *adv_data, uint8_t len,
+                          uint32_t interval_us, uint64_t phase_us)
+{
+    if(len > HARNESS_ADV_DATA_MAX || interval_us == 0)
+    {
+        len = 0;
+    }
+
+    if(len != 0)
+    {
+        memcpy(g_harness.sync_data, adv_data, len);
+    }
+    g_harness.sync_len = len;
+    g_harness.sync_interval_us = interval_us;
+    g_harness.sync_phase_us = phase_us;
+
+    scheduleNextSync(g_harness.now_us);
+}
+
+void HarnessSetMotion(uint8_t pio, uint64_t period_us, uint64_t move_us,
+                      uint32_t pulse_us)
+{
+    if(pio >= PIO_COUNT || pulse_us == 0)
+    {
+        period_us = 0;
+    }
+
+    g_harness.motion_pio = pio;
+    g_harness.motion_origin_us = g_harness.now_us;
+    g_harness.motion_period_us = period_us;
+    g_harness.motion_move_us = move_us < period_us ? move_us : period_us;
+    g_harness.motion_pulse_us = pulse_us;
+    g_harness.next_motion_us = nextMotionPulse(g_harness.now_us);
+}
+
+void HarnessSetClockDrift(double ppm)
+{
+    g_harness.clock_ppm = ppm;
+}
+
+void HarnessSetTemperature(int16_t celsius)
+{
+    g_harness.temperature = celsius;
+}
+
+/*============================================================================*
+ *  SDK Function Implementations
+ *============================================================================*/
+
+uint16 CSReadUserKey(uint16 index)
+{
+    chargeCycles(harness_call_user_key, MODEL_CYCLES_USER_KEY);
+
+    return index < HARNESS_USER_KEY_COUNT ? g_harness.user_keys[index] : 0;
+}
+
+void MemCopy(void *dst, const void *src, uint16 n)
+{
+    chargeCycles(harness_call_mem_copy,
+                 MODEL_CYCLES_MEM_COPY_BASE + n * MODEL_CYCLES_MEM_COPY_UNIT);
+
+    memmove(dst, src, n);
+}
+
+void MemSet(void *dst, uint16 value, uint16 n)
+{
+    chargeCycles(harness_call_mem_copy,
+                 MODEL_CYCLES_MEM_COPY_BASE + n * MODEL_CYCLES_MEM_COPY_UNIT);
+
+    memset(dst, value, n);
+}
+
+void GattInit(void)
+{
+    chargeCycles(harness_call_gatt_init, MODEL_CYCLES_GATT_INIT);
+}
+
+void GattAddDatabaseReq(uint16 db_length, uint16 *db)
+{
+    LM_EVENT_T event;
+
+    chargeCycles(harness_call_gatt_init, MODEL_CYCLES_GATT_ADD_DB_BASE +
+                 (uint64_t)db_length * MODEL_CYCLES_GATT_ADD_DB_WORD);
+
+    event.gatt_add_db_cfm.result = sys_status_success;
+    queueLmEvent(MODEL_GATT_ADD_DB_US, GATT_ADD_DB_CFM, &event);
+}
+
+void GattAccessRsp(uint16 cid, uint16 handle, sys_status rc,
+                   uint16 size_value, uint8 *value)
+{
+    chargeCycles(harness_call_gatt_access_rsp,
+                 MODEL_CYCLES_GATT_ACCESS_RSP);
+
+    if(size_value > HARNESS_GATT_VALUE_MAX)
+    {
+        size_value = HARNESS_GATT_VALUE_MAX;
+    }
+
+    g_harness.gatt_rsp_status = rc;
+    g_harness.gatt_rsp_len = rc == sys_status_success ? size_value : 0;
+    if(g_harness.gatt_rsp_len != 0)
+    {
+        memcpy(g_harness.gatt_rsp_value, value, size_value);
+    }
+}
+
+void GattConnectReq(TYPED_BD_ADDR_T *address, uint16 flags)
+{
+    chargeCycles(harness_call_gatt_connect, MODEL_CYCLES_GATT_CONNECT);
+
+    startAdvertising(TRUE);
+}
+
+void GattCancelConnectReq(void)
+{
+    LM_EVENT_T event;
+
+    chargeCycles(harness_call_gatt_connect, MODEL_CYCLES_GATT_CONNECT);
+
+    g_harness.advertising = FALSE;
+    g_harness.connectable = FALSE;
+
+    event.gatt_cancel_connect_cfm.result = sys_status_success;
+    queueLmEvent(0, GATT_CANCEL_CONNECT_CFM, &event);
+}
+
+void GattDisconnectReq(uint16 cid)
+{
+    LM_EVENT_T event;
+
+    chargeCycles(harness_call_gatt_connect, MODEL_CYCLES_GATT_CONNECT);
+
+    if(!g_harness.connected)
+    {
+        return;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.lm_ev_disconnect_complete.data.reason = 0x16;
+    queueLmEvent(MODEL_DISCONNECT_US, LM_EV_DISCONNECT_COMPLETE, &event);
+}
+
+ls_err GapSetMode(gap_role role, gap_mode_discover discover,
+                  gap_mode_connect connect, gap_mode_bond bond,
+                  gap_mode_security security)
+{
+    g_harness.mode_start_cycles = g_harness.stats.cycles;
+    chargeCycles(harness_call_gap_set_mode, MODEL_CYCLES_GAP_SET_MODE);
+
+    return ls_err_none;
+}
+
+ls_err GapSetAdvInterval(uint32 adv_interval_min, uint32 adv_interval_max)
+{
+    chargeCycles(harness_call_gap_set_adv_interval,
+                 MODEL_CYCLES_GAP_SET_ADV_INTVL);
+
+    if(adv_interval_min > adv_interval_max)
+    {
+        return ls_err_arg;
+    }
+
+    g_harness.adv_interval_min = adv_interval_min;
+    g_harness.adv_interval_max = adv_interval_max;
+
+    return ls_err_none;
+}
+
+ls_err GapSetAdvChanMask(uint8 channel_mask)
+{
+    chargeCycles(harness_call_gap_set_adv_chan_mask,
+                 MODEL_CYCLES_GAP_SET_ADV_CHAN);
+
+    if(channel_mask == 0 || (channel_mask & ~GAP_ADV_CHANNELS_ALL) != 0)
+    {
+        return ls_err_arg;
+    }
+
+    g_harness.adv_channels = channel_mask;
+
+    return ls_err_none;
+}
+
+ls_err GapSetScanInterval(uint32 scan_interval, uint32 scan_window)
+{
+    chargeCycles(harness_call_gap_set_scan_interval,
+                 MODEL_CYCLES_GAP_SET_SCAN_INTVL);
+
+    if(scan_window == 0 || scan_window > scan_interval)
+    {
+        return ls_err_arg;
+    }
+
+    if(g_harness.scanning)
+    {
+        chargeScan();
+    }
+
+    g_harness.scan_interval = scan_interval;
+    g_harness.scan_window = scan_window;
+
+    if(g_harness.scanning)
+    {
+        scheduleNextReport(g_harness.now_us);
+        scheduleNextSync(g_harness.now_us);
+    }
+
+    return ls_err_none;
+}
+
+ls_err LsStoreAdvScanData(uint8 len, uint8 *data, ad_src src)
+{
+    uint8 *buffer = g_harness.adv_data;
+    uint8 *used = &g_harness.adv_len;
+
+    chargeCycles(harness_call_store_adv_scan_data,
+                 MODEL_CYCLES_STORE_ADV_BASE +
+                 len * MODEL_CYCLES_STORE_ADV_OCTET);
+
+    if(src == ad_src_scan_rsp)
+    {
+        buffer = g_harness.scan_rsp_data;
+        used = &g_harness.scan_rsp_len;
+    }
+
+    if(len == 0)
+    {
+        *used = 0;
+        return ls_err_none;
+    }
+
+    /* The stack prefixes the AD structure with its length */
+    if(data == NULL || *used + len + 1 > HARNESS_ADV_DATA_MAX)
+    {
+        return ls_err_arg;
+    }
+
+    buffer[(*used)++] = len;
+    memcpy(buffer + *used, data, len);
+    *used += len;
+
+    return ls_err_none;
+}
+
+ls_err LsSetTransmitPowerLevel(uint8 power_level)
+{
+    chargeCycles(harness_call_set_tx_power, MODEL_CYCLES_SET_TX_POWER);
+
+    if(power_level > 7)
+    {
+        return ls_err_arg;
+    }
+
+    g_harness.tx_power_level = power_level;
+
+    return ls_err_none;
+}
+
+ls_err LsStartStopAdvertise(bool start, whitelist_mode white_list,
+                            ls_addr_type addr_type)
+{
+    chargeCycles(harness_call_start_stop_advertise,
+                 MODEL_CYCLES_START_STOP_ADV);
+
+    if(start)
+    {
+        startAdvertising(FALSE);
+    }
+    else
+    {
+        g_harness.advertising = FALSE;
+        g_harness.connectable = FALSE;
+    }
+
+    return ls_err_none;
+}
+
+ls_err LsStartStopScan(bool start, whitelist_mode white_list,
+                       ls_addr_type addr_type)
+{
+    chargeCycles(harness_call_start_stop_scan, MODEL_CYCLES_START_STOP_SCAN);
+
+    if(!start)
+    {
+        scanDown();
+        return ls_err_none;
+    }
+
+    if(g_harness.scanning)
+    {
+        return ls_err_state;
+    }
+
+    g_harness.scanning = TRUE;
+    g_harness.scan_charged_us = g_harness.now_us;
+    scheduleNextReport(g_harness.now_us);
+    scheduleNextSync(g_harness.now_us);
+
+    return ls_err_none;
+}
+
+ls_err LsConnectionParamUpdateReq(TYPED_BD_ADDR_T *p_bd_addr,
+                                  ble_con_params *new_params)
+{
+    LM_EVENT_T event;
+
+    chargeCycles(harness_call_conn_param_update,
+                 MODEL_CYCLES_CONN_PARAM_UPDATE);
+
+    if(!g_harness.connected)
+    {
+        return ls_err_state;
+    }
+    if(new_params->con_min_interval > new_params->con_max_interval)
+    {
+        return ls_err_arg;
+    }
+
+    g_harness.stats.conn_param_requests++;
+
+    memset(&event, 0, sizeof(event));
+    event.ls_connection_param_update_cfm.address = *p_bd_addr;
+    event.ls_connection_param_update_cfm.status =
+        g_harness.central_accepts_updates ? sys_status_success :
+                                            sys_status_failed;
+    queueLmEvent(MODEL_CONN_PARAM_RSP_US, LS_CONNECTION_PARAM_UPDATE_CFM,
+                 &event);
+
+    /* The central picks the longest interval it was offered */
+    if(g_harness.central_accepts_updates)
+    {
+        memset(&event, 0, sizeof(event));
+        event.lm_ev_connection_update.data.status = sys_status_success;
+        event.lm_ev_connection_update.data.conn_interval =
+            new_params->con_max_interval;
+        event.lm_ev_connection_update.data.conn_latency =
+            new_params->con_slave_latency;
+        event.lm_ev_connection_update.data.supervision_timeout =
+            new_params->con_super_timeout;
+        queueLmEvent(MODEL_CONN_PARAM_RSP_US + MODEL_CONN_UPDATE_US,
+                     LM_EV_CONNECTION_UPDATE, &event);
+    }
+
+    return ls_err_none;
+}
+
+void DebugInit(uint16 rx_threshold, debug_rx_callback rx_cb,
+               debug_tx_callback tx_cb)
+{
+    chargeCycles(harness_call_debug_init, MODEL_CYCLES_DEBUG_INIT);
+}
+
+void DebugWriteChar(char c)
+{
+    char string[2];
+
+    string[0] = c;
+    string[1] = '\0';
+    debugWrite(string);
+}
+
+void DebugWriteString(const char *string)
+{
+    debugWrite(string);
+}
+
+void DebugWriteUint8(uint8 val)
+{
+    char string[3];
+
+    snprintf(string, sizeof(string), "%02x", val);
+    debugWrite(string);
+}
+
+void DebugWriteUint16(uint16 val)
+{
+    char string[5];
+
+    snprintf(string, sizeof(string), "%04x", val);
+    debugWrite(string);
+}
+
+void DebugWriteUint32(uint32 val)
+{
+    char string[9];
+
+    snprintf(string, sizeof(string), "%08x", val);
+    debugWrite(string);
+}
+
+void UartInit(uart_data_in_fn rx_event_handler,
+              uart_data_out_fn tx_event_handler,
+              uint16 *rx_buffer, uint16 rx_buffer_size,
+              uint16 *tx_buffer, uint16 tx_buffer_size,
+              uart_data_unit data_unit)
+{
+    uint32 octets = UART_BUFFER_WORDS(tx_buffer_size) *
+                    (data_unit == uart_data_packed ? 2 : 1);
+
+    chargeCycles(harness_call_debug_init, MODEL_CYCLES_UART_INIT);
+
+    g_harness.uart_tx_handler = tx_event_handler;
+    g_harness.uart_tx_size = octets < HARNESS_UART_TX_MAX ?
+                             (uint16)octets : HARNESS_UART_TX_MAX;
+    g_harness.uart_tx_len = 0;
+    g_harness.uart_done_us = HARNESS_NEVER;
+}
+
+void UartEnable(bool enable)
+{
+    g_harness.uart_enabled = enable;
+}
+
+bool UartWrite(const void *p_data, uint16 length)
+{
+    const uint16 *words = (const uint16 *)p_data;
+    uint16 octets = length * 2;
+    uint64_t start_us;
+    uint16 i;
+
+    chargeCycles(harness_call_uart_write, MODEL_CYCLES_UART_WRITE_BASE +
+                 (uint64_t)length * MODEL_CYCLES_UART_WRITE_WORD);
+
+    if(!g_harness.uart_enabled ||
+       g_harness.uart_tx_len + octets > g_harness.uart_tx_size)
+    {
+        return FALSE;
+    }
+
+    /* packed, LSB first */
+    for(i = 0; i < length; i++)
+    {
+        g_harness.uart_tx[g_harness.uart_tx_len++] = (uint8)(words[i] & 0xFF);
+        g_harness.uart_tx[g_harness.uart_tx_len++] = (uint8)(words[i] >> 8);
+    }
+
+    start_us = g_harness.uart_done_us != HARNESS_NEVER ?
+               g_harness.uart_done_us : g_harness.now_us;
+    g_harness.uart_done_us = start_us +
+                             (uint64_t)octets * MODEL_UART_US_PER_CHAR;
+    g_harness.stats.uart_uas += (double)octets * MODEL_UART_US_PER_CHAR *
+                                MODEL_UART_ACTIVE_UA / 1e6;
+
+    return TRUE;
+}
+
+void TimerInit(uint16 num_timers, void *buffer)
+{
+    memset(g_harness.timers, 0, sizeof(g_harness.timers));
+    g_harness.num_timers = num_timers < HARNESS_MAX_TIMERS ?
+                           num_timers : HARNESS_MAX_TIMERS;
+}
+
+timer_id TimerCreate(uint32 time, bool is_relative,
+                     timer_callback_arg handler)
+{
+    uint16 i;
+
+    chargeCycles(harness_call_timer, MODEL_CYCLES_TIMER);
+
+    for(i = 0; i < g_harness.num_timers; i++)
+    {
+        if(!g_harness.timers[i].active)
+        {
+            g_harness.timers[i].active = TRUE;
+            g_harness.timers[i].handler = handler;
+            g_harness.timers[i].due_us = g_harness.now_us +
+                trueSpan(is_relative ? time : (uint32)(time - TimeGet32()));
+
+            return (timer_id)i;
+        }
+    }
+
+    return TIMER_INVALID;
+}
+
+bool TimerDelete(timer_id const id)
+{
+    chargeCycles(harness_call_timer, MODEL_CYCLES_TIMER);
+
+    if(id >= g_harness.num_timers || !g_harness.timers[id].active)
+    {
+        return FALSE;
+    }
+
+    g_harness.timers[id].active = FALSE;
+
+    return TRUE;
+}
+
+uint32 TimeGet32(void)
+{
+    return (uint32)(g_harness.now_us +
+                    (int64_t)((double)g_harness.now_us *
+                              g_harness.clock_ppm / 1e6));
+}
+
+void PioSetModes(uint32 pio_mask, pio_mode mode)
+{
+    chargeCycles(harness_call_pio, MODEL_CYCLES_PIO);
+}
+
+void PioSetDir(uint16 pio, bool dir)
+{
+    chargeCycles(harness_call_pio, MODEL_CYCLES_PIO);
+}
+
+void PioSetPullModes(uint32 pio_mask, pio_pull_mode pull_mode)
+{
+    chargeCycles(harness_call_pio, MODEL_CYCLES_PIO);
+}
+
+void PioSetEventMask(uint32 pio_mask, pio_event_mode mode)
+{
+    chargeCycles(harness_call_pio, MODEL_CYCLES_PIO);
+
+    g_harness.pio_rising &= ~pio_mask;
+    g_harness.pio_falling &= ~pio_mask;
+    if(mode == pio_event_mode_rising || mode == pio_event_mode_both)
+    {
+        g_harness.pio_rising |= pio_mask;
+    }
+    if(mode == pio_event_mode_falling || mode == pio_event_mode_both)
+    {
+        g_harness.pio_falling |= pio_mask;
+    }
+}
+
+bool PioGet(uint16 pio)
+{
+    chargeCycles(harness_call_pio, MODEL_CYCLES_PIO);
+
+    /* the accelerometer line is low between its pulses */
+    return FALSE;
+}
+
+uint16 BatteryReadVoltage(void)
+{
+    chargeCycles(harness_call_battery_read, MODEL_CYCLES_BATTERY_READ);
+
+    return batteryMv();
+}
+
+int16 ThermometerReadTemperature(void)
+{
+    chargeCycles(harness_call_temperature_read,
+                 MODEL_CYCLES_TEMPERATURE_READ);
+
+    return g_harness.temperature;
+}
+
+void AesEncrypt(const uint16 *key, const uint16 *in, uint16 *out)
+{
+    AES128_KEY_T expanded;
+    uint8_t octets[AES128_BLOCK_SIZE];
+    int i;
+
+    chargeCycles(harness_call_aes, MODEL_CYCLES_AES_ENCRYPT);
+
+    for(i = 0; i < AES_BLOCK_WORDS; i++)
+    {
+        octets[2 * i] = (uint8_t)(key[i] >> 8);
+        octets[2 * i + 1] = (uint8_t)key[i];
+    }
+    Aes128ExpandKey(&expanded, octets);
+
+    for(i = 0; i < AES_BLOCK_WORDS; i++)
+    {
+        octets[2 * i] = (uint8_t)(in[i] >> 8);
+        octets[2 * i + 1] = (uint8_t)in[i];
+    }
+    Aes128Encrypt(&expanded, octets, octets);
+
+    for(i = 0; i < AES_BLOCK_WORDS; i++)
+    {
+        out[i] = (uint16)((octets[2 * i] << 8) | octets[2 * i + 1]);
+    }
+}
+
+sys_status NvmConfigureI2cEeprom(void)
+{
+    chargeCycles(harness_call_nvm_read, MODEL_CYCLES_NVM_ACCESS);
+
+    g_harness.nvm_configured = TRUE;
+
+    return sys_status_success;
+}
+
+sys_status NvmDisable(void)
+{
+    return sys_status_success;
+}
+
+sys_status NvmRead(uint16 *buffer, uint16 length, uint16 offset)
+{
+    chargeCycles(harness_call_nvm_read, MODEL_CYCLES_NVM_ACCESS +
+                 (uint64_t)length * MODEL_CYCLES_NVM_WORD);
+
+    if(!g_harness.nvm_configured)
+    {
+        return nvm_status_not_configured;
+    }
+
+    if((uint32)offset + length > g_harness.nvm_words)
+    {
+        return nvm_status_invalid_offset;
+    }
+
+    memcpy(buffer, &g_harness.nvm[offset], length * sizeof(uint16));
+
+    return sys_status_success;
+}
+
+sys_status NvmWrite(uint16 *buffer, uint16 length, uint16 offset)
+{
+    uint16 i;
+
+    chargeCycles(harness_call_nvm_write, MODEL_CYCLES_NVM_ACCESS +
+                 MODEL_CYCLES_NVM_PAGE_WRITE +
+                 (uint64_t)length * MODEL_CYCLES_NVM_WORD);
+
+    if(!g_harness.nvm_configured)
+    {
+        return nvm_status_not_configured;
+    }
+
+    if((uint32)offset + length > g_harness.nvm_words)
+    {
+        return nvm_status_invalid_offset;
+    }
+
+    for(i = 0; i < length && g_harness.nvm_brown_out != 0; i++)
+    {
+        g_harness.nvm[offset + i] = buffer[i];
+        g_harness.nvm_wear[offset + i]++;
+        if(g_harness.nvm_brown_out != HARNESS_NVM_NO_BROWN_OUT)
+        {
+            g_harness.nvm_brown_out--;
+        }
+    }
+
+    g_harness.stats.nvm_writes++;
+    g_harness.stats.nvm_words_written += length;
+
+    return sys_status_success;
+}
+
+void SleepModeChange(sleep_mode mode)
+{
+}
+
+void SleepRequest(sleep_state new_state, bool pio_wake, uint32 *wakeup_time)
+{
+    chargeCycles(harness_call_sleep, MODEL_CYCLES_SLEEP_REQUEST);
+
+    if(new_state != sleep_state_hibernate && new_state != sleep_state_dormant)
+    {
+        return;
+    }
+
+    g_harness.sleep_requested = TRUE;
+    g_harness.requested_state = new_state;
+    g_harness.requested_wake_us = HARNESS_NEVER;
+    g_harness.requested_pio_wake = pio_wake ||
+                                   new_state == sleep_state_dormant;
+
+    if(new_state == sleep_state_hibernate && wakeup_time != NULL)
+    {
+        g_harness.requested_wake_us = g_harness.now_us +
+                                      (uint64_t)*wakeup_time * 1000000ULL;
+    }
+}
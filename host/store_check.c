@@ -0,0 +1,448 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      store_check.c
+ *
+ *  DESCRIPTION
+ *      Power failure check of the record store, beacon_store.c, on the
+ *      stand-in NVM.
+ *
+ *      store_check
+ *          for every record
+ *          - cuts the supply after each word of a write, at every slot of
+ *            the ring and on every lap of it, and checks that the latest
+ *            complete copy comes back after the reset, that the other
+ *            records are untouched and that the next write goes through;
+ *          - writes past the wrap of the 16-bit sequence numbers, reading
+ *            the record back after every write and tearing the writes
+ *            either side of the wrap;
+ *          and reads the store with a build whose configuration layout
+ *          version is bumped (store_check_next.c), which must ignore the
+ *          old copies of that record only and keep its own, while the
+ *          old build never takes a copy of the new layout.
+ *
+ *          The exit status is 1 if any copy read back is not the one
+ *          expected.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  Standard Header Files
+ *============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "harness.h"
+#include "app_common.h"
+#include "beacon_store.h"
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Largest record */
+#define CHECK_MAX_WORDS                 (STORE_COUNTERS_WORDS)
+
+/* Words a write of a record puts in NVM: the copy, its CRC and its
+ * sequence word
+ */
+#define CHECK_WRITE_WORDS(words)        ((words) + 2)
+
+/* Writes before each torn one; enough to go round the largest ring three
+ * times
+ */
+#define CHECK_TORN_LAPS                 (25)
+
+/* Writes of the wrap check: the sequence numbers, which skip 0x0000 and
+ * 0xFFFF, wrap after 65534 of them
+ */
+#define CHECK_SEQ_PERIOD                (65534UL)
+#define CHECK_WRAP_WRITES               (CHECK_SEQ_PERIOD + 1000)
+#define CHECK_WRAP_TEAR_SPAN            (4)
+
+/* Copy number meaning there should be no copy */
+#define CHECK_NONE                      (0)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* A build of the store */
+typedef struct
+{
+    const char *name;
+    void (*init)(void);
+    bool (*read)(store_record record, uint16 *words);
+    void (*write)(store_record record, const uint16 *words);
+} CHECK_BUILD_T;
+
+/*============================================================================*
+ *  External Function Prototypes
+ *============================================================================*/
+
+/* The store with the configuration layout version bumped */
+extern void StoreInitNext(void);
+extern bool StoreReadNext(store_record record, uint16 *words);
+extern void StoreWriteNext(store_record record, const uint16 *words);
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+static const uint8_t g_record_words[store_record_count] =
+{
+    STORE_CLOCK_WORDS, STORE_COUNTERS_WORDS, STORE_CONFIG_WORDS,
+    STORE_EID_COUNTER_WORDS
+};
+
+static const char * const g_record_names[store_record_count] =
+{
+    "clock", "counters", "config", "eid_counter"
+};
+
+static const CHECK_BUILD_T g_current =
+{
+    "current", StoreInit, StoreRead, StoreWrite
+};
+
+static const CHECK_BUILD_T g_next =
+{
+    "next", StoreInitNext, StoreReadNext, StoreWriteNext
+};
+
+static uint32_t g_checks;
+static uint32_t g_failures;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      makeCopy
+ *
+ *  DESCRIPTION
+ *      Fills in the contents of a numbered copy of a record, different
+ *      for every record and number.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void makeCopy(store_record record, uint32_t number, uint16 *words)
+{
+    uint8_t i;
+
+    for(i = 0; i < g_record_words[record]; i++)
+    {
+        uint32_t x = number * 0x9E3779B1u ^ ((uint32_t)record << 28) ^
+                     (i * 0x85EBCA6Bu);
+
+        x ^= x >> 15;
+        x *= 0x2C1B3C6Du;
+        x ^= x >> 12;
+        words[i] = (uint16)(x >> 16);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writeCopy
+ *
+ *  DESCRIPTION
+ *      Writes a numbered copy of a record with a build of the store,
+ *      cutting the supply after the given number of words.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void writeCopy(const CHECK_BUILD_T *build, store_record record,
+                      uint32_t number, uint32_t cut)
+{
+    uint16 words[CHECK_MAX_WORDS];
+
+    makeCopy(record, number, words);
+    HarnessNvmBrownOut(cut);
+    build->write(record, words);
+    HarnessNvmBrownOut(HARNESS_NVM_NO_BROWN_OUT);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      erase
+ *
+ *  DESCRIPTION
+ *      Starts again with an erased NVM and a store that has not looked at
+ *      it.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void erase(void)
+{
+    uint16 erased[NVM_SIZE_WORDS];
+
+    memset(erased, 0xFF, sizeof(erased));
+    HarnessReset(1);
+    HarnessSetNvmSize(NVM_SIZE_WORDS);
+    HarnessNvmLoad(0, erased, NVM_SIZE_WORDS);
+    StoreInit();
+    StoreInitNext();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      expectCopy
+ *
+ *  DESCRIPTION
+ *      Reads a record with a build of the store, as after a reset, and
+ *      checks that it is the numbered copy, or that there is none.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void expectCopy(const CHECK_BUILD_T *build, store_record record,
+                       uint32_t number, const char *what)
+{
+    uint16 got[CHECK_MAX_WORDS];
+    uint16 want[CHECK_MAX_WORDS];
+    bool found;
+
+    build->init();
+    found = build->read(record, got);
+    makeCopy(record, number, want);
+
+    g_checks++;
+    if(number == CHECK_NONE ? found :
+       !found || memcmp(got, want, g_record_words[record] * sizeof(uint16)))
+    {
+        if(g_failures++ < 20)
+        {
+            fprintf(stderr, "%s %s, %s: expected %s%u, got %s\n",
+                    build->name, g_record_names[record], what,
+                    number == CHECK_NONE ? "no copy" : "copy ",
+                    number == CHECK_NONE ? 0 : number,
+                    found ? "another copy" : "no copy");
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkTorn
+ *
+ *  DESCRIPTION
+ *      Tears a write of a record after every word, after every number of
+ *      whole writes up to CHECK_TORN_LAPS, with a copy of every other
+ *      record in place.
+ *
+ *  RETURNS
+ *      Number of torn writes.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t checkTorn(store_record record)
+{
+    uint32_t words = CHECK_WRITE_WORDS(g_record_words[record]);
+    uint32_t torn = 0;
+    uint32_t written;
+    uint32_t cut;
+    uint32_t i;
+    char what[64];
+
+    for(written = 0; written < CHECK_TORN_LAPS; written++)
+    {
+        for(cut = 0; cut <= words; cut++)
+        {
+            erase();
+            for(i = 0; i < store_record_count; i++)
+            {
+                if(i != record)
+                {
+                    writeCopy(&g_current, (store_record)i, 1,
+                              HARNESS_NVM_NO_BROWN_OUT);
+                }
+            }
+            for(i = 1; i <= written; i++)
+            {
+                writeCopy(&g_current, record, i, HARNESS_NVM_NO_BROWN_OUT);
+            }
+
+            writeCopy(&g_current, record, written + 1, cut);
+            torn++;
+
+            snprintf(what, sizeof(what), "write %u cut after %u words",
+                     written + 1, cut);
+            expectCopy(&g_current, record,
+                       cut == words ? written + 1 : written, what);
+            for(i = 0; i < store_record_count; i++)
+            {
+                if(i != record)
+                {
+                    expectCopy(&g_current, (store_record)i, 1, what);
+                }
+            }
+
+            /* the store carries on from the copy it found */
+            writeCopy(&g_current, record, written + 2,
+                      HARNESS_NVM_NO_BROWN_OUT);
+            snprintf(what, sizeof(what), "write after write %u cut after "
+                     "%u words", written + 1, cut);
+            expectCopy(&g_current, record, written + 2, what);
+        }
+    }
+
+    return torn;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkWrap
+ *
+ *  DESCRIPTION
+ *      Writes a record past the wrap of the sequence numbers, reading it
+ *      back after every write and tearing the writes near the wrap.
+ *
+ *  RETURNS
+ *      Number of writes.
+ *
+ *---------------------------------------------------------------------------*/
+static uint32_t checkWrap(store_record record)
+{
+    uint32_t words = CHECK_WRITE_WORDS(g_record_words[record]);
+    uint32_t number;
+    char what[64];
+
+    erase();
+
+    for(number = 1; number <= CHECK_WRAP_WRITES; number++)
+    {
+        uint32_t from_wrap = number % CHECK_SEQ_PERIOD;
+
+        if(from_wrap <= CHECK_WRAP_TEAR_SPAN ||
+           from_wrap >= CHECK_SEQ_PERIOD - CHECK_WRAP_TEAR_SPAN)
+        {
+            writeCopy(&g_current, record, number, number % words);
+            snprintf(what, sizeof(what), "write %u cut after %u words",
+                     number, number % words);
+            expectCopy(&g_current, record, number - 1, what);
+        }
+
+        writeCopy(&g_current, record, number, HARNESS_NVM_NO_BROWN_OUT);
+        if(number % 64 == 0 || from_wrap <= 2 * CHECK_WRAP_TEAR_SPAN ||
+           from_wrap >= CHECK_SEQ_PERIOD - 2 * CHECK_WRAP_TEAR_SPAN)
+        {
+            snprintf(what, sizeof(what), "write %u", number);
+            expectCopy(&g_current, record, number, what);
+        }
+    }
+
+    return CHECK_WRAP_WRITES;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      checkVersionBump
+ *
+ *  DESCRIPTION
+ *      Reads copies written by the current build with the build whose
+ *      configuration layout version is bumped, then has that build write
+ *      its own, tearing one of them, and reads them with both builds.
+ *
+ *  RETURNS
+ *      Nothing.
+ *
+ *---------------------------------------------------------------------------*/
+static void checkVersionBump(void)
+{
+    uint32_t words = CHECK_WRITE_WORDS(STORE_CONFIG_WORDS);
+    uint16 got[CHECK_MAX_WORDS];
+    uint16 old[CHECK_MAX_WORDS];
+    uint32_t number;
+    uint32_t i;
+    bool found;
+
+    erase();
+    for(number = 1; number <= 3; number++)
+    {
+        for(i = 0; i < store_record_count; i++)
+        {
+            writeCopy(&g_current, (store_record)i, number,
+                      HARNESS_NVM_NO_BROWN_OUT);
+        }
+    }
+
+    /* the new build drops the old layout of the bumped record only */
+    for(i = 0; i < store_record_count; i++)
+    {
+        expectCopy(&g_next, (store_record)i,
+                   i == store_record_config ? CHECK_NONE : 3,
+                   "after the version bump");
+    }
+
+    writeCopy(&g_next, store_record_config, 10, HARNESS_NVM_NO_BROWN_OUT);
+    expectCopy(&g_next, store_record_config, 10, "first copy of the new "
+               "layout");
+    writeCopy(&g_next, store_record_config, 11, words / 2);
+    expectCopy(&g_next, store_record_config, 10, "torn copy of the new "
+               "layout");
+    writeCopy(&g_next, store_record_config, 12, HARNESS_NVM_NO_BROWN_OUT);
+    expectCopy(&g_next, store_record_config, 12, "after the torn copy");
+
+    /* the old build may fall back to an old copy, never a new one */
+    StoreInit();
+    found = StoreRead(store_record_config, got);
+    g_checks++;
+    for(number = 1; found && number <= 3; number++)
+    {
+        makeCopy(store_record_config, number, old);
+        if(memcmp(got, old, sizeof(uint16) * STORE_CONFIG_WORDS) == 0)
+        {
+            break;
+        }
+    }
+    if(found && number > 3)
+    {
+        g_failures++;
+        fprintf(stderr, "current config: read a copy of the new layout\n");
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+int main(int argc, char *argv[])
+{
+    uint32_t torn = 0;
+    uint32_t wrap = 0;
+    uint32_t i;
+
+    if(argc != 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    for(i = 0; i < store_record_count; i++)
+    {
+        torn += checkTorn((store_record)i);
+        wrap += checkWrap((store_record)i);
+    }
+    checkVersionBump();
+
+    printf("torn writes                         : %u\n", torn);
+    printf("writes across the sequence wrap     : %u\n", wrap);
+    printf("copies read back                    : %u\n", g_checks);
+    printf("wrong copies                        : %u\n", g_failures);
+
+    return g_failures != 0;
+}
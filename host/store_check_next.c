@@ -0,0 +1,21 @@
+/******************************************************************************
+ *  Copyright (C) Cambridge Silicon Radio Limited 2013
+ *
+ *  FILE
+ *      store_check_next.c
+ *
+ *  DESCRIPTION
+ *      The record store as a later firmware would build it, with the
+ *      layout version of the configuration record bumped, for the store
+ *      check. Its public functions end in Next so that it links beside
+ *      the store the application uses.
+ *
+ *****************************************************************************/
+
+#define STORE_CONFIG_VERSION            (2)
+
+#define StoreInit                       StoreInitNext
+#define StoreRead                       StoreReadNext
+#define StoreWrite                      StoreWriteNext
+
+#include "beacon_store.c"
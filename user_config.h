@@ -44,4 +44,130 @@
 /* Beacon TX power */
 #define BEACON_DEFAULT_TX_POWER (-74)
 
+/* &TX_POWER_LEVEL at which the beacon TX power (default or user key 3) was
+ * measured. The advertised TX power follows the battery ladder tiers from
+ * this reference.
+ */
+#define BEACON_TX_POWER_REFERENCE_LEVEL (0)
+
+/* Scan response, served to active scanners when bit 1 of user key 7 is
+ * set; the advert itself stays the bare frame. A name longer than the
+ * scan response holds (19 octets) is sent shortened; it must not be
+ * longer than DEVICE_NAME_MAX_LENGTH.
+ */
+#define BEACON_DEVICE_NAME      "CSR Beacon"
+#define BEACON_APPEARANCE       (0x0200)    /* Generic Tag */
+#define BEACON_FIRMWARE_VERSION (0x0100)    /* major.minor, one octet each */
+
+/* Eddystone-URL: the URL scheme prefix code and the URL, with the expansion
+ * codes of the Eddystone-URL specification (0x07 is ".com"), here for
+ * https://csr.com
+ */
+#define EDDYSTONE_URL_SCHEME    (0x03)
+#define EDDYSTONE_URL_INIT      'c', 's', 'r', 0x07
+#define EDDYSTONE_URL_LENGTH    (4)
+
+/* Frame rotation weights: the number of rotation periods each frame type is
+ * put on air for in every rotation cycle, 0 to 15. Zero leaves the frame
+ * type out. Overridden by user key 4.
+ */
+#define BEACON_ROTATION_IBEACON_WEIGHT          (1)
+#define BEACON_ROTATION_EDDYSTONE_UID_WEIGHT    (0)
+#define BEACON_ROTATION_EDDYSTONE_URL_WEIGHT    (0)
+#define BEACON_ROTATION_EDDYSTONE_TLM_WEIGHT    (0)
+
+/* Time each frame stays on air before the next is swapped in */
+#define BEACON_ROTATION_PERIOD  (1 * SECOND)
+
+/* Time between samples of the battery voltage and die temperature sent in
+ * the Eddystone-TLM frame. The sensors are not read unless the frame is
+ * in the rotation.
+ */
+#define BEACON_TLM_SAMPLE_PERIOD        (5 * MINUTE)
+
+/* Advertising schedule: the windows of the day in which the beacon
+ * advertises, as { open, close } in minutes since midnight; a window may
+ * run past midnight. The schedule only runs once user key 5 gives the time
+ * of day at power-up. User key 6 replaces the windows with a single one.
+ */
+#define BEACON_SCHEDULE_WINDOWS { { 8 * 60, 18 * 60 } }
+
+/* Shortest time between snapshots of the runtime counters to NVM. The
+ * snapshot is taken on the first wake-up after this time, never on a
+ * wake-up of its own.
+ */
+#define BEACON_COUNTERS_SNAPSHOT_PERIOD (60 * MINUTE)
+
+/* Configuration over GATT: the beacon advertises connectable for
+ * BEACON_CONFIG_WINDOW after power-up and then every BEACON_CONFIG_PERIOD
+ * (zero for after power-up only; a zero window keeps the beacon
+ * non-connectable). The first BEACON_CONFIG_FAST_TIME of a window
+ * advertises at the fast connection interval of gap_conn_params.h and the
+ * rest at the reduced power one. A connection may last at most
+ * BEACON_CONFIG_CONNECTION_TIME and can only write once it has sent the
+ * device's passcode, from USER_KEY8 and USER_KEY9. Each window gives the
+ * passcode BEACON_CONFIG_PASSCODE_ATTEMPTS tries, shared by all of its
+ * connections.
+ */
+#define BEACON_CONFIG_WINDOW            (30 * SECOND)
+#define BEACON_CONFIG_FAST_TIME         (10 * SECOND)
+#define BEACON_CONFIG_PERIOD            (5 * MINUTE)
+#define BEACON_CONFIG_CONNECTION_TIME   (2 * MINUTE)
+#define BEACON_CONFIG_PASSCODE_ATTEMPTS (3)
+
+/* Time a client is left at the connection parameters it chose before the
+ * beacon asks for the preferred ones of gap_conn_params.h, and between
+ * requests
+ */
+#define BEACON_CONN_PARAM_UPDATE_DELAY  (5 * SECOND)
+
+/* Ephemeral IDs, turned on by bit 0 of user key 7: the major, minor and
+ * Eddystone-EID identifier change every BEACON_EID_PERIOD. IDs are worked
+ * out BEACON_EID_BATCH_SIZE at a time, a power of two, and the counter is
+ * saved to NVM once per batch.
+ */
+#define BEACON_EID_PERIOD               (15 * MINUTE)
+#define BEACON_EID_BATCH_SIZE           (16)
+
+/* Scanning, for the census and slotted advertising: the controller listens
+ * for BEACON_SCAN_WINDOW of every BEACON_SCAN_INTERVAL in the gaps between
+ * the beacon's own advertising events
+ */
+#define BEACON_SCAN_INTERVAL            (100 * MILLISECOND)
+#define BEACON_SCAN_WINDOW              (90 * MILLISECOND)
+
+/* Neighbourhood census, turned on by bit 5 of user key 7: every
+ * BEACON_CENSUS_PERIOD the beacon scans for BEACON_CENSUS_WINDOW and
+ * estimates how many distinct advertisers it heard. The estimate is sent
+ * with the Eddystone-TLM frame. A window longer than the neighbours'
+ * advertising interval hears most of them; every microsecond of it costs
+ * receive current.
+ */
+#define BEACON_CENSUS_PERIOD            (5 * MINUTE)
+#define BEACON_CENSUS_WINDOW            (1200 * MILLISECOND)
+
+/* Slotted advertising, turned on by bits 6 and 7 of user key 7: time is cut
+ * into frames of BEACON_SLOT_FRAME, each of BEACON_SLOT_COUNT slots, kept
+ * in step by a sync beacon advertising at the start of every frame. Every
+ * other beacon advertises at the start of a slot of its own, picked by its
+ * minor, so a slot must outlast an advertising event. Beacons listen for
+ * the sync beacon every BEACON_SLOT_SYNC_PERIOD, for
+ * BEACON_SLOT_ACQUIRE_WINDOW until they know when it will be heard and for
+ * a few milliseconds around that time after.
+ */
+#define BEACON_SLOT_FRAME               (60 * MILLISECOND)
+#define BEACON_SLOT_COUNT               (24)
+#define BEACON_SLOT_SYNC_PERIOD         (1 * MINUTE)
+#define BEACON_SLOT_ACQUIRE_WINDOW      (150 * MILLISECOND)
+
+/* Motion-triggered advertising, turned on by bits 8 to 11 of user key 7
+ * naming the PIO an accelerometer interrupt is wired to: the beacon
+ * advertises at the battery ladder interval while the asset moves and for
+ * BEACON_MOTION_HOLD_OFF after the last interrupt, then at
+ * BEACON_MOTION_STILL_INTERVAL until it moves again. Bit 12 makes it stop
+ * advertising and hibernate until the next interrupt instead.
+ */
+#define BEACON_MOTION_HOLD_OFF          (2 * MINUTE)
+#define BEACON_MOTION_STILL_INTERVAL    (10 * SECOND)
+
 #endif /* __USER_CONFIG_H__ */